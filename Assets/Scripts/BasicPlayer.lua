@@ -4,17 +4,35 @@ require "math"
 local playerSize = {}
 local playerDirection = {x=0,y=0,z=1}
 
+-- animation graph handles, the graph itself lives in Animations/BasicPlayer.json
+local movingParameter = 0
+local sprintingParameter = 0
+local jumpParameter = 0
+local jumpState = 0
+
+-- resolved once in init so the per frame calls don't pass strings around
+local mainCamera = 0
+local shadowCamera = 0
+
 BasicPlayer_init = function(id)
 	-- Create a player and it's controler attahced to the mesh instance.
 	local playerPosition = {x=0,y=0,z=0}
 	TempestEngine_createPlayerInstance(id, playerPosition, playerDirection)
 	TempestEngine_createControllerInstance(id, 0)
 
+	mainCamera = TempestEngine_getCameraHandle("MainCamera")
+	shadowCamera = TempestEngine_getCameraHandle("ShadowCamera")
+
 	-- Attach the main camera to the player
-	TempestEngine_attachCameraToPlayer(id, "MainCamera", 5.0)
-	TempestEngine_attachShadowCameraToPlayer(id, "ShadowCamera")
+	TempestEngine_attachCameraHandleToPlayer(id, mainCamera, 5.0)
+	TempestEngine_attachShadowCameraHandleToPlayer(id, shadowCamera)
 
 	playerSize = TempestEngine_getInstanceSize(id)
+
+	movingParameter = TempestEngine_getAnimationParameterHandle(id, "Moving")
+	sprintingParameter = TempestEngine_getAnimationParameterHandle(id, "Sprinting")
+	jumpParameter = TempestEngine_getAnimationParameterHandle(id, "Jump")
+	jumpState = TempestEngine_getAnimationStateHandle(id, "Jump")
 end
 
 vector3_add = function(v1, v2)
@@ -50,25 +68,12 @@ vector3_angle = function(v1, v2)
 	return math.acos(vector3_dot(v1, v2))
 end
 
-local State = {Resting = 1, Walking = 2, Sprinting = 3, Jumping = 4 }       -- player states
-local currentState = State.Resting
-local timeout = 0
-
--- animation names
-local kWalkingAnimation = "Armature|Armature|Armature|Walk|Armature|Walk"
-local kSprintAnimation = "Armature|Armature|mixamo.com|Layer0"
-local kJumpAnimation = "Armature|Armature|mixamo.com|Layer1"
-
 BasicPlayer = function(id, tick)
 
 	TempestEngine_startInstanceFrame(id)
 
-	if timeout > 0 then
-		timeout = timeout - 1
-	end
-
-	-- update the controller
-	local controller = TempestEngine_updateControllerInstance(id)
+	-- sampled by the engine once a frame, this is just a read only view
+	local controller = TempestEngine_getControllerForInstance(id)
 	
 	local sprinting = controller.LShft;
 	local speedModifier = 0.02
@@ -80,10 +85,10 @@ BasicPlayer = function(id, tick)
     local moving = (x ~= 0.0 or z ~= 0.0);
 
     if moving then
-    	local camDir = TempestEngine_getCameraDirectionByName("MainCamera")
+    	local camDir = TempestEngine_getCameraDirection(mainCamera)
     	camDir.y = 0
     	camDir = vector3_normalize(camDir)
-    	local camRight = TempestEngine_getCameraRightByName("MainCamera")
+    	local camRight = TempestEngine_getCameraRight(mainCamera)
 
     	local trans = vector3_add(vector3_mul(camDir, -z), vector3_mul(camRight, x))
     	TempestEngine_translateInstance(id, trans)
@@ -103,42 +108,13 @@ BasicPlayer = function(id, tick)
     TempestEngine_updatePlayersAttachedCameras(id)
 
     -- update animation state
-  	if (timeout == 0 and currentState == State.Jumping) then
-        currentState = State.Resting;
-    end
-
-    if moving and sprinting and currentState == State.Resting then
-        TempestEngine_startAnimation(id, kSprintAnimation, true, 1.0)
-        currentState = State.Sprinting
-    elseif moving and sprinting and currentState == State.Walking then
-        TempestEngine_terminateAnimation(id, kWalkingAnimation)
-        TempestEngine_startAnimation(id, kSprintAnimation, true, 1.0)
-        currentState = State.Sprinting
-    elseif ((currentState == State.Resting or currentState == State.Sprinting) and moving and not sprinting) then
-        if currentState == State.Sprinting then
-            TempestEngine_terminateAnimation(id, kSprintAnimation)
-        end
-        TempestEngine_startAnimation(id, kWalkingAnimation, true, 0.5)
-        currentState = State.Walking
-    elseif ((currentState == State.Walking or currentState == State.Sprinting) and not moving) then
-        TempestEngine_terminateAnimation(id, kWalkingAnimation)
-        TempestEngine_terminateAnimation(id, kSprintAnimation)
-        currentState = State.Resting;
-    end
-
-    if (controller.X and currentState ~= State.Jumping) then
-        if (currentState == Walking or currentState == State.Sprinting) then
-            TempestEngine_terminateAnimation(id, kWalkingAnimation)
-            TempestEngine_terminateAnimation(id, kSprintAnimation)
-        end
-
-        currentState = State.Jumping;
-
-        TempestEngine_startAnimation(id, kJumpAnimation, false, 1.0);
+    TempestEngine_setAnimationIntParameter(id, movingParameter, moving and 1 or 0)
+    TempestEngine_setAnimationIntParameter(id, sprintingParameter, sprinting and 1 or 0)
 
+    local jumping = controller.X and TempestEngine_getCurrentAnimationState(id) ~= jumpState
+    TempestEngine_setAnimationIntParameter(id, jumpParameter, jumping and 1 or 0)
+    if jumping then
         TempestEngine_applyImpulseToInstance(id, {x=0.0, y=400.0, z=0.0});
-
-        timeout = 80;
     end
 
-end
\ No newline at end of file
+end
@@ -0,0 +1,255 @@
+#include "AnimationGraph.hpp"
+
+#include "Core/BellLogging.hpp"
+
+#include "json/json.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace Tempest
+{
+
+namespace
+{
+    AnimationGraph::ConditionOp parseConditionOp(const std::string& op)
+    {
+        if(op == "<")
+            return AnimationGraph::ConditionOp::Less;
+        else if(op == "<=")
+            return AnimationGraph::ConditionOp::LessEqual;
+        else if(op == ">")
+            return AnimationGraph::ConditionOp::Greater;
+        else if(op == ">=")
+            return AnimationGraph::ConditionOp::GreaterEqual;
+        else if(op == "==")
+            return AnimationGraph::ConditionOp::Equal;
+        else if(op == "!=")
+            return AnimationGraph::ConditionOp::NotEqual;
+
+        BELL_LOG_ARGS("Unknown animation condition %s", op.c_str());
+        BELL_TRAP;
+
+        return AnimationGraph::ConditionOp::Equal;
+    }
+}
+
+
+AnimationGraph::AnimationGraph(const std::filesystem::path& path) :
+    mEntryState{0}
+{
+    std::ifstream graphFile;
+    graphFile.open(path);
+    BELL_ASSERT(graphFile.is_open(), "Failed to open animation graph file")
+
+    Json::Value root;
+    graphFile >> root;
+
+    if(root.isMember("Parameters"))
+    {
+        const Json::Value& parameters = root["Parameters"];
+        for(const std::string& name : parameters.getMemberNames())
+        {
+            const Json::Value& entry = parameters[name];
+
+            Parameter parameter{};
+            parameter.mName = name;
+            parameter.mInteger = entry.isMember("Type") && entry["Type"].asString() == "Int";
+            parameter.mDefault = entry.isMember("Default") ? entry["Default"].asFloat() : 0.0f;
+
+            mParameters.push_back(parameter);
+        }
+    }
+
+    BELL_ASSERT(root.isMember("States"), "Animation graph requires states")
+    const Json::Value& states = root["States"];
+    for(const std::string& name : states.getMemberNames())
+    {
+        const Json::Value& entry = states[name];
+
+        State state{};
+        state.mName = name;
+        state.mClipName = entry.isMember("Clip") ? entry["Clip"].asString() : "";
+        state.mClip = getAnimationClipHandle(state.mClipName);
+        state.mLoop = entry.isMember("Loop") ? entry["Loop"].asBool() : true;
+        state.mSpeed = entry.isMember("Speed") ? entry["Speed"].asFloat() : 1.0f;
+
+        mStates.push_back(state);
+    }
+    mTransitions.resize(mStates.size());
+
+    if(root.isMember("Entry"))
+    {
+        mEntryState = getStateHandle(root["Entry"].asString());
+        BELL_ASSERT(mEntryState != kInvalidAnimationState, "Entry state doesn't exist")
+    }
+
+    if(root.isMember("Transitions"))
+    {
+        const Json::Value& transitions = root["Transitions"];
+        BELL_ASSERT(transitions.isArray(), "Transitions not correct format")
+        for(uint32_t i = 0; i < transitions.size(); ++i)
+        {
+            const Json::Value& entry = transitions[i];
+            BELL_ASSERT(entry.isMember("From") && entry.isMember("To"), "Fields required for transition")
+
+            Transition transition{};
+            transition.mTo = getStateHandle(entry["To"].asString());
+            BELL_ASSERT(transition.mTo != kInvalidAnimationState, "Transition to unknown state")
+            transition.mBlendTime = entry.isMember("Blend") ? entry["Blend"].asFloat() : 0.0f;
+            transition.mExitTime = entry.isMember("ExitTime") ? entry["ExitTime"].asFloat() : -1.0f;
+
+            if(entry.isMember("Conditions"))
+            {
+                // Each condition is ["Parameter", "op", value]
+                const Json::Value& conditions = entry["Conditions"];
+                for(uint32_t c = 0; c < conditions.size(); ++c)
+                {
+                    const Json::Value& conditionEntry = conditions[c];
+                    BELL_ASSERT(conditionEntry.isArray() && conditionEntry.size() == 3, "Condition not correct format")
+
+                    Condition condition{};
+                    condition.mParameter = getParameterHandle(conditionEntry[0].asString());
+                    BELL_ASSERT(condition.mParameter != kInvalidAnimationParameter, "Condition uses unknown parameter")
+                    condition.mOp = parseConditionOp(conditionEntry[1].asString());
+                    condition.mValue = conditionEntry[2].asFloat();
+
+                    transition.mConditions.push_back(condition);
+                }
+            }
+
+            const std::string from = entry["From"].asString();
+            if(from == "Any")
+                mAnyStateTransitions.push_back(transition);
+            else
+            {
+                const AnimationStateHandle fromState = getStateHandle(from);
+                BELL_ASSERT(fromState != kInvalidAnimationState, "Transition from unknown state")
+                mTransitions[fromState].push_back(transition);
+            }
+        }
+    }
+}
+
+
+AnimationParameterHandle AnimationGraph::getParameterHandle(const std::string& name) const
+{
+    auto it = std::find_if(mParameters.begin(), mParameters.end(), [&](const Parameter& p) { return p.mName == name; });
+    if(it != mParameters.end())
+        return static_cast<AnimationParameterHandle>(std::distance(mParameters.begin(), it));
+
+    return kInvalidAnimationParameter;
+}
+
+
+AnimationStateHandle AnimationGraph::getStateHandle(const std::string& name) const
+{
+    auto it = std::find_if(mStates.begin(), mStates.end(), [&](const State& s) { return s.mName == name; });
+    if(it != mStates.end())
+        return static_cast<AnimationStateHandle>(std::distance(mStates.begin(), it));
+
+    return kInvalidAnimationState;
+}
+
+
+AnimationGraphInstance::AnimationGraphInstance(const AnimationGraph* graph) :
+    mGraph(graph),
+    mCurrentState(graph->getEntryState()),
+    mTimeInState(0.0f),
+    mBlendTime(0.0f)
+{
+    const std::vector<AnimationGraph::Parameter>& parameters = mGraph->getParameters();
+    mParameters.reserve(parameters.size());
+    for(const auto& parameter : parameters)
+        mParameters.push_back(parameter.mDefault);
+}
+
+
+void AnimationGraphInstance::setParameter(const AnimationParameterHandle parameter, const float value)
+{
+    if(parameter < mParameters.size())
+        mParameters[parameter] = value;
+}
+
+
+bool AnimationGraphInstance::update(const float delta)
+{
+    mTimeInState += delta;
+
+    const AnimationGraph::Transition* taken = nullptr;
+    for(const auto& transition : mGraph->getAnyStateTransitions())
+    {
+        if(transition.mTo != mCurrentState && conditionsMet(transition))
+        {
+            taken = &transition;
+            break;
+        }
+    }
+
+    if(!taken)
+    {
+        for(const auto& transition : mGraph->getTransitions(mCurrentState))
+        {
+            if(conditionsMet(transition))
+            {
+                taken = &transition;
+                break;
+            }
+        }
+    }
+
+    if(!taken)
+        return false;
+
+    mCurrentState = taken->mTo;
+    mTimeInState = 0.0f;
+    mBlendTime = taken->mBlendTime;
+
+    return true;
+}
+
+
+bool AnimationGraphInstance::conditionsMet(const AnimationGraph::Transition& transition) const
+{
+    if(transition.mExitTime >= 0.0f && mTimeInState < transition.mExitTime)
+        return false;
+
+    for(const auto& condition : transition.mConditions)
+    {
+        const float value = mParameters[condition.mParameter];
+        bool met = false;
+        switch(condition.mOp)
+        {
+            case AnimationGraph::ConditionOp::Less:
+                met = value < condition.mValue;
+                break;
+
+            case AnimationGraph::ConditionOp::LessEqual:
+                met = value <= condition.mValue;
+                break;
+
+            case AnimationGraph::ConditionOp::Greater:
+                met = value > condition.mValue;
+                break;
+
+            case AnimationGraph::ConditionOp::GreaterEqual:
+                met = value >= condition.mValue;
+                break;
+
+            case AnimationGraph::ConditionOp::Equal:
+                met = value == condition.mValue;
+                break;
+
+            case AnimationGraph::ConditionOp::NotEqual:
+                met = value != condition.mValue;
+                break;
+        }
+
+        if(!met)
+            return false;
+    }
+
+    return true;
+}
+
+}
@@ -0,0 +1,156 @@
+#ifndef TEMPEST_ANIMATION_GRAPH_HPP
+#define TEMPEST_ANIMATION_GRAPH_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace Tempest
+{
+
+using AnimationClipHandle = uint64_t;
+using AnimationParameterHandle = uint32_t;
+using AnimationStateHandle = uint32_t;
+
+static constexpr AnimationClipHandle kInvalidAnimationClip = 0;
+static constexpr AnimationParameterHandle kInvalidAnimationParameter = std::numeric_limits<uint32_t>::max();
+static constexpr AnimationStateHandle kInvalidAnimationState = std::numeric_limits<uint32_t>::max();
+
+inline AnimationClipHandle getAnimationClipHandle(const std::string& clipName)
+{
+    if(clipName.empty())
+        return kInvalidAnimationClip;
+
+    return std::hash<std::string>{}(clipName);
+}
+
+// States, transitions and parameters for a mesh, shared between all of its instances.
+class AnimationGraph
+{
+public:
+    AnimationGraph(const std::filesystem::path& path);
+    ~AnimationGraph() = default;
+
+    struct State
+    {
+        std::string mName;
+        std::string mClipName;
+        AnimationClipHandle mClip;
+        bool mLoop;
+        float mSpeed;
+    };
+
+    enum class ConditionOp
+    {
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        Equal,
+        NotEqual
+    };
+
+    struct Condition
+    {
+        AnimationParameterHandle mParameter;
+        ConditionOp mOp;
+        float mValue;
+    };
+
+    struct Transition
+    {
+        AnimationStateHandle mTo;
+        float mBlendTime;
+        // Time in the source state before the transition can be taken, negative for none.
+        float mExitTime;
+        std::vector<Condition> mConditions;
+    };
+
+    struct Parameter
+    {
+        std::string mName;
+        bool mInteger;
+        float mDefault;
+    };
+
+    AnimationParameterHandle getParameterHandle(const std::string&) const;
+    AnimationStateHandle getStateHandle(const std::string&) const;
+
+    const State& getState(const AnimationStateHandle state) const
+    {
+        return mStates[state];
+    }
+
+    const std::vector<Parameter>& getParameters() const
+    {
+        return mParameters;
+    }
+
+    const std::vector<Transition>& getTransitions(const AnimationStateHandle state) const
+    {
+        return mTransitions[state];
+    }
+
+    const std::vector<Transition>& getAnyStateTransitions() const
+    {
+        return mAnyStateTransitions;
+    }
+
+    AnimationStateHandle getEntryState() const
+    {
+        return mEntryState;
+    }
+
+private:
+
+    std::vector<State> mStates;
+    std::vector<std::vector<Transition>> mTransitions;
+    std::vector<Transition> mAnyStateTransitions;
+    std::vector<Parameter> mParameters;
+    AnimationStateHandle mEntryState;
+};
+
+
+class AnimationGraphInstance
+{
+public:
+    AnimationGraphInstance(const AnimationGraph*);
+
+    void setParameter(const AnimationParameterHandle, const float);
+
+    // Returns true if a transition was taken.
+    bool update(const float delta);
+
+    const AnimationGraph* getGraph() const
+    {
+        return mGraph;
+    }
+
+    AnimationStateHandle getCurrentState() const
+    {
+        return mCurrentState;
+    }
+
+    // Blend time of the transition that entered the current state.
+    float getBlendTime() const
+    {
+        return mBlendTime;
+    }
+
+private:
+
+    bool conditionsMet(const AnimationGraph::Transition&) const;
+
+    const AnimationGraph* mGraph;
+    AnimationStateHandle mCurrentState;
+    float mTimeInState;
+    float mBlendTime;
+    std::vector<float> mParameters;
+};
+
+}
+
+#endif
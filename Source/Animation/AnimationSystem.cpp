@@ -0,0 +1,571 @@
+#include "AnimationSystem.hpp"
+#include "JobSystem.hpp"
+
+#include "Core/Profiling.hpp"
+#include "Engine/StaticMesh.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+namespace Tempest
+{
+
+namespace
+{
+    struct BoneTRS
+    {
+        float3 mTranslation;
+        quat mRotation;
+        float3 mScale;
+    };
+
+    BoneTRS decomposeBone(const float4x4& transform)
+    {
+        const float3 axes[3] = {float3(transform[0]), float3(transform[1]), float3(transform[2])};
+        float3 scale(glm::length(axes[0]), glm::length(axes[1]), glm::length(axes[2]));
+
+        // Mirrored bones, fold the reflection in to one axis so what's left is a rotation.
+        if(glm::dot(glm::cross(axes[0], axes[1]), axes[2]) < 0.0f)
+            scale.x = -scale.x;
+
+        glm::mat3 rotation(1.0f);
+        for(int i = 0; i < 3; ++i)
+        {
+            if(scale[i] != 0.0f)
+                rotation[i] = axes[i] / scale[i];
+        }
+
+        return {float3(transform[3]), glm::normalize(glm::quat_cast(rotation)), scale};
+    }
+
+    // Lerping the matrices directly shrinks and shears anything that rotates,
+    // so go through translation, rotation and scale instead.
+    float4x4 blendBones(const float4x4& from, const float4x4& to, const float t)
+    {
+        const BoneTRS a = decomposeBone(from);
+        const BoneTRS b = decomposeBone(to);
+
+        return glm::translate(float4x4(1.0f), glm::mix(a.mTranslation, b.mTranslation, t)) *
+               glm::mat4_cast(glm::slerp(a.mRotation, b.mRotation, t)) *
+               glm::scale(float4x4(1.0f), glm::mix(a.mScale, b.mScale, t));
+    }
+}
+
+
+AnimationSystem::AnimationSystem(JobSystem* jobs) :
+    mScene(nullptr),
+    mJobSystem(jobs),
+    mAnimationTime(0.0),
+    mLastDelta(0.0f),
+    mPoseQuantum(1.0 / 60.0),
+    mLODSettings{{{0.25f, 1, 1.0f},
+                  {0.1f, 2, 1.0f},
+                  {0.04f, 4, 0.5f},
+                  {0.0f, 8, 0.25f}}},
+    mStats{}
+{
+}
+
+
+void AnimationSystem::setScene(Scene* scene)
+{
+    mScene = scene;
+    mAnimationTime = 0.0;
+
+    mEntries.clear();
+    mEntryLookup.clear();
+    mEvaluations.clear();
+    mPoseBuffer.clear();
+    mFreePoseBlocks.clear();
+}
+
+
+void AnimationSystem::registerInstance(const InstanceID id)
+{
+    BELL_ASSERT(mScene, "No scene set")
+    if(isRegistered(id))
+        return;
+
+    MeshInstance* instance = mScene->getMeshInstance(id);
+    BELL_ASSERT(instance, "invalid mesh ID")
+
+    const StaticMesh* mesh = instance->getMesh();
+    const uint32_t boneCount = static_cast<uint32_t>(mesh->getSkeleton().size());
+    if(boneCount == 0)
+        return;
+
+    Entry entry{};
+    entry.mID = id;
+    entry.mInstance = instance;
+    entry.mMesh = mesh;
+    entry.mBoneCount = boneCount;
+    entry.mActiveBoneCount = boneCount;
+    entry.mBoundingRadius = glm::length(mesh->getAABB().getSideLengths() * instance->getScale()) * 0.5f;
+    entry.mClip = kInvalidAnimationClip;
+    entry.mClipStartTime = mAnimationTime;
+    entry.mClipSpeed = 1.0f;
+    entry.mClipLoop = false;
+    entry.mAnimated = false;
+    entry.mHasHistory = false;
+    entry.mBlendDuration = 0.0f;
+    entry.mBlendElapsed = 0.0f;
+    entry.mLOD = AnimationLOD::Full;
+    entry.mUpdateInterval = 1;
+    entry.mFramesSinceEvaluation = 0;
+
+    // Reuse the storage of a removed instance if there's a big enough block.
+    const uint32_t blockSize = boneCount * kPosesPerEntry;
+    auto it = std::find_if(mFreePoseBlocks.begin(), mFreePoseBlocks.end(), [=](const PoseBlock& block)
+    {
+        return block.mSize >= blockSize;
+    });
+    if(it != mFreePoseBlocks.end())
+    {
+        entry.mPoseOffset = it->mOffset;
+        if(it->mSize > blockSize)
+        {
+            it->mOffset += blockSize;
+            it->mSize -= blockSize;
+        }
+        else
+            mFreePoseBlocks.erase(it);
+    }
+    else
+    {
+        entry.mPoseOffset = static_cast<uint32_t>(mPoseBuffer.size());
+        mPoseBuffer.resize(mPoseBuffer.size() + blockSize, float4x4(1.0f));
+    }
+
+    mEntryLookup[id] = static_cast<uint32_t>(mEntries.size());
+    mEntries.push_back(std::move(entry));
+    mEvaluations.reserve(mEntries.size());
+}
+
+
+void AnimationSystem::unregisterInstance(const InstanceID id)
+{
+    auto it = mEntryLookup.find(id);
+    if(it == mEntryLookup.end())
+        return;
+
+    const uint32_t index = it->second;
+    mEntryLookup.erase(it);
+
+    const Entry& entry = mEntries[index];
+    mFreePoseBlocks.push_back({entry.mPoseOffset, entry.mBoneCount * kPosesPerEntry});
+
+    // swap and pop to keep the entries dense.
+    if(index != mEntries.size() - 1)
+    {
+        mEntries[index] = std::move(mEntries.back());
+        mEntryLookup[mEntries[index].mID] = index;
+    }
+    mEntries.pop_back();
+}
+
+
+void AnimationSystem::playClip(const InstanceID id, const AnimationClipHandle clip, const bool loop, const float speed)
+{
+    Entry* entry = findEntry(id);
+    if(!entry)
+        return;
+
+    entry->mClip = clip;
+    entry->mClipStartTime = mAnimationTime;
+    entry->mClipSpeed = speed;
+    entry->mClipLoop = loop;
+    entry->mHasHistory = false;
+    // Make sure the new clip shows up next tick regardless of LOD.
+    entry->mFramesSinceEvaluation = entry->mUpdateInterval;
+}
+
+
+void AnimationSystem::stopClip(const InstanceID id)
+{
+    Entry* entry = findEntry(id);
+    if(!entry)
+        return;
+
+    entry->mClip = kInvalidAnimationClip;
+    entry->mHasHistory = false;
+}
+
+
+void AnimationSystem::saveState(SavedState& state) const
+{
+    state.mAnimationTime = mAnimationTime;
+    state.mInstances.resize(mEntries.size());
+
+    for(uint32_t i = 0; i < mEntries.size(); ++i)
+    {
+        const Entry& entry = mEntries[i];
+        SavedState::Instance& instance = state.mInstances[i];
+        instance.mID = entry.mID;
+        instance.mClip = entry.mClip;
+        instance.mClipStartTime = entry.mClipStartTime;
+        instance.mClipSpeed = entry.mClipSpeed;
+        instance.mClipLoop = entry.mClipLoop;
+        instance.mAnimated = entry.mAnimated;
+        instance.mGraph = entry.mGraph;
+        instance.mBlendDuration = entry.mBlendDuration;
+        instance.mBlendElapsed = entry.mBlendElapsed;
+
+        instance.mBlendSource.clear();
+        if(entry.mBlendElapsed < entry.mBlendDuration)
+            instance.mBlendSource.assign(blendSourcePose(entry), blendSourcePose(entry) + entry.mBoneCount);
+    }
+}
+
+
+void AnimationSystem::restoreState(const SavedState& state)
+{
+    mAnimationTime = state.mAnimationTime;
+
+    for(const SavedState::Instance& instance : state.mInstances)
+    {
+        Entry* entry = findEntry(instance.mID);
+        if(!entry)
+            continue;
+
+        entry->mClip = instance.mClip;
+        entry->mClipStartTime = instance.mClipStartTime;
+        entry->mClipSpeed = instance.mClipSpeed;
+        entry->mClipLoop = instance.mClipLoop;
+        entry->mAnimated = instance.mAnimated;
+        entry->mGraph = instance.mGraph;
+        entry->mBlendDuration = instance.mBlendDuration;
+        entry->mBlendElapsed = instance.mBlendElapsed;
+        if(!instance.mBlendSource.empty())
+            std::copy_n(instance.mBlendSource.data(), entry->mBoneCount, blendSourcePose(*entry));
+
+        // The mesh instance keeps its own idea of what's playing.
+        auto name = mClipNames.find(instance.mClip);
+        if(instance.mAnimated && name != mClipNames.end())
+            entry->mInstance->setActiveAnimation(name->second, instance.mClipLoop);
+        else
+            entry->mInstance->endActiveAnimation();
+
+        entry->mHasHistory = false;
+        entry->mFramesSinceEvaluation = entry->mUpdateInterval;
+    }
+}
+
+
+AnimationClipHandle AnimationSystem::registerClip(const std::string& name)
+{
+    const AnimationClipHandle clip = getAnimationClipHandle(name);
+    if(clip != kInvalidAnimationClip)
+        mClipNames.insert({clip, name});
+
+    return clip;
+}
+
+
+const std::string& AnimationSystem::getClipName(const AnimationClipHandle clip) const
+{
+    auto it = mClipNames.find(clip);
+    BELL_ASSERT(it != mClipNames.end(), "Clip handle was never registered")
+
+    return it->second;
+}
+
+
+void AnimationSystem::setAnimationGraph(const InstanceID id, const AnimationGraph* graph)
+{
+    Entry* entry = findEntry(id);
+    if(!entry)
+        return;
+
+    entry->mGraph.emplace(graph);
+
+    const AnimationGraph::State& state = graph->getState(entry->mGraph->getCurrentState());
+    registerClip(state.mClipName);
+    if(state.mClip != kInvalidAnimationClip)
+    {
+        entry->mInstance->setActiveAnimation(state.mClipName, state.mLoop);
+        playClip(id, state.mClip, state.mLoop, state.mSpeed);
+    }
+}
+
+
+AnimationParameterHandle AnimationSystem::getParameterHandle(const InstanceID id, const std::string& name) const
+{
+    const Entry* entry = findEntry(id);
+    if(!entry || !entry->mGraph)
+        return kInvalidAnimationParameter;
+
+    return entry->mGraph->getGraph()->getParameterHandle(name);
+}
+
+
+AnimationStateHandle AnimationSystem::getStateHandle(const InstanceID id, const std::string& name) const
+{
+    const Entry* entry = findEntry(id);
+    if(!entry || !entry->mGraph)
+        return kInvalidAnimationState;
+
+    return entry->mGraph->getGraph()->getStateHandle(name);
+}
+
+
+void AnimationSystem::setParameter(const InstanceID id, const AnimationParameterHandle parameter, const float value)
+{
+    Entry* entry = findEntry(id);
+    if(entry && entry->mGraph)
+        entry->mGraph->setParameter(parameter, value);
+}
+
+
+AnimationStateHandle AnimationSystem::getCurrentState(const InstanceID id) const
+{
+    const Entry* entry = findEntry(id);
+    if(!entry || !entry->mGraph)
+        return kInvalidAnimationState;
+
+    return entry->mGraph->getCurrentState();
+}
+
+
+void AnimationSystem::tick(const std::chrono::microseconds delta)
+{
+    PROFILER_EVENT();
+
+    const double deltaSeconds = double(delta.count()) / 1000000.0;
+    mAnimationTime += deltaSeconds;
+    mLastDelta = static_cast<float>(deltaSeconds);
+
+    mStats = Stats{};
+
+    updateGraphs(mLastDelta);
+
+    const float3 viewPosition = mScene->getCamera().getPosition();
+
+    // Work out who needs a new pose this frame.
+    mEvaluations.clear();
+    for(uint32_t i = 0; i < mEntries.size(); ++i)
+    {
+        Entry& entry = mEntries[i];
+
+        entry.mAnimated = entry.mInstance->getActiveAnimation();
+        if(!entry.mAnimated)
+        {
+            entry.mHasHistory = false;
+            continue;
+        }
+
+        ++mStats.mAnimatedInstances;
+
+        selectLOD(entry, viewPosition);
+        ++mStats.mInstancesPerLOD[static_cast<uint32_t>(entry.mLOD)];
+
+        ++entry.mFramesSinceEvaluation;
+        if(entry.mHasHistory && entry.mFramesSinceEvaluation < entry.mUpdateInterval)
+            continue;
+
+        // Sample where we will be at the next evaluation and interpolate towards it.
+        const double lookAhead = entry.mUpdateInterval > 1 ? deltaSeconds * entry.mUpdateInterval : 0.0;
+        const double clipTime = ((mAnimationTime - entry.mClipStartTime) + lookAhead) * entry.mClipSpeed;
+
+        Evaluation evaluation{};
+        evaluation.mMesh = entry.mMesh;
+        evaluation.mClip = entry.mClip;
+        evaluation.mSampleIndex = std::llround(clipTime / mPoseQuantum);
+        evaluation.mEntry = i;
+        mEvaluations.push_back(evaluation);
+
+        entry.mFramesSinceEvaluation = 0;
+    }
+
+    // Group identical samples, the first of each run gets evaluated and the rest copy from it.
+    auto sampleKey = [](const Evaluation& e) { return std::make_tuple(e.mMesh, e.mClip, e.mSampleIndex); };
+    std::sort(mEvaluations.begin(), mEvaluations.end(), [&](const Evaluation& lhs, const Evaluation& rhs)
+    {
+        return sampleKey(lhs) < sampleKey(rhs);
+    });
+
+    for(uint32_t i = 0; i < mEvaluations.size(); ++i)
+    {
+        // If we don't know what's playing never share it.
+        const bool shared = i > 0 && mEvaluations[i].mClip != kInvalidAnimationClip && sampleKey(mEvaluations[i]) == sampleKey(mEvaluations[i - 1]);
+        mEvaluations[i].mOwner = shared ? mEvaluations[i - 1].mOwner : i;
+
+        if(shared)
+            ++mStats.mSharedPoses;
+        else
+            ++mStats.mEvaluatedPoses;
+    }
+
+    const uint32_t evaluationCount = static_cast<uint32_t>(mEvaluations.size());
+    mJobSystem->parallelFor(evaluationCount, [this](const uint32_t i)
+    {
+        if(mEvaluations[i].mOwner == i)
+            evaluate(mEvaluations[i]);
+    });
+
+    if(mStats.mSharedPoses > 0)
+    {
+        mJobSystem->parallelFor(evaluationCount, [this](const uint32_t i)
+        {
+            if(mEvaluations[i].mOwner != i)
+                copySharedPose(mEvaluations[i]);
+        });
+    }
+
+    mJobSystem->parallelFor(static_cast<uint32_t>(mEntries.size()), [this](const uint32_t i)
+    {
+        if(mEntries[i].mAnimated)
+            interpolate(mEntries[i]);
+    });
+}
+
+
+AnimationSystem::Pose AnimationSystem::getPose(const InstanceID id) const
+{
+    const Entry* entry = findEntry(id);
+    if(!entry)
+        return {nullptr, 0, 0, false};
+
+    const float4x4* output = mPoseBuffer.data() + entry->mPoseOffset + (entry->mBoneCount * 2);
+    return {output, entry->mBoneCount, entry->mActiveBoneCount, entry->mAnimated};
+}
+
+
+AnimationSystem::Entry* AnimationSystem::findEntry(const InstanceID id)
+{
+    auto it = mEntryLookup.find(id);
+    if(it == mEntryLookup.end())
+        return nullptr;
+
+    return &mEntries[it->second];
+}
+
+
+const AnimationSystem::Entry* AnimationSystem::findEntry(const InstanceID id) const
+{
+    auto it = mEntryLookup.find(id);
+    if(it == mEntryLookup.end())
+        return nullptr;
+
+    return &mEntries[it->second];
+}
+
+
+void AnimationSystem::updateGraphs(const float delta)
+{
+    for(Entry& entry : mEntries)
+    {
+        if(!entry.mGraph || !entry.mGraph->update(delta))
+            continue;
+
+        const AnimationGraph::State& state = entry.mGraph->getGraph()->getState(entry.mGraph->getCurrentState());
+        if(state.mClip != kInvalidAnimationClip)
+        {
+            entry.mInstance->setActiveAnimation(state.mClipName, state.mLoop);
+            playClip(entry.mID, state.mClip, state.mLoop, state.mSpeed);
+        }
+        else
+        {
+            entry.mInstance->endActiveAnimation();
+            stopClip(entry.mID);
+        }
+
+        startBlend(entry, entry.mGraph->getBlendTime());
+    }
+}
+
+
+void AnimationSystem::startBlend(Entry& entry, const float blendTime)
+{
+    entry.mBlendDuration = blendTime;
+    entry.mBlendElapsed = 0.0f;
+
+    if(blendTime > 0.0f)
+        std::copy_n(outputPose(entry), entry.mBoneCount, blendSourcePose(entry));
+}
+
+
+void AnimationSystem::selectLOD(Entry& entry, const float3& viewPosition)
+{
+    const float distance = glm::length(entry.mInstance->getPosition() - viewPosition);
+    const float screenSize = distance > 0.0f ? entry.mBoundingRadius / distance : 1.0f;
+
+    uint32_t lod = 0;
+    while(lod + 1 < mLODSettings.size() && screenSize < mLODSettings[lod].mMinScreenSize)
+        ++lod;
+
+    const LODSettings& settings = mLODSettings[lod];
+    entry.mLOD = static_cast<AnimationLOD>(lod);
+    entry.mUpdateInterval = std::max(settings.mUpdateInterval, 1u);
+    entry.mActiveBoneCount = std::clamp(static_cast<uint32_t>(std::ceil(entry.mBoneCount * settings.mBoneFraction)), 1u, entry.mBoneCount);
+}
+
+
+void AnimationSystem::evaluate(const Evaluation& evaluation)
+{
+    Entry& entry = mEntries[evaluation.mEntry];
+
+    const std::vector<float4x4> boneTransforms = entry.mInstance->tickAnimation(evaluation.mSampleIndex * mPoseQuantum);
+    BELL_ASSERT(boneTransforms.size() >= entry.mBoneCount, "Skeleton size changed after registration")
+
+    std::copy_n(nextPose(entry), entry.mBoneCount, previousPose(entry));
+    std::copy_n(boneTransforms.begin(), entry.mBoneCount, nextPose(entry));
+
+    if(!entry.mHasHistory)
+    {
+        std::copy_n(nextPose(entry), entry.mBoneCount, previousPose(entry));
+        entry.mHasHistory = true;
+    }
+}
+
+
+void AnimationSystem::copySharedPose(const Evaluation& evaluation)
+{
+    Entry& entry = mEntries[evaluation.mEntry];
+    const Entry& owner = mEntries[mEvaluations[evaluation.mOwner].mEntry];
+
+    std::copy_n(nextPose(entry), entry.mBoneCount, previousPose(entry));
+    std::copy_n(nextPose(owner), entry.mBoneCount, nextPose(entry));
+
+    if(!entry.mHasHistory)
+    {
+        std::copy_n(nextPose(entry), entry.mBoneCount, previousPose(entry));
+        entry.mHasHistory = true;
+    }
+}
+
+
+void AnimationSystem::interpolate(Entry& entry)
+{
+    const float4x4* previous = previousPose(entry);
+    const float4x4* next = nextPose(entry);
+    float4x4* output = outputPose(entry);
+
+    // Bones outside of the active set keep their last pose.
+    if(entry.mUpdateInterval == 1)
+    {
+        std::copy_n(next, entry.mActiveBoneCount, output);
+    }
+    else
+    {
+        const float alpha = float(entry.mFramesSinceEvaluation) / float(entry.mUpdateInterval);
+        for(uint32_t i = 0; i < entry.mActiveBoneCount; ++i)
+            output[i] = blendBones(previous[i], next[i], alpha);
+    }
+
+    // Fade in from where we were when the state graph changed clip.
+    if(entry.mBlendElapsed < entry.mBlendDuration)
+    {
+        entry.mBlendElapsed += mLastDelta;
+
+        const float weight = std::min(entry.mBlendElapsed / entry.mBlendDuration, 1.0f);
+        const float4x4* source = blendSourcePose(entry);
+        for(uint32_t i = 0; i < entry.mActiveBoneCount; ++i)
+            output[i] = blendBones(source[i], output[i], weight);
+    }
+}
+
+}
@@ -0,0 +1,241 @@
+#ifndef TEMPEST_ANIMATION_SYSTEM_HPP
+#define TEMPEST_ANIMATION_SYSTEM_HPP
+
+#include "Engine/Scene.h"
+#include "AnimationGraph.hpp"
+
+#include <array>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Tempest
+{
+    class JobSystem;
+
+enum class AnimationLOD : uint32_t
+{
+    Full = 0,
+    Half,
+    Quarter,
+    Eighth,
+    Count
+};
+
+class AnimationSystem
+{
+public:
+    AnimationSystem(JobSystem*);
+    ~AnimationSystem() = default;
+
+    void setScene(Scene*);
+
+    // Allocates pose storage for the instance, instances without a skeleton are ignored.
+    void registerInstance(const InstanceID);
+    void unregisterInstance(const InstanceID);
+
+    // Keep track of what each instance is playing so that instances playing
+    // the same clip at the same time can share a pose.
+    void playClip(const InstanceID, const AnimationClipHandle, const bool loop, const float speed);
+    void stopClip(const InstanceID);
+
+    // Clip names are only needed when handing a clip to the mesh instance,
+    // everything else refers to them by handle.
+    AnimationClipHandle registerClip(const std::string& name);
+    const std::string& getClipName(const AnimationClipHandle) const;
+
+    // Drive the instance from a state graph rather than explicit clip changes.
+    void setAnimationGraph(const InstanceID, const AnimationGraph*);
+    AnimationParameterHandle getParameterHandle(const InstanceID, const std::string&) const;
+    AnimationStateHandle getStateHandle(const InstanceID, const std::string&) const;
+    void setParameter(const InstanceID, const AnimationParameterHandle, const float);
+    AnimationStateHandle getCurrentState(const InstanceID) const;
+
+    // Evaluates every registered instance in parallel.
+    void tick(const std::chrono::microseconds delta);
+
+    struct LODSettings
+    {
+        // Bounding radius over distance from the camera at which this LOD starts.
+        float mMinScreenSize;
+        uint32_t mUpdateInterval;
+        // Fraction of the skeleton (from the root) that gets updated.
+        float mBoneFraction;
+    };
+
+    void setLODSettings(const AnimationLOD lod, const LODSettings& settings)
+    {
+        mLODSettings[static_cast<uint32_t>(lod)] = settings;
+    }
+
+    // Clip times are snapped to this so that instances can share poses.
+    void setPoseQuantum(const double seconds)
+    {
+        mPoseQuantum = seconds;
+    }
+
+    struct Pose
+    {
+        const float4x4* mBoneTransforms;
+        uint32_t mBoneCount;
+        // Bones past this weren't updated this frame.
+        uint32_t mActiveBoneCount;
+        bool mAnimated;
+    };
+
+    Pose getPose(const InstanceID) const;
+
+    bool isRegistered(const InstanceID id) const
+    {
+        return mEntryLookup.find(id) != mEntryLookup.end();
+    }
+
+    struct Stats
+    {
+        uint32_t mAnimatedInstances;
+        uint32_t mEvaluatedPoses;
+        uint32_t mSharedPoses;
+        std::array<uint32_t, static_cast<size_t>(AnimationLOD::Count)> mInstancesPerLOD;
+    };
+
+    const Stats& getStats() const
+    {
+        return mStats;
+    }
+
+    // What each instance is playing, enough to rewind without the pose
+    // history which gets rebuilt on the next tick.
+    struct SavedState
+    {
+        struct Instance
+        {
+            InstanceID mID;
+            AnimationClipHandle mClip;
+            double mClipStartTime;
+            float mClipSpeed;
+            bool mClipLoop;
+            bool mAnimated;
+            std::optional<AnimationGraphInstance> mGraph;
+            float mBlendDuration;
+            float mBlendElapsed;
+            // Only kept while blending.
+            std::vector<float4x4> mBlendSource;
+        };
+
+        double mAnimationTime;
+        std::vector<Instance> mInstances;
+    };
+
+    void saveState(SavedState&) const;
+    // Instances registered since the save are left as they are.
+    void restoreState(const SavedState&);
+
+private:
+
+    struct Entry
+    {
+        InstanceID mID;
+        MeshInstance* mInstance;
+        const StaticMesh* mMesh;
+        // previous, next and output poses are stored back to back.
+        uint32_t mPoseOffset;
+        uint32_t mBoneCount;
+        uint32_t mActiveBoneCount;
+        float mBoundingRadius;
+
+        AnimationClipHandle mClip;
+        double mClipStartTime;
+        float mClipSpeed;
+        bool mClipLoop;
+        bool mAnimated;
+        bool mHasHistory;
+
+        std::optional<AnimationGraphInstance> mGraph;
+        float mBlendDuration;
+        float mBlendElapsed;
+
+        AnimationLOD mLOD;
+        uint32_t mUpdateInterval;
+        uint32_t mFramesSinceEvaluation;
+    };
+
+    struct Evaluation
+    {
+        const StaticMesh* mMesh;
+        AnimationClipHandle mClip;
+        int64_t mSampleIndex;
+        uint32_t mEntry;
+        uint32_t mOwner;
+    };
+
+    static constexpr uint32_t kPosesPerEntry = 4;
+
+    Entry* findEntry(const InstanceID);
+    const Entry* findEntry(const InstanceID) const;
+    void updateGraphs(const float delta);
+    void startBlend(Entry&, const float blendTime);
+
+    void selectLOD(Entry&, const float3& viewPosition);
+    void evaluate(const Evaluation&);
+    void copySharedPose(const Evaluation&);
+    void interpolate(Entry&);
+
+    float4x4* previousPose(const Entry& entry)
+    {
+        return mPoseBuffer.data() + entry.mPoseOffset;
+    }
+
+    float4x4* nextPose(const Entry& entry)
+    {
+        return mPoseBuffer.data() + entry.mPoseOffset + entry.mBoneCount;
+    }
+
+    float4x4* outputPose(const Entry& entry)
+    {
+        return mPoseBuffer.data() + entry.mPoseOffset + (entry.mBoneCount * 2);
+    }
+
+    // Output pose at the point a blend started.
+    float4x4* blendSourcePose(const Entry& entry)
+    {
+        return mPoseBuffer.data() + entry.mPoseOffset + (entry.mBoneCount * 3);
+    }
+
+    const float4x4* blendSourcePose(const Entry& entry) const
+    {
+        return mPoseBuffer.data() + entry.mPoseOffset + (entry.mBoneCount * 3);
+    }
+
+    Scene* mScene;
+    JobSystem* mJobSystem;
+
+    double mAnimationTime;
+    float mLastDelta;
+    double mPoseQuantum;
+    std::array<LODSettings, static_cast<size_t>(AnimationLOD::Count)> mLODSettings;
+
+    std::vector<Entry> mEntries;
+    std::unordered_map<InstanceID, uint32_t> mEntryLookup;
+    std::vector<Evaluation> mEvaluations;
+
+    std::unordered_map<AnimationClipHandle, std::string> mClipNames;
+
+    // Bone transforms for all registered instances, sized at registration so
+    // ticking never has to grow it.
+    std::vector<float4x4> mPoseBuffer;
+
+    struct PoseBlock
+    {
+        uint32_t mOffset;
+        uint32_t mSize;
+    };
+    std::vector<PoseBlock> mFreePoseBlocks;
+
+    Stats mStats;
+};
+
+}
+
+#endif
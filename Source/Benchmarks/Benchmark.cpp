@@ -0,0 +1,166 @@
+#include "Benchmark.hpp"
+
+#include "json/json.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <thread>
+
+namespace Tempest
+{
+
+namespace
+{
+    struct RegisteredBenchmark
+    {
+        const char* mName;
+        BenchmarkFunction mFunction;
+        std::vector<uint32_t> mParams;
+    };
+
+    std::vector<RegisteredBenchmark>& getRegisteredBenchmarks()
+    {
+        static std::vector<RegisteredBenchmark> benchmarks;
+        return benchmarks;
+    }
+
+    BenchmarkResult runBenchmark(const RegisteredBenchmark& benchmark, const uint32_t param, const BenchmarkSettings& settings)
+    {
+        BenchmarkResult result{benchmark.mName, param, 0, 0.0, 0.0, 0.0, 0.0, ""};
+
+        // Grow the iteration count until a single run takes at least the min time.
+        uint64_t iterations = 1;
+        while(true)
+        {
+            BenchmarkState state(iterations, param);
+            benchmark.mFunction(state);
+
+            if(!state.getSkipReason().empty())
+            {
+                result.mSkipReason = state.getSkipReason();
+                return result;
+            }
+
+            if(state.getElapsed() >= settings.mMinTime || iterations >= (1ull << 32))
+                break;
+
+            const double elapsed = std::max<double>(state.getElapsed().count(), 1.0);
+            const double target = std::chrono::duration_cast<std::chrono::nanoseconds>(settings.mMinTime).count() * 1.2;
+            iterations = std::max<uint64_t>(iterations * 2, static_cast<uint64_t>(iterations * (target / elapsed)));
+        }
+
+        std::vector<double> nsPerItem;
+        uint64_t itemsPerIteration = 1;
+        for(uint32_t i = 0; i < std::max(settings.mRepetitions, 1u); ++i)
+        {
+            BenchmarkState state(iterations, param);
+            benchmark.mFunction(state);
+
+            itemsPerIteration = state.getItemsPerIteration();
+            nsPerItem.push_back(double(state.getElapsed().count()) / double(iterations * itemsPerIteration));
+        }
+
+        std::sort(nsPerItem.begin(), nsPerItem.end());
+        result.mIterations = iterations * itemsPerIteration;
+        result.mMedianNs = nsPerItem[nsPerItem.size() / 2];
+        result.mMinNs = nsPerItem.front();
+        result.mMaxNs = nsPerItem.back();
+        result.mItemsPerSecond = result.mMedianNs > 0.0 ? 1e9 / result.mMedianNs : 0.0;
+
+        return result;
+    }
+}
+
+
+BenchmarkEnvironment& getBenchmarkEnvironment()
+{
+    static BenchmarkEnvironment environment;
+    return environment;
+}
+
+
+BenchmarkRegistration::BenchmarkRegistration(const char* name, BenchmarkFunction function, std::vector<uint32_t> params)
+{
+    getRegisteredBenchmarks().push_back({name, function, std::move(params)});
+}
+
+
+std::vector<BenchmarkResult> runBenchmarks(const BenchmarkSettings& settings)
+{
+    std::vector<RegisteredBenchmark> benchmarks = getRegisteredBenchmarks();
+    std::sort(benchmarks.begin(), benchmarks.end(), [](const auto& lhs, const auto& rhs) { return std::string(lhs.mName) < std::string(rhs.mName); });
+
+    std::vector<BenchmarkResult> results;
+    for(const RegisteredBenchmark& benchmark : benchmarks)
+    {
+        if(!settings.mFilter.empty() && std::string(benchmark.mName).find(settings.mFilter) == std::string::npos)
+            continue;
+
+        for(const uint32_t param : benchmark.mParams)
+        {
+            const BenchmarkResult result = runBenchmark(benchmark, param, settings);
+
+            if(result.mSkipReason.empty())
+                printf("%-40s %-8u %12.1f ns %14.0f items/s\n", result.mName.c_str(), result.mParam, result.mMedianNs, result.mItemsPerSecond);
+            else
+                printf("%-40s %-8u skipped: %s\n", result.mName.c_str(), result.mParam, result.mSkipReason.c_str());
+
+            results.push_back(result);
+        }
+    }
+
+    return results;
+}
+
+
+bool writeBenchmarkResults(const std::vector<BenchmarkResult>& results, const std::filesystem::path& path)
+{
+    Json::Value root;
+
+    Json::Value& context = root["context"];
+    context["date"] = static_cast<Json::Int64>(std::time(nullptr));
+    context["hardware_concurrency"] = std::thread::hardware_concurrency();
+#ifdef NDEBUG
+    context["build_type"] = "release";
+#else
+    context["build_type"] = "debug";
+#endif
+
+    Json::Value& benchmarks = root["benchmarks"];
+    benchmarks = Json::Value(Json::arrayValue);
+    for(const BenchmarkResult& result : results)
+    {
+        Json::Value entry;
+        entry["name"] = result.mName;
+        entry["param"] = result.mParam;
+
+        if(!result.mSkipReason.empty())
+        {
+            entry["skipped"] = result.mSkipReason;
+        }
+        else
+        {
+            entry["iterations"] = static_cast<Json::UInt64>(result.mIterations);
+            entry["ns_per_op"] = result.mMedianNs;
+            entry["ns_per_op_min"] = result.mMinNs;
+            entry["ns_per_op_max"] = result.mMaxNs;
+            entry["items_per_second"] = result.mItemsPerSecond;
+        }
+
+        benchmarks.append(entry);
+    }
+
+    std::ofstream file(path);
+    if(!file.is_open())
+        return false;
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "    ";
+    file << Json::writeString(builder, root) << "\n";
+
+    return file.good();
+}
+
+}
@@ -0,0 +1,146 @@
+#ifndef TEMPEST_BENCHMARK_HPP
+#define TEMPEST_BENCHMARK_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+class RenderEngine;
+
+namespace Tempest
+{
+
+// Passed to every benchmark run, only the time between start and stop is measured.
+class BenchmarkState
+{
+public:
+    BenchmarkState(const uint64_t iterations, const uint32_t param) :
+        mIterations(iterations),
+        mParam(param),
+        mElapsed(0),
+        mItemsPerIteration(1) {}
+
+    uint64_t getIterations() const
+    {
+        return mIterations;
+    }
+
+    // The value from the benchmarks argument list, e.g. a body count.
+    uint32_t getParam() const
+    {
+        return mParam;
+    }
+
+    void start()
+    {
+        mStart = std::chrono::steady_clock::now();
+    }
+
+    void stop()
+    {
+        mElapsed += std::chrono::steady_clock::now() - mStart;
+    }
+
+    // For benchmarks where one iteration covers several items (e.g. lua calls in a loop).
+    void setItemsPerIteration(const uint64_t items)
+    {
+        mItemsPerIteration = items;
+    }
+
+    uint64_t getItemsPerIteration() const
+    {
+        return mItemsPerIteration;
+    }
+
+    void skip(const std::string& reason)
+    {
+        mSkipReason = reason;
+    }
+
+    const std::string& getSkipReason() const
+    {
+        return mSkipReason;
+    }
+
+    std::chrono::nanoseconds getElapsed() const
+    {
+        return mElapsed;
+    }
+
+private:
+
+    uint64_t mIterations;
+    uint32_t mParam;
+    std::chrono::steady_clock::time_point mStart;
+    std::chrono::nanoseconds mElapsed;
+    uint64_t mItemsPerIteration;
+    std::string mSkipReason;
+};
+
+
+// Shared resources the benchmarks may need. The render engine is only created
+// when an asset directory is passed, anything needing it skips otherwise.
+struct BenchmarkEnvironment
+{
+    std::filesystem::path mAssetDir;
+    std::filesystem::path mScenePath;
+    RenderEngine* mRenderEngine = nullptr;
+};
+
+BenchmarkEnvironment& getBenchmarkEnvironment();
+
+
+using BenchmarkFunction = void(*)(BenchmarkState&);
+
+struct BenchmarkRegistration
+{
+    BenchmarkRegistration(const char* name, BenchmarkFunction, std::vector<uint32_t> params = {0});
+};
+
+
+struct BenchmarkResult
+{
+    std::string mName;
+    uint32_t mParam;
+    uint64_t mIterations;
+    double mMedianNs;
+    double mMinNs;
+    double mMaxNs;
+    double mItemsPerSecond;
+    std::string mSkipReason;
+};
+
+struct BenchmarkSettings
+{
+    std::string mFilter;
+    std::chrono::milliseconds mMinTime{100};
+    uint32_t mRepetitions = 5;
+};
+
+std::vector<BenchmarkResult> runBenchmarks(const BenchmarkSettings&);
+bool writeBenchmarkResults(const std::vector<BenchmarkResult>&, const std::filesystem::path&);
+
+// Stops the optimiser throwing away results that are never read.
+template<typename T>
+inline void doNotOptimise(T const& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+}
+
+#define TEMPEST_BENCHMARK_CONCAT_IMPL(A, B) A ## B
+#define TEMPEST_BENCHMARK_CONCAT(A, B) TEMPEST_BENCHMARK_CONCAT_IMPL(A, B)
+
+#define TEMPEST_BENCHMARK(F, ...) \
+    static Tempest::BenchmarkRegistration TEMPEST_BENCHMARK_CONCAT(benchmark_, __LINE__)(#F, &F, ##__VA_ARGS__);
+
+#endif
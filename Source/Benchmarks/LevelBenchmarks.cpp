@@ -0,0 +1,69 @@
+#include "Benchmark.hpp"
+
+#include "Level.hpp"
+#include "PhysicsWorld.hpp"
+#include "ScriptEngine.hpp"
+
+#include "json/json.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace Tempest
+{
+
+namespace
+{
+    // Just the json side of a level load, no assets touched.
+    void benchParseLevelJson(BenchmarkState& state)
+    {
+        const BenchmarkEnvironment& environment = getBenchmarkEnvironment();
+        if(environment.mScenePath.empty())
+        {
+            state.skip("needs --scene");
+            return;
+        }
+
+        std::ifstream sceneFile(environment.mScenePath);
+        std::stringstream contents;
+        contents << sceneFile.rdbuf();
+        const std::string sceneText = contents.str();
+
+        state.start();
+        for(uint64_t i = 0; i < state.getIterations(); ++i)
+        {
+            std::istringstream stream(sceneText);
+            Json::Value sceneRoot;
+            stream >> sceneRoot;
+            doNotOptimise(sceneRoot);
+        }
+        state.stop();
+    }
+
+    void benchLoadLevel(BenchmarkState& state)
+    {
+        const BenchmarkEnvironment& environment = getBenchmarkEnvironment();
+        if(environment.mScenePath.empty() || !environment.mRenderEngine)
+        {
+            state.skip("needs --assets and --scene");
+            return;
+        }
+
+        for(uint64_t i = 0; i < state.getIterations(); ++i)
+        {
+            PhysicsWorld physics(nullptr);
+            ScriptEngine scripts{};
+
+            state.start();
+            Level level(environment.mRenderEngine, &physics, &scripts, nullptr, environment.mScenePath);
+            state.stop();
+
+            doNotOptimise(level);
+        }
+    }
+}
+
+TEMPEST_BENCHMARK(benchParseLevelJson)
+TEMPEST_BENCHMARK(benchLoadLevel)
+
+}
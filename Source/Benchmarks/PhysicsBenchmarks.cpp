@@ -0,0 +1,116 @@
+#include "Benchmark.hpp"
+
+#include "PhysicsWorld.hpp"
+
+#include "Engine/Engine.hpp"
+#include "Engine/StaticMesh.h"
+
+#include <cmath>
+
+namespace Tempest
+{
+
+namespace
+{
+    constexpr auto kFixedStep = std::chrono::microseconds(16666);
+
+    // Boxes dropped in a grid over a ground plane so the broadphase has real pairs to deal with.
+    void addBodies(PhysicsWorld& world, const uint32_t count, const std::vector<InstanceID>* ids = nullptr)
+    {
+        world.addObject(kInvalidInstanceID, PhysicsEntityType::StaticRigid, BasicCollisionGeometry::Plane,
+                        float3(0.0f), quat(1.0f, 0.0f, 0.0f, 0.0f), float3(1.0f));
+
+        const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(float(count))));
+        for(uint32_t i = 0; i < count; ++i)
+        {
+            const float3 position{float(i % side) * 1.5f, 2.0f + float(i / (side * side)) * 1.5f, float((i / side) % side) * 1.5f};
+            const InstanceID id = ids ? (*ids)[i] : static_cast<InstanceID>(i);
+
+            world.addObject(id, PhysicsEntityType::DynamicRigid, BasicCollisionGeometry::Box,
+                            position, quat(1.0f, 0.0f, 0.0f, 0.0f), float3(1.0f), 1.0f);
+        }
+    }
+
+    void benchPhysicsTick(BenchmarkState& state)
+    {
+        PhysicsWorld world(nullptr);
+        addBodies(world, state.getParam());
+
+        // Let everything land first so we measure resting contacts, not free fall.
+        for(uint32_t i = 0; i < 60; ++i)
+            world.tick(kFixedStep);
+
+        state.start();
+        for(uint64_t i = 0; i < state.getIterations(); ++i)
+            world.tick(kFixedStep);
+        state.stop();
+    }
+
+    // With shared sizes every add after the first hits the shape cache, param is bodies added per world.
+    void addBoxes(BenchmarkState& state, const bool uniqueSizes)
+    {
+        state.setItemsPerIteration(state.getParam());
+
+        for(uint64_t i = 0; i < state.getIterations(); ++i)
+        {
+            PhysicsWorld world(nullptr);
+
+            state.start();
+            for(uint32_t j = 0; j < state.getParam(); ++j)
+            {
+                const float size = uniqueSizes ? 1.0f + float(j) * 0.001f : 1.0f;
+                world.addObject(static_cast<InstanceID>(j), PhysicsEntityType::DynamicRigid, BasicCollisionGeometry::Box,
+                                float3(float(j), 0.0f, 0.0f), quat(1.0f, 0.0f, 0.0f, 0.0f), float3(size), 1.0f);
+            }
+            state.stop();
+        }
+    }
+
+    void benchShapeCacheHit(BenchmarkState& state)
+    {
+        addBoxes(state, false);
+    }
+
+    void benchShapeCacheMiss(BenchmarkState& state)
+    {
+        addBoxes(state, true);
+    }
+
+    void benchUpdateDynamicObjects(BenchmarkState& state)
+    {
+        BenchmarkEnvironment& environment = getBenchmarkEnvironment();
+        if(!environment.mRenderEngine)
+        {
+            state.skip("needs --assets");
+            return;
+        }
+
+        Scene scene("UpdateDynamicObjects");
+        StaticMesh cube((environment.mAssetDir / "Meshes" / "cube.fbx").string(), VertexAttributes::Position4 | VertexAttributes::Normals | VertexAttributes::Albedo |
+                        VertexAttributes::TextureCoordinates | VertexAttributes::Tangents, true);
+        const SceneID meshID = scene.addMesh(environment.mRenderEngine, cube, MeshType::Dynamic);
+
+        std::vector<InstanceID> ids{};
+        for(uint32_t i = 0; i < state.getParam(); ++i)
+        {
+            ids.push_back(scene.addMeshInstance(meshID, kInvalidInstanceID, float3(0.0f), float3(1.0f), quat(1.0f, 0.0f, 0.0f, 0.0f),
+                                                0, 0, "Box" + std::to_string(i)));
+        }
+
+        PhysicsWorld world(nullptr);
+        addBodies(world, state.getParam(), &ids);
+        world.tick(kFixedStep);
+
+        state.start();
+        for(uint64_t i = 0; i < state.getIterations(); ++i)
+            world.updateDynamicObjects(&scene);
+        state.stop();
+    }
+}
+
+TEMPEST_BENCHMARK(benchPhysicsTick, {100, 1000, 4000})
+TEMPEST_BENCHMARK(benchShapeCacheHit, {1000})
+TEMPEST_BENCHMARK(benchShapeCacheMiss, {1000})
+TEMPEST_BENCHMARK(benchUpdateDynamicObjects, {100, 1000, 4000})
+
+}
@@ -0,0 +1,184 @@
+#include "Benchmark.hpp"
+
+#include "ScriptEngine.hpp"
+
+#include <fstream>
+
+namespace Tempest
+{
+
+// Stand in for the engine so hook dispatch can be measured without a level.
+class BenchScriptTarget
+{
+public:
+    float3 addVectors(const float3& lhs, const float3& rhs)
+    {
+        return lhs + rhs;
+    }
+
+    void setValue(const uint64_t id, const float value)
+    {
+        mLastID = id;
+        mLastValue = value;
+    }
+
+    uint64_t mLastID = 0;
+    float mLastValue = 0.0f;
+};
+
+LUA_SCRIPT_HOOK_DEFINITION(BenchScriptTarget, addVectors)
+
+LUA_SCRIPT_HOOK_DEFINITION(BenchScriptTarget, setValue)
+
+
+namespace
+{
+    void pushVector(lua_State* L)
+    {
+        pushLuaStack(L, float3{1.0f, 2.0f, 3.0f});
+    }
+
+    void benchExecuteCallbackVector(BenchmarkState& state)
+    {
+        lua_State* L = luaL_newstate();
+        BenchScriptTarget target{};
+
+        pushVector(L);
+        pushVector(L);
+
+        state.start();
+        for(uint64_t i = 0; i < state.getIterations(); ++i)
+        {
+            executeCallback<decltype(&BenchScriptTarget::addVectors), BenchScriptTarget, float3, float3>(L, &BenchScriptTarget::addVectors, &target);
+            lua_pop(L, 1);
+        }
+        state.stop();
+
+        lua_close(L);
+    }
+
+    void benchExecuteCallbackScalar(BenchmarkState& state)
+    {
+        lua_State* L = luaL_newstate();
+        BenchScriptTarget target{};
+
+        lua_pushinteger(L, 42);
+        lua_pushnumber(L, 1.5);
+
+        state.start();
+        for(uint64_t i = 0; i < state.getIterations(); ++i)
+            executeCallback<decltype(&BenchScriptTarget::setValue), BenchScriptTarget, uint64_t, float>(L, &BenchScriptTarget::setValue, &target);
+        state.stop();
+
+        doNotOptimise(target.mLastValue);
+        lua_close(L);
+    }
+
+    void benchMarshalVector(BenchmarkState& state)
+    {
+        lua_State* L = luaL_newstate();
+        const float3 value{1.0f, 2.0f, 3.0f};
+
+        state.start();
+        for(uint64_t i = 0; i < state.getIterations(); ++i)
+        {
+            pushLuaStack(L, value);
+            uint32_t index = 1;
+            const float3 result = popLuaStack<float3>(L, index);
+            doNotOptimise(result);
+            lua_pop(L, 1);
+        }
+        state.stop();
+
+        lua_close(L);
+    }
+
+    void benchMarshalString(BenchmarkState& state)
+    {
+        lua_State* L = luaL_newstate();
+        const std::string value = "PlayerCamera";
+
+        state.start();
+        for(uint64_t i = 0; i < state.getIterations(); ++i)
+        {
+            pushLuaStack(L, value);
+            uint32_t index = 1;
+            const std::string result = popLuaStack<std::string>(L, index);
+            doNotOptimise(result);
+            lua_pop(L, 1);
+        }
+        state.stop();
+
+        lua_close(L);
+    }
+
+    void benchMarshalQuat(BenchmarkState& state)
+    {
+        lua_State* L = luaL_newstate();
+
+        lua_createtable(L, 0, 4);
+        setLuaTableEntry(L, "x", lua_Number(0.0));
+        setLuaTableEntry(L, "y", lua_Number(0.0));
+        setLuaTableEntry(L, "z", lua_Number(0.0));
+        setLuaTableEntry(L, "w", lua_Number(1.0));
+
+        state.start();
+        for(uint64_t i = 0; i < state.getIterations(); ++i)
+        {
+            uint32_t index = 1;
+            const quat result = popLuaStack<quat>(L, index);
+            doNotOptimise(result);
+        }
+        state.stop();
+
+        lua_close(L);
+    }
+
+    // Lua -> C++ -> Lua round trip through the registered hook, param is calls per tick.
+    void benchHookDispatch(BenchmarkState& state)
+    {
+        const uint32_t callsPerTick = state.getParam();
+
+        const std::filesystem::path scriptPath = std::filesystem::temp_directory_path() / "tempest_bench_dispatch.lua";
+        {
+            std::ofstream script(scriptPath);
+            script << "function main(delta)\n"
+                   << "    local v = {x = 1.0, y = 2.0, z = 3.0}\n"
+                   << "    for i = 1, " << callsPerTick << " do\n"
+                   << "        v = BenchScriptTarget_addVectors(v, v)\n"
+                   << "        BenchScriptTarget_setValue(i, v.x)\n"
+                   << "    end\n"
+                   << "end\n";
+        }
+
+        ScriptEngine engine{};
+        BenchScriptTarget target{};
+
+        CallablesRegistrar* registrar = engine.createCallablesRegistrar();
+        LUA_REGISTER_HOOK(BenchScriptTarget, addVectors, &target, float3, float3)
+        LUA_REGISTER_HOOK(BenchScriptTarget, setValue, &target, uint64_t, float)
+        engine.registerCallables(registrar);
+
+        engine.loadScript(scriptPath.string());
+
+        state.setItemsPerIteration(callsPerTick * 2);
+        state.start();
+        for(uint64_t i = 0; i < state.getIterations(); ++i)
+        {
+            engine.tick(std::chrono::microseconds(16666));
+            engine.collectGarbage();
+        }
+        state.stop();
+
+        doNotOptimise(target.mLastValue);
+    }
+}
+
+TEMPEST_BENCHMARK(benchExecuteCallbackVector)
+TEMPEST_BENCHMARK(benchExecuteCallbackScalar)
+TEMPEST_BENCHMARK(benchMarshalVector)
+TEMPEST_BENCHMARK(benchMarshalString)
+TEMPEST_BENCHMARK(benchMarshalQuat)
+TEMPEST_BENCHMARK(benchHookDispatch, {100, 1000})
+
+}
@@ -0,0 +1,66 @@
+#include "Engine/Engine.hpp"
+
+#include "GLFW/glfw3.h"
+
+#include "Benchmark.hpp"
+
+#include <cstring>
+
+
+// TEMPEST_BENCH [--out results.json] [--filter name] [--min-time ms] [--repetitions n] [--assets dir] [--scene file]
+// Without --assets only the benchmarks that don't need a renderer are run.
+int main(int argc, char **argv)
+{
+    Tempest::BenchmarkSettings settings{};
+    std::filesystem::path outputPath = "benchmark_results.json";
+    Tempest::BenchmarkEnvironment& environment = Tempest::getBenchmarkEnvironment();
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if(strcmp(argv[i], "--out") == 0 && hasValue)
+            outputPath = argv[++i];
+        else if(strcmp(argv[i], "--filter") == 0 && hasValue)
+            settings.mFilter = argv[++i];
+        else if(strcmp(argv[i], "--min-time") == 0 && hasValue)
+            settings.mMinTime = std::chrono::milliseconds(atoi(argv[++i]));
+        else if(strcmp(argv[i], "--repetitions") == 0 && hasValue)
+            settings.mRepetitions = static_cast<uint32_t>(atoi(argv[++i]));
+        else if(strcmp(argv[i], "--assets") == 0 && hasValue)
+            environment.mAssetDir = argv[++i];
+        else if(strcmp(argv[i], "--scene") == 0 && hasValue)
+            environment.mScenePath = argv[++i];
+        else
+        {
+            printf("Unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    GLFWwindow* window = nullptr;
+    if(!environment.mAssetDir.empty())
+    {
+        glfwInit();
+
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        window = glfwCreateWindow(1280, 720, "Tempest Bench", nullptr, nullptr);
+
+        environment.mRenderEngine = new RenderEngine(window, {DeviceFeaturesFlags::Compute | DeviceFeaturesFlags::Subgroup, true});
+    }
+
+    const std::vector<Tempest::BenchmarkResult> results = Tempest::runBenchmarks(settings);
+
+    const bool written = Tempest::writeBenchmarkResults(results, outputPath);
+    if(!written)
+        printf("Failed to write results to %s\n", outputPath.string().c_str());
+
+    delete environment.mRenderEngine;
+    if(window)
+    {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
+
+    return written ? 0 : 1;
+}
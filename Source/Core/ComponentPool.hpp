@@ -0,0 +1,146 @@
+#ifndef TEMPEST_COMPONENT_POOL_HPP
+#define TEMPEST_COMPONENT_POOL_HPP
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Core/BellLogging.hpp"
+
+namespace Tempest
+{
+
+// Sparse set of one component type keyed by entity index (the InstanceTable
+// slot). Components are packed in a dense array so systems can walk them
+// linearly or split them across the job system, the sparse array only
+// exists to find an entities component. Removal swaps the last one into the
+// hole so pointers and references don't survive an add or remove.
+template<typename T>
+class ComponentPool
+{
+public:
+
+    template<typename... Args>
+    T& emplace(const uint32_t entity, Args&&... args)
+    {
+        if(entity >= mSparse.size())
+            mSparse.resize(entity + 1, kEmpty);
+
+        if(mSparse[entity] != kEmpty)
+        {
+            T& component = mComponents[mSparse[entity]];
+            component = T(std::forward<Args>(args)...);
+            return component;
+        }
+
+        mSparse[entity] = static_cast<uint32_t>(mComponents.size());
+        mEntities.push_back(entity);
+        return mComponents.emplace_back(std::forward<Args>(args)...);
+    }
+
+    void remove(const uint32_t entity)
+    {
+        if(!contains(entity))
+            return;
+
+        const uint32_t index = mSparse[entity];
+        const uint32_t last = static_cast<uint32_t>(mComponents.size()) - 1;
+        if(index != last)
+        {
+            mComponents[index] = std::move(mComponents[last]);
+            mEntities[index] = mEntities[last];
+            mSparse[mEntities[index]] = index;
+        }
+
+        mComponents.pop_back();
+        mEntities.pop_back();
+        mSparse[entity] = kEmpty;
+    }
+
+    bool contains(const uint32_t entity) const
+    {
+        return entity < mSparse.size() && mSparse[entity] != kEmpty;
+    }
+
+    T& get(const uint32_t entity)
+    {
+        BELL_ASSERT(contains(entity), "Entity doesn't have this component")
+        return mComponents[mSparse[entity]];
+    }
+
+    const T& get(const uint32_t entity) const
+    {
+        BELL_ASSERT(contains(entity), "Entity doesn't have this component")
+        return mComponents[mSparse[entity]];
+    }
+
+    T* tryGet(const uint32_t entity)
+    {
+        return contains(entity) ? &mComponents[mSparse[entity]] : nullptr;
+    }
+
+    const T* tryGet(const uint32_t entity) const
+    {
+        return contains(entity) ? &mComponents[mSparse[entity]] : nullptr;
+    }
+
+    uint32_t size() const
+    {
+        return static_cast<uint32_t>(mComponents.size());
+    }
+
+    bool empty() const
+    {
+        return mComponents.empty();
+    }
+
+    // Dense arrays, index i of both refer to the same entity.
+    std::vector<T>& getComponents()
+    {
+        return mComponents;
+    }
+
+    const std::vector<T>& getComponents() const
+    {
+        return mComponents;
+    }
+
+    const std::vector<uint32_t>& getEntities() const
+    {
+        return mEntities;
+    }
+
+    // f(entity, component) in dense order.
+    template<typename F>
+    void each(F&& f)
+    {
+        for(uint32_t i = 0; i < mComponents.size(); ++i)
+            f(mEntities[i], mComponents[i]);
+    }
+
+    template<typename F>
+    void each(F&& f) const
+    {
+        for(uint32_t i = 0; i < mComponents.size(); ++i)
+            f(mEntities[i], mComponents[i]);
+    }
+
+    void clear()
+    {
+        mSparse.clear();
+        mEntities.clear();
+        mComponents.clear();
+    }
+
+private:
+
+    static constexpr uint32_t kEmpty = ~0u;
+
+    std::vector<uint32_t> mSparse;
+    std::vector<uint32_t> mEntities;
+    std::vector<T> mComponents;
+};
+
+}
+
+#endif
@@ -0,0 +1,117 @@
+#include "FramePacer.hpp"
+
+#include "Core/BellLogging.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace Tempest
+{
+
+// Sleeps can overshoot by about a scheduler tick, the last bit of a wait spins.
+static constexpr std::chrono::microseconds kSpinMargin{2000};
+
+
+FramePacer::FramePacer(const uint32_t targetRate) :
+    mTargetRate(0),
+    mBudget(0),
+    mSmoothing(0.1f),
+    mDelta(0),
+    mSmoothedDelta(0.0),
+    mWorkTime(0),
+    mWaitTime(0),
+    mHitch(false),
+    mHitchCount(0),
+    mFramesSinceReset(0)
+{
+    setTargetRate(targetRate);
+    reset();
+}
+
+
+void FramePacer::setTargetRate(const uint32_t hz)
+{
+    mTargetRate = hz;
+    mBudget = hz ? std::chrono::microseconds(1000000 / hz) : std::chrono::microseconds(0);
+
+    // Start the new rate from the current frame.
+    mNextFrame = mFrameStart + mBudget;
+}
+
+
+void FramePacer::setSmoothing(const float weight)
+{
+    BELL_ASSERT(weight > 0.0f && weight <= 1.0f, "Smoothing weight needs to be in (0, 1]")
+    mSmoothing = std::clamp(weight, 0.01f, 1.0f);
+}
+
+
+void FramePacer::reset()
+{
+    // The first frame goes straight away.
+    mFrameStart = Clock::now();
+    mNextFrame = mFrameStart;
+    mFramesSinceReset = 0;
+}
+
+
+void FramePacer::waitUntil(const Clock::time_point deadline)
+{
+    const auto sleepUntil = deadline - kSpinMargin;
+    if(mWait)
+    {
+        for(auto now = Clock::now(); now < sleepUntil; now = Clock::now())
+            mWait(std::chrono::duration_cast<std::chrono::microseconds>(sleepUntil - now));
+    }
+    else if(Clock::now() < sleepUntil)
+    {
+        std::this_thread::sleep_until(sleepUntil);
+    }
+
+    while(Clock::now() < deadline)
+        std::this_thread::yield();
+}
+
+
+void FramePacer::beginFrame()
+{
+    const auto waitStart = Clock::now();
+    if(mTargetRate)
+    {
+        waitUntil(mNextFrame);
+
+        // After a long frame start a fresh slot rather than rushing to catch up.
+        const auto now = Clock::now();
+        mNextFrame += mBudget;
+        if(mNextFrame < now)
+            mNextFrame = now + mBudget;
+    }
+
+    const auto now = Clock::now();
+    mWaitTime = std::chrono::duration_cast<std::chrono::microseconds>(now - waitStart);
+    mDelta = std::chrono::duration_cast<std::chrono::microseconds>(now - mFrameStart);
+    mFrameStart = now;
+
+    // The first frame only measures from reset, don't let it drag the average down.
+    if(mFramesSinceReset < 2)
+        mSmoothedDelta = static_cast<double>(mDelta.count());
+    else
+        mSmoothedDelta += (static_cast<double>(mDelta.count()) - mSmoothedDelta) * mSmoothing;
+
+    ++mFramesSinceReset;
+}
+
+
+bool FramePacer::endFrame()
+{
+    mWorkTime = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - mFrameStart);
+
+    const std::chrono::microseconds budget = getHitchBudget();
+    mHitch = budget.count() > 0 && mWorkTime > budget;
+    if(mHitch)
+        ++mHitchCount;
+
+    return mHitch;
+}
+
+}
@@ -0,0 +1,121 @@
+#ifndef TEMPEST_FRAME_PACER_HPP
+#define TEMPEST_FRAME_PACER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace Tempest
+{
+
+// Frame timing off the steady clock. With a target rate set, beginFrame holds
+// the frame back until its slot comes round, sleeping for most of the wait
+// and spinning the last bit since sleeps overshoot by up to a scheduler tick.
+// Also keeps an exponentially smoothed delta and flags frames whose work ran
+// over budget.
+class FramePacer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    // Called instead of sleeping, can return early but not late.
+    using WaitFunction = std::function<void(const std::chrono::microseconds timeout)>;
+
+    // 0 runs as fast as possible.
+    FramePacer(const uint32_t targetRate = 0);
+
+    void setTargetRate(const uint32_t hz);
+
+    uint32_t getTargetRate() const
+    {
+        return mTargetRate;
+    }
+
+    // Frame length at the target rate, 0 when unlimited.
+    std::chrono::microseconds getBudget() const
+    {
+        return mBudget;
+    }
+
+    // Weight given to the newest delta, 1 turns smoothing off.
+    void setSmoothing(const float weight);
+
+    // e.g. waiting on window events, so they get handled as they arrive
+    // rather than all at once after the wait.
+    void setWaitFunction(WaitFunction wait)
+    {
+        mWait = std::move(wait);
+    }
+
+    // Starts timing from now, call before the first frame.
+    void reset();
+
+    // Waits out the rest of the last frames slot and starts a new frame.
+    void beginFrame();
+    // Marks the end of this frames work, returns true if it was a hitch.
+    bool endFrame();
+
+    // Start to start, including any waiting.
+    std::chrono::microseconds getDelta() const
+    {
+        return mDelta;
+    }
+
+    std::chrono::microseconds getSmoothedDelta() const
+    {
+        return std::chrono::microseconds(static_cast<int64_t>(mSmoothedDelta + 0.5));
+    }
+
+    // Between beginFrame and endFrame, no waiting.
+    std::chrono::microseconds getWorkTime() const
+    {
+        return mWorkTime;
+    }
+
+    std::chrono::microseconds getWaitTime() const
+    {
+        return mWaitTime;
+    }
+
+    // The target budget, or twice the smoothed delta when unlimited.
+    std::chrono::microseconds getHitchBudget() const
+    {
+        return mTargetRate ? mBudget : getSmoothedDelta() * 2;
+    }
+
+    // Last frames work was over the hitch budget.
+    bool isHitch() const
+    {
+        return mHitch;
+    }
+
+    uint32_t getHitchCount() const
+    {
+        return mHitchCount;
+    }
+
+private:
+
+    void waitUntil(const Clock::time_point);
+
+    uint32_t mTargetRate;
+    std::chrono::microseconds mBudget;
+    float mSmoothing;
+    WaitFunction mWait;
+
+    Clock::time_point mFrameStart;
+    Clock::time_point mNextFrame;
+
+    std::chrono::microseconds mDelta;
+    // Fractional so small changes don't get rounded away.
+    double mSmoothedDelta;
+    std::chrono::microseconds mWorkTime;
+    std::chrono::microseconds mWaitTime;
+
+    bool mHitch;
+    uint32_t mHitchCount;
+    uint32_t mFramesSinceReset;
+};
+
+}
+
+#endif
@@ -0,0 +1,318 @@
+#include "FrameProfiler.hpp"
+
+#include "LinearMath/btQuickprof.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+namespace Tempest
+{
+
+namespace
+{
+    thread_local FrameProfiler::ThreadBuffer* tThreadBuffer = nullptr;
+
+    void writeEscaped(std::ofstream& file, const char* str)
+    {
+        for(; *str; ++str)
+        {
+            if(*str == '"' || *str == '\\')
+                file << '\\';
+            file << *str;
+        }
+    }
+
+    void bulletEnterZone(const char* name)
+    {
+        FrameProfiler& profiler = FrameProfiler::get();
+        FrameProfiler::ThreadBuffer& buffer = profiler.getThreadBuffer();
+
+        if(buffer.mZoneDepth < FrameProfiler::kMaxZoneDepth)
+        {
+            // Zones opened while disabled are still tracked so enter/leave stay balanced.
+            buffer.mZoneStack[buffer.mZoneDepth] = {profiler.isEnabled() ? name : nullptr, profiler.now(), 0};
+        }
+        ++buffer.mZoneDepth;
+    }
+
+    void bulletLeaveZone()
+    {
+        FrameProfiler& profiler = FrameProfiler::get();
+        FrameProfiler::ThreadBuffer& buffer = profiler.getThreadBuffer();
+
+        if(buffer.mZoneDepth == 0)
+            return;
+
+        --buffer.mZoneDepth;
+        if(buffer.mZoneDepth < FrameProfiler::kMaxZoneDepth)
+        {
+            const FrameProfiler::Event& zone = buffer.mZoneStack[buffer.mZoneDepth];
+            if(zone.mName && profiler.isEnabled())
+                profiler.recordEvent(zone.mName, zone.mStart, profiler.now());
+        }
+    }
+}
+
+
+FrameProfiler& FrameProfiler::get()
+{
+    static FrameProfiler profiler;
+    return profiler;
+}
+
+
+FrameProfiler::FrameProfiler() :
+    mEpoch(std::chrono::steady_clock::now()),
+    mEnabled(true),
+    mFrames{},
+    mFrameIndex(0),
+    mHitchThreshold(0),
+    mRequestedFrameCount(0),
+    mWriting(false)
+{
+}
+
+
+FrameProfiler::~FrameProfiler()
+{
+    finishWrite();
+}
+
+
+FrameProfiler::ThreadBuffer& FrameProfiler::getThreadBuffer()
+{
+    if(!tThreadBuffer)
+    {
+        std::unique_lock lock(mThreadsMutex);
+        mThreads.push_back(std::make_unique<ThreadBuffer>());
+        tThreadBuffer = mThreads.back().get();
+        tThreadBuffer->mThreadIndex = static_cast<uint32_t>(mThreads.size());
+    }
+
+    return *tThreadBuffer;
+}
+
+
+void FrameProfiler::setThreadName(const char* name)
+{
+    getThreadBuffer().mName.store(name, std::memory_order_relaxed);
+}
+
+
+const char* FrameProfiler::internName(const std::string& name)
+{
+    std::unique_lock lock(mNamesMutex);
+    return mNames.insert(name).first->c_str();
+}
+
+
+void FrameProfiler::recordEvent(const char* name, const uint64_t start, const uint64_t end)
+{
+    ThreadBuffer& buffer = getThreadBuffer();
+
+    const uint64_t index = buffer.mWriteIndex.load(std::memory_order_relaxed);
+    EventSlot& slot = buffer.mEvents[index % kEventsPerThread];
+    slot.mName.store(name, std::memory_order_relaxed);
+    slot.mStart.store(start, std::memory_order_relaxed);
+    slot.mEnd.store(end, std::memory_order_relaxed);
+    buffer.mWriteIndex.store(index + 1, std::memory_order_release);
+}
+
+
+void FrameProfiler::beginFrame()
+{
+    mFrames[mFrameIndex % kFrameHistory] = {now(), 0};
+}
+
+
+void FrameProfiler::endFrame()
+{
+    Frame& frame = mFrames[mFrameIndex % kFrameHistory];
+    frame.mEnd = now();
+    ++mFrameIndex;
+
+    std::filesystem::path capturePath;
+    uint32_t captureFrameCount = 0;
+    bool hitchCapture = false;
+    {
+        std::unique_lock lock(mCaptureMutex);
+        if(!mRequestedCapture.empty())
+        {
+            capturePath = mRequestedCapture;
+            captureFrameCount = mRequestedFrameCount;
+            mRequestedCapture.clear();
+        }
+    }
+
+    const std::chrono::microseconds frameTime{(frame.mEnd - frame.mStart) / 1000};
+    if(capturePath.empty() && mHitchThreshold.count() > 0 && frameTime > mHitchThreshold)
+    {
+        capturePath = mCaptureDirectory / ("hitch_" + std::to_string(mFrameIndex - 1) + ".json");
+        captureFrameCount = 8;
+        hitchCapture = true;
+    }
+
+    // Hitches come in runs, rather than stall the frame on the last write just skip them.
+    if(capturePath.empty() || (hitchCapture && mWriting.load(std::memory_order_acquire)))
+        return;
+
+    auto capture = std::make_unique<Capture>();
+    capture->mPath = capturePath;
+    if(!collectCapture(captureFrameCount, *capture))
+        return;
+
+    finishWrite();
+    mWriting.store(true, std::memory_order_release);
+    mWriter = std::thread([this, capture = std::move(capture)]()
+    {
+        if(!writeCapture(*capture))
+            printf("Failed to write profile capture %s\n", capture->mPath.string().c_str());
+        mWriting.store(false, std::memory_order_release);
+    });
+}
+
+
+void FrameProfiler::setHitchThreshold(const std::chrono::microseconds threshold, const std::filesystem::path& captureDirectory)
+{
+    mHitchThreshold = threshold;
+    mCaptureDirectory = captureDirectory;
+
+    if(mHitchThreshold.count() > 0 && !mCaptureDirectory.empty())
+        std::filesystem::create_directories(mCaptureDirectory);
+}
+
+
+void FrameProfiler::requestCapture(const std::filesystem::path& path, const uint32_t frameCount)
+{
+    std::unique_lock lock(mCaptureMutex);
+    mRequestedCapture = path;
+    mRequestedFrameCount = frameCount;
+}
+
+
+bool FrameProfiler::writeChromeTrace(const std::filesystem::path& path, const uint32_t frameCount)
+{
+    Capture capture;
+    capture.mPath = path;
+    if(!collectCapture(frameCount, capture))
+        return false;
+
+    return writeCapture(capture);
+}
+
+
+bool FrameProfiler::collectCapture(const uint32_t frameCount, Capture& capture)
+{
+    if(mFrameIndex == 0)
+        return false;
+
+    const uint64_t frames = std::min<uint64_t>({frameCount, mFrameIndex, kFrameHistory});
+    capture.mFirstFrame = mFrameIndex - frames;
+    for(uint64_t i = capture.mFirstFrame; i < mFrameIndex; ++i)
+        capture.mFrames.push_back(mFrames[i % kFrameHistory]);
+
+    const uint64_t windowStart = capture.mFrames.front().mStart;
+    const uint64_t windowEnd = capture.mFrames.back().mEnd;
+
+    std::vector<Event> events;
+
+    std::unique_lock lock(mThreadsMutex);
+    for(const auto& thread : mThreads)
+    {
+        ThreadCapture& threadCapture = capture.mThreads.emplace_back();
+        threadCapture.mThreadIndex = thread->mThreadIndex;
+        threadCapture.mName = thread->mName.load(std::memory_order_relaxed);
+
+        // Everything before the write index was finished before we started.
+        const uint64_t writeIndex = thread->mWriteIndex.load(std::memory_order_acquire);
+        const uint64_t firstIndex = writeIndex - std::min<uint64_t>(writeIndex, kEventsPerThread);
+        events.clear();
+        for(uint64_t i = firstIndex; i < writeIndex; ++i)
+        {
+            const EventSlot& slot = thread->mEvents[i % kEventsPerThread];
+            events.push_back({slot.mName.load(std::memory_order_relaxed),
+                              slot.mStart.load(std::memory_order_relaxed),
+                              slot.mEnd.load(std::memory_order_relaxed)});
+        }
+
+        // The owner keeps recording while we copy, anything it could have
+        // wrapped round and started overwriting since then gets dropped.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t writeIndexAfter = thread->mWriteIndex.load(std::memory_order_relaxed);
+        const uint64_t firstValid = writeIndexAfter + 1 > kEventsPerThread ? writeIndexAfter + 1 - kEventsPerThread : 0;
+
+        for(uint64_t i = std::max(firstIndex, firstValid); i < writeIndex; ++i)
+        {
+            const Event& event = events[i - firstIndex];
+            if(event.mEnd < windowStart || event.mStart > windowEnd || !event.mName)
+                continue;
+
+            threadCapture.mEvents.push_back(event);
+        }
+    }
+
+    return true;
+}
+
+
+bool FrameProfiler::writeCapture(const Capture& capture)
+{
+    std::ofstream file(capture.mPath);
+    if(!file.is_open())
+        return false;
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+
+    auto writeEvent = [&](const char* name, const uint32_t tid, const uint64_t start, const uint64_t end)
+    {
+        file << (first ? "" : ",\n") << "{\"name\":\"";
+        writeEscaped(file, name);
+        file << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+             << ",\"ts\":" << (start / 1000.0) << ",\"dur\":" << ((end - start) / 1000.0) << "}";
+        first = false;
+    };
+
+    // Frame markers on their own track so frame boundaries are easy to see.
+    for(uint64_t i = 0; i < capture.mFrames.size(); ++i)
+    {
+        const Frame& frame = capture.mFrames[i];
+        const std::string name = "Frame " + std::to_string(capture.mFirstFrame + i);
+        writeEvent(name.c_str(), 0, frame.mStart, frame.mEnd);
+    }
+
+    for(const ThreadCapture& thread : capture.mThreads)
+    {
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.mThreadIndex << ",\"args\":{\"name\":\"";
+        if(thread.mName)
+            writeEscaped(file, thread.mName);
+        else
+            file << "Thread " << thread.mThreadIndex;
+        file << "\"}}";
+        first = false;
+
+        for(const Event& event : thread.mEvents)
+            writeEvent(event.mName, thread.mThreadIndex, event.mStart, event.mEnd);
+    }
+
+    file << "\n]}\n";
+
+    return file.good();
+}
+
+
+void FrameProfiler::finishWrite()
+{
+    if(mWriter.joinable())
+        mWriter.join();
+}
+
+
+void installBulletProfilerHooks()
+{
+    btSetCustomEnterProfileZoneFunc(bulletEnterZone);
+    btSetCustomLeaveProfileZoneFunc(bulletLeaveZone);
+}
+
+}
@@ -0,0 +1,194 @@
+#ifndef TEMPEST_FRAME_PROFILER_HPP
+#define TEMPEST_FRAME_PROFILER_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace Tempest
+{
+
+// Records timed scopes from every thread into per thread ring buffers and can
+// write the last few frames out as a chrome://tracing / Perfetto json file.
+class FrameProfiler
+{
+public:
+
+    static FrameProfiler& get();
+
+    void setEnabled(const bool enabled)
+    {
+        mEnabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool isEnabled() const
+    {
+        return mEnabled.load(std::memory_order_relaxed);
+    }
+
+    // Called from the game thread around each iteration of the main loop.
+    void beginFrame();
+    void endFrame();
+
+    // Frames longer than this get written to the capture directory automatically, 0 disables.
+    void setHitchThreshold(const std::chrono::microseconds threshold, const std::filesystem::path& captureDirectory);
+
+    // Writes the last frameCount frames at the end of the current frame, the
+    // events are copied then and the file written on another thread.
+    void requestCapture(const std::filesystem::path& path, const uint32_t frameCount = 16);
+    // Blocks until written, call from the game thread between frames.
+    bool writeChromeTrace(const std::filesystem::path& path, const uint32_t frameCount);
+
+    void setThreadName(const char* name);
+
+    // Names have to outlive the capture, use this for anything not a literal.
+    const char* internName(const std::string& name);
+
+    void recordEvent(const char* name, const uint64_t start, const uint64_t end);
+
+    // Nanoseconds since the profiler was created.
+    uint64_t now() const
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - mEpoch).count());
+    }
+
+    static constexpr uint32_t kEventsPerThread = 1 << 16;
+    static constexpr uint32_t kFrameHistory = 256;
+    static constexpr uint32_t kMaxZoneDepth = 64;
+
+    struct Event
+    {
+        const char* mName;
+        uint64_t mStart;
+        uint64_t mEnd;
+    };
+
+    // Atomic so captures can read the ring while its owner is writing it,
+    // relaxed stores are plain moves so recording costs the same.
+    struct EventSlot
+    {
+        std::atomic<const char*> mName{nullptr};
+        std::atomic<uint64_t> mStart{0};
+        std::atomic<uint64_t> mEnd{0};
+    };
+
+    struct ThreadBuffer
+    {
+        std::array<EventSlot, kEventsPerThread> mEvents;
+        // Only written by the owning thread.
+        std::atomic<uint64_t> mWriteIndex{0};
+        uint32_t mThreadIndex = 0;
+        std::atomic<const char*> mName{nullptr};
+
+        // Open zones from Bullets profiler callbacks.
+        std::array<Event, kMaxZoneDepth> mZoneStack;
+        uint32_t mZoneDepth = 0;
+    };
+
+    ThreadBuffer& getThreadBuffer();
+
+private:
+
+    FrameProfiler();
+    ~FrameProfiler();
+
+    struct Frame
+    {
+        uint64_t mStart;
+        uint64_t mEnd;
+    };
+
+    struct ThreadCapture
+    {
+        uint32_t mThreadIndex;
+        const char* mName;
+        std::vector<Event> mEvents;
+    };
+
+    struct Capture
+    {
+        std::filesystem::path mPath;
+        uint64_t mFirstFrame;
+        std::vector<Frame> mFrames;
+        std::vector<ThreadCapture> mThreads;
+    };
+
+    // Copies the events of the last frameCount frames out of the rings.
+    bool collectCapture(const uint32_t frameCount, Capture&);
+    static bool writeCapture(const Capture&);
+    // Waits for the last background write.
+    void finishWrite();
+
+    std::chrono::steady_clock::time_point mEpoch;
+    std::atomic<bool> mEnabled;
+
+    std::mutex mThreadsMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> mThreads;
+
+    std::mutex mNamesMutex;
+    std::unordered_set<std::string> mNames;
+
+    std::array<Frame, kFrameHistory> mFrames;
+    uint64_t mFrameIndex;
+
+    std::chrono::microseconds mHitchThreshold;
+    std::filesystem::path mCaptureDirectory;
+
+    std::mutex mCaptureMutex;
+    std::filesystem::path mRequestedCapture;
+    uint32_t mRequestedFrameCount;
+
+    std::thread mWriter;
+    std::atomic<bool> mWriting;
+};
+
+
+class ScopedProfileEvent
+{
+public:
+    ScopedProfileEvent(const char* name) :
+        mName(name),
+        mStart(0)
+    {
+        FrameProfiler& profiler = FrameProfiler::get();
+        if(profiler.isEnabled())
+            mStart = profiler.now();
+        else
+            mName = nullptr;
+    }
+
+    ~ScopedProfileEvent()
+    {
+        if(mName)
+        {
+            FrameProfiler& profiler = FrameProfiler::get();
+            profiler.recordEvent(mName, mStart, profiler.now());
+        }
+    }
+
+private:
+    const char* mName;
+    uint64_t mStart;
+};
+
+// Forward Bullets CProfileManager zones in to the frame profiler.
+void installBulletProfilerHooks();
+
+}
+
+#define TEMPEST_PROFILE_CONCAT_IMPL(A, B) A ## B
+#define TEMPEST_PROFILE_CONCAT(A, B) TEMPEST_PROFILE_CONCAT_IMPL(A, B)
+
+#define TEMPEST_PROFILE_SCOPE(NAME) Tempest::ScopedProfileEvent TEMPEST_PROFILE_CONCAT(profileEvent_, __LINE__)(NAME);
+#define TEMPEST_PROFILE_FUNCTION() TEMPEST_PROFILE_SCOPE(__func__)
+#define TEMPEST_PROFILE_THREAD(NAME) Tempest::FrameProfiler::get().setThreadName(NAME);
+
+#endif
@@ -0,0 +1,92 @@
+#include "FrameStatistics.hpp"
+
+#include "Core/BellLogging.hpp"
+
+#include <algorithm>
+
+namespace Tempest
+{
+
+FrameStatistics::FrameStatistics(const uint32_t windowFrames) :
+    mWindow(std::max(windowFrames, 1u))
+{
+}
+
+
+uint32_t FrameStatistics::addChannel(const char* name)
+{
+    mChannels.push_back({name, {}, 0});
+    mChannels.back().mSamples.reserve(mWindow);
+
+    return static_cast<uint32_t>(mChannels.size() - 1);
+}
+
+
+void FrameStatistics::record(const uint32_t channel, const std::chrono::microseconds time)
+{
+    Channel& c = mChannels[channel];
+    const uint32_t sample = static_cast<uint32_t>(std::clamp<int64_t>(time.count(), 0, UINT32_MAX));
+
+    if(c.mSamples.size() < mWindow)
+        c.mSamples.push_back(sample);
+    else
+        c.mSamples[c.mNext] = sample;
+
+    c.mNext = (c.mNext + 1) % mWindow;
+}
+
+
+FramePercentiles FrameStatistics::getPercentiles(const uint32_t channel) const
+{
+    const Channel& c = mChannels[channel];
+
+    FramePercentiles result;
+    result.mSamples = static_cast<uint32_t>(c.mSamples.size());
+    if(c.mSamples.empty())
+        return result;
+
+    mSorted = c.mSamples;
+    std::sort(mSorted.begin(), mSorted.end());
+
+    // Nearest rank.
+    auto percentile = [&](const uint32_t p)
+    {
+        const size_t rank = (mSorted.size() * p + 99) / 100;
+        return std::chrono::microseconds(mSorted[std::max<size_t>(rank, 1) - 1]);
+    };
+
+    result.mP50 = percentile(50);
+    result.mP90 = percentile(90);
+    result.mP99 = percentile(99);
+    result.mMax = std::chrono::microseconds(mSorted.back());
+
+    return result;
+}
+
+
+void FrameStatistics::reset()
+{
+    for(Channel& channel : mChannels)
+    {
+        channel.mSamples.clear();
+        channel.mNext = 0;
+    }
+}
+
+
+void FrameStatistics::log() const
+{
+    for(uint32_t i = 0; i < mChannels.size(); ++i)
+    {
+        const FramePercentiles p = getPercentiles(i);
+        BELL_LOG_ARGS("%-10s p50 %6.2fms  p90 %6.2fms  p99 %6.2fms  max %6.2fms  (%u frames)",
+                      mChannels[i].mName,
+                      p.mP50.count() / 1000.0,
+                      p.mP90.count() / 1000.0,
+                      p.mP99.count() / 1000.0,
+                      p.mMax.count() / 1000.0,
+                      p.mSamples);
+    }
+}
+
+}
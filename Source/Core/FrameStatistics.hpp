@@ -0,0 +1,65 @@
+#ifndef TEMPEST_FRAME_STATISTICS_HPP
+#define TEMPEST_FRAME_STATISTICS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace Tempest
+{
+
+struct FramePercentiles
+{
+    std::chrono::microseconds mP50{0};
+    std::chrono::microseconds mP90{0};
+    std::chrono::microseconds mP99{0};
+    std::chrono::microseconds mMax{0};
+    uint32_t mSamples = 0;
+};
+
+// The last windowFrames samples of a handful of per frame timings, with
+// percentiles worked out on demand rather than every frame.
+class FrameStatistics
+{
+public:
+    FrameStatistics(const uint32_t windowFrames = 600);
+
+    // Returns the channel index, name must outlive this.
+    uint32_t addChannel(const char* name);
+    void record(const uint32_t channel, const std::chrono::microseconds);
+
+    FramePercentiles getPercentiles(const uint32_t channel) const;
+
+    const char* getChannelName(const uint32_t channel) const
+    {
+        return mChannels[channel].mName;
+    }
+
+    uint32_t getChannelCount() const
+    {
+        return static_cast<uint32_t>(mChannels.size());
+    }
+
+    // Drops the samples, channels stay.
+    void reset();
+
+    // A line per channel.
+    void log() const;
+
+private:
+
+    struct Channel
+    {
+        const char* mName;
+        std::vector<uint32_t> mSamples;
+        uint32_t mNext;
+    };
+
+    uint32_t mWindow;
+    std::vector<Channel> mChannels;
+    mutable std::vector<uint32_t> mSorted;
+};
+
+}
+
+#endif
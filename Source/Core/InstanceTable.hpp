@@ -0,0 +1,138 @@
+#ifndef TEMPEST_INSTANCE_TABLE_HPP
+#define TEMPEST_INSTANCE_TABLE_HPP
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Engine/Scene.h"
+
+namespace Tempest
+{
+
+// Generation in the high 32 bits, slot index in the low.
+using InstanceHandle = uint64_t;
+constexpr InstanceHandle kInvalidInstanceHandle = ~0ull;
+
+// Central slot table for level instances. Scripts and gameplay hold handles,
+// the slot has the index into each subsystem so a lookup is an array index and
+// a generation compare. Removing an instance bumps the generation so a handle
+// held on to after that fails to resolve instead of aliasing whatever reuses
+// the slot.
+class InstanceTable
+{
+public:
+
+    static constexpr uint32_t kInvalidIndex = ~0u;
+
+    struct Slot
+    {
+        InstanceID mInstance = kInvalidInstanceID;
+        uint32_t mPhysicsIndex = kInvalidIndex;
+        uint32_t mGeneration = 0;
+        bool mAlive = false;
+    };
+
+    InstanceHandle create(const InstanceID id)
+    {
+        uint32_t index;
+        if(mFreeSlots.empty())
+        {
+            index = static_cast<uint32_t>(mSlots.size());
+            mSlots.emplace_back();
+        }
+        else
+        {
+            index = mFreeSlots.back();
+            mFreeSlots.pop_back();
+        }
+
+        Slot& slot = mSlots[index];
+        slot.mInstance = id;
+        slot.mPhysicsIndex = kInvalidIndex;
+        slot.mAlive = true;
+
+        const InstanceHandle handle = makeHandle(index, slot.mGeneration);
+        mHandles[id] = handle;
+
+        return handle;
+    }
+
+    void destroy(const InstanceHandle handle)
+    {
+        Slot* slot = get(handle);
+        if(!slot)
+            return;
+
+        mHandles.erase(slot->mInstance);
+
+        slot->mInstance = kInvalidInstanceID;
+        slot->mPhysicsIndex = kInvalidIndex;
+        slot->mAlive = false;
+        ++slot->mGeneration;
+
+        mFreeSlots.push_back(getIndex(handle));
+    }
+
+    // nullptr for stale or invalid handles.
+    Slot* get(const InstanceHandle handle)
+    {
+        const uint32_t index = getIndex(handle);
+        if(index >= mSlots.size())
+            return nullptr;
+
+        Slot& slot = mSlots[index];
+        return slot.mAlive && slot.mGeneration == getGeneration(handle) ? &slot : nullptr;
+    }
+
+    const Slot* get(const InstanceHandle handle) const
+    {
+        return const_cast<InstanceTable*>(this)->get(handle);
+    }
+
+    bool isValid(const InstanceHandle handle) const
+    {
+        return get(handle) != nullptr;
+    }
+
+    // Hashed, for resolving from names and editor selections not per frame use.
+    InstanceHandle getHandle(const InstanceID id) const
+    {
+        if(auto it = mHandles.find(id); it != mHandles.end())
+            return it->second;
+        else
+            return kInvalidInstanceHandle;
+    }
+
+    void clear()
+    {
+        mSlots.clear();
+        mFreeSlots.clear();
+        mHandles.clear();
+    }
+
+    static uint32_t getIndex(const InstanceHandle handle)
+    {
+        return static_cast<uint32_t>(handle);
+    }
+
+    static uint32_t getGeneration(const InstanceHandle handle)
+    {
+        return static_cast<uint32_t>(handle >> 32);
+    }
+
+private:
+
+    static InstanceHandle makeHandle(const uint32_t index, const uint32_t generation)
+    {
+        return (static_cast<uint64_t>(generation) << 32) | index;
+    }
+
+    std::vector<Slot> mSlots;
+    std::vector<uint32_t> mFreeSlots;
+    std::unordered_map<InstanceID, InstanceHandle> mHandles;
+};
+
+}
+
+#endif
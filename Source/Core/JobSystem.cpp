@@ -0,0 +1,300 @@
+#include "JobSystem.hpp"
+#include "FrameProfiler.hpp"
+
+#include "Core/Profiling.hpp"
+
+#include <chrono>
+#include <iterator>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#endif
+
+namespace Tempest
+{
+
+namespace
+{
+    // Queue index of the current thread, 0 for anything that isn't a worker.
+    // There's only ever one job system so this doesn't need to know which.
+    thread_local uint32_t tThreadIndex = 0;
+
+    // Failed steals while jobs are queued (the queue holding them is locked,
+    // or a push hasn't landed yet) spin, then yield, then sleep for a bit.
+    constexpr uint32_t kStealSpins = 32;
+    constexpr uint32_t kStealYields = 32;
+    constexpr std::chrono::microseconds kStealBackoff(50);
+
+    const char* kWorkerNames[] = {"Worker Thread 0", "Worker Thread 1", "Worker Thread 2", "Worker Thread 3",
+                                  "Worker Thread 4", "Worker Thread 5", "Worker Thread 6", "Worker Thread 7",
+                                  "Worker Thread 8", "Worker Thread 9", "Worker Thread 10", "Worker Thread 11",
+                                  "Worker Thread 12", "Worker Thread 13", "Worker Thread 14", "Worker Thread 15"};
+
+    void pinCurrentThread(const int core)
+    {
+#if defined(_WIN32)
+        SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core);
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set);
+#else
+        (void)core;
+#endif
+    }
+}
+
+
+void JobCounter::decrement(JobSystem& jobs)
+{
+    std::vector<Continuation> continuations;
+    JobCounter* parent = mParent;
+
+    // Held across the decrement so wait() can't return (and the counter go
+    // out of scope) until we're done touching it.
+    {
+        std::unique_lock lock(mContinuationMutex);
+        if(mCount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+
+        continuations.swap(mContinuations);
+    }
+
+    for(Continuation& continuation : continuations)
+        jobs.run(std::move(continuation.mFunction), continuation.mCounter, continuation.mName);
+
+    if(parent)
+        parent->decrement(jobs);
+}
+
+
+JobSystem::JobSystem(const JobSystemSettings& settings) :
+    mQueuedJobs(0),
+    mShouldExit(false)
+{
+    uint32_t workerCount = settings.mWorkerCount;
+    if(workerCount == 0)
+    {
+        const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = hardwareThreads > 3 ? hardwareThreads - 2 : 1;
+    }
+
+    // Queue 0 belongs to the threads that aren't workers.
+    for(uint32_t i = 0; i <= workerCount; ++i)
+        mQueues.push_back(std::make_unique<Queue>());
+
+    const uint32_t coreCount = std::max(std::thread::hardware_concurrency(), 1u);
+    mThreads.reserve(workerCount);
+    for(uint32_t i = 0; i < workerCount; ++i)
+    {
+        const int core = settings.mPinWorkers ? static_cast<int>((settings.mFirstCore + i) % coreCount) : -1;
+        mThreads.emplace_back(&JobSystem::workerLoop, this, i + 1, core);
+    }
+}
+
+
+JobSystem::~JobSystem()
+{
+    {
+        std::unique_lock lock(mSleepMutex);
+        mShouldExit = true;
+    }
+    mWorkAvailable.notify_all();
+
+    for(auto& thread : mThreads)
+        thread.join();
+}
+
+
+uint32_t JobSystem::getCurrentThreadIndex()
+{
+    return tThreadIndex;
+}
+
+
+void JobSystem::run(JobFunction f, JobCounter* counter, const char* name)
+{
+    if(counter)
+        counter->increment(1);
+
+    // Nobody to hand it to.
+    if(mThreads.empty())
+    {
+        Job job{std::move(f), counter, name};
+        execute(job);
+        return;
+    }
+
+    push({std::move(f), counter, name});
+}
+
+
+void JobSystem::then(JobCounter& dependency, JobFunction f, JobCounter* counter, const char* name)
+{
+    // Count it now so anything waiting on counter waits for the continuation too.
+    if(counter)
+        counter->increment(1);
+
+    {
+        std::unique_lock lock(dependency.mContinuationMutex);
+        if(!dependency.isDone())
+        {
+            dependency.mContinuations.push_back({std::move(f), counter, name});
+            return;
+        }
+    }
+
+    if(mThreads.empty())
+    {
+        Job job{std::move(f), counter, name};
+        execute(job);
+        return;
+    }
+
+    push({std::move(f), counter, name});
+}
+
+
+void JobSystem::wait(JobCounter& counter)
+{
+    TEMPEST_PROFILE_SCOPE("Wait for jobs")
+
+    while(!counter.isDone())
+    {
+        if(!tryRunJob())
+            std::this_thread::yield();
+    }
+
+    // Make sure whoever finished it has let go of the counter.
+    std::unique_lock lock(counter.mContinuationMutex);
+}
+
+
+void JobSystem::push(Job&& job)
+{
+    // Counted first so a thief can't take it and drop the count below zero.
+    mQueuedJobs.fetch_add(1, std::memory_order_release);
+
+    Queue& queue = *mQueues[tThreadIndex];
+    {
+        std::unique_lock lock(queue.mMutex);
+        queue.mJobs.push_back(std::move(job));
+    }
+
+    // Take the sleep lock so a worker can't check for work and then miss this.
+    {
+        std::unique_lock lock(mSleepMutex);
+    }
+    mWorkAvailable.notify_one();
+}
+
+
+bool JobSystem::pop(const uint32_t index, Job& job)
+{
+    Queue& queue = *mQueues[index];
+    std::unique_lock lock(queue.mMutex);
+    if(queue.mJobs.empty())
+        return false;
+
+    job = std::move(queue.mJobs.back());
+    queue.mJobs.pop_back();
+    return true;
+}
+
+
+bool JobSystem::steal(const uint32_t index, Job& job)
+{
+    const uint32_t queueCount = static_cast<uint32_t>(mQueues.size());
+    for(uint32_t i = 1; i < queueCount; ++i)
+    {
+        Queue& victim = *mQueues[(index + i) % queueCount];
+        std::unique_lock lock(victim.mMutex, std::try_to_lock);
+        if(!lock.owns_lock() || victim.mJobs.empty())
+            continue;
+
+        job = std::move(victim.mJobs.front());
+        victim.mJobs.pop_front();
+        return true;
+    }
+
+    return false;
+}
+
+
+bool JobSystem::tryRunJob()
+{
+    if(mQueuedJobs.load(std::memory_order_acquire) == 0)
+        return false;
+
+    Job job;
+    if(!pop(tThreadIndex, job) && !steal(tThreadIndex, job))
+        return false;
+
+    mQueuedJobs.fetch_sub(1, std::memory_order_acq_rel);
+    execute(job);
+
+    return true;
+}
+
+
+void JobSystem::execute(Job& job)
+{
+    {
+        TEMPEST_PROFILE_SCOPE(job.mName ? job.mName : "Job")
+        job.mFunction();
+    }
+
+    if(job.mCounter)
+        job.mCounter->decrement(*this);
+}
+
+
+void JobSystem::workerLoop(const uint32_t index, const int core)
+{
+    const char* name = index <= std::size(kWorkerNames) ? kWorkerNames[index - 1] : "Worker Thread";
+    PROFILER_THREAD("Worker Thread")
+    TEMPEST_PROFILE_THREAD(name)
+
+    tThreadIndex = index;
+    if(core >= 0)
+        pinCurrentThread(core);
+
+    uint32_t failedSteals = 0;
+    while(true)
+    {
+        if(tryRunJob())
+        {
+            failedSteals = 0;
+            continue;
+        }
+
+        if(mQueuedJobs.load(std::memory_order_acquire) > 0 && !mShouldExit)
+        {
+            ++failedSteals;
+            if(failedSteals <= kStealSpins)
+                continue;
+
+            if(failedSteals <= kStealSpins + kStealYields)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+        }
+
+        std::unique_lock lock(mSleepMutex);
+        if(mQueuedJobs.load(std::memory_order_acquire) > 0)
+            mWorkAvailable.wait_for(lock, kStealBackoff, [this]{ return mShouldExit.load(); });
+        else
+            mWorkAvailable.wait(lock, [this]{ return mShouldExit || mQueuedJobs.load(std::memory_order_acquire) > 0; });
+
+        if(mShouldExit)
+            return;
+
+        failedSteals = 0;
+    }
+}
+
+}
@@ -0,0 +1,183 @@
+#ifndef TEMPEST_JOB_SYSTEM_HPP
+#define TEMPEST_JOB_SYSTEM_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Tempest
+{
+    class JobSystem;
+
+using JobFunction = std::function<void()>;
+
+struct JobSystemSettings
+{
+    // 0 leaves a core each for the game and render threads.
+    uint32_t mWorkerCount = 0;
+    // Pin worker i to core mFirstCore + i, wrapping around.
+    bool mPinWorkers = false;
+    uint32_t mFirstCore = 2;
+};
+
+// Counts outstanding jobs. Counters with a parent keep the parent from
+// completing until they do, continuations added with JobSystem::then are
+// kicked off when the count drops to zero.
+class JobCounter
+{
+public:
+    JobCounter(JobCounter* parent = nullptr) :
+        mCount(0),
+        mParent(parent) {}
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool isDone() const
+    {
+        return mCount.load(std::memory_order_acquire) == 0;
+    }
+
+private:
+    friend class JobSystem;
+
+    struct Continuation
+    {
+        JobFunction mFunction;
+        JobCounter* mCounter;
+        const char* mName;
+    };
+
+    void increment(const uint32_t count)
+    {
+        if(mCount.fetch_add(count, std::memory_order_acq_rel) == 0 && mParent)
+            mParent->increment(1);
+    }
+
+    void decrement(JobSystem&);
+
+    std::atomic<uint32_t> mCount;
+    JobCounter* mParent;
+
+    std::mutex mContinuationMutex;
+    std::vector<Continuation> mContinuations;
+};
+
+// Work stealing scheduler. Each worker pushes and pops its own queue from the
+// back and steals from the front of the others, threads that aren't workers
+// share one extra queue. Waiting on a counter runs other jobs rather than
+// blocking, so jobs are free to start and wait on child jobs.
+class JobSystem
+{
+public:
+    JobSystem(const JobSystemSettings& = {});
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // name must be a literal or interned, it's used for the profiler scope.
+    void run(JobFunction, JobCounter* counter = nullptr, const char* name = nullptr);
+
+    // Runs f once dependency reaches zero, straight away if it already has.
+    void then(JobCounter& dependency, JobFunction, JobCounter* counter = nullptr, const char* name = nullptr);
+
+    // Helps out with queued jobs until the counter is done.
+    void wait(JobCounter&);
+
+    // Calls f(begin, end) over [0, count) in batches of at least grainSize.
+    template<typename F>
+    void parallelForRange(const uint32_t count, const uint32_t grainSize, F&& f)
+    {
+        if(count == 0)
+            return;
+
+        // A few batches per thread is enough to even out uneven work.
+        const uint32_t batchTarget = getThreadCount() * 4;
+        const uint32_t batchSize = std::max({grainSize, 1u, (count + batchTarget - 1) / batchTarget});
+        if(batchSize >= count)
+        {
+            f(0u, count);
+            return;
+        }
+
+        JobCounter counter;
+        for(uint32_t begin = batchSize; begin < count; begin += batchSize)
+        {
+            const uint32_t end = std::min(begin + batchSize, count);
+            run([&f, begin, end]() { f(begin, end); }, &counter);
+        }
+
+        // First batch on this thread.
+        f(0u, std::min(batchSize, count));
+        wait(counter);
+    }
+
+    // Calls f(i) for every i in [0, count), returns once all are done.
+    template<typename F>
+    void parallelFor(const uint32_t count, F&& f, const uint32_t grainSize = 1)
+    {
+        parallelForRange(count, grainSize, [&f](const uint32_t begin, const uint32_t end)
+        {
+            for(uint32_t i = begin; i < end; ++i)
+                f(i);
+        });
+    }
+
+    // Workers plus the thread that created the system.
+    uint32_t getThreadCount() const
+    {
+        return static_cast<uint32_t>(mQueues.size());
+    }
+
+    uint32_t getWorkerCount() const
+    {
+        return static_cast<uint32_t>(mQueues.size() - 1);
+    }
+
+    // 0 for threads that aren't workers.
+    static uint32_t getCurrentThreadIndex();
+
+private:
+
+    struct Job
+    {
+        JobFunction mFunction;
+        JobCounter* mCounter;
+        const char* mName;
+    };
+
+    struct Queue
+    {
+        std::mutex mMutex;
+        std::deque<Job> mJobs;
+    };
+
+    void push(Job&&);
+    bool pop(const uint32_t index, Job&);
+    bool steal(const uint32_t index, Job&);
+    // Runs one job from our queue or someone else's.
+    bool tryRunJob();
+    void execute(Job&);
+
+    void workerLoop(const uint32_t index, const int core);
+
+    std::vector<std::unique_ptr<Queue>> mQueues;
+    std::vector<std::thread> mThreads;
+
+    std::atomic<uint32_t> mQueuedJobs;
+    std::mutex mSleepMutex;
+    std::condition_variable mWorkAvailable;
+    std::atomic<bool> mShouldExit;
+};
+
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef TEMPEST_RANDOM_HPP
+#define TEMPEST_RANDOM_HPP
+
+#include <cstdint>
+
+namespace Tempest
+{
+
+// xoshiro256** seeded through splitmix64. Anything gameplay related should
+// draw from the engines instance (lua's math.random gets seeded alongside it)
+// so that a replay with the same seed plays out exactly the same.
+class Random
+{
+public:
+    Random(const uint64_t seed = 0)
+    {
+        setSeed(seed);
+    }
+
+    void setSeed(const uint64_t seed)
+    {
+        mSeed = seed;
+
+        uint64_t x = seed;
+        for(uint64_t& s : mState)
+        {
+            x += 0x9E3779B97F4A7C15ull;
+            uint64_t z = x;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            s = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t getSeed() const
+    {
+        return mSeed;
+    }
+
+    uint64_t next()
+    {
+        const uint64_t result = rotl(mState[1] * 5, 7) * 9;
+        const uint64_t t = mState[1] << 17;
+
+        mState[2] ^= mState[0];
+        mState[3] ^= mState[1];
+        mState[1] ^= mState[2];
+        mState[0] ^= mState[3];
+        mState[2] ^= t;
+        mState[3] = rotl(mState[3], 45);
+
+        return result;
+    }
+
+    // [0, 1)
+    float nextFloat()
+    {
+        return static_cast<float>(next() >> 40) * (1.0f / 16777216.0f);
+    }
+
+    // [min, max)
+    float range(const float min, const float max)
+    {
+        return min + (max - min) * nextFloat();
+    }
+
+    // [min, max]
+    int32_t range(const int32_t min, const int32_t max)
+    {
+        if(max <= min)
+            return min;
+
+        const uint64_t span = static_cast<uint64_t>(static_cast<int64_t>(max) - min) + 1;
+        return static_cast<int32_t>(min + static_cast<int64_t>(((next() >> 32) * span) >> 32));
+    }
+
+private:
+
+    static uint64_t rotl(const uint64_t x, const int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    uint64_t mSeed;
+    uint64_t mState[4];
+};
+
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef TEMPEST_RING_BUFFER_HPP
+#define TEMPEST_RING_BUFFER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace Tempest
+{
+
+// Fixed size single producer / single consumer queue, no locks so the
+// producer can be a callback or another thread without stalling the consumer.
+template<typename T, uint32_t Capacity>
+class RingBuffer
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity needs to be a power of two");
+
+public:
+
+    // Producer only, false when full.
+    bool push(const T& value)
+    {
+        const uint32_t head = mHead.load(std::memory_order_relaxed);
+        if(head - mTail.load(std::memory_order_acquire) == Capacity)
+            return false;
+
+        mItems[head & (Capacity - 1)] = value;
+        mHead.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Consumer only, nullptr when empty.
+    const T* peek() const
+    {
+        const uint32_t tail = mTail.load(std::memory_order_relaxed);
+        if(tail == mHead.load(std::memory_order_acquire))
+            return nullptr;
+
+        return &mItems[tail & (Capacity - 1)];
+    }
+
+    // Consumer only, drops what peek returned.
+    void pop()
+    {
+        mTail.store(mTail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    uint32_t size() const
+    {
+        return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<T, Capacity> mItems;
+    // Separate lines so the two sides don't fight over them.
+    alignas(64) std::atomic<uint32_t> mHead{0};
+    alignas(64) std::atomic<uint32_t> mTail{0};
+};
+
+}
+
+#endif
@@ -0,0 +1,201 @@
+#include "SystemGraph.hpp"
+#include "JobSystem.hpp"
+#include "FrameProfiler.hpp"
+
+#include "Core/BellLogging.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+namespace Tempest
+{
+
+uint32_t SystemGraph::addSystem(const char* name, const ResourceMask reads, const ResourceMask writes, std::function<void()> f, const Affinity affinity)
+{
+    mSystems.push_back({name, reads, writes, std::move(f), affinity, {}, 0, 0});
+    mCompiled = false;
+
+    return static_cast<uint32_t>(mSystems.size() - 1);
+}
+
+
+void SystemGraph::compile()
+{
+    mWaves.clear();
+    mWaveWorkerCounts.clear();
+
+    for(uint32_t i = 0; i < mSystems.size(); ++i)
+    {
+        System& system = mSystems[i];
+        system.mDependencies.clear();
+        system.mWave = 0;
+
+        for(uint32_t j = 0; j < i; ++j)
+        {
+            const System& earlier = mSystems[j];
+            const bool conflicts = (earlier.mWrites & (system.mReads | system.mWrites)) || (earlier.mReads & system.mWrites);
+            if(conflicts)
+            {
+                system.mDependencies.push_back(j);
+                system.mWave = std::max(system.mWave, earlier.mWave + 1);
+            }
+        }
+
+        if(system.mWave >= mWaves.size())
+            mWaves.resize(system.mWave + 1);
+        mWaves[system.mWave].push_back(i);
+    }
+
+    // Workers take the front of each wave, the calling thread runs the rest after.
+    for(std::vector<uint32_t>& wave : mWaves)
+    {
+        auto mainThreadStart = std::stable_partition(wave.begin(), wave.end(), [this](const uint32_t i) { return mSystems[i].mAffinity == Affinity::Any; });
+        mWaveWorkerCounts.push_back(static_cast<uint32_t>(mainThreadStart - wave.begin()));
+    }
+
+    mCompiled = true;
+}
+
+
+void SystemGraph::runSystem(const uint32_t index)
+{
+    System& system = mSystems[index];
+    TEMPEST_PROFILE_SCOPE(system.mName)
+
+    const auto start = std::chrono::steady_clock::now();
+    system.mFunction();
+    system.mLastDuration = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+
+void SystemGraph::run(JobSystem& jobs)
+{
+    if(!mCompiled)
+        compile();
+
+    FrameProfiler& profiler = FrameProfiler::get();
+    const uint64_t start = profiler.now();
+
+    for(uint32_t w = 0; w < mWaves.size(); ++w)
+    {
+        const std::vector<uint32_t>& wave = mWaves[w];
+        const uint32_t workerCount = mWaveWorkerCounts[w];
+
+        if(workerCount == 1)
+            runSystem(wave[0]);
+        else if(workerCount > 1)
+            jobs.parallelFor(workerCount, [&](const uint32_t i) { runSystem(wave[i]); });
+
+        for(uint32_t i = workerCount; i < wave.size(); ++i)
+            runSystem(wave[i]);
+    }
+
+    updateCriticalPath();
+
+    if(mCriticalPathName && profiler.isEnabled())
+        profiler.recordEvent(mCriticalPathName, start, profiler.now());
+}
+
+
+void SystemGraph::updateCriticalPath()
+{
+    std::vector<uint64_t> finish(mSystems.size(), 0);
+    std::vector<uint32_t> previous(mSystems.size(), ~0u);
+
+    uint32_t last = 0;
+    for(uint32_t i = 0; i < mSystems.size(); ++i)
+    {
+        uint64_t ready = 0;
+        for(const uint32_t dependency : mSystems[i].mDependencies)
+        {
+            if(finish[dependency] > ready)
+            {
+                ready = finish[dependency];
+                previous[i] = dependency;
+            }
+        }
+
+        finish[i] = ready + mSystems[i].mLastDuration;
+        if(finish[i] >= finish[last])
+            last = i;
+    }
+
+    mCriticalPath.clear();
+    if(mSystems.empty())
+        return;
+
+    for(uint32_t i = last; i != ~0u; i = previous[i])
+        mCriticalPath.push_back(i);
+    std::reverse(mCriticalPath.begin(), mCriticalPath.end());
+
+    // Only intern a new name when the path actually changes.
+    uint64_t hash = 14695981039346656037ull;
+    for(const uint32_t i : mCriticalPath)
+        hash = (hash ^ i) * 1099511628211ull;
+
+    if(hash != mCriticalPathHash || !mCriticalPathName)
+    {
+        std::string name = "Critical path:";
+        for(const uint32_t i : mCriticalPath)
+        {
+            name += i == mCriticalPath.front() ? " " : " > ";
+            name += mSystems[i].mName;
+        }
+
+        mCriticalPathName = FrameProfiler::get().internName(name);
+        mCriticalPathHash = hash;
+    }
+}
+
+
+bool SystemGraph::writeGraph(const std::filesystem::path& path) const
+{
+    std::ofstream file(path);
+    if(!file.is_open())
+    {
+        BELL_LOG_ARGS("Failed to write system graph %s", path.string().c_str());
+        return false;
+    }
+
+    auto onCriticalPath = [this](const uint32_t i)
+    {
+        return std::find(mCriticalPath.begin(), mCriticalPath.end(), i) != mCriticalPath.end();
+    };
+
+    file << "digraph Frame {\n    rankdir=LR;\n    node [shape=box];\n";
+    for(uint32_t i = 0; i < mSystems.size(); ++i)
+    {
+        const System& system = mSystems[i];
+        file << "    s" << i << " [label=\"" << system.mName << "\\n" << (system.mLastDuration / 1000) << "us\"";
+        if(system.mAffinity == Affinity::MainThread)
+            file << " style=dashed";
+        if(onCriticalPath(i))
+            file << " color=red";
+        file << "];\n";
+    }
+
+    for(uint32_t i = 0; i < mSystems.size(); ++i)
+    {
+        for(const uint32_t dependency : mSystems[i].mDependencies)
+        {
+            // Skip edges already implied by another path so the picture stays readable.
+            const bool implied = std::any_of(mSystems[i].mDependencies.begin(), mSystems[i].mDependencies.end(), [&](const uint32_t other)
+            {
+                const std::vector<uint32_t>& otherDependencies = mSystems[other].mDependencies;
+                return other != dependency && std::find(otherDependencies.begin(), otherDependencies.end(), dependency) != otherDependencies.end();
+            });
+            if(implied)
+                continue;
+
+            file << "    s" << dependency << " -> s" << i;
+            if(onCriticalPath(i) && onCriticalPath(dependency))
+                file << " [color=red]";
+            file << ";\n";
+        }
+    }
+    file << "}\n";
+
+    return true;
+}
+
+}
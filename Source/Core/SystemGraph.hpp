@@ -0,0 +1,101 @@
+#ifndef TEMPEST_SYSTEM_GRAPH_HPP
+#define TEMPEST_SYSTEM_GRAPH_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Tempest
+{
+    class JobSystem;
+
+// Per frame systems with the resources they read and write. Systems are
+// added in the order they would run serially, a system depends on every
+// earlier one it conflicts with (write/read, read/write or write/write on a
+// resource) and systems with no path between them run in the same wave on
+// the job system. Last frames timings give the critical path, which goes in
+// to the frame profiler and the dot output.
+class SystemGraph
+{
+public:
+
+    using ResourceMask = uint32_t;
+    static constexpr ResourceMask kAllResources = ~0u;
+
+    enum class Affinity
+    {
+        Any,
+        // Has to run on the thread calling run, glfw, lua or a lock it owns.
+        MainThread
+    };
+
+    // Returns the system index.
+    uint32_t addSystem(const char* name, const ResourceMask reads, const ResourceMask writes, std::function<void()> f, const Affinity = Affinity::Any);
+
+    // Runs on the calling thread with everything before finished and nothing after started.
+    uint32_t addSyncPoint(const char* name, std::function<void()> f)
+    {
+        return addSystem(name, kAllResources, kAllResources, std::move(f), Affinity::MainThread);
+    }
+
+    void run(JobSystem&);
+
+    uint32_t getSystemCount() const
+    {
+        return static_cast<uint32_t>(mSystems.size());
+    }
+
+    const char* getName(const uint32_t system) const
+    {
+        return mSystems[system].mName;
+    }
+
+    // Nanoseconds each system took last run, in add order.
+    uint64_t getLastDuration(const uint32_t system) const
+    {
+        return mSystems[system].mLastDuration;
+    }
+
+    const std::vector<uint32_t>& getCriticalPath() const
+    {
+        return mCriticalPath;
+    }
+
+    // Graphviz, critical path in red.
+    bool writeGraph(const std::filesystem::path&) const;
+
+private:
+
+    void compile();
+    void runSystem(const uint32_t);
+    void updateCriticalPath();
+
+    struct System
+    {
+        const char* mName;
+        ResourceMask mReads;
+        ResourceMask mWrites;
+        std::function<void()> mFunction;
+        Affinity mAffinity;
+
+        std::vector<uint32_t> mDependencies;
+        uint32_t mWave;
+        uint64_t mLastDuration;
+    };
+
+    std::vector<System> mSystems;
+    // System indices per wave, workers first then main thread ones.
+    std::vector<std::vector<uint32_t>> mWaves;
+    std::vector<uint32_t> mWaveWorkerCounts;
+    bool mCompiled = false;
+
+    std::vector<uint32_t> mCriticalPath;
+    const char* mCriticalPathName = nullptr;
+    uint64_t mCriticalPathHash = 0;
+};
+
+}
+
+#endif
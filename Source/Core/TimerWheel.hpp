@@ -0,0 +1,91 @@
+#ifndef TEMPEST_TIMER_WHEEL_HPP
+#define TEMPEST_TIMER_WHEEL_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace Tempest
+{
+
+// Hashed timer wheel, timers are bucketed by due tick modulo the slot count so
+// advancing only touches the slots that could have something due. Timers
+// further out than one revolution just sit in their slot until their turn.
+class TimerWheel
+{
+public:
+    TimerWheel(const uint32_t slotCount) :
+        mSlots(slotCount),
+        mCurrentTick(0),
+        mTimerCount(0) {}
+
+    void schedule(const uint64_t dueTick, const uint64_t id)
+    {
+        // Anything already due fires on the next advance.
+        const uint64_t tick = dueTick > mCurrentTick ? dueTick : mCurrentTick + 1;
+        mSlots[tick % mSlots.size()].push_back({tick, id});
+        ++mTimerCount;
+    }
+
+    // Calls f(id) for every timer due at or before tick, f is free to schedule new timers.
+    template<typename F>
+    void advance(const uint64_t tick, F&& f)
+    {
+        if(tick <= mCurrentTick)
+            return;
+
+        mDue.clear();
+        if(mTimerCount > 0)
+        {
+            const uint64_t slotsToVisit = std::min<uint64_t>(tick - mCurrentTick, mSlots.size());
+            for(uint64_t i = 1; i <= slotsToVisit; ++i)
+            {
+                std::vector<Timer>& slot = mSlots[(mCurrentTick + i) % mSlots.size()];
+                for(size_t t = 0; t < slot.size();)
+                {
+                    if(slot[t].mDueTick <= tick)
+                    {
+                        mDue.push_back(slot[t].mID);
+                        slot[t] = slot.back();
+                        slot.pop_back();
+                        --mTimerCount;
+                    }
+                    else
+                        ++t;
+                }
+            }
+        }
+
+        mCurrentTick = tick;
+
+        for(const uint64_t id : mDue)
+            f(id);
+    }
+
+    uint64_t getCurrentTick() const
+    {
+        return mCurrentTick;
+    }
+
+    uint32_t getTimerCount() const
+    {
+        return mTimerCount;
+    }
+
+private:
+
+    struct Timer
+    {
+        uint64_t mDueTick;
+        uint64_t mID;
+    };
+
+    std::vector<std::vector<Timer>> mSlots;
+    std::vector<uint64_t> mDue;
+    uint64_t mCurrentTick;
+    uint32_t mTimerCount;
+};
+
+}
+
+#endif
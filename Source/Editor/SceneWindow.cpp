@@ -64,11 +64,12 @@ namespace Tempest
 
                 if(ImGui::TreeNode("Cameras"))
                 {
-                    const std::unordered_map<std::string, Camera>& cameras = mCurrentLevel->getCameras();
-                    for(const auto& [name, cam] : cameras)
+                    const std::unordered_map<std::string, CameraHandle>& cameras = mCurrentLevel->getCameras();
+                    for(const auto& [name, handle] : cameras)
                     {
                         if(ImGui::TreeNode(name.c_str()))
                         {
+                            const Camera& cam = mCurrentLevel->getCamera(handle);
                             const float3& position = cam.getPosition();
                             const float3& direction = cam.getDirection();
                             ImGui::Text("Position %f %f %f", position.x, position.y, position.z);
@@ -217,6 +218,10 @@ namespace Tempest
                      mesh["Path"] = path.string();
                  mesh["Dynamism"] = isDynamic ? "Dynamic" : "Static";
 
+                 const std::filesystem::path graphPath = mCurrentLevel->getAnimationGraphPath(id);
+                 if(!graphPath.empty())
+                     mesh["AnimationGraph"] = graphPath.string();
+
                 meshJson[name] = mesh;
             }
 
@@ -306,10 +311,11 @@ namespace Tempest
 
         // Export Cameras
         {
-            const std::unordered_map<std::string, Camera>& cameras = mCurrentLevel->getCameras();
+            const std::unordered_map<std::string, CameraHandle>& cameras = mCurrentLevel->getCameras();
             Json::Value camerasJson{};
-            for(const auto&[name, cam] : cameras)
+            for(const auto&[name, handle] : cameras)
             {
+                const Camera& cam = mCurrentLevel->getCamera(handle);
                 Json::Value CameraJson{};
                 const float3& position = cam.getPosition();
                 const float3& direction = cam.getDirection();
@@ -415,10 +421,8 @@ namespace Tempest
             if(ImGui::Button("Add"))
             {
                 std::string cameraName = mCameraAddTextEdit;
-                mCurrentLevel->addCamera(cameraName, {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, CameraMode::Perspective);
-                std::unordered_map<std::string, Camera>& cams = mCurrentLevel->getCameras();
-                Camera* cam = &cams.find(cameraName)->second;
-                mCameras.push_back({cameraName, cam});
+                const CameraHandle handle = mCurrentLevel->addCamera(cameraName, {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, CameraMode::Perspective);
+                mCameras.push_back({cameraName, &mCurrentLevel->getCamera(handle)});
 
                 std::memset(mCameraAddTextEdit, 0, 64);
                 mShowAddCameraWindow = false;
@@ -434,9 +438,9 @@ namespace Tempest
         if(!materials.empty())
             mSelectedMaterial = materials[0];
 
-        std::unordered_map<std::string, Camera>& cameras = mCurrentLevel->getCameras();
-        for(auto&[name, cam] : cameras)
-            mCameras.push_back({name, &cam});
+        const std::unordered_map<std::string, CameraHandle>& cameras = mCurrentLevel->getCameras();
+        for(const auto&[name, handle] : cameras)
+            mCameras.push_back({name, &mCurrentLevel->getCamera(handle)});
 
     }
 }
@@ -61,12 +61,12 @@ namespace Tempest
         std::filesystem::path sceneFile = mRootDir / "scene.json";
         if(std::filesystem::exists(sceneFile))
         {
-            mCurrentOpenLevel = new Level(mRenderEngine, mPhysicsEngine, mScriptEngine, sceneFile, mInstanceWindow, mSceneWindow);
+            mCurrentOpenLevel = new Level(mRenderEngine, mPhysicsEngine, mScriptEngine, nullptr, sceneFile, mInstanceWindow, mSceneWindow);
             addNewAssets();
         }
         else
         {
-            mCurrentOpenLevel = new Level(mRenderEngine, mPhysicsEngine, mScriptEngine, sceneFile.parent_path(), "NewLevel", mInstanceWindow, mSceneWindow);
+            mCurrentOpenLevel = new Level(mRenderEngine, mPhysicsEngine, mScriptEngine, nullptr, sceneFile.parent_path(), "NewLevel", mInstanceWindow, mSceneWindow);
         }
 
         mSceneWindow->setLevel(mCurrentOpenLevel);
@@ -80,11 +80,11 @@ namespace Tempest
 
     void Editor::run()
     {
-        auto frameStartTime = std::chrono::system_clock::now();
+        auto frameStartTime = std::chrono::steady_clock::now();
 
         while(!glfwWindowShouldClose(mWindow))
         {
-            const auto currentTime = std::chrono::system_clock::now();
+            const auto currentTime = std::chrono::steady_clock::now();
             std::chrono::microseconds frameDelta = std::chrono::duration_cast<std::chrono::microseconds>(currentTime - frameStartTime);
             frameStartTime = currentTime;
 
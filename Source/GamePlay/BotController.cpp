@@ -0,0 +1,73 @@
+#include "BotController.hpp"
+
+#include <cmath>
+#include <cstring>
+
+namespace Tempest
+{
+
+    namespace
+    {
+        // In frames, about 0.5 to 3 seconds at 60Hz.
+        constexpr int32_t kMinHold = 30;
+        constexpr int32_t kMaxHold = 180;
+
+        // Per frame.
+        constexpr float kJumpChance = 0.01f;
+        // Per new direction.
+        constexpr float kSprintChance = 0.25f;
+        constexpr float kStandChance = 0.15f;
+    }
+
+
+    BotController::BotController(const int id, const uint64_t seed, const BotPolicy policy) :
+        Controller(id, "Bot"),
+        mPolicy(policy),
+        mRandom(seed),
+        mState{},
+        mFramesLeft(0)
+    {
+    }
+
+
+    void BotController::update(const InputSampler&)
+    {
+        if(mPolicy == BotPolicy::RandomWalk)
+        {
+            if(mFramesLeft == 0)
+                pickMove();
+            --mFramesLeft;
+
+            // Only held for the frame it fires, like a tap.
+            mState.mButtons[0] = mRandom.nextFloat() < kJumpChance ? GLFW_PRESS : GLFW_RELEASE;
+        }
+
+        setState(mState);
+    }
+
+
+    void BotController::setScriptedState(const ControllerState& state)
+    {
+        mPolicy = BotPolicy::Scripted;
+        mState = state;
+    }
+
+
+    void BotController::pickMove()
+    {
+        std::memset(mState.mAxis, 0, sizeof(mState.mAxis));
+        mFramesLeft = static_cast<uint32_t>(mRandom.range(kMinHold, kMaxHold));
+
+        if(mRandom.nextFloat() < kStandChance)
+        {
+            mState.mShftPressed = false;
+            return;
+        }
+
+        const float angle = mRandom.range(0.0f, 6.2831853f);
+        mState.mAxis[0] = std::cos(angle);
+        mState.mAxis[1] = std::sin(angle);
+        mState.mShftPressed = mRandom.nextFloat() < kSprintChance;
+    }
+
+}
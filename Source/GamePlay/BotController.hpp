@@ -0,0 +1,51 @@
+#ifndef BOT_CONTROLLER_HPP
+#define BOT_CONTROLLER_HPP
+
+#include "Controller.hpp"
+#include "Core/Random.hpp"
+
+#include <cstdint>
+
+namespace Tempest
+{
+    enum class BotPolicy
+    {
+        // Picks a stick direction and holds it for a while, jumping and
+        // sprinting now and then.
+        RandomWalk,
+        // Holds whatever a script last set with setScriptedState.
+        Scripted
+    };
+
+    // Stands in for a gamepad so levels can be loaded up with players nobody
+    // is holding. Scripts read it like any other controller.
+    class BotController : public Controller
+    {
+    public:
+        // Ids are only for logging, keep them clear of the joysticks.
+        BotController(const int id, const uint64_t seed, const BotPolicy);
+
+        virtual void update(const InputSampler&) override;
+
+        // Switches to BotPolicy::Scripted.
+        void setScriptedState(const ControllerState&);
+
+        BotPolicy getPolicy() const
+        {
+            return mPolicy;
+        }
+
+    private:
+
+        void pickMove();
+
+        BotPolicy mPolicy;
+        Random mRandom;
+
+        ControllerState mState;
+        // Frames until the next new direction.
+        uint32_t mFramesLeft;
+    };
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "Controller.hpp"
+#include "InputSampler.hpp"
 #include <cstdio>
 #include <cassert>
 #include <cstring>
@@ -7,10 +8,9 @@
 
 namespace  Tempest {
 
-    Controller::Controller(const int id) : mID(id),
-                                           mMouseX(0.0),
-                                           mMouseY(0.0) {
+    Controller::Controller(const int id) : mID(id) {
         mCtlPressed = false;
+        mShftPressed = false;
         const int present = glfwJoystickPresent(mID);
         if (present == GLFW_TRUE)
             mHardwareController = true;
@@ -23,12 +23,23 @@ namespace  Tempest {
     }
 
 
+    Controller::Controller(const int id, const char* name) :
+        mName(name),
+        mID(id),
+        mCtlPressed(false),
+        mShftPressed(false),
+        mHardwareController(false) {
+        std::memset(mAxis, 0, sizeof(mAxis));
+        std::memset(mButtons, 0, sizeof(mButtons));
+    }
+
+
     Controller::~Controller() {
 
     }
 
 
-    void Controller::update(GLFWwindow *window) {
+    void Controller::update(const InputSampler& input) {
         PROFILER_EVENT();
 
         if (mHardwareController) {
@@ -46,29 +57,47 @@ namespace  Tempest {
             for (uint32_t i = 0; i < 8; ++i)
                 mButtons[i] = 0;
 
-            if (glfwGetKey(window, mID == GLFW_JOYSTICK_1 ? GLFW_KEY_W : GLFW_KEY_I) == GLFW_PRESS)
+            if (input.isKeyDown(mID == GLFW_JOYSTICK_1 ? GLFW_KEY_W : GLFW_KEY_I))
                 mAxis[1] = -1.0f;
-            if (glfwGetKey(window, mID == GLFW_JOYSTICK_1 ? GLFW_KEY_S : GLFW_KEY_K) == GLFW_PRESS)
+            if (input.isKeyDown(mID == GLFW_JOYSTICK_1 ? GLFW_KEY_S : GLFW_KEY_K))
                 mAxis[1] = 1.0f;
 
-            if (glfwGetKey(window, mID == GLFW_JOYSTICK_1 ? GLFW_KEY_A : GLFW_KEY_J) == GLFW_PRESS)
+            if (input.isKeyDown(mID == GLFW_JOYSTICK_1 ? GLFW_KEY_A : GLFW_KEY_J))
                 mAxis[0] = -1.0f;
-            if (glfwGetKey(window, mID == GLFW_JOYSTICK_1 ? GLFW_KEY_D : GLFW_KEY_L) == GLFW_PRESS)
+            if (input.isKeyDown(mID == GLFW_JOYSTICK_1 ? GLFW_KEY_D : GLFW_KEY_L))
                 mAxis[0] = 1.0f;
 
-            double x, y;
-            glfwGetCursorPos(window, &x, &y);
-            mAxis[3] = (x - mMouseX) / 10.0;
-            mMouseX = x;
-            mAxis[4] = (y - mMouseY) / 10.0;
-            mMouseY = y;
+            const float2 cursorDelta = input.getCursorDelta();
+            mAxis[3] = cursorDelta.x / 10.0f;
+            mAxis[4] = cursorDelta.y / 10.0f;
 
-            if (glfwGetKey(window, mID == GLFW_JOYSTICK_1 ? GLFW_KEY_SPACE : GLFW_KEY_U) == GLFW_PRESS)
+            // Count taps that were already released by the time we sampled.
+            const int jumpKey = mID == GLFW_JOYSTICK_1 ? GLFW_KEY_SPACE : GLFW_KEY_U;
+            if (input.isKeyDown(jumpKey) || input.wasKeyPressed(jumpKey))
                 mButtons[0] = GLFW_PRESS;
 
-            mCtlPressed = glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS;
-            mShftPressed = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS;
+            mCtlPressed = input.isKeyDown(GLFW_KEY_LEFT_CONTROL);
+            mShftPressed = input.isKeyDown(GLFW_KEY_LEFT_SHIFT);
         }
     }
 
+
+    ControllerState Controller::getState() const {
+        ControllerState state;
+        std::memcpy(state.mAxis, mAxis, sizeof(mAxis));
+        std::memcpy(state.mButtons, mButtons, sizeof(mButtons));
+        state.mCtlPressed = mCtlPressed;
+        state.mShftPressed = mShftPressed;
+
+        return state;
+    }
+
+
+    void Controller::setState(const ControllerState& state) {
+        std::memcpy(mAxis, state.mAxis, sizeof(mAxis));
+        std::memcpy(mButtons, state.mButtons, sizeof(mButtons));
+        mCtlPressed = state.mCtlPressed;
+        mShftPressed = state.mShftPressed;
+    }
+
 }
@@ -5,6 +5,16 @@
 
 namespace Tempest
 {
+    class InputSampler;
+
+    // Everything scripts can see of a controller, what gets recorded and replayed.
+    struct ControllerState
+    {
+        float mAxis[6];
+        unsigned char mButtons[8];
+        bool mCtlPressed;
+        bool mShftPressed;
+    };
 
     class Controller
             {
@@ -12,10 +22,20 @@ namespace Tempest
 
         Controller(const int joyStickID);
 
-        ~Controller();
+        virtual ~Controller();
 
 
-        void update(GLFWwindow *window);
+        // Called once a frame, by the sampler for joysticks and the keyboard
+        // and by the engine for bots. Scripts just read the result.
+        virtual void update(const InputSampler&);
+
+        ControllerState getState() const;
+        // Overrides the sampled state, for replays.
+        void setState(const ControllerState&);
+
+        int getID() const {
+            return mID;
+        }
 
         float getLeftAxisX() const {
             return mAxis[0];
@@ -49,6 +69,11 @@ namespace Tempest
             return mShftPressed;
         }
 
+    protected:
+
+        // For controllers that aren't backed by glfw, starts with nothing pressed.
+        Controller(const int id, const char* name);
+
     private:
 
         const char *mName;
@@ -60,7 +85,6 @@ namespace Tempest
         bool mCtlPressed;
         bool mShftPressed;
 
-        double mMouseX, mMouseY;
         bool mHardwareController;
     };
 
@@ -0,0 +1,335 @@
+#include "HitBoxQuery.hpp"
+#include "Player.hpp"
+
+#include "Core/Profiling.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEMPEST_HITBOX_SSE 1
+#endif
+
+namespace
+{
+    // 4 pairs are tested at once, one per lane.
+    struct Lanes
+    {
+#ifdef TEMPEST_HITBOX_SSE
+        __m128 v;
+
+        static Lanes load(const float* p) { return {_mm_loadu_ps(p)}; }
+        static Lanes splat(const float f) { return {_mm_set1_ps(f)}; }
+        void store(float* p) const { _mm_storeu_ps(p, v); }
+
+        friend Lanes operator+(const Lanes a, const Lanes b) { return {_mm_add_ps(a.v, b.v)}; }
+        friend Lanes operator-(const Lanes a, const Lanes b) { return {_mm_sub_ps(a.v, b.v)}; }
+        friend Lanes operator*(const Lanes a, const Lanes b) { return {_mm_mul_ps(a.v, b.v)}; }
+        friend Lanes operator/(const Lanes a, const Lanes b) { return {_mm_div_ps(a.v, b.v)}; }
+        friend Lanes lanesMin(const Lanes a, const Lanes b) { return {_mm_min_ps(a.v, b.v)}; }
+        friend Lanes lanesMax(const Lanes a, const Lanes b) { return {_mm_max_ps(a.v, b.v)}; }
+        friend Lanes lanesAbs(const Lanes a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+        friend Lanes lanesLess(const Lanes a, const Lanes b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+        friend Lanes lanesSelect(const Lanes mask, const Lanes a, const Lanes b)
+        {
+            return {_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))};
+        }
+#else
+        float v[4];
+
+        static Lanes load(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+        static Lanes splat(const float f) { return {{f, f, f, f}}; }
+        void store(float* p) const { for(uint32_t i = 0; i < 4; ++i) p[i] = v[i]; }
+
+        template<typename F>
+        static Lanes apply(const Lanes a, const Lanes b, F f)
+        {
+            return {{f(a.v[0], b.v[0]), f(a.v[1], b.v[1]), f(a.v[2], b.v[2]), f(a.v[3], b.v[3])}};
+        }
+
+        friend Lanes operator+(const Lanes a, const Lanes b) { return apply(a, b, [](float x, float y) { return x + y; }); }
+        friend Lanes operator-(const Lanes a, const Lanes b) { return apply(a, b, [](float x, float y) { return x - y; }); }
+        friend Lanes operator*(const Lanes a, const Lanes b) { return apply(a, b, [](float x, float y) { return x * y; }); }
+        friend Lanes operator/(const Lanes a, const Lanes b) { return apply(a, b, [](float x, float y) { return x / y; }); }
+        friend Lanes lanesMin(const Lanes a, const Lanes b) { return apply(a, b, [](float x, float y) { return std::min(x, y); }); }
+        friend Lanes lanesMax(const Lanes a, const Lanes b) { return apply(a, b, [](float x, float y) { return std::max(x, y); }); }
+        friend Lanes lanesAbs(const Lanes a) { return apply(a, a, [](float x, float) { return std::abs(x); }); }
+        friend Lanes lanesLess(const Lanes a, const Lanes b) { return apply(a, b, [](float x, float y) { return x < y ? 1.0f : 0.0f; }); }
+        friend Lanes lanesSelect(const Lanes mask, const Lanes a, const Lanes b)
+        {
+            return {{mask.v[0] != 0.0f ? a.v[0] : b.v[0], mask.v[1] != 0.0f ? a.v[1] : b.v[1],
+                     mask.v[2] != 0.0f ? a.v[2] : b.v[2], mask.v[3] != 0.0f ? a.v[3] : b.v[3]}};
+        }
+#endif
+    };
+
+    struct Lanes3
+    {
+        Lanes x, y, z;
+    };
+
+    Lanes dot(const Lanes3& a, const Lanes3& b)
+    {
+        return (a.x * b.x) + (a.y * b.y) + (a.z * b.z);
+    }
+
+    Lanes3 cross(const Lanes3& a, const Lanes3& b)
+    {
+        return {(a.y * b.z) - (a.z * b.y),
+                (a.z * b.x) - (a.x * b.z),
+                (a.x * b.y) - (a.y * b.x)};
+    }
+
+    // Structure of arrays for 4 pairs.
+    struct PairBatch
+    {
+        float mFirstAxes[3][3][4];
+        float mFirstExtents[3][4];
+        float mSecondAxes[3][3][4];
+        float mSecondExtents[3][4];
+        // Second relative to the first at the start of the frame.
+        float mSeparation[3][4];
+        float mRelativeMotion[3][4];
+
+        Lanes3 load(const float (&v)[3][4]) const
+        {
+            return {Lanes::load(v[0]), Lanes::load(v[1]), Lanes::load(v[2])};
+        }
+    };
+}
+
+namespace Tempest
+{
+
+void HitBoxQuery::beginFrame()
+{
+    mVolumes.clear();
+    mSweptBounds.clear();
+    mPairs.clear();
+    mHitEvents.clear();
+}
+
+
+void HitBoxQuery::addPlayer(const InstanceID id, const Player& player)
+{
+    const std::vector<Player::HitBox>& hitBoxes = player.getHitBoxes();
+    for(uint32_t i = 0; i < hitBoxes.size(); ++i)
+    {
+        const Player::HitBox& hitBox = hitBoxes[i];
+        const std::array<float4, 8> corners = hitBox.mOrientatedBoundingBox.getCubeAsVertexArray();
+
+        Volume volume{};
+        volume.mCenter = float3(0.0f, 0.0f, 0.0f);
+        for(const float4& corner : corners)
+            volume.mCenter += float3(corner) / 8.0f;
+
+        // The 3 closest corners to any corner are its neighbours along each edge,
+        // so this doesn't depend on how the corners are ordered.
+        std::array<uint32_t, 7> neighbours{1, 2, 3, 4, 5, 6, 7};
+        std::partial_sort(neighbours.begin(), neighbours.begin() + 3, neighbours.end(), [&](const uint32_t lhs, const uint32_t rhs)
+        {
+            return glm::length(float3(corners[lhs] - corners[0])) < glm::length(float3(corners[rhs] - corners[0]));
+        });
+
+        for(uint32_t axis = 0; axis < 3; ++axis)
+        {
+            const float3 edge = float3(corners[neighbours[axis]] - corners[0]);
+            const float length = glm::length(edge);
+
+            float3 basis(0.0f, 0.0f, 0.0f);
+            basis[axis] = 1.0f;
+            volume.mAxes[axis] = length > 0.0f ? edge / length : basis;
+            volume.mHalfExtents[axis] = length * 0.5f;
+        }
+
+        volume.mVelocity = hitBox.mVelocity;
+        volume.mOwner = id;
+        volume.mBone = static_cast<uint16_t>(i);
+
+        addVolume(volume);
+    }
+}
+
+
+void HitBoxQuery::addVolume(const InstanceID owner, const float3& center, const float3 axes[3], const float3& halfExtents, const float3& velocity)
+{
+    Volume volume{};
+    volume.mCenter = center;
+    volume.mAxes[0] = axes[0];
+    volume.mAxes[1] = axes[1];
+    volume.mAxes[2] = axes[2];
+    volume.mHalfExtents = halfExtents;
+    volume.mVelocity = velocity;
+    volume.mOwner = owner;
+    volume.mBone = kVolumeBone;
+
+    addVolume(volume);
+}
+
+
+void HitBoxQuery::addVolume(const Volume& volume)
+{
+    const float3 extent = (glm::abs(volume.mAxes[0]) * volume.mHalfExtents.x) +
+                          (glm::abs(volume.mAxes[1]) * volume.mHalfExtents.y) +
+                          (glm::abs(volume.mAxes[2]) * volume.mHalfExtents.z);
+    const float3 start = volume.mCenter - volume.mVelocity;
+
+    mSweptBounds.push_back({glm::min(start, volume.mCenter) - extent, glm::max(start, volume.mCenter) + extent});
+    mVolumes.push_back(volume);
+}
+
+
+void HitBoxQuery::execute()
+{
+    PROFILER_EVENT();
+
+    findCandidatePairs();
+
+    for(uint32_t i = 0; i < mPairs.size(); i += 4)
+        testPairs(i, std::min<uint32_t>(4, static_cast<uint32_t>(mPairs.size()) - i));
+}
+
+
+void HitBoxQuery::findCandidatePairs()
+{
+    // Sort and sweep along x.
+    mSortedVolumes.resize(mVolumes.size());
+    for(uint32_t i = 0; i < mSortedVolumes.size(); ++i)
+        mSortedVolumes[i] = i;
+
+    std::sort(mSortedVolumes.begin(), mSortedVolumes.end(), [this](const uint32_t lhs, const uint32_t rhs)
+    {
+        return mSweptBounds[lhs].mMin.x < mSweptBounds[rhs].mMin.x;
+    });
+
+    for(uint32_t i = 0; i < mSortedVolumes.size(); ++i)
+    {
+        const uint32_t first = mSortedVolumes[i];
+        const Bounds& firstBounds = mSweptBounds[first];
+
+        for(uint32_t j = i + 1; j < mSortedVolumes.size(); ++j)
+        {
+            const uint32_t second = mSortedVolumes[j];
+            const Bounds& secondBounds = mSweptBounds[second];
+            if(secondBounds.mMin.x > firstBounds.mMax.x)
+                break;
+
+            if(mVolumes[first].mOwner == mVolumes[second].mOwner)
+                continue;
+
+            if(secondBounds.mMin.y > firstBounds.mMax.y || secondBounds.mMax.y < firstBounds.mMin.y ||
+               secondBounds.mMin.z > firstBounds.mMax.z || secondBounds.mMax.z < firstBounds.mMin.z)
+                continue;
+
+            mPairs.push_back({first, second});
+        }
+    }
+}
+
+
+void HitBoxQuery::testPairs(const uint32_t firstPair, const uint32_t count)
+{
+    PairBatch batch{};
+    for(uint32_t lane = 0; lane < 4; ++lane)
+    {
+        // Pad the batch by repeating the last pair.
+        const Pair& pair = mPairs[firstPair + std::min(lane, count - 1)];
+        const Volume& first = mVolumes[pair.mFirst];
+        const Volume& second = mVolumes[pair.mSecond];
+
+        const float3 separation = (second.mCenter - second.mVelocity) - (first.mCenter - first.mVelocity);
+        const float3 motion = second.mVelocity - first.mVelocity;
+
+        for(uint32_t c = 0; c < 3; ++c)
+        {
+            for(uint32_t axis = 0; axis < 3; ++axis)
+            {
+                batch.mFirstAxes[axis][c][lane] = first.mAxes[axis][c];
+                batch.mSecondAxes[axis][c][lane] = second.mAxes[axis][c];
+            }
+
+            batch.mFirstExtents[c][lane] = first.mHalfExtents[c];
+            batch.mSecondExtents[c][lane] = second.mHalfExtents[c];
+            batch.mSeparation[c][lane] = separation[c];
+            batch.mRelativeMotion[c][lane] = motion[c];
+        }
+    }
+
+    const Lanes3 firstAxes[3] = {batch.load(batch.mFirstAxes[0]), batch.load(batch.mFirstAxes[1]), batch.load(batch.mFirstAxes[2])};
+    const Lanes3 secondAxes[3] = {batch.load(batch.mSecondAxes[0]), batch.load(batch.mSecondAxes[1]), batch.load(batch.mSecondAxes[2])};
+    const Lanes firstExtents[3] = {Lanes::load(batch.mFirstExtents[0]), Lanes::load(batch.mFirstExtents[1]), Lanes::load(batch.mFirstExtents[2])};
+    const Lanes secondExtents[3] = {Lanes::load(batch.mSecondExtents[0]), Lanes::load(batch.mSecondExtents[1]), Lanes::load(batch.mSecondExtents[2])};
+    const Lanes3 separation = batch.load(batch.mSeparation);
+    const Lanes3 motion = batch.load(batch.mRelativeMotion);
+
+    const Lanes zero = Lanes::splat(0.0f);
+    const Lanes epsilon = Lanes::splat(1e-6f);
+    const Lanes infinity = Lanes::splat(std::numeric_limits<float>::infinity());
+
+    // Interval of the frame for which the boxes overlap on every axis tested so far.
+    Lanes enter = zero;
+    Lanes exit = Lanes::splat(1.0f);
+
+    auto testAxis = [&](const Lanes3& axis)
+    {
+        const Lanes distance = dot(separation, axis);
+        const Lanes speed = dot(motion, axis);
+        const Lanes radius = (lanesAbs(dot(axis, firstAxes[0])) * firstExtents[0]) +
+                             (lanesAbs(dot(axis, firstAxes[1])) * firstExtents[1]) +
+                             (lanesAbs(dot(axis, firstAxes[2])) * firstExtents[2]) +
+                             (lanesAbs(dot(axis, secondAxes[0])) * secondExtents[0]) +
+                             (lanesAbs(dot(axis, secondAxes[1])) * secondExtents[1]) +
+                             (lanesAbs(dot(axis, secondAxes[2])) * secondExtents[2]);
+
+        // Not moving along this axis, either always or never separated.
+        // This also covers degenerate cross product axes where everything is 0.
+        const Lanes stationary = lanesLess(lanesAbs(speed), epsilon);
+        const Lanes separated = lanesLess(radius, lanesAbs(distance));
+        const Lanes stationaryEnter = lanesSelect(separated, infinity, zero - infinity);
+        const Lanes stationaryExit = lanesSelect(separated, zero - infinity, infinity);
+
+        const Lanes safeSpeed = lanesSelect(stationary, Lanes::splat(1.0f), speed);
+        const Lanes t0 = (zero - radius - distance) / safeSpeed;
+        const Lanes t1 = (radius - distance) / safeSpeed;
+
+        const Lanes axisEnter = lanesSelect(stationary, stationaryEnter, lanesMin(t0, t1));
+        const Lanes axisExit = lanesSelect(stationary, stationaryExit, lanesMax(t0, t1));
+
+        enter = lanesMax(enter, axisEnter);
+        exit = lanesMin(exit, axisExit);
+    };
+
+    for(uint32_t i = 0; i < 3; ++i)
+        testAxis(firstAxes[i]);
+
+    for(uint32_t i = 0; i < 3; ++i)
+        testAxis(secondAxes[i]);
+
+    for(uint32_t i = 0; i < 3; ++i)
+    {
+        for(uint32_t j = 0; j < 3; ++j)
+            testAxis(cross(firstAxes[i], secondAxes[j]));
+    }
+
+    float enterTimes[4];
+    float exitTimes[4];
+    enter.store(enterTimes);
+    exit.store(exitTimes);
+
+    for(uint32_t lane = 0; lane < count; ++lane)
+    {
+        if(enterTimes[lane] > exitTimes[lane])
+            continue;
+
+        const Pair& pair = mPairs[firstPair + lane];
+        const Volume& first = mVolumes[pair.mFirst];
+        const Volume& second = mVolumes[pair.mSecond];
+
+        mHitEvents.push_back({first.mOwner, second.mOwner, first.mBone, second.mBone, enterTimes[lane]});
+    }
+}
+
+}
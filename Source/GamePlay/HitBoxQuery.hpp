@@ -0,0 +1,94 @@
+#ifndef HITBOX_QUERY_HPP
+#define HITBOX_QUERY_HPP
+
+#include "Engine/GeomUtils.h"
+#include "Engine/Scene.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Tempest
+{
+    class Player;
+
+    // Swept OBB tests between every players hitboxes (and any extra volumes
+    // such as weapons), rebuilt once per frame.
+    class HitBoxQuery
+    {
+    public:
+
+        HitBoxQuery() = default;
+        ~HitBoxQuery() = default;
+
+        void beginFrame();
+
+        void addPlayer(const InstanceID, const Player&);
+
+        // Bone index is reported as kVolumeBone for these.
+        void addVolume(const InstanceID owner, const float3& center, const float3 axes[3], const float3& halfExtents, const float3& velocity);
+
+        // Generates hit events between volumes with different owners.
+        void execute();
+
+        static constexpr uint16_t kVolumeBone = 0xFFFF;
+
+        struct HitEvent
+        {
+            InstanceID mFirst;
+            InstanceID mSecond;
+            uint16_t mFirstBone;
+            uint16_t mSecondBone;
+            // Fraction of the last frames movement at which they first touched.
+            float mTime;
+        };
+
+        const std::vector<HitEvent>& getHitEvents() const
+        {
+            return mHitEvents;
+        }
+
+        uint32_t getCandidatePairCount() const
+        {
+            return static_cast<uint32_t>(mPairs.size());
+        }
+
+    private:
+
+        struct Volume
+        {
+            float3 mCenter;
+            float3 mAxes[3];
+            float3 mHalfExtents;
+            // Movement over the last frame.
+            float3 mVelocity;
+            InstanceID mOwner;
+            uint16_t mBone;
+        };
+
+        struct Bounds
+        {
+            float3 mMin;
+            float3 mMax;
+        };
+
+        void addVolume(const Volume&);
+        void findCandidatePairs();
+        void testPairs(const uint32_t first, const uint32_t count);
+
+        std::vector<Volume> mVolumes;
+        std::vector<Bounds> mSweptBounds;
+        std::vector<uint32_t> mSortedVolumes;
+
+        struct Pair
+        {
+            uint32_t mFirst;
+            uint32_t mSecond;
+        };
+        std::vector<Pair> mPairs;
+
+        std::vector<HitEvent> mHitEvents;
+    };
+}
+
+#endif
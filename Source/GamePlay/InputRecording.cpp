@@ -0,0 +1,177 @@
+#include "InputRecording.hpp"
+#include "InputSampler.hpp"
+
+#include "Core/BellLogging.hpp"
+
+#include <cstring>
+
+namespace Tempest
+{
+
+    namespace
+    {
+        constexpr char kMagic[4] = {'T', 'R', 'E', 'C'};
+        constexpr uint32_t kVersion = 1;
+
+        // joystick, axes, buttons, flags
+        constexpr size_t kControllerSize = 1 + sizeof(float) * 6 + 1 + 1;
+        constexpr size_t kFrameHeaderSize = sizeof(uint32_t) + 1;
+
+        template<typename T>
+        void append(std::vector<uint8_t>& data, const T& value)
+        {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+            data.insert(data.end(), bytes, bytes + sizeof(T));
+        }
+
+        template<typename T>
+        T read(const uint8_t* data)
+        {
+            T value;
+            std::memcpy(&value, data, sizeof(T));
+            return value;
+        }
+    }
+
+
+    InputRecorder::InputRecorder(const std::filesystem::path& path, const uint64_t seed) :
+        mFile(path, std::ios::binary)
+    {
+        if(!mFile.is_open())
+        {
+            BELL_LOG_ARGS("Failed to open input recording %s", path.string().c_str());
+            return;
+        }
+
+        InputRecordingHeader header;
+        std::memcpy(header.mMagic, kMagic, sizeof(kMagic));
+        header.mVersion = kVersion;
+        header.mSeed = seed;
+        mFile.write(reinterpret_cast<const char*>(&header), sizeof(InputRecordingHeader));
+    }
+
+
+    void InputRecorder::recordFrame(const std::chrono::microseconds delta, InputSampler& input)
+    {
+        if(!mFile.is_open())
+            return;
+
+        mFrame.clear();
+        append(mFrame, static_cast<uint32_t>(delta.count()));
+        append(mFrame, uint8_t(0));
+
+        uint8_t controllerCount = 0;
+        input.forEachController([&](const Controller& controller)
+        {
+            const ControllerState state = controller.getState();
+
+            uint8_t buttons = 0;
+            for(uint32_t i = 0; i < 8; ++i)
+            {
+                if(state.mButtons[i] == GLFW_PRESS)
+                    buttons |= 1 << i;
+            }
+
+            append(mFrame, static_cast<uint8_t>(controller.getID()));
+            for(const float axis : state.mAxis)
+                append(mFrame, axis);
+            append(mFrame, buttons);
+            append(mFrame, static_cast<uint8_t>((state.mCtlPressed ? 1 : 0) | (state.mShftPressed ? 2 : 0)));
+
+            ++controllerCount;
+        });
+        mFrame[sizeof(uint32_t)] = controllerCount;
+
+        mFile.write(reinterpret_cast<const char*>(mFrame.data()), mFrame.size());
+    }
+
+
+    InputReplay::InputReplay(const std::filesystem::path& path, const ReplayTiming timing) :
+        mCurrentFrame(0),
+        mSeed(0),
+        mTiming(timing),
+        mValid(false)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if(!file.is_open())
+        {
+            BELL_LOG_ARGS("Failed to open input recording %s", path.string().c_str());
+            return;
+        }
+
+        mData.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(mData.data()), mData.size());
+
+        if(mData.size() < sizeof(InputRecordingHeader))
+        {
+            BELL_LOG_ARGS("Input recording %s is truncated", path.string().c_str());
+            return;
+        }
+
+        const InputRecordingHeader header = read<InputRecordingHeader>(mData.data());
+        if(std::memcmp(header.mMagic, kMagic, sizeof(kMagic)) != 0 || header.mVersion != kVersion)
+        {
+            BELL_LOG_ARGS("%s isn't a version %u input recording", path.string().c_str(), kVersion);
+            return;
+        }
+        mSeed = header.mSeed;
+
+        // Index the frames up front, a partial last frame (crash while recording) is dropped.
+        size_t offset = sizeof(InputRecordingHeader);
+        while(offset + kFrameHeaderSize <= mData.size())
+        {
+            const size_t frameSize = kFrameHeaderSize + mData[offset + sizeof(uint32_t)] * kControllerSize;
+            if(offset + frameSize > mData.size())
+                break;
+
+            // Joystick indices go straight to the sampler, a bad one means a corrupt file.
+            for(size_t controller = offset + kFrameHeaderSize; controller < offset + frameSize; controller += kControllerSize)
+            {
+                if(mData[controller] > GLFW_JOYSTICK_LAST)
+                {
+                    BELL_LOG_ARGS("Input recording %s has an invalid joystick %u", path.string().c_str(), mData[controller]);
+                    mFrameOffsets.clear();
+                    return;
+                }
+            }
+
+            mFrameOffsets.push_back(offset);
+            offset += frameSize;
+        }
+
+        mValid = true;
+    }
+
+
+    bool InputReplay::nextFrame(std::chrono::microseconds& delta, InputSampler& input)
+    {
+        if(!mValid || mCurrentFrame >= mFrameOffsets.size())
+            return false;
+
+        const uint8_t* frame = mData.data() + mFrameOffsets[mCurrentFrame++];
+        const std::chrono::microseconds recordedDelta{read<uint32_t>(frame)};
+        delta = mTiming == ReplayTiming::Fixed ? kFixedReplayStep : recordedDelta;
+
+        const uint8_t controllerCount = frame[sizeof(uint32_t)];
+        const uint8_t* controller = frame + kFrameHeaderSize;
+        for(uint32_t i = 0; i < controllerCount; ++i, controller += kControllerSize)
+        {
+            ControllerState state;
+            std::memcpy(state.mAxis, controller + 1, sizeof(state.mAxis));
+
+            const uint8_t buttons = controller[1 + sizeof(state.mAxis)];
+            for(uint32_t b = 0; b < 8; ++b)
+                state.mButtons[b] = (buttons & (1 << b)) ? GLFW_PRESS : GLFW_RELEASE;
+
+            const uint8_t flags = controller[2 + sizeof(state.mAxis)];
+            state.mCtlPressed = flags & 1;
+            state.mShftPressed = flags & 2;
+
+            input.getController(controller[0]).setState(state);
+        }
+
+        return true;
+    }
+
+}
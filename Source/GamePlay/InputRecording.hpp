@@ -0,0 +1,93 @@
+#ifndef INPUT_RECORDING_HPP
+#define INPUT_RECORDING_HPP
+
+#include "Controller.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace Tempest
+{
+    class InputSampler;
+
+    // File layout, all little endian:
+    //   header: "TREC", uint32 version, uint64 random seed
+    //   frame:  uint32 delta in microseconds, uint8 controller count, then per
+    //           controller uint8 joystick, 6 float axes, uint8 button bits,
+    //           uint8 flags (1 = ctrl, 2 = shift)
+    struct InputRecordingHeader
+    {
+        char mMagic[4];
+        uint32_t mVersion;
+        uint64_t mSeed;
+    };
+
+    // Writes each frames controller state and delta as it's sampled.
+    class InputRecorder
+    {
+    public:
+        // The seed has to be what the session was started with for a replay to match.
+        InputRecorder(const std::filesystem::path&, const uint64_t seed);
+
+        bool isOpen() const
+        {
+            return mFile.is_open();
+        }
+
+        void recordFrame(const std::chrono::microseconds delta, InputSampler&);
+
+    private:
+        std::ofstream mFile;
+        std::vector<uint8_t> mFrame;
+    };
+
+    enum class ReplayTiming
+    {
+        // Deltas as they were recorded.
+        Recorded,
+        // Every frame gets kFixedReplayStep, for runs that shouldn't depend on the machine they were recorded on.
+        Fixed
+    };
+
+    constexpr std::chrono::microseconds kFixedReplayStep{16667};
+
+    // Loads a whole recording and hands it back a frame at a time.
+    class InputReplay
+    {
+    public:
+        InputReplay(const std::filesystem::path&, const ReplayTiming);
+
+        bool isValid() const
+        {
+            return mValid;
+        }
+
+        uint64_t getSeed() const
+        {
+            return mSeed;
+        }
+
+        uint32_t getFrameCount() const
+        {
+            return static_cast<uint32_t>(mFrameOffsets.size());
+        }
+
+        // Sets the controllers for the next frame, false once the recording has run out.
+        bool nextFrame(std::chrono::microseconds& delta, InputSampler&);
+
+    private:
+
+        std::vector<uint8_t> mData;
+        std::vector<size_t> mFrameOffsets;
+        uint32_t mCurrentFrame;
+        uint64_t mSeed;
+        ReplayTiming mTiming;
+        bool mValid;
+    };
+
+}
+
+#endif
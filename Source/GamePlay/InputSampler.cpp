@@ -0,0 +1,137 @@
+#include "InputSampler.hpp"
+#include "Controller.hpp"
+#include "FrameProfiler.hpp"
+
+#include "Core/BellLogging.hpp"
+#include "Core/Profiling.hpp"
+
+#include <algorithm>
+
+namespace Tempest
+{
+
+    InputSampler::InputSampler(GLFWwindow* window) :
+        mWindow(window),
+        mHasCursor(false),
+        mCursorX(0.0),
+        mCursorY(0.0),
+        mCursorDelta(0.0f, 0.0f),
+        mSampleTime(0),
+        mLive(true)
+    {
+        mKeysDown.fill(false);
+        mKeysPressed.fill(false);
+
+        glfwSetWindowUserPointer(mWindow, this);
+        glfwSetKeyCallback(mWindow, keyCallback);
+        glfwSetCursorPosCallback(mWindow, cursorCallback);
+    }
+
+
+    InputSampler::~InputSampler()
+    {
+        glfwSetKeyCallback(mWindow, nullptr);
+        glfwSetCursorPosCallback(mWindow, nullptr);
+        glfwSetWindowUserPointer(mWindow, nullptr);
+    }
+
+
+    void InputSampler::sample()
+    {
+        PROFILER_EVENT();
+        TEMPEST_PROFILE_SCOPE("Sample input")
+
+        FrameProfiler& profiler = FrameProfiler::get();
+        const uint64_t pollStart = profiler.now();
+        glfwPollEvents();
+        mSampleTime = profiler.now();
+
+        mKeysPressed.fill(false);
+        mCursorDelta = float2(0.0f, 0.0f);
+
+        uint64_t oldestEvent = mSampleTime;
+        while(const InputEvent* event = mEvents.peek())
+        {
+            // Anything stamped by the poll above has been waiting an unknown time.
+            if(event->mTimestamp < pollStart)
+                oldestEvent = std::min(oldestEvent, event->mTimestamp);
+
+            if(event->mType == InputEvent::Type::Key)
+            {
+                if(event->mKey >= 0 && event->mKey <= GLFW_KEY_LAST)
+                {
+                    if(event->mAction == GLFW_PRESS)
+                    {
+                        mKeysDown[event->mKey] = true;
+                        mKeysPressed[event->mKey] = true;
+                    }
+                    else if(event->mAction == GLFW_RELEASE)
+                        mKeysDown[event->mKey] = false;
+                }
+            }
+            else
+            {
+                // First position is just the baseline.
+                if(mHasCursor)
+                    mCursorDelta += float2(event->mX - mCursorX, event->mY - mCursorY);
+
+                mCursorX = event->mX;
+                mCursorY = event->mY;
+                mHasCursor = true;
+            }
+
+            mEvents.pop();
+        }
+
+        // How long the oldest input this frame sat around before anyone saw it.
+        if(oldestEvent < mSampleTime && profiler.isEnabled())
+            profiler.recordEvent("Input age", oldestEvent, mSampleTime);
+
+        if(mLive)
+            forEachController([this](Controller& controller) { controller.update(*this); });
+    }
+
+
+    void InputSampler::waitForEvents(const std::chrono::microseconds timeout)
+    {
+        glfwWaitEventsTimeout(static_cast<double>(timeout.count()) / 1000000.0);
+    }
+
+
+    Controller& InputSampler::getController(const uint32_t joystick)
+    {
+        BELL_ASSERT(joystick < mControllers.size(), "Invalid joystick index")
+
+        std::unique_ptr<Controller>& controller = mControllers[joystick];
+        if(!controller)
+        {
+            controller = std::make_unique<Controller>(joystick);
+            controller->update(*this);
+        }
+
+        return *controller;
+    }
+
+
+    void InputSampler::addEvent(const InputEvent& event)
+    {
+        // Only happens if nothing samples for a very long time.
+        if(!mEvents.push(event))
+            BELL_LOG_ARGS("Input ring buffer full, dropping event from %llu", static_cast<unsigned long long>(event.mTimestamp));
+    }
+
+
+    void InputSampler::keyCallback(GLFWwindow* window, int key, int, int action, int)
+    {
+        InputSampler* sampler = static_cast<InputSampler*>(glfwGetWindowUserPointer(window));
+        sampler->addEvent({FrameProfiler::get().now(), InputEvent::Type::Key, key, action, 0.0, 0.0});
+    }
+
+
+    void InputSampler::cursorCallback(GLFWwindow* window, double x, double y)
+    {
+        InputSampler* sampler = static_cast<InputSampler*>(glfwGetWindowUserPointer(window));
+        sampler->addEvent({FrameProfiler::get().now(), InputEvent::Type::Cursor, 0, 0, x, y});
+    }
+
+}
@@ -0,0 +1,126 @@
+#ifndef INPUT_SAMPLER_HPP
+#define INPUT_SAMPLER_HPP
+
+#include <GLFW/glfw3.h>
+
+#include "Engine/GeomUtils.h"
+#include "RingBuffer.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace Tempest
+{
+    class Controller;
+
+    struct InputEvent
+    {
+        enum class Type : uint8_t
+        {
+            Key,
+            Cursor
+        };
+
+        // FrameProfiler::now() when glfw handed it over.
+        uint64_t mTimestamp;
+        Type mType;
+        int mKey;
+        int mAction;
+        double mX;
+        double mY;
+    };
+
+    // Glfws input functions are main thread only, so rather than polling them
+    // each time a script asks, key and cursor events get timestamped in to a
+    // ring buffer as glfw delivers them and are folded in to every controllers
+    // state once a frame. Presses that start and end within a frame still
+    // show up, and the controllers live here so script views of them never
+    // move.
+    class InputSampler
+    {
+    public:
+        InputSampler(GLFWwindow*);
+        ~InputSampler();
+
+        InputSampler(const InputSampler&) = delete;
+        InputSampler& operator=(const InputSampler&) = delete;
+
+        // Pumps glfw and updates the controllers, once per frame before scripts run.
+        void sample();
+
+        // Call instead of sleeping on the main thread, so events get stamped
+        // when they arrive. Without it there's no input age to report.
+        void waitForEvents(const std::chrono::microseconds timeout);
+
+        // Created on first use, the reference stays valid for the samplers lifetime.
+        Controller& getController(const uint32_t joystick);
+
+        // f(Controller&) for every controller created so far.
+        template<typename F>
+        void forEachController(F&& f)
+        {
+            for(std::unique_ptr<Controller>& controller : mControllers)
+            {
+                if(controller)
+                    f(*controller);
+            }
+        }
+
+        // When not live glfw still gets pumped but the controllers are left
+        // alone, so a replay can drive them.
+        void setLive(const bool live)
+        {
+            mLive = live;
+        }
+
+        bool isKeyDown(const int key) const
+        {
+            return key >= 0 && key <= GLFW_KEY_LAST && mKeysDown[key];
+        }
+
+        // Went down at any point since the last sample, even if it's already back up.
+        bool wasKeyPressed(const int key) const
+        {
+            return key >= 0 && key <= GLFW_KEY_LAST && mKeysPressed[key];
+        }
+
+        float2 getCursorDelta() const
+        {
+            return mCursorDelta;
+        }
+
+        // When the last sample was taken, in FrameProfiler::now() time.
+        uint64_t getSampleTime() const
+        {
+            return mSampleTime;
+        }
+
+    private:
+
+        static void keyCallback(GLFWwindow*, int key, int scancode, int action, int mods);
+        static void cursorCallback(GLFWwindow*, double x, double y);
+
+        void addEvent(const InputEvent&);
+
+        GLFWwindow* mWindow;
+        RingBuffer<InputEvent, 1024> mEvents;
+
+        std::array<bool, GLFW_KEY_LAST + 1> mKeysDown;
+        std::array<bool, GLFW_KEY_LAST + 1> mKeysPressed;
+
+        bool mHasCursor;
+        double mCursorX;
+        double mCursorY;
+        float2 mCursorDelta;
+
+        uint64_t mSampleTime;
+        bool mLive;
+
+        std::array<std::unique_ptr<Controller>, GLFW_JOYSTICK_LAST + 1> mControllers;
+    };
+
+}
+
+#endif
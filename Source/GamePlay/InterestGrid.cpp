@@ -0,0 +1,266 @@
+#include "InterestGrid.hpp"
+
+#include "Core/BellLogging.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Tempest
+{
+
+    InterestGrid::InterestGrid(const float cellSize) :
+        mCellSize(cellSize),
+        mCellChanges(0)
+    {
+        BELL_ASSERT(cellSize > 0.0f, "Interest grid cells need a size")
+    }
+
+
+    InterestGrid::Cell InterestGrid::getCell(const float3& position) const
+    {
+        return {static_cast<int32_t>(std::floor(position.x / mCellSize)),
+                static_cast<int32_t>(std::floor(position.z / mCellSize))};
+    }
+
+
+    InterestGrid::Observer* InterestGrid::findObserver(const InstanceID id)
+    {
+        auto it = std::find_if(mObservers.begin(), mObservers.end(), [id](const Observer& observer) { return observer.mID == id; });
+        return it != mObservers.end() ? &*it : nullptr;
+    }
+
+
+    const InterestGrid::Observer* InterestGrid::findObserver(const InstanceID id) const
+    {
+        auto it = std::find_if(mObservers.begin(), mObservers.end(), [id](const Observer& observer) { return observer.mID == id; });
+        return it != mObservers.end() ? &*it : nullptr;
+    }
+
+
+    void InterestGrid::addRelevant(Observer& observer, const InstanceID id)
+    {
+        if(observer.mRelevant.insert(id).second)
+            ++mObjects[id].mObserverCount;
+    }
+
+
+    void InterestGrid::removeRelevant(Observer& observer, const InstanceID id)
+    {
+        if(observer.mRelevant.erase(id))
+            --mObjects[id].mObserverCount;
+    }
+
+
+    void InterestGrid::addObject(const InstanceID id, const float3& position)
+    {
+        BELL_ASSERT(mObjects.find(id) == mObjects.end(), "Instance already in the interest grid")
+
+        const Cell cell = getCell(position);
+        mObjects[id] = {cell, 0};
+        mCells[getKey(cell)].push_back(id);
+
+        for(Observer& observer : mObservers)
+        {
+            if(inWindow(mObjects[observer.mID].mCell, observer.mRadius, cell))
+                addRelevant(observer, id);
+        }
+    }
+
+
+    void InterestGrid::removeObject(const InstanceID id)
+    {
+        auto it = mObjects.find(id);
+        if(it == mObjects.end())
+            return;
+
+        if(isObserver(id))
+            removeObserver(id);
+
+        for(Observer& observer : mObservers)
+            observer.mRelevant.erase(id);
+
+        auto cell = mCells.find(getKey(it->second.mCell));
+        std::vector<InstanceID>& ids = cell->second;
+        ids.erase(std::find(ids.begin(), ids.end(), id));
+        if(ids.empty())
+            mCells.erase(cell);
+
+        mObjects.erase(it);
+    }
+
+
+    void InterestGrid::moveObject(const InstanceID id, const float3& position)
+    {
+        auto it = mObjects.find(id);
+        if(it == mObjects.end())
+            return;
+
+        const Cell from = it->second.mCell;
+        const Cell to = getCell(position);
+        if(from.mX == to.mX && from.mZ == to.mZ)
+            return;
+
+        ++mCellChanges;
+
+        auto oldCell = mCells.find(getKey(from));
+        std::vector<InstanceID>& oldIDs = oldCell->second;
+        oldIDs.erase(std::find(oldIDs.begin(), oldIDs.end(), id));
+        if(oldIDs.empty())
+            mCells.erase(oldCell);
+
+        mCells[getKey(to)].push_back(id);
+        it->second.mCell = to;
+
+        Observer* moved = nullptr;
+        for(Observer& observer : mObservers)
+        {
+            if(observer.mID == id)
+            {
+                moved = &observer;
+                continue;
+            }
+
+            const Cell& centre = mObjects[observer.mID].mCell;
+            const bool wasInside = inWindow(centre, observer.mRadius, from);
+            const bool isInside = inWindow(centre, observer.mRadius, to);
+            if(isInside && !wasInside)
+                addRelevant(observer, id);
+            else if(wasInside && !isInside)
+                removeRelevant(observer, id);
+        }
+
+        if(moved)
+            moveWindow(*moved, from, moved->mRadius, to, moved->mRadius);
+    }
+
+
+    void InterestGrid::moveWindow(Observer& observer, const Cell& from, const int32_t fromRadius, const Cell& to, const int32_t toRadius)
+    {
+        // Only cells in one window but not the other need looking at.
+        for(int32_t x = from.mX - fromRadius; x <= from.mX + fromRadius; ++x)
+        {
+            for(int32_t z = from.mZ - fromRadius; z <= from.mZ + fromRadius; ++z)
+            {
+                const Cell cell{x, z};
+                if(inWindow(to, toRadius, cell))
+                    continue;
+
+                auto ids = mCells.find(getKey(cell));
+                if(ids == mCells.end())
+                    continue;
+
+                for(const InstanceID id : ids->second)
+                    removeRelevant(observer, id);
+            }
+        }
+
+        for(int32_t x = to.mX - toRadius; x <= to.mX + toRadius; ++x)
+        {
+            for(int32_t z = to.mZ - toRadius; z <= to.mZ + toRadius; ++z)
+            {
+                const Cell cell{x, z};
+                if(inWindow(from, fromRadius, cell))
+                    continue;
+
+                auto ids = mCells.find(getKey(cell));
+                if(ids == mCells.end())
+                    continue;
+
+                for(const InstanceID id : ids->second)
+                    addRelevant(observer, id);
+            }
+        }
+    }
+
+
+    void InterestGrid::addObserver(const InstanceID id, const uint32_t radius)
+    {
+        auto object = mObjects.find(id);
+        BELL_ASSERT(object != mObjects.end(), "Observers need adding as objects first")
+        if(object == mObjects.end() || isObserver(id))
+            return;
+
+        mObservers.push_back({id, static_cast<int32_t>(radius), {}});
+        mObserverIDs.push_back(id);
+
+        Observer& observer = mObservers.back();
+        const Cell centre = object->second.mCell;
+        for(int32_t x = centre.mX - observer.mRadius; x <= centre.mX + observer.mRadius; ++x)
+        {
+            for(int32_t z = centre.mZ - observer.mRadius; z <= centre.mZ + observer.mRadius; ++z)
+            {
+                auto ids = mCells.find(getKey({x, z}));
+                if(ids == mCells.end())
+                    continue;
+
+                for(const InstanceID relevant : ids->second)
+                    addRelevant(observer, relevant);
+            }
+        }
+    }
+
+
+    void InterestGrid::removeObserver(const InstanceID id)
+    {
+        auto it = std::find_if(mObservers.begin(), mObservers.end(), [id](const Observer& observer) { return observer.mID == id; });
+        if(it == mObservers.end())
+            return;
+
+        for(const InstanceID relevant : it->mRelevant)
+            --mObjects[relevant].mObserverCount;
+
+        mObservers.erase(it);
+        mObserverIDs.erase(std::find(mObserverIDs.begin(), mObserverIDs.end(), id));
+    }
+
+
+    void InterestGrid::setObserverRadius(const InstanceID id, const uint32_t radius)
+    {
+        Observer* observer = findObserver(id);
+        if(!observer)
+            return;
+
+        const Cell centre = mObjects[id].mCell;
+        const int32_t oldRadius = observer->mRadius;
+        observer->mRadius = static_cast<int32_t>(radius);
+        moveWindow(*observer, centre, oldRadius, centre, observer->mRadius);
+    }
+
+
+    bool InterestGrid::isObserver(const InstanceID id) const
+    {
+        return findObserver(id) != nullptr;
+    }
+
+
+    bool InterestGrid::isRelevant(const InstanceID observerID, const InstanceID id) const
+    {
+        const Observer* observer = findObserver(observerID);
+        return observer && observer->mRelevant.count(id) != 0;
+    }
+
+
+    const std::unordered_set<InstanceID>* InterestGrid::getRelevant(const InstanceID observerID) const
+    {
+        const Observer* observer = findObserver(observerID);
+        return observer ? &observer->mRelevant : nullptr;
+    }
+
+
+    bool InterestGrid::isObserved(const InstanceID id) const
+    {
+        auto it = mObjects.find(id);
+        return it != mObjects.end() && it->second.mObserverCount > 0;
+    }
+
+
+    void InterestGrid::clear()
+    {
+        mCells.clear();
+        mObjects.clear();
+        mObservers.clear();
+        mObserverIDs.clear();
+        mCellChanges = 0;
+    }
+
+}
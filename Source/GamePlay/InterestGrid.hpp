@@ -0,0 +1,111 @@
+#ifndef TEMPEST_INTEREST_GRID_HPP
+#define TEMPEST_INTEREST_GRID_HPP
+
+#include "Engine/Scene.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Tempest
+{
+
+// Uniform grid over the xz plane keeping track of what each observer (a
+// player) cares about, everything within radius cells of the observers cell.
+// Relevant sets are patched as objects change cell instead of being rebuilt,
+// so an object moving inside its cell costs a lookup and the total cost
+// scales with how much moves rather than how much there is.
+class InterestGrid
+{
+public:
+    InterestGrid(const float cellSize = 16.0f);
+
+    void addObject(const InstanceID, const float3& position);
+    void removeObject(const InstanceID);
+    void moveObject(const InstanceID, const float3& position);
+
+    // Observers have to be objects already, radius is in cells.
+    void addObserver(const InstanceID, const uint32_t radius);
+    void removeObserver(const InstanceID);
+    void setObserverRadius(const InstanceID, const uint32_t radius);
+
+    bool isObserver(const InstanceID) const;
+    bool isRelevant(const InstanceID observer, const InstanceID object) const;
+    // Everything the observer can see, nullptr if it isn't one. Cheaper than
+    // isRelevant when testing a lot of objects against the same observer.
+    const std::unordered_set<InstanceID>* getRelevant(const InstanceID observer) const;
+    // Relevant to at least one observer.
+    bool isObserved(const InstanceID) const;
+
+    // In the order they were added.
+    const std::vector<InstanceID>& getObservers() const
+    {
+        return mObserverIDs;
+    }
+
+    // Objects that changed cell since the last call, to see what motion costs.
+    uint32_t resetCellChangeCount()
+    {
+        const uint32_t count = mCellChanges;
+        mCellChanges = 0;
+        return count;
+    }
+
+    void clear();
+
+private:
+
+    struct Cell
+    {
+        int32_t mX;
+        int32_t mZ;
+    };
+
+    struct Object
+    {
+        Cell mCell;
+        uint32_t mObserverCount;
+    };
+
+    struct Observer
+    {
+        InstanceID mID;
+        int32_t mRadius;
+        std::unordered_set<InstanceID> mRelevant;
+    };
+
+    Cell getCell(const float3&) const;
+
+    static uint64_t getKey(const Cell& cell)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(cell.mX)) << 32) | static_cast<uint32_t>(cell.mZ);
+    }
+
+    static bool inWindow(const Cell& centre, const int32_t radius, const Cell& cell)
+    {
+        return std::abs(cell.mX - centre.mX) <= radius && std::abs(cell.mZ - centre.mZ) <= radius;
+    }
+
+    Observer* findObserver(const InstanceID);
+    const Observer* findObserver(const InstanceID) const;
+
+    void addRelevant(Observer&, const InstanceID);
+    void removeRelevant(Observer&, const InstanceID);
+    // Patches the relevant set for a window moving or changing size.
+    void moveWindow(Observer&, const Cell& from, const int32_t fromRadius, const Cell& to, const int32_t toRadius);
+
+    float mCellSize;
+
+    std::unordered_map<uint64_t, std::vector<InstanceID>> mCells;
+    std::unordered_map<InstanceID, Object> mObjects;
+    std::vector<Observer> mObservers;
+    std::vector<InstanceID> mObserverIDs;
+
+    uint32_t mCellChanges;
+};
+
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include "Player.hpp"
 #include "Controller.hpp"
 #include "PhysicsWorld.hpp"
+#include "AnimationSystem.hpp"
 
 #include "Engine/Engine.hpp"
 #include "Engine/GeomUtils.h"
@@ -20,6 +21,7 @@ namespace Tempest
             mDirection(dir),
             mCurrentState(Resting),
             mHitBoxes{},
+            mBoneTransforms{},
             mCoolDownCounter{0}
     {
         MeshInstance *inst = mScene->getMeshInstance(id);
@@ -39,6 +41,7 @@ namespace Tempest
             box.mVelocity = float3{0.0f, 0.0f, 0.0f};
             mHitBoxes.push_back(box);
         }
+        mBoneTransforms.resize(skeleton.size(), float4x4(1.0f));
     }
 
 
@@ -81,7 +84,7 @@ namespace Tempest
 
         }
 
-        updateHitBoxes(eng);
+        updateHitBoxes(animationSystem);
 
         if (!body->isActive())
             body->activate(true);
@@ -119,45 +122,35 @@ namespace Tempest
     }
 
 
-    void Player::updateHitBoxes(RenderEngine *eng)
+    void Player::updateHitBoxes(const AnimationSystem& animationSystem)
     {
         MeshInstance *instance = mScene->getMeshInstance(mID);
         BELL_ASSERT(instance, "invalid mesh ID")
+        if (!instance)
+            return;
 
-        bool foundAnim = instance->getActiveAnimation();
+        const AnimationSystem::Pose pose = animationSystem.getPose(mID);
 
         const std::vector<Bone> &skeleton = instance->getMesh()->getSkeleton();
+        BELL_ASSERT(!pose.mAnimated || pose.mBoneCount == skeleton.size(), "Pose doesn't match skeleton")
 
-        std::vector<float4x4> boneTransforms = instance->tickAnimation(eng->getDevice()->getCurrentSubmissionIndex() / 60.0);
+        // Distant instances only get the bones nearest the root re-skinned,
+        // the rest keep their last pose but move with the instance.
+        const uint32_t skinnedCount = pose.mAnimated ? pose.mActiveBoneCount : skeleton.size();
+        for (uint32_t i = 0; i < skinnedCount; ++i)
+            mBoneTransforms[i] = pose.mAnimated ? pose.mBoneTransforms[i] : float4x4(1.0f);
 
+        const float4x4 instanceTransformation = instance->getTransMatrix();
         for (uint32_t i = 0; i < skeleton.size(); ++i)
         {
             const Bone &bone = skeleton[i];
-            const float4x4 &transform = boneTransforms[i];
 
-            const float4x4 OBBTransformation = instance->getTransMatrix() * transform;
-            const OBB transformedOBB = bone.mOBB * OBBTransformation;
+            const OBB transformedOBB = bone.mOBB * (instanceTransformation * mBoneTransforms[i]);
 
             HitBox &previousHitBox = mHitBoxes[i];
             previousHitBox.mVelocity =
-                        transformedOBB.getCentralPoint() - previousHitBox.mOrientatedBoundingBox.getCentralPoint();
-                        previousHitBox.mOrientatedBoundingBox = transformedOBB;
-        }
-
-        if (!foundAnim)
-        {
-            for (uint32_t i = 0; i < skeleton.size(); ++i)
-            {
-                const Bone &bone = skeleton[i];
-
-                const float4x4 OBBTransformation = instance->getTransMatrix();
-                const OBB transformedOBB = bone.mOBB * OBBTransformation;
-
-                HitBox &previousHitBox = mHitBoxes[i];
-                previousHitBox.mVelocity =
-                        transformedOBB.getCentralPoint() - previousHitBox.mOrientatedBoundingBox.getCentralPoint();
-                previousHitBox.mOrientatedBoundingBox = transformedOBB;
-            }
+                    transformedOBB.getCentralPoint() - previousHitBox.mOrientatedBoundingBox.getCentralPoint();
+            previousHitBox.mOrientatedBoundingBox = transformedOBB;
         }
     }
 }
@@ -14,6 +14,7 @@ static constexpr const char kJumpAnimation[] = "Armature|Armature|mixamo.com|Lay
 namespace Tempest {
     class PhysicsWorld;
     class Controller;
+    class AnimationSystem;
 
 
     class Player {
@@ -25,6 +26,8 @@ namespace Tempest {
 
         void update(const Controller *, RenderEngine *, Tempest::PhysicsWorld *world);
         void updateCameras(Controller*);
+        // Uses the pose evaluated by the animation system this frame.
+        void updateHitBoxes(const AnimationSystem&);
 
         struct HitBox {
             HitBox() :
@@ -43,6 +46,10 @@ namespace Tempest {
             return mDirection;
         }
 
+        InstanceID getInstanceID() const {
+            return mID;
+        }
+
         void attachCamera(Camera &cam, const float armatureLength) {
             mArmatureLength = armatureLength;
             mCamera = &cam;
@@ -62,8 +69,6 @@ namespace Tempest {
 
     private:
 
-        void updateHitBoxes(RenderEngine *eng);
-
         InstanceID mID;
         Scene *mScene;
 
@@ -84,6 +89,9 @@ namespace Tempest {
         State mCurrentState;
 
         std::vector<HitBox> mHitBoxes;
+        // Last skinned pose per bone, relative to the instance. Bones the
+        // animation system skips keep theirs but still follow the instance.
+        std::vector<float4x4> mBoneTransforms;
 
         size_t mCoolDownCounter;
     };
@@ -1,4 +1,5 @@
 #include "RenderThread.hpp"
+#include "FrameProfiler.hpp"
 
 #include "Core/Profiling.hpp"
 #include "Engine/Engine.hpp"
@@ -7,28 +8,48 @@
 void run(Tempest::RenderThread* thread)
 {
     PROFILER_THREAD("Render Thread")
+    TEMPEST_PROFILE_THREAD("Render Thread")
 
-    auto frameStartTime = std::chrono::system_clock::now();
+    auto frameStartTime = std::chrono::steady_clock::now();
 
     while(!(thread->mShouldClose))
     {
         std::unique_lock lock(thread->mGraphics_context_mutex);
-        thread->mGraphics_cv.wait(lock, [=]{return thread->mReady;});
+        {
+            TEMPEST_PROFILE_SCOPE("Wait for game thread")
+            thread->mGraphics_cv.wait(lock, [=]{return thread->mReady;});
+        }
         thread->mReady = false;
 
-        const auto currentTime = std::chrono::system_clock::now();
+        TEMPEST_PROFILE_SCOPE("Render frame")
+
+        const auto currentTime = std::chrono::steady_clock::now();
         std::chrono::microseconds frameDelta = std::chrono::duration_cast<std::chrono::microseconds>(currentTime - frameStartTime);
         frameStartTime = currentTime;
 
         if(!(thread->mFirstFrame))
             thread->mEngine->startFrame(frameDelta);
 
-        thread->mEngine->getScene()->computeBounds(AccelerationStructure::DynamicMesh);
-
-        thread->mEngine->recordScene();
-        thread->mEngine->render();
-        thread->mEngine->swap();
-        thread->mEngine->endFrame();
+        {
+            TEMPEST_PROFILE_SCOPE("Compute bounds")
+            thread->mEngine->getScene()->computeBounds(AccelerationStructure::DynamicMesh);
+        }
+
+        {
+            TEMPEST_PROFILE_SCOPE("Record scene")
+            thread->mEngine->recordScene();
+        }
+
+        {
+            TEMPEST_PROFILE_SCOPE("Render")
+            thread->mEngine->render();
+        }
+
+        {
+            TEMPEST_PROFILE_SCOPE("Swap")
+            thread->mEngine->swap();
+            thread->mEngine->endFrame();
+        }
     }
 
     /*std::unique_lock lock(thread->mGraphics_context_mutex);
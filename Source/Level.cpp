@@ -4,6 +4,7 @@
 
 #include "PhysicsWorld.hpp"
 #include "ScriptEngine.hpp"
+#include "JobSystem.hpp"
 #include "Editor/InstanceWindow.hpp"
 #include "Editor/SceneWindow.hpp"
 
@@ -17,6 +18,7 @@ namespace Tempest
 Level::Level(RenderEngine *eng,
              PhysicsWorld* physWorld,
              ScriptEngine* scriptEngine,
+             JobSystem* jobSystem,
              const std::filesystem::path& path,
              InstanceWindow* instanceWindow,
              SceneWindow* sceneWindow) :
@@ -26,6 +28,7 @@ Level::Level(RenderEngine *eng,
         mRenderEngine(eng),
         mPhysWorld{physWorld},
         mScriptEngine{scriptEngine},
+        mJobSystem{jobSystem},
         mInstanceWindow{instanceWindow},
         mSceneWindow{sceneWindow}
 {
@@ -54,6 +57,8 @@ Level::Level(RenderEngine *eng,
 
     }
 
+    loadAnimationGraphs();
+
     mScene->computeBounds(AccelerationStructure::DynamicMesh);
     mScene->computeBounds(AccelerationStructure::StaticMesh);
 }
@@ -62,6 +67,7 @@ Level::Level(RenderEngine *eng,
 Level::Level(RenderEngine* eng,
              PhysicsWorld* physWorld,
              ScriptEngine* scriptEngine,
+             JobSystem* jobSystem,
              const std::filesystem::path& path,
              const std::string& name,
              InstanceWindow* instanceWindow,
@@ -72,6 +78,7 @@ Level::Level(RenderEngine* eng,
         mRenderEngine(eng),
         mPhysWorld{physWorld},
         mScriptEngine{scriptEngine},
+        mJobSystem{jobSystem},
         mInstanceWindow{instanceWindow},
         mSceneWindow{sceneWindow}
 {
@@ -136,11 +143,41 @@ void Level::addMesh(const std::string& name, const Json::Value& entry)
     mIDToPath[id] = path;
     mAssetNames[id] = name;
 
+    if(entry.isMember("AnimationGraph"))
+    {
+        const std::string graphPath = entry["AnimationGraph"].asString();
+        mPendingAnimationGraphs.emplace_back(mScene->getMesh(id), mWorkingDir / graphPath);
+        mAnimationGraphPaths[id] = graphPath;
+    }
+
     if(mSceneWindow)
         mSceneWindow->setAssetDynamic(id, type == "Dynamic");
 }
 
 
+void Level::loadAnimationGraphs()
+{
+    std::vector<std::unique_ptr<AnimationGraph>> graphs(mPendingAnimationGraphs.size());
+    auto load = [&](const uint32_t i)
+    {
+        graphs[i] = std::make_unique<AnimationGraph>(mPendingAnimationGraphs[i].second);
+    };
+
+    const uint32_t count = static_cast<uint32_t>(graphs.size());
+    if(mJobSystem)
+        mJobSystem->parallelFor(count, load);
+    else
+    {
+        for(uint32_t i = 0; i < count; ++i)
+            load(i);
+    }
+
+    for(uint32_t i = 0; i < count; ++i)
+        mAnimationGraphs[mPendingAnimationGraphs[i].first] = std::move(graphs[i]);
+    mPendingAnimationGraphs.clear();
+}
+
+
 void Level::addMeshInstance(const std::string& name, const Json::Value& entry)
 {
     const std::string assetName = entry["Asset"].asString();
@@ -204,9 +241,10 @@ void Level::addMeshInstance(const std::string& name, const Json::Value& entry)
                                                   name);
 
     mInstanceIDs[name] = id;
+    mInstanceEntries[name] = entry;
+    const InstanceHandle handle = mInstanceTable.create(id);
     {
         const Json::Value& materialEntry = entry["Material"];
-        std::vector<std::string>& materials = mInstanceMapertials[id];
 
         for(uint32_t i = 0; i < materialEntry.size(); ++i)
         {
@@ -298,10 +336,10 @@ void Level::addMeshInstance(const std::string& name, const Json::Value& entry)
                 const SceneID colliderAsset = mAssetIDs[colliderName];
                 const StaticMesh* colliderMesh = mScene->getMesh(colliderAsset);
 
-                mPhysWorld->addObject(id, entityType, colliderMesh, position, rotation, scale);
+                mInstanceTable.get(handle)->mPhysicsIndex = mPhysWorld->addObject(id, entityType, colliderMesh, position, rotation, scale);
             }
             else
-                mPhysWorld->addObject(id, entityType, colliderType, position + center, rotation, collisderScale, mass, restitution);
+                mInstanceTable.get(handle)->mPhysicsIndex = mPhysWorld->addObject(id, entityType, colliderType, position + center, rotation, collisderScale, mass, restitution);
         }
 
         if(mInstanceWindow)
@@ -315,7 +353,8 @@ void Level::addMeshInstance(const std::string& name, const Json::Value& entry)
         {
             const Json::Value& gamePlayScript = scriptEntry["GamePlay"];
             const std::string func = gamePlayScript.asString();
-            mScriptEngine->registerEntityWithScript(func, id);
+            // Scripts only ever see the handle.
+            mScriptEngine->registerEntityWithScript(func, static_cast<int64_t>(handle));
 
             if(mInstanceWindow)
                 mInstanceWindow->setInstanceScript(id, func);
@@ -509,10 +548,15 @@ void Level::addMaterial(const std::string &name, const Json::Value &entry)
 
 void Level::addScript(const std::string &name, const Json::Value &entry)
 {
-    std::string scriptPath = (mWorkingDir / entry.asString()).string();
+    // Either just the path or {"Path", "InstructionBudget", "Priority"}.
+    const Json::Value& pathEntry = entry.isObject() ? entry["Path"] : entry;
+    std::string scriptPath = (mWorkingDir / pathEntry.asString()).string();
 
     BELL_ASSERT(!scriptPath.empty(), "No path given for script")
     mScriptEngine->registerScript(scriptPath, name);
+
+    if(entry.isObject() && (entry.isMember("InstructionBudget") || entry.isMember("Priority")))
+        mScriptEngine->setScriptBudget(name, entry.get("InstructionBudget", 0).asUInt(), entry.get("Priority", 0).asInt());
 }
 
 
@@ -590,7 +634,7 @@ void Level::addCamera(const std::string& name, const Json::Value& entry)
         newCamera.setOrthographicSize(s);
     }
 
-    mCamera.insert({name, newCamera});
+    insertCamera(name, newCamera);
 }
 
 
@@ -634,19 +678,69 @@ void Level::processGlobals(const std::string& name, const Json::Value& entry)
 
 void Level::setMainCameraByName(const std::string& name)
 {
-    BELL_ASSERT(mCamera.find(name) != mCamera.end(), "Camera has not been created")
-    Camera& cam = mCamera.find(name)->second;
-
-    mScene->setCamera(&cam);
+    setMainCamera(getCameraHandle(name));
 }
 
 
 void Level::setShadowCameraByName(const std::string& name)
 {
-    BELL_ASSERT(mCamera.find(name) != mCamera.end(), "Camera has not been created")
-    Camera& cam = mCamera.find(name)->second;
+    setShadowCamera(getCameraHandle(name));
+}
+
 
-    mScene->setShadowingLight(&cam);
+void Level::setMainCamera(const CameraHandle handle)
+{
+    if(!isValidCamera(handle))
+    {
+        BELL_LOG_ARGS("Ignoring invalid main camera handle %u", handle);
+        return;
+    }
+
+    mScene->setCamera(&getCamera(handle));
+}
+
+
+void Level::setShadowCamera(const CameraHandle handle)
+{
+    if(!isValidCamera(handle))
+    {
+        BELL_LOG_ARGS("Ignoring invalid shadow camera handle %u", handle);
+        return;
+    }
+
+    mScene->setShadowingLight(&getCamera(handle));
+}
+
+
+void Level::releaseInstanceHandle(const InstanceID id)
+{
+    const InstanceHandle handle = mInstanceTable.getHandle(id);
+    if(const InstanceTable::Slot* slot = mInstanceTable.get(handle); slot)
+    {
+        if(mInstanceRemoved)
+            mInstanceRemoved(handle, id);
+
+        if(slot->mPhysicsIndex != InstanceTable::kInvalidIndex)
+            mPhysWorld->removeBody(slot->mPhysicsIndex);
+
+        mInstanceMaterials.remove(InstanceTable::getIndex(handle));
+
+        mInstanceTable.destroy(handle);
+    }
+}
+
+
+CameraHandle Level::insertCamera(const std::string& name, const Camera& camera)
+{
+    // Same as the old map insert, re-adding a name keeps the original camera.
+    if(auto it = mCameraHandles.find(name); it != mCameraHandles.end())
+        return it->second;
+
+    const CameraHandle handle = static_cast<CameraHandle>(mCameras.size());
+    mCameras.push_back(camera);
+    mCameraHandles[name] = handle;
+
+    return handle;
 }
 
 
@@ -677,10 +771,11 @@ InstanceID Level::addMeshInstance(const std::string& name, const SceneID meshID,
                                                   matEntry.mMaterialFlags,
                                                   name);
 
-    const uint32_t subMeshCount = mScene->getMeshInstance(id)->getSubMeshCount();
-    for(uint32_t i = 0; i < subMeshCount; ++i)
-        mInstanceMapertials[id].push_back(materialsName);
     mInstanceIDs[name] = id;
+    const InstanceHandle handle = mInstanceTable.create(id);
+
+    const uint32_t subMeshCount = mScene->getMeshInstance(id)->getSubMeshCount();
+    mInstanceMaterials.emplace(InstanceTable::getIndex(handle), subMeshCount, materialsName);
 
     return id;
 }
@@ -697,10 +792,29 @@ void Level::addMaterialFromFile(const std::filesystem::path& path)
     addMaterial(path.stem().string(), materialEntry);
 }
 
-void Level::addCamera(const std::string& name, const float3& pos, const float3& dir, const CameraMode mode)
+InstanceHandle Level::cloneInstance(const std::string& templateName, const std::string& name, const float3& position)
+{
+    auto it = mInstanceEntries.find(templateName);
+    BELL_ASSERT(it != mInstanceEntries.end(), "Only instances from the level file can be cloned")
+    BELL_ASSERT(mInstanceIDs.find(name) == mInstanceIDs.end(), "Instance name already taken")
+
+    Json::Value entry = it->second;
+    Json::Value positionEntry(Json::arrayValue);
+    positionEntry.append(position.x);
+    positionEntry.append(position.y);
+    positionEntry.append(position.z);
+    entry["Position"] = positionEntry;
+
+    addMeshInstance(name, entry);
+    mScene->computeBounds(AccelerationStructure::DynamicMesh);
+
+    return getInstanceHandleByName(name);
+}
+
+CameraHandle Level::addCamera(const std::string& name, const float3& pos, const float3& dir, const CameraMode mode)
 {
     Camera newCam(pos, dir, 1920.0f / 1080.0f, 0.1, 200.0f, 90.0f, mode);
-    mCamera.insert({name, newCam});
+    return insertCamera(name, newCam);
 }
 
 }
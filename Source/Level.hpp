@@ -1,7 +1,9 @@
 #ifndef TEMPEST_LEVEL_HPP
 #define TEMPEST_LEVEL_HPP
 
+#include <deque>
 #include <filesystem>
+#include <functional>
 #include <string>
 #include <memory>
 #include <unordered_map>
@@ -9,21 +11,31 @@
 #include "json/json.h"
 
 #include "Engine/Scene.h"
+#include "AnimationGraph.hpp"
+#include "InstanceTable.hpp"
+#include "ComponentPool.hpp"
 
 namespace Tempest
 {
 
     class PhysicsWorld;
     class ScriptEngine;
+    class JobSystem;
     class SceneWindow;
     class InstanceWindow;
 
+// Index into the levels dense camera storage, resolve once from a name and
+// keep it around instead of looking the name up every frame.
+using CameraHandle = uint32_t;
+constexpr CameraHandle kInvalidCameraHandle = ~0u;
+
 class Level
 {
 public:
     Level(RenderEngine* eng,
           PhysicsWorld* physWorld,
           ScriptEngine*,
+          JobSystem*,
           const std::filesystem::path& path,
           InstanceWindow* instanceWindow = nullptr,
           SceneWindow* sceneWindow = nullptr);
@@ -31,6 +43,7 @@ public:
     Level(RenderEngine* eng,
           PhysicsWorld* physWorld,
           ScriptEngine*,
+          JobSystem*,
           const std::filesystem::path& path,
           const std::string& name,
           InstanceWindow* instanceWindow = nullptr,
@@ -51,12 +64,20 @@ public:
         return mName;
     }
 
+    // Called as an instance is removed, before its handle goes stale, so
+    // whoever keeps per entity components can drop them.
+    using InstanceRemovedCallback = std::function<void(const InstanceHandle, const InstanceID)>;
+    void setInstanceRemovedCallback(InstanceRemovedCallback callback)
+    {
+        mInstanceRemoved = std::move(callback);
+    }
+
     void removeInstance(const InstanceID id)
     {
         const std::string& name = getScene()->getMeshInstance(id)->getName();
 
+        releaseInstanceHandle(id);
         mScene->removeInstance(id);
-        mInstanceMapertials.erase(id);
         mInstanceIDs.erase(name);
     }
 
@@ -64,8 +85,8 @@ public:
     {
         const InstanceID id = mInstanceIDs[name];
 
+        releaseInstanceHandle(id);
         mScene->removeInstance(id);
-        mInstanceMapertials.erase(id);
         mInstanceIDs.erase(name);
     }
 
@@ -76,6 +97,22 @@ public:
         else
             return kInvalidInstanceID;
     }
+
+    InstanceHandle getInstanceHandle(const InstanceID id) const
+    {
+        return mInstanceTable.getHandle(id);
+    }
+
+    InstanceHandle getInstanceHandleByName(const std::string& name) const
+    {
+        return mInstanceTable.getHandle(getInstanceIDByName(name));
+    }
+
+    const InstanceTable& getInstanceTable() const
+    {
+        return mInstanceTable;
+    }
+
     SceneID    getSceneIDByname(const std::string& name) const
     {
         if(auto it = mAssetIDs.find(name); it != mAssetIDs.end())
@@ -87,15 +124,40 @@ public:
     void setMainCameraByName(const std::string&);
     void setShadowCameraByName(const std::string&);
 
-    Camera& getCameraByName(const std::string& n)
+    void setMainCamera(const CameraHandle);
+    void setShadowCamera(const CameraHandle);
+
+    CameraHandle getCameraHandle(const std::string& name) const
     {
-        BELL_ASSERT(mCamera.find(n) != mCamera.end(), "Camera not created")
-        if(auto it = mCamera.find(n); it != mCamera.end())
-        {
+        if(auto it = mCameraHandles.find(name); it != mCameraHandles.end())
             return it->second;
-        }
+        else
+            return kInvalidCameraHandle;
+    }
+
+    // Handles from scripts need checking, unknown names give kInvalidCameraHandle.
+    bool isValidCamera(const CameraHandle handle) const
+    {
+        return handle < mCameras.size();
+    }
 
-        BELL_TRAP;
+    Camera& getCamera(const CameraHandle handle)
+    {
+        BELL_ASSERT(handle < mCameras.size(), "Invalid camera handle")
+        return mCameras[handle];
+    }
+
+    const Camera& getCamera(const CameraHandle handle) const
+    {
+        BELL_ASSERT(handle < mCameras.size(), "Invalid camera handle")
+        return mCameras[handle];
+    }
+
+    Camera& getCameraByName(const std::string& n)
+    {
+        const CameraHandle handle = getCameraHandle(n);
+        BELL_ASSERT(handle != kInvalidCameraHandle, "Camera not created")
+        return getCamera(handle);
     }
 
     const std::unordered_map<std::string, SceneID>& getAssets() const
@@ -108,19 +170,31 @@ public:
         return mIDToPath[id];
     }
 
-    const std::unordered_map<std::string, InstanceID>& getInstances() const
+    const AnimationGraph* getAnimationGraph(const StaticMesh* mesh) const
     {
-        return mInstanceIDs;
+        if(auto it = mAnimationGraphs.find(mesh); it != mAnimationGraphs.end())
+            return it->second.get();
+        else
+            return nullptr;
     }
 
-    const std::unordered_map<std::string, Camera>& getCameras() const
+    std::filesystem::path getAnimationGraphPath(const SceneID id) const
     {
-        return mCamera;
+        if(auto it = mAnimationGraphPaths.find(id); it != mAnimationGraphPaths.end())
+            return it->second;
+        else
+            return {};
+    }
+
+    const std::unordered_map<std::string, InstanceID>& getInstances() const
+    {
+        return mInstanceIDs;
     }
 
-    std::unordered_map<std::string, Camera>& getCameras()
+    // Name to handle, use getCamera to get at the camera itself.
+    const std::unordered_map<std::string, CameraHandle>& getCameras() const
     {
-        return mCamera;
+        return mCameraHandles;
     }
 
     std::string getAssetName(const SceneID id)
@@ -166,10 +240,10 @@ public:
 
     std::string getMaterialName(const InstanceID id, const uint32_t subMeshIndex) const
     {
-        if(auto it = mInstanceMapertials.find(id); it != mInstanceMapertials.end())
+        if(const std::vector<std::string>* materials = mInstanceMaterials.tryGet(getEntity(id)); materials)
         {
-            BELL_ASSERT(it->second.size() > subMeshIndex, "Index out of bounds")
-            return it->second[subMeshIndex];
+            BELL_ASSERT(materials->size() > subMeshIndex, "Index out of bounds")
+            return (*materials)[subMeshIndex];
         }
         else
             return "";
@@ -178,12 +252,19 @@ public:
     void addMeshFromFile(const std::filesystem::path& path, const MeshType);
     InstanceID addMeshInstance(const std::string& name, const SceneID, const std::string& materialsName, const float3& pos,
                          const quat& rotation, const float3& scale);
-    void addCamera(const std::string& name, const float3& pos, const float3& dir, const CameraMode mode);
+    CameraHandle addCamera(const std::string& name, const float3& pos, const float3& dir, const CameraMode mode);
     void addMaterialFromFile(const std::filesystem::path&);
 
+    // Another copy of an instance from the level file, collider and scripts
+    // included. Scripts still need their init calling.
+    InstanceHandle cloneInstance(const std::string& templateName, const std::string& name, const float3& position);
+
     void setInstanceMaterial(const InstanceID id, const uint32_t subMeshIndex, const std::string& n)
     {
-        std::vector<std::string>& materials = mInstanceMapertials[id];
+        const uint32_t entity = getEntity(id);
+        if(!mInstanceMaterials.contains(entity))
+            mInstanceMaterials.emplace(entity);
+        std::vector<std::string>& materials = mInstanceMaterials.get(entity);
         if(subMeshIndex + 1 > materials.size())
             materials.resize(subMeshIndex + 1);
         materials[subMeshIndex] = n;
@@ -201,28 +282,52 @@ public:
 private:
 
     void addMesh(const std::string& name, const Json::Value& entry);
+    void loadAnimationGraphs();
     void addMeshInstance(const std::string& name, const Json::Value& entry);
     void addLight(const std::string& name, const Json::Value& entry);
     void addMaterial(const std::string& name, const Json::Value& entry);
     void addScript(const std::string& name, const Json::Value& entry);
     void addCamera(const std::string& name, const Json::Value& entry);
+    CameraHandle insertCamera(const std::string& name, const Camera&);
+    void releaseInstanceHandle(const InstanceID);
+
+    uint32_t getEntity(const InstanceID id) const
+    {
+        const InstanceHandle handle = mInstanceTable.getHandle(id);
+        BELL_ASSERT(handle != kInvalidInstanceHandle, "Instance not in the instance table")
+        return InstanceTable::getIndex(handle);
+    }
     void processGlobals(const std::string& name, const Json::Value& entry);
 
     std::string mName;
     std::filesystem::path mWorkingDir;
 
-    std::unordered_map<std::string, Camera>  mCamera;
+    InstanceRemovedCallback mInstanceRemoved;
+
+    // Deque so the scene and editor can hold on to camera pointers.
+    std::deque<Camera> mCameras;
+    std::unordered_map<std::string, CameraHandle> mCameraHandles;
     std::unordered_map<std::string, SceneID> mAssetIDs;
     std::unordered_map<SceneID, std::string> mAssetNames;
     std::unordered_map<SceneID, std::filesystem::path> mIDToPath;
     std::unordered_map<std::string, InstanceID> mInstanceIDs;
-    std::unordered_map<InstanceID, std::vector<std::string>> mInstanceMapertials;
+    // What each instance was loaded from, for cloning.
+    std::unordered_map<std::string, Json::Value> mInstanceEntries;
+    InstanceTable mInstanceTable;
+    // Components keyed by instance table slot.
+    ComponentPool<std::vector<std::string>> mInstanceMaterials;
     std::unordered_map<std::string, MaterialEntry> mMaterials;
+    std::unordered_map<const StaticMesh*, std::unique_ptr<AnimationGraph>> mAnimationGraphs;
+    std::unordered_map<SceneID, std::filesystem::path> mAnimationGraphPaths;
+    // Graphs are parsed together once every mesh is in.
+    std::vector<std::pair<const StaticMesh*, std::filesystem::path>> mPendingAnimationGraphs;
 
     std::unique_ptr<Scene> mScene;
     RenderEngine* mRenderEngine;
     PhysicsWorld* mPhysWorld;
     ScriptEngine* mScriptEngine;
+    // Optional, loading runs serially without it.
+    JobSystem* mJobSystem;
 
     std::array<std::string, 6> mSkybox;
     std::vector<std::string> mGlobalScripts;
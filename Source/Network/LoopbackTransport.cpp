@@ -0,0 +1,63 @@
+#include "LoopbackTransport.hpp"
+
+#include "Core/BellLogging.hpp"
+
+namespace Tempest
+{
+
+LoopbackTransport::LoopbackTransport(const uint64_t seed) :
+    mPacketLoss(0.0f),
+    mRandom(seed)
+{
+}
+
+
+ConnectionID LoopbackTransport::connect(LoopbackTransport& other)
+{
+    const ConnectionID id = static_cast<ConnectionID>(mPeers.size());
+    const ConnectionID otherID = static_cast<ConnectionID>(other.mPeers.size());
+
+    mPeers.push_back({&other, otherID});
+    other.mPeers.push_back({this, id});
+
+    return id;
+}
+
+
+void LoopbackTransport::send(const ConnectionID to, const uint8_t* data, const size_t size)
+{
+    BELL_ASSERT(to < mPeers.size(), "Not connected")
+
+    if(mPacketLoss > 0.0f)
+    {
+        std::unique_lock lock(mMutex);
+        if(mRandom.nextFloat() < mPacketLoss)
+            return;
+    }
+
+    const Peer& peer = mPeers[to];
+    peer.mTransport->deliver(peer.mRemoteID, data, size);
+}
+
+
+bool LoopbackTransport::receive(ConnectionID& from, std::vector<uint8_t>& data)
+{
+    std::unique_lock lock(mMutex);
+    if(mInbox.empty())
+        return false;
+
+    from = mInbox.front().mFrom;
+    data.swap(mInbox.front().mData);
+    mInbox.pop_front();
+
+    return true;
+}
+
+
+void LoopbackTransport::deliver(const ConnectionID from, const uint8_t* data, const size_t size)
+{
+    std::unique_lock lock(mMutex);
+    mInbox.push_back({from, std::vector<uint8_t>(data, data + size)});
+}
+
+}
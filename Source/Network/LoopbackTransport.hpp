@@ -0,0 +1,60 @@
+#ifndef TEMPEST_LOOPBACK_TRANSPORT_HPP
+#define TEMPEST_LOOPBACK_TRANSPORT_HPP
+
+#include "Transport.hpp"
+#include "Random.hpp"
+
+#include <deque>
+#include <mutex>
+
+namespace Tempest
+{
+
+// In process transport for tests or a client and server in one process.
+// Endpoints have to outlive each other once connected. Can drop a fraction
+// of sent packets to exercise the ack path.
+class LoopbackTransport : public Transport
+{
+public:
+    LoopbackTransport(const uint64_t seed = 0);
+
+    // Returns the id to send to other on, other gets one back to this.
+    ConnectionID connect(LoopbackTransport& other);
+
+    void setPacketLoss(const float fraction)
+    {
+        mPacketLoss = fraction;
+    }
+
+    void send(const ConnectionID, const uint8_t* data, const size_t size) override;
+    bool receive(ConnectionID& from, std::vector<uint8_t>& data) override;
+
+private:
+
+    void deliver(const ConnectionID from, const uint8_t* data, const size_t size);
+
+    struct Peer
+    {
+        LoopbackTransport* mTransport;
+        // What the peer calls us.
+        ConnectionID mRemoteID;
+    };
+
+    struct Packet
+    {
+        ConnectionID mFrom;
+        std::vector<uint8_t> mData;
+    };
+
+    std::vector<Peer> mPeers;
+
+    std::mutex mMutex;
+    std::deque<Packet> mInbox;
+
+    float mPacketLoss;
+    Random mRandom;
+};
+
+}
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef TEMPEST_PACKET_STREAM_HPP
+#define TEMPEST_PACKET_STREAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Tempest
+{
+
+// Little endian byte packing for network packets. Varints are LEB128, signed
+// values go through zigzag first so small deltas either side of zero stay small.
+class PacketWriter
+{
+public:
+    PacketWriter(std::vector<uint8_t>& data) :
+        mData(data) {}
+
+    void writeU8(const uint8_t v)
+    {
+        mData.push_back(v);
+    }
+
+    void writeU16(const uint16_t v)
+    {
+        writeU8(static_cast<uint8_t>(v));
+        writeU8(static_cast<uint8_t>(v >> 8));
+    }
+
+    void writeU32(const uint32_t v)
+    {
+        writeU16(static_cast<uint16_t>(v));
+        writeU16(static_cast<uint16_t>(v >> 16));
+    }
+
+    void writeVarint(uint64_t v)
+    {
+        while(v >= 0x80)
+        {
+            writeU8(static_cast<uint8_t>(v) | 0x80);
+            v >>= 7;
+        }
+        writeU8(static_cast<uint8_t>(v));
+    }
+
+    void writeSignedVarint(const int64_t v)
+    {
+        writeVarint((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+    }
+
+    size_t size() const
+    {
+        return mData.size();
+    }
+
+private:
+    std::vector<uint8_t>& mData;
+};
+
+// Packets come off the wire so nothing here trusts the length, reading past
+// the end returns zeros and sets the error flag for the caller to check once.
+class PacketReader
+{
+public:
+    PacketReader(const uint8_t* data, const size_t size) :
+        mData(data),
+        mSize(size),
+        mOffset(0),
+        mError(false) {}
+
+    uint8_t readU8()
+    {
+        if(mOffset >= mSize)
+        {
+            mError = true;
+            return 0;
+        }
+
+        return mData[mOffset++];
+    }
+
+    uint16_t readU16()
+    {
+        const uint16_t low = readU8();
+        return static_cast<uint16_t>(low | (readU8() << 8));
+    }
+
+    uint32_t readU32()
+    {
+        const uint32_t low = readU16();
+        return low | (static_cast<uint32_t>(readU16()) << 16);
+    }
+
+    uint64_t readVarint()
+    {
+        uint64_t v = 0;
+        for(uint32_t shift = 0; shift < 64; shift += 7)
+        {
+            const uint8_t byte = readU8();
+            v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if(!(byte & 0x80))
+                return v;
+        }
+
+        mError = true;
+        return 0;
+    }
+
+    int64_t readSignedVarint()
+    {
+        const uint64_t v = readVarint();
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+    bool hasError() const
+    {
+        return mError;
+    }
+
+    bool atEnd() const
+    {
+        return mOffset >= mSize;
+    }
+
+    size_t getRemaining() const
+    {
+        return mOffset < mSize ? mSize - mOffset : 0;
+    }
+
+private:
+    const uint8_t* mData;
+    size_t mSize;
+    size_t mOffset;
+    bool mError;
+};
+
+}
+
+#endif
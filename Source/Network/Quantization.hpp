@@ -0,0 +1,88 @@
+#ifndef TEMPEST_QUANTIZATION_HPP
+#define TEMPEST_QUANTIZATION_HPP
+
+#include "Engine/GeomUtils.h"
+
+#include <cmath>
+#include <cstdint>
+
+namespace Tempest
+{
+
+// Positions go over the wire as fixed point millimetre-ish steps.
+constexpr float kPositionQuantum = 1.0f / 1024.0f;
+
+inline int32_t quantizePosition(const float v)
+{
+    return static_cast<int32_t>(std::lround(v / kPositionQuantum));
+}
+
+inline float dequantizePosition(const int32_t v)
+{
+    return static_cast<float>(v) * kPositionQuantum;
+}
+
+// Smallest three: drop the largest component (it's recoverable from the
+// other three since the quaternion is unit length), store its index in 2
+// bits and the rest in 10 bits each over [-1/sqrt2, 1/sqrt2].
+constexpr uint32_t kRotationComponentBits = 10;
+
+inline uint32_t packRotation(const quat& q)
+{
+    constexpr float kRange = 0.70710678f;
+    constexpr uint32_t kMax = (1u << kRotationComponentBits) - 1;
+
+    const float components[4] = {q.x, q.y, q.z, q.w};
+    uint32_t largest = 0;
+    for(uint32_t i = 1; i < 4; ++i)
+    {
+        if(std::fabs(components[i]) > std::fabs(components[largest]))
+            largest = i;
+    }
+
+    // q and -q are the same rotation, flip so the dropped one is positive.
+    const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+    uint32_t packed = largest;
+    uint32_t shift = 2;
+    for(uint32_t i = 0; i < 4; ++i)
+    {
+        if(i == largest)
+            continue;
+
+        const float normalised = ((components[i] * sign) + kRange) / (2.0f * kRange);
+        const float clamped = std::fmin(std::fmax(normalised, 0.0f), 1.0f);
+        packed |= static_cast<uint32_t>(std::lround(clamped * kMax)) << shift;
+        shift += kRotationComponentBits;
+    }
+
+    return packed;
+}
+
+inline quat unpackRotation(const uint32_t packed)
+{
+    constexpr float kRange = 0.70710678f;
+    constexpr uint32_t kMax = (1u << kRotationComponentBits) - 1;
+
+    const uint32_t largest = packed & 3;
+    float components[4];
+    float sumSquares = 0.0f;
+    uint32_t shift = 2;
+    for(uint32_t i = 0; i < 4; ++i)
+    {
+        if(i == largest)
+            continue;
+
+        const float normalised = static_cast<float>((packed >> shift) & kMax) / kMax;
+        components[i] = (normalised * 2.0f * kRange) - kRange;
+        sumSquares += components[i] * components[i];
+        shift += kRotationComponentBits;
+    }
+    components[largest] = std::sqrt(std::fmax(1.0f - sumSquares, 0.0f));
+
+    return quat(components[3], components[0], components[1], components[2]);
+}
+
+}
+
+#endif
@@ -0,0 +1,628 @@
+#include "Replication.hpp"
+#include "PacketStream.hpp"
+#include "Quantization.hpp"
+
+#include "FrameProfiler.hpp"
+#include "InterestGrid.hpp"
+
+#include "Core/BellLogging.hpp"
+
+#include <algorithm>
+#include <random>
+
+namespace Tempest
+{
+
+namespace
+{
+    // Snapshot packet:
+    //   u8 type, u16 sequence, u8 flags, [u16 baseline]
+    //   varint removed count, removed ids as varint gaps
+    //   varint record count, per record:
+    //     varint id gap, u8 fields, [3 signed varint position deltas],
+    //     [u32 rotation], [u8 slot mask, signed varint value deltas]
+    // Instances in the baseline without a record are unchanged, instances
+    // not in the baseline are sent against an all zero entity.
+    // Ack packet:
+    //   u8 type, u32 token, u8 has snapshot, u16 newest sequence
+    // Challenge packet, the reply to an ack with the wrong token:
+    //   u8 type, u32 token
+    // Tokens come from a server secret and the connection, only someone
+    // really at that address sees the challenge, so spoofed acks can't start
+    // snapshots flowing. The challenge is smaller than the ack that asked.
+    enum PacketType : uint8_t
+    {
+        kSnapshotPacket = 1,
+        kAckPacket = 2,
+        kChallengePacket = 3
+    };
+
+    enum FieldBits : uint8_t
+    {
+        kPositionField = 1 << 0,
+        kRotationField = 1 << 1,
+        kValuesField = 1 << 2
+    };
+
+    constexpr uint8_t kHasBaselineFlag = 1;
+
+    // Clients that go quiet this many updates get dropped.
+    constexpr uint32_t kClientTimeout = 300;
+    // Acks from anyone else are ignored until a client drops.
+    constexpr uint32_t kMaxClients = 64;
+
+    uint32_t challengeToken(const uint64_t secret, const ConnectionID connection)
+    {
+        uint64_t z = secret ^ (static_cast<uint64_t>(connection) * 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return static_cast<uint32_t>(z ^ (z >> 31));
+    }
+
+    bool sequenceNewer(const uint16_t a, const uint16_t b)
+    {
+        return a != b && static_cast<uint16_t>(a - b) < 0x8000;
+    }
+
+    ReplicatedEntity emptyEntity(const InstanceID id)
+    {
+        ReplicatedEntity entity{};
+        entity.mID = id;
+        return entity;
+    }
+
+    uint8_t changedValues(const ReplicatedEntity& current, const ReplicatedEntity& base)
+    {
+        uint8_t mask = 0;
+        for(uint32_t i = 0; i < kReplicatedValueCount; ++i)
+        {
+            if(current.mValues[i] != base.mValues[i])
+                mask |= 1 << i;
+        }
+
+        return mask;
+    }
+
+    // Writes nothing if the entity is unchanged and not new.
+    bool writeEntity(PacketWriter& writer, const ReplicatedEntity& current, const ReplicatedEntity& base, const bool isNew, const InstanceID previousID)
+    {
+        const bool positionChanged = current.mPosition[0] != base.mPosition[0] ||
+                                     current.mPosition[1] != base.mPosition[1] ||
+                                     current.mPosition[2] != base.mPosition[2];
+        const uint8_t valueMask = changedValues(current, base);
+
+        uint8_t fields = 0;
+        fields |= positionChanged ? kPositionField : 0;
+        fields |= current.mRotation != base.mRotation ? kRotationField : 0;
+        fields |= valueMask ? kValuesField : 0;
+        if(!fields && !isNew)
+            return false;
+
+        writer.writeVarint(static_cast<uint64_t>(current.mID) - static_cast<uint64_t>(previousID));
+        writer.writeU8(fields);
+
+        if(fields & kPositionField)
+        {
+            for(uint32_t i = 0; i < 3; ++i)
+                writer.writeSignedVarint(static_cast<int64_t>(current.mPosition[i]) - base.mPosition[i]);
+        }
+
+        if(fields & kRotationField)
+            writer.writeU32(current.mRotation);
+
+        if(fields & kValuesField)
+        {
+            writer.writeU8(valueMask);
+            for(uint32_t i = 0; i < kReplicatedValueCount; ++i)
+            {
+                if(valueMask & (1 << i))
+                    writer.writeSignedVarint(static_cast<int64_t>(current.mValues[i]) - base.mValues[i]);
+            }
+        }
+
+        return true;
+    }
+
+    void readEntity(PacketReader& reader, ReplicatedEntity& entity)
+    {
+        const uint8_t fields = reader.readU8();
+
+        if(fields & kPositionField)
+        {
+            for(uint32_t i = 0; i < 3; ++i)
+                entity.mPosition[i] = static_cast<int32_t>(entity.mPosition[i] + reader.readSignedVarint());
+        }
+
+        if(fields & kRotationField)
+            entity.mRotation = reader.readU32();
+
+        if(fields & kValuesField)
+        {
+            const uint8_t valueMask = reader.readU8();
+            for(uint32_t i = 0; i < kReplicatedValueCount; ++i)
+            {
+                if(valueMask & (1 << i))
+                    entity.mValues[i] = static_cast<int32_t>(entity.mValues[i] + reader.readSignedVarint());
+            }
+        }
+    }
+
+    // baselineSequence is -1 for a full snapshot, base is empty then.
+    void writeSnapshot(std::vector<uint8_t>& data,
+                       std::vector<uint8_t>& recordScratch,
+                       const uint16_t sequence,
+                       const std::vector<ReplicatedEntity>& current,
+                       const int32_t baselineSequence,
+                       const std::vector<ReplicatedEntity>& base)
+    {
+        data.clear();
+        PacketWriter writer(data);
+        writer.writeU8(kSnapshotPacket);
+        writer.writeU16(sequence);
+        writer.writeU8(baselineSequence >= 0 ? kHasBaselineFlag : 0);
+        if(baselineSequence >= 0)
+            writer.writeU16(static_cast<uint16_t>(baselineSequence));
+
+        // Both sorted by id, walk them together.
+        recordScratch.clear();
+        PacketWriter records(recordScratch);
+        uint64_t recordCount = 0;
+        InstanceID previousRecord = 0;
+
+        std::vector<InstanceID> removed;
+        size_t b = 0;
+        for(const ReplicatedEntity& entity : current)
+        {
+            while(b < base.size() && base[b].mID < entity.mID)
+                removed.push_back(base[b++].mID);
+
+            const bool inBaseline = b < base.size() && base[b].mID == entity.mID;
+            const ReplicatedEntity empty = inBaseline ? ReplicatedEntity{} : emptyEntity(entity.mID);
+            if(writeEntity(records, entity, inBaseline ? base[b] : empty, !inBaseline, previousRecord))
+            {
+                previousRecord = entity.mID;
+                ++recordCount;
+            }
+
+            if(inBaseline)
+                ++b;
+        }
+        for(; b < base.size(); ++b)
+            removed.push_back(base[b].mID);
+
+        writer.writeVarint(removed.size());
+        InstanceID previousRemoved = 0;
+        for(const InstanceID id : removed)
+        {
+            writer.writeVarint(static_cast<uint64_t>(id) - static_cast<uint64_t>(previousRemoved));
+            previousRemoved = id;
+        }
+
+        writer.writeVarint(recordCount);
+        data.insert(data.end(), recordScratch.begin(), recordScratch.end());
+    }
+}
+
+
+ReplicationServer::ReplicationServer(Transport* transport) :
+    mTransport(transport),
+    mInterest(nullptr),
+    mSecret(0),
+    mSequence(0),
+    mEncodedCount(0),
+    mStats{}
+{
+    std::random_device device;
+    mSecret = (static_cast<uint64_t>(device()) << 32) | device();
+}
+
+
+void ReplicationServer::addInstance(const InstanceID id)
+{
+    mInstances.insert({id, {}});
+}
+
+
+void ReplicationServer::removeInstance(const InstanceID id)
+{
+    mInstances.erase(id);
+}
+
+
+void ReplicationServer::clearInstances()
+{
+    mInstances.clear();
+}
+
+
+void ReplicationServer::setValue(const InstanceID id, const uint32_t slot, const int32_t value)
+{
+    BELL_ASSERT(slot < kReplicatedValueCount, "Replicated value slot out of range")
+    if(auto it = mInstances.find(id); it != mInstances.end())
+        it->second[slot] = value;
+}
+
+
+void ReplicationServer::update(Scene* scene)
+{
+    TEMPEST_PROFILE_SCOPE("Replication send")
+
+    receiveAcks();
+
+    ReplicationSnapshot& snapshot = mHistory[mSequence % kSnapshotHistory];
+    snapshot.mSequence = mSequence;
+    snapshot.mValid = true;
+    capture(scene, snapshot);
+
+    mStats = {};
+    mEncodedCount = 0;
+    for(Client& client : mClients)
+    {
+        if(mInterest)
+            assignObserver(client);
+
+        const ReplicationSnapshot* baseline = findBaseline(client);
+        const std::vector<uint8_t>& packet = client.mObserver != kInvalidInstanceID ? getFilteredPacket(client, snapshot, baseline) : getPacket(snapshot, baseline);
+        mTransport->send(client.mConnection, packet.data(), packet.size());
+        mStats.mBytesSent += packet.size();
+    }
+    mStats.mClients = static_cast<uint32_t>(mClients.size());
+    mStats.mEncodedPackets += mEncodedCount;
+
+    ++mSequence;
+}
+
+
+void ReplicationServer::receiveAcks()
+{
+    for(Client& client : mClients)
+        ++client.mIdleUpdates;
+
+    ConnectionID from;
+    while(mTransport->receive(from, mReceiveBuffer))
+    {
+        PacketReader reader(mReceiveBuffer.data(), mReceiveBuffer.size());
+        if(reader.readU8() != kAckPacket)
+            continue;
+
+        const uint32_t token = reader.readU32();
+        const bool hasSnapshot = reader.readU8() != 0;
+        const uint16_t sequence = reader.readU16();
+        if(reader.hasError())
+            continue;
+
+        const uint32_t expectedToken = challengeToken(mSecret, from);
+        if(token != expectedToken)
+        {
+            mChallengeBuffer.clear();
+            PacketWriter writer(mChallengeBuffer);
+            writer.writeU8(kChallengePacket);
+            writer.writeU32(expectedToken);
+            mTransport->send(from, mChallengeBuffer.data(), mChallengeBuffer.size());
+            continue;
+        }
+
+        auto it = std::find_if(mClients.begin(), mClients.end(), [from](const Client& c) { return c.mConnection == from; });
+        if(it == mClients.end())
+        {
+            if(mClients.size() >= kMaxClients)
+                continue;
+
+            mClients.push_back({from, 0, false, 0, mSequence, kInvalidInstanceID, {}});
+            it = mClients.end() - 1;
+        }
+
+        it->mIdleUpdates = 0;
+        if(hasSnapshot && (!it->mHasAck || sequenceNewer(sequence, it->mAckedSequence)))
+        {
+            it->mAckedSequence = sequence;
+            it->mHasAck = true;
+        }
+    }
+
+    mClients.erase(std::remove_if(mClients.begin(), mClients.end(), [](const Client& c) { return c.mIdleUpdates > kClientTimeout; }), mClients.end());
+}
+
+
+void ReplicationServer::capture(Scene* scene, ReplicationSnapshot& snapshot)
+{
+    snapshot.mEntities.resize(mInstances.size());
+
+    uint32_t i = 0;
+    for(const auto& [id, values] : mInstances)
+    {
+        const MeshInstance* instance = scene->getMeshInstance(id);
+        if(!instance)
+            continue;
+
+        const float3 position = instance->getPosition();
+
+        ReplicatedEntity& entity = snapshot.mEntities[i++];
+        entity.mID = id;
+        entity.mPosition[0] = quantizePosition(position.x);
+        entity.mPosition[1] = quantizePosition(position.y);
+        entity.mPosition[2] = quantizePosition(position.z);
+        entity.mRotation = packRotation(instance->getRotation());
+        std::copy(values.begin(), values.end(), entity.mValues);
+    }
+    snapshot.mEntities.resize(i);
+}
+
+
+const ReplicationSnapshot* ReplicationServer::findBaseline(const Client& client) const
+{
+    if(!client.mHasAck)
+        return nullptr;
+
+    const uint16_t age = static_cast<uint16_t>(mSequence - client.mAckedSequence);
+    const ReplicationSnapshot& baseline = mHistory[client.mAckedSequence % kSnapshotHistory];
+    if(age == 0 || age >= kSnapshotHistory || !baseline.mValid || baseline.mSequence != client.mAckedSequence)
+        return nullptr;
+
+    if(sequenceNewer(client.mFirstSequence, client.mAckedSequence))
+        return nullptr;
+
+    return &baseline;
+}
+
+
+const std::vector<uint8_t>& ReplicationServer::getPacket(const ReplicationSnapshot& snapshot, const ReplicationSnapshot* baseline)
+{
+    const int32_t baselineSequence = baseline ? baseline->mSequence : -1;
+    for(uint32_t i = 0; i < mEncodedCount; ++i)
+    {
+        if(mEncoded[i].mBaseline == baselineSequence)
+            return mEncoded[i].mData;
+    }
+
+    if(mEncodedCount == mEncoded.size())
+        mEncoded.emplace_back();
+
+    EncodedPacket& packet = mEncoded[mEncodedCount++];
+    packet.mBaseline = baselineSequence;
+    static const std::vector<ReplicatedEntity> kNoEntities;
+    writeSnapshot(packet.mData, mRecordScratch, snapshot.mSequence, snapshot.mEntities, baselineSequence, baseline ? baseline->mEntities : kNoEntities);
+
+    return packet.mData;
+}
+
+
+void ReplicationServer::assignObserver(Client& client)
+{
+    if(client.mObserver != kInvalidInstanceID && mInterest->isObserver(client.mObserver))
+        return;
+
+    const InstanceID previous = client.mObserver;
+    client.mObserver = kInvalidInstanceID;
+    for(const InstanceID observer : mInterest->getObservers())
+    {
+        auto claimed = std::find_if(mClients.begin(), mClients.end(), [observer](const Client& c) { return c.mObserver == observer; });
+        if(claimed == mClients.end())
+        {
+            client.mObserver = observer;
+            break;
+        }
+    }
+
+    if(client.mObserver == previous)
+        return;
+
+    // Nothing sent before this matches what the client should have now.
+    client.mFirstSequence = mSequence;
+    client.mSent.resize(kSnapshotHistory);
+    for(SentSet& sent : client.mSent)
+        sent.mValid = false;
+}
+
+
+const std::vector<uint8_t>& ReplicationServer::getFilteredPacket(Client& client, const ReplicationSnapshot& snapshot, const ReplicationSnapshot* baseline)
+{
+    SentSet& sent = client.mSent[snapshot.mSequence % kSnapshotHistory];
+    sent.mSequence = snapshot.mSequence;
+    sent.mValid = true;
+    sent.mIDs.clear();
+
+    mFilteredCurrent.clear();
+    const std::unordered_set<InstanceID>* relevant = mInterest->getRelevant(client.mObserver);
+    for(const ReplicatedEntity& entity : snapshot.mEntities)
+    {
+        if(relevant && relevant->count(entity.mID))
+        {
+            mFilteredCurrent.push_back(entity);
+            sent.mIDs.push_back(entity.mID);
+        }
+    }
+
+    // The baseline is whatever of the shared snapshot this client was sent, ids are sorted in both.
+    int32_t baselineSequence = -1;
+    mFilteredBaseline.clear();
+    if(baseline)
+    {
+        const SentSet& sentBase = client.mSent[baseline->mSequence % kSnapshotHistory];
+        if(sentBase.mValid && sentBase.mSequence == baseline->mSequence)
+        {
+            baselineSequence = baseline->mSequence;
+
+            size_t e = 0;
+            for(const InstanceID id : sentBase.mIDs)
+            {
+                while(baseline->mEntities[e].mID < id)
+                    ++e;
+                mFilteredBaseline.push_back(baseline->mEntities[e]);
+            }
+        }
+    }
+
+    writeSnapshot(mFilteredPacket, mRecordScratch, snapshot.mSequence, mFilteredCurrent, baselineSequence, mFilteredBaseline);
+    ++mStats.mEncodedPackets;
+
+    return mFilteredPacket;
+}
+
+
+ReplicationClient::ReplicationClient(Transport* transport, const ConnectionID server) :
+    mTransport(transport),
+    mServer(server),
+    mToken(0),
+    mLatest(0),
+    mHasSnapshot(false)
+{
+}
+
+
+bool ReplicationClient::update()
+{
+    TEMPEST_PROFILE_SCOPE("Replication receive")
+
+    bool updated = false;
+
+    ConnectionID from;
+    while(mTransport->receive(from, mReceiveBuffer))
+    {
+        if(from != mServer)
+            continue;
+
+        if(!mReceiveBuffer.empty() && mReceiveBuffer[0] == kChallengePacket)
+            readChallenge(mReceiveBuffer);
+        else
+            updated |= decode(mReceiveBuffer);
+    }
+
+    // Every update, doubles as a keep alive and the first one gets us challenged.
+    sendAck();
+
+    return updated;
+}
+
+
+int32_t ReplicationClient::getValue(const InstanceID id, const uint32_t slot) const
+{
+    const ReplicationSnapshot* snapshot = getLatestSnapshot();
+    if(!snapshot || slot >= kReplicatedValueCount)
+        return 0;
+
+    auto it = std::lower_bound(snapshot->mEntities.begin(), snapshot->mEntities.end(), id, [](const ReplicatedEntity& e, const InstanceID i) { return e.mID < i; });
+    if(it == snapshot->mEntities.end() || it->mID != id)
+        return 0;
+
+    return it->mValues[slot];
+}
+
+
+bool ReplicationClient::decode(const std::vector<uint8_t>& packet)
+{
+    PacketReader reader(packet.data(), packet.size());
+    if(reader.readU8() != kSnapshotPacket)
+        return false;
+
+    const uint16_t sequence = reader.readU16();
+    const uint8_t flags = reader.readU8();
+    const bool hasBaseline = flags & kHasBaselineFlag;
+    const uint16_t baselineSequence = hasBaseline ? reader.readU16() : 0;
+    if(reader.hasError() || (mHasSnapshot && !sequenceNewer(sequence, mLatest)))
+        return false;
+
+    const ReplicationSnapshot* baseline = nullptr;
+    if(hasBaseline)
+    {
+        baseline = &mHistory[baselineSequence % kSnapshotHistory];
+        // Already overwritten, the server will fall back to a full one soon.
+        if(!baseline->mValid || baseline->mSequence != baselineSequence || baselineSequence == sequence)
+            return false;
+    }
+
+    static const std::vector<ReplicatedEntity> kNoEntities;
+    const std::vector<ReplicatedEntity>& base = baseline ? baseline->mEntities : kNoEntities;
+
+    // Every entry is at least a byte, so counts past that are garbage.
+    const uint64_t removedCount = reader.readVarint();
+    if(removedCount > reader.getRemaining())
+        return false;
+
+    std::vector<InstanceID> removed(removedCount);
+    InstanceID previous = 0;
+    for(InstanceID& id : removed)
+    {
+        id = static_cast<InstanceID>(static_cast<uint64_t>(previous) + reader.readVarint());
+        previous = id;
+    }
+
+    const uint64_t recordCount = reader.readVarint();
+    if(reader.hasError() || recordCount > reader.getRemaining())
+        return false;
+
+    // Merge the records in to the baseline, both sorted by id.
+    std::vector<ReplicatedEntity> entities;
+    entities.reserve(base.size() + recordCount);
+    size_t b = 0;
+    size_t r = 0;
+    // Everything before id, or all that's left.
+    auto copyBaseline = [&](const InstanceID id, const bool all)
+    {
+        while(b < base.size() && (all || base[b].mID < id))
+        {
+            while(r < removed.size() && removed[r] < base[b].mID)
+                ++r;
+            if(r == removed.size() || removed[r] != base[b].mID)
+                entities.push_back(base[b]);
+            ++b;
+        }
+    };
+
+    InstanceID id = 0;
+    for(uint64_t i = 0; i < recordCount; ++i)
+    {
+        const uint64_t gap = reader.readVarint();
+        if(i > 0 && gap == 0)
+            return false;
+        id = static_cast<InstanceID>(static_cast<uint64_t>(id) + gap);
+
+        copyBaseline(id, false);
+
+        ReplicatedEntity entity = emptyEntity(id);
+        if(b < base.size() && base[b].mID == id)
+            entity = base[b++];
+
+        readEntity(reader, entity);
+        entities.push_back(entity);
+    }
+    copyBaseline(id, true);
+
+    if(reader.hasError())
+        return false;
+
+    ReplicationSnapshot& snapshot = mHistory[sequence % kSnapshotHistory];
+    snapshot.mSequence = sequence;
+    snapshot.mValid = true;
+    snapshot.mEntities.swap(entities);
+
+    mLatest = sequence;
+    mHasSnapshot = true;
+
+    return true;
+}
+
+
+void ReplicationClient::readChallenge(const std::vector<uint8_t>& packet)
+{
+    PacketReader reader(packet.data(), packet.size());
+    reader.readU8();
+    const uint32_t token = reader.readU32();
+    if(!reader.hasError())
+        mToken = token;
+}
+
+
+void ReplicationClient::sendAck()
+{
+    mAckBuffer.clear();
+    PacketWriter writer(mAckBuffer);
+    writer.writeU8(kAckPacket);
+    writer.writeU32(mToken);
+    writer.writeU8(mHasSnapshot ? 1 : 0);
+    writer.writeU16(mLatest);
+
+    mTransport->send(mServer, mAckBuffer.data(), mAckBuffer.size());
+}
+
+}
@@ -0,0 +1,180 @@
+#ifndef TEMPEST_REPLICATION_HPP
+#define TEMPEST_REPLICATION_HPP
+
+#include "Engine/Scene.h"
+#include "Transport.hpp"
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace Tempest
+{
+    class InterestGrid;
+
+// Integer slots per instance that scripts can replicate alongside the transform.
+constexpr uint32_t kReplicatedValueCount = 8;
+// Snapshots kept on both ends to delta against, a client that hasn't acked
+// anything this recent gets a full snapshot.
+constexpr uint32_t kSnapshotHistory = 64;
+
+// Quantized state of one instance, what gets compared and sent.
+struct ReplicatedEntity
+{
+    InstanceID mID;
+    int32_t mPosition[3];
+    uint32_t mRotation;
+    int32_t mValues[kReplicatedValueCount];
+};
+
+struct ReplicationSnapshot
+{
+    uint16_t mSequence = 0;
+    bool mValid = false;
+    // Sorted by id.
+    std::vector<ReplicatedEntity> mEntities;
+};
+
+// Captures registered instances every update and sends each client the
+// difference from the newest snapshot it acknowledged. Clients sharing a
+// baseline share the encoded packet, so the per client cost is mostly the
+// send. With an interest grid clients take the grids observers in the order
+// they connect and only get what their observer can see, instances leaving
+// the set are sent as removed. Clients have to echo a challenge token before
+// they get anything.
+class ReplicationServer
+{
+public:
+    ReplicationServer(Transport*);
+
+    // Clients without an observer get everything.
+    void setInterestGrid(const InterestGrid* grid)
+    {
+        mInterest = grid;
+    }
+
+    void addInstance(const InstanceID);
+    void removeInstance(const InstanceID);
+    // Instance ids don't carry over between levels.
+    void clearInstances();
+    void setValue(const InstanceID, const uint32_t slot, const int32_t value);
+
+    // Reads acks, captures the scene and sends.
+    void update(Scene*);
+
+    struct Stats
+    {
+        uint32_t mClients;
+        uint32_t mEncodedPackets;
+        uint64_t mBytesSent;
+    };
+
+    // For the last update.
+    const Stats& getStats() const
+    {
+        return mStats;
+    }
+
+private:
+
+    // What a filtered client was sent, its baseline is rebuilt from this
+    // and the shared history.
+    struct SentSet
+    {
+        uint16_t mSequence;
+        bool mValid;
+        std::vector<InstanceID> mIDs;
+    };
+
+    struct Client
+    {
+        ConnectionID mConnection;
+        uint16_t mAckedSequence;
+        bool mHasAck;
+        uint32_t mIdleUpdates;
+        // Acks for anything older were sent with a different observer.
+        uint16_t mFirstSequence;
+        InstanceID mObserver;
+        // By sequence, only used with an observer.
+        std::vector<SentSet> mSent;
+    };
+
+    struct EncodedPacket
+    {
+        // -1 for a full snapshot.
+        int32_t mBaseline;
+        std::vector<uint8_t> mData;
+    };
+
+    void receiveAcks();
+    void capture(Scene*, ReplicationSnapshot&);
+    const ReplicationSnapshot* findBaseline(const Client&) const;
+    const std::vector<uint8_t>& getPacket(const ReplicationSnapshot&, const ReplicationSnapshot* baseline);
+    void assignObserver(Client&);
+    const std::vector<uint8_t>& getFilteredPacket(Client&, const ReplicationSnapshot&, const ReplicationSnapshot* baseline);
+
+    Transport* mTransport;
+    const InterestGrid* mInterest;
+    std::vector<Client> mClients;
+    uint64_t mSecret;
+    std::vector<uint8_t> mChallengeBuffer;
+
+    std::map<InstanceID, std::array<int32_t, kReplicatedValueCount>> mInstances;
+
+    std::array<ReplicationSnapshot, kSnapshotHistory> mHistory;
+    uint16_t mSequence;
+
+    // This updates packets by baseline.
+    std::vector<EncodedPacket> mEncoded;
+    uint32_t mEncodedCount;
+    std::vector<uint8_t> mRecordScratch;
+    std::vector<ReplicatedEntity> mFilteredCurrent;
+    std::vector<ReplicatedEntity> mFilteredBaseline;
+    std::vector<uint8_t> mFilteredPacket;
+    std::vector<uint8_t> mReceiveBuffer;
+
+    Stats mStats;
+};
+
+// Decodes snapshots from the server, acks the newest it has and keeps the
+// ones the server might delta against.
+class ReplicationClient
+{
+public:
+    ReplicationClient(Transport*, const ConnectionID server);
+
+    // Returns true if a newer snapshot arrived.
+    bool update();
+
+    // nullptr until the first snapshot arrives.
+    const ReplicationSnapshot* getLatestSnapshot() const
+    {
+        return mHasSnapshot ? &mHistory[mLatest % kSnapshotHistory] : nullptr;
+    }
+
+    // 0 for unknown instances.
+    int32_t getValue(const InstanceID, const uint32_t slot) const;
+
+private:
+
+    bool decode(const std::vector<uint8_t>& packet);
+    void readChallenge(const std::vector<uint8_t>& packet);
+    void sendAck();
+
+    Transport* mTransport;
+    ConnectionID mServer;
+    // Echoed in acks, whatever the server last challenged us with.
+    uint32_t mToken;
+
+    std::array<ReplicationSnapshot, kSnapshotHistory> mHistory;
+    uint16_t mLatest;
+    bool mHasSnapshot;
+
+    std::vector<uint8_t> mReceiveBuffer;
+    std::vector<uint8_t> mAckBuffer;
+};
+
+}
+
+#endif
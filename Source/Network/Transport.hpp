@@ -0,0 +1,30 @@
+#ifndef TEMPEST_TRANSPORT_HPP
+#define TEMPEST_TRANSPORT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Tempest
+{
+
+// Local handle for whoever is on the other end, assigned by the transport.
+using ConnectionID = uint32_t;
+constexpr ConnectionID kInvalidConnection = ~0u;
+
+// Unreliable, unordered datagrams. Anything on top (acks, baselines) is up
+// to the caller, a transport only has to deliver whole packets or nothing.
+class Transport
+{
+public:
+    virtual ~Transport() = default;
+
+    virtual void send(const ConnectionID, const uint8_t* data, const size_t size) = 0;
+
+    // Pops the next waiting packet, false once there are none.
+    virtual bool receive(ConnectionID& from, std::vector<uint8_t>& data) = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,217 @@
+#include "UdpTransport.hpp"
+
+#include "Core/BellLogging.hpp"
+
+#include <cstring>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace Tempest
+{
+
+namespace
+{
+    // Biggest payload a single datagram can carry.
+    constexpr size_t kMaxDatagramSize = 65507;
+
+#if defined(_WIN32)
+    using SocketHandle = SOCKET;
+
+    void closeSocket(const SocketHandle s)
+    {
+        closesocket(s);
+    }
+
+    bool setNonBlocking(const SocketHandle s)
+    {
+        u_long enabled = 1;
+        return ioctlsocket(s, FIONBIO, &enabled) == 0;
+    }
+#else
+    using SocketHandle = int;
+
+    void closeSocket(const SocketHandle s)
+    {
+        close(s);
+    }
+
+    bool setNonBlocking(const SocketHandle s)
+    {
+        return fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK) == 0;
+    }
+#endif
+}
+
+
+UdpTransport::UdpTransport(const uint16_t port) :
+    mSocket(kInvalidSocket),
+    mNextPeer(0),
+    mReceiveBuffer(kMaxDatagramSize)
+{
+#if defined(_WIN32)
+    WSADATA data;
+    if(WSAStartup(MAKEWORD(2, 2), &data) != 0)
+    {
+        BELL_LOG_ARGS("WSAStartup failed for port %u", port);
+        return;
+    }
+#endif
+
+    const SocketHandle s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if(s == static_cast<SocketHandle>(kInvalidSocket))
+    {
+        BELL_LOG_ARGS("Failed to create udp socket for port %u", port);
+        return;
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+
+    if(bind(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || !setNonBlocking(s))
+    {
+        BELL_LOG_ARGS("Failed to bind udp port %u", port);
+        closeSocket(s);
+        return;
+    }
+
+    mSocket = static_cast<intptr_t>(s);
+}
+
+
+UdpTransport::~UdpTransport()
+{
+    if(isOpen())
+        closeSocket(static_cast<SocketHandle>(mSocket));
+
+#if defined(_WIN32)
+    WSACleanup();
+#endif
+}
+
+
+ConnectionID UdpTransport::connect(const std::string& host, const uint16_t port)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    addrinfo* result = nullptr;
+    if(getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || !result)
+    {
+        BELL_LOG_ARGS("Failed to resolve %s", host.c_str());
+        return kInvalidConnection;
+    }
+
+    const sockaddr_in* resolved = reinterpret_cast<const sockaddr_in*>(result->ai_addr);
+    const Address address{resolved->sin_addr.s_addr, htons(port)};
+    freeaddrinfo(result);
+
+    return findOrAddPeer(address, true);
+}
+
+
+void UdpTransport::send(const ConnectionID to, const uint8_t* data, const size_t size)
+{
+    if(!isOpen())
+        return;
+
+    if(size > kMaxDatagramSize)
+    {
+        BELL_LOG_ARGS("Dropped %zu byte packet, too big for a datagram", size);
+        return;
+    }
+
+    Address peer;
+    {
+        std::unique_lock lock(mPeerMutex);
+        auto it = mPeers.find(to);
+        // Forgotten to make room, same as the packet getting lost.
+        if(it == mPeers.end())
+            return;
+
+        peer = it->second.mAddress;
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = peer.mHost;
+    address.sin_port = peer.mPort;
+
+    // Unreliable anyway, a full send buffer is just another lost packet.
+    sendto(static_cast<SocketHandle>(mSocket), reinterpret_cast<const char*>(data), static_cast<int>(size), 0,
+           reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+}
+
+
+bool UdpTransport::receive(ConnectionID& from, std::vector<uint8_t>& data)
+{
+    if(!isOpen())
+        return false;
+
+    sockaddr_in address{};
+    socklen_t addressSize = sizeof(address);
+    const auto received = recvfrom(static_cast<SocketHandle>(mSocket), reinterpret_cast<char*>(mReceiveBuffer.data()), static_cast<int>(mReceiveBuffer.size()), 0,
+                                   reinterpret_cast<sockaddr*>(&address), &addressSize);
+
+    // Nothing waiting, or an error we can't do anything about.
+    if(received < 0)
+        return false;
+
+    from = findOrAddPeer({address.sin_addr.s_addr, address.sin_port}, false);
+    data.assign(mReceiveBuffer.begin(), mReceiveBuffer.begin() + received);
+
+    return true;
+}
+
+
+ConnectionID UdpTransport::findOrAddPeer(const Address& address, const bool pinned)
+{
+    std::unique_lock lock(mPeerMutex);
+
+    const uint64_t key = getAddressKey(address);
+    if(auto it = mPeerIDs.find(key); it != mPeerIDs.end())
+    {
+        Peer& peer = mPeers.at(it->second);
+        if(!peer.mPinned)
+            mRecent.splice(mRecent.begin(), mRecent, peer.mRecent);
+        return it->second;
+    }
+
+    if(mPeers.size() >= kMaxPeers && !mRecent.empty())
+    {
+        auto oldest = mPeers.find(mRecent.back());
+        mPeerIDs.erase(getAddressKey(oldest->second.mAddress));
+        mPeers.erase(oldest);
+        mRecent.pop_back();
+    }
+
+    const ConnectionID id = mNextPeer++;
+    if(mNextPeer == kInvalidConnection)
+        mNextPeer = 0;
+
+    Peer& peer = mPeers[id];
+    peer.mAddress = address;
+    peer.mPinned = pinned;
+    if(!pinned)
+    {
+        mRecent.push_front(id);
+        peer.mRecent = mRecent.begin();
+    }
+    mPeerIDs.emplace(key, id);
+
+    return id;
+}
+
+}
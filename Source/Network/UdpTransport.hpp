@@ -0,0 +1,81 @@
+#ifndef TEMPEST_UDP_TRANSPORT_HPP
+#define TEMPEST_UDP_TRANSPORT_HPP
+
+#include "Transport.hpp"
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Tempest
+{
+
+// Non blocking IPv4 UDP socket. Anyone who sends us a packet becomes a
+// connection, so a server only has to bind and wait. Past kMaxPeers the peer
+// heard from longest ago is forgotten, sends to it get dropped and if it
+// comes back it gets a new id. Peers from connect are kept.
+class UdpTransport : public Transport
+{
+public:
+    static constexpr uint32_t kMaxPeers = 1024;
+
+    // Port 0 binds to any free port, fine for clients.
+    UdpTransport(const uint16_t port = 0);
+    ~UdpTransport();
+
+    UdpTransport(const UdpTransport&) = delete;
+    UdpTransport& operator=(const UdpTransport&) = delete;
+
+    bool isOpen() const
+    {
+        return mSocket != kInvalidSocket;
+    }
+
+    // kInvalidConnection if the host doesn't resolve.
+    ConnectionID connect(const std::string& host, const uint16_t port);
+
+    void send(const ConnectionID, const uint8_t* data, const size_t size) override;
+    bool receive(ConnectionID& from, std::vector<uint8_t>& data) override;
+
+private:
+
+    // Both in network byte order.
+    struct Address
+    {
+        uint32_t mHost;
+        uint16_t mPort;
+    };
+
+    struct Peer
+    {
+        Address mAddress;
+        bool mPinned;
+        // Into mRecent, unpinned peers only.
+        std::list<ConnectionID>::iterator mRecent;
+    };
+
+    static uint64_t getAddressKey(const Address& address)
+    {
+        return (static_cast<uint64_t>(address.mHost) << 16) | address.mPort;
+    }
+
+    ConnectionID findOrAddPeer(const Address&, const bool pinned);
+
+    static constexpr intptr_t kInvalidSocket = -1;
+    intptr_t mSocket;
+
+    std::mutex mPeerMutex;
+    std::unordered_map<ConnectionID, Peer> mPeers;
+    std::unordered_map<uint64_t, ConnectionID> mPeerIDs;
+    // Most recently heard from first.
+    std::list<ConnectionID> mRecent;
+    // Ids aren't reused so an evicted peers id can't reach someone else.
+    ConnectionID mNextPeer;
+
+    std::vector<uint8_t> mReceiveBuffer;
+};
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+#include "BulletTaskScheduler.hpp"
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <mutex>
+
+namespace Tempest
+{
+
+BulletTaskScheduler::BulletTaskScheduler(JobSystem* jobs) :
+    btITaskScheduler("Tempest"),
+    mJobSystem(jobs),
+    mThreadCount(static_cast<int>(jobs->getThreadCount()))
+{
+}
+
+
+int BulletTaskScheduler::getMaxNumThreads() const
+{
+    return static_cast<int>(mJobSystem->getThreadCount());
+}
+
+
+int BulletTaskScheduler::getNumThreads() const
+{
+    return mThreadCount;
+}
+
+
+void BulletTaskScheduler::setNumThreads(int numThreads)
+{
+    mThreadCount = std::clamp(numThreads, 1, getMaxNumThreads());
+}
+
+
+void BulletTaskScheduler::parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+{
+    if(iEnd <= iBegin)
+        return;
+
+    const uint32_t count = static_cast<uint32_t>(iEnd - iBegin);
+    const uint32_t grain = std::max(static_cast<uint32_t>(grainSize), count / static_cast<uint32_t>(mThreadCount * 4));
+    mJobSystem->parallelForRange(count, grain, [&](const uint32_t begin, const uint32_t end)
+    {
+        body.forLoop(iBegin + static_cast<int>(begin), iBegin + static_cast<int>(end));
+    });
+}
+
+
+btScalar BulletTaskScheduler::parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body)
+{
+    if(iEnd <= iBegin)
+        return btScalar(0);
+
+    // Batches are coarse enough that a lock per batch doesn't matter.
+    std::mutex sumMutex;
+    btScalar sum = btScalar(0);
+
+    const uint32_t count = static_cast<uint32_t>(iEnd - iBegin);
+    const uint32_t grain = std::max(static_cast<uint32_t>(grainSize), count / static_cast<uint32_t>(mThreadCount * 4));
+    mJobSystem->parallelForRange(count, grain, [&](const uint32_t begin, const uint32_t end)
+    {
+        const btScalar partial = body.sumLoop(iBegin + static_cast<int>(begin), iBegin + static_cast<int>(end));
+
+        std::unique_lock lock(sumMutex);
+        sum += partial;
+    });
+
+    return sum;
+}
+
+}
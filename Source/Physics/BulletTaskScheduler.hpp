@@ -0,0 +1,32 @@
+#ifndef PHYSICS_BULLET_TASK_SCHEDULER_HPP
+#define PHYSICS_BULLET_TASK_SCHEDULER_HPP
+
+#include <LinearMath/btThreads.h>
+
+namespace Tempest
+{
+    class JobSystem;
+
+    // Hands bullets internal parallel loops to the engines job system. Bullet
+    // only calls in to this when it's built with BT_THREADSAFE, otherwise its
+    // loops stay serial and installing this is harmless.
+    class BulletTaskScheduler : public btITaskScheduler
+    {
+    public:
+        BulletTaskScheduler(JobSystem* jobs);
+
+        virtual int getMaxNumThreads() const override;
+        virtual int getNumThreads() const override;
+        virtual void setNumThreads(int numThreads) override;
+
+        virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) override;
+        virtual btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) override;
+
+    private:
+        JobSystem* mJobSystem;
+        // Bullet can ask for fewer threads than we have, batches are sized for this.
+        int mThreadCount;
+    };
+}
+
+#endif
@@ -0,0 +1,94 @@
+#include "PhysicsThread.hpp"
+#include "PhysicsWorld.hpp"
+#include "FrameProfiler.hpp"
+
+#include "Core/Profiling.hpp"
+
+namespace Tempest
+{
+
+PhysicsThread::PhysicsThread(PhysicsWorld* world) :
+    mWorld(world),
+    mDelta(0),
+    mStepTime(0),
+    mLastStepTime(0),
+    mStepPending(false),
+    mShouldExit(false)
+{
+    mWorld->setDeferred(true);
+    mThread = std::thread(&PhysicsThread::run, this);
+}
+
+
+PhysicsThread::~PhysicsThread()
+{
+    {
+        std::unique_lock lock(mMutex);
+        mStepFinished.wait(lock, [this]{ return !mStepPending; });
+        mShouldExit = true;
+    }
+    mStepStarted.notify_one();
+    mThread.join();
+
+    // Hand anything recorded since the last step to the next tick.
+    mWorld->swapBuffers();
+    mWorld->setDeferred(false);
+}
+
+
+void PhysicsThread::sync(const std::chrono::microseconds delta)
+{
+    std::unique_lock lock(mMutex);
+    {
+        TEMPEST_PROFILE_SCOPE("Wait for physics")
+        mStepFinished.wait(lock, [this]{ return !mStepPending; });
+    }
+
+    mWorld->swapBuffers();
+    mLastStepTime = mStepTime;
+
+    mDelta = delta;
+    mStepPending = true;
+    lock.unlock();
+    mStepStarted.notify_one();
+}
+
+
+void PhysicsThread::wait()
+{
+    std::unique_lock lock(mMutex);
+    mStepFinished.wait(lock, [this]{ return !mStepPending; });
+}
+
+
+void PhysicsThread::run()
+{
+    PROFILER_THREAD("Physics Thread")
+    TEMPEST_PROFILE_THREAD("Physics Thread")
+
+    while(true)
+    {
+        std::chrono::microseconds delta;
+        {
+            std::unique_lock lock(mMutex);
+            mStepStarted.wait(lock, [this]{ return mShouldExit || mStepPending; });
+            if(mShouldExit)
+                return;
+
+            delta = mDelta;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        mWorld->tick(delta);
+        const auto stepTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        {
+            std::unique_lock lock(mMutex);
+            mStepTime = stepTime;
+            mStepPending = false;
+        }
+        mStepFinished.notify_all();
+    }
+}
+
+}
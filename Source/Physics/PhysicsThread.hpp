@@ -0,0 +1,58 @@
+#ifndef TEMPEST_PHYSICS_THREAD_HPP
+#define TEMPEST_PHYSICS_THREAD_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace Tempest
+{
+    class PhysicsWorld;
+
+// Steps the world on its own thread one frame behind the game thread. While
+// this exists the world is deferred, so the game thread reads the last
+// published poses and its body changes get applied at the start of the next
+// step.
+class PhysicsThread
+{
+public:
+    PhysicsThread(PhysicsWorld*);
+    ~PhysicsThread();
+
+    PhysicsThread(const PhysicsThread&) = delete;
+    PhysicsThread& operator=(const PhysicsThread&) = delete;
+
+    // Blocks until the last step is done and publishes it, then starts the
+    // next one. Call once per frame from the game thread.
+    void sync(const std::chrono::microseconds delta);
+
+    // Blocks until the last step is done, e.g. before adding bodies.
+    void wait();
+
+    // How long the step published by the last sync took.
+    std::chrono::microseconds getLastStepTime() const
+    {
+        return mLastStepTime;
+    }
+
+private:
+
+    void run();
+
+    PhysicsWorld* mWorld;
+    std::thread mThread;
+
+    std::mutex mMutex;
+    std::condition_variable mStepStarted;
+    std::condition_variable mStepFinished;
+    std::chrono::microseconds mDelta;
+    std::chrono::microseconds mStepTime;
+    std::chrono::microseconds mLastStepTime;
+    bool mStepPending;
+    bool mShouldExit;
+};
+
+}
+
+#endif
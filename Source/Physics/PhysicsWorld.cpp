@@ -9,12 +9,18 @@
 #include "glm/gtc/type_ptr.hpp"
 
 #include "Core/Profiling.hpp"
+#include "FrameProfiler.hpp"
+
+#include <algorithm>
 
 namespace Tempest
 {
 
 PhysicsWorld::PhysicsWorld(RenderEngine* debugDraw) :
-    mDebugRenderer(debugDraw)
+    mDebugRenderer(debugDraw),
+    mDeferred(false),
+    mRecordingCommands(0),
+    mFrontPoses(0)
 {
     mCollisionConfig = std::make_unique<btDefaultCollisionConfiguration>();
 
@@ -30,6 +36,8 @@ PhysicsWorld::PhysicsWorld(RenderEngine* debugDraw) :
     mWorld->setWorldUserInfo(this);
     if(debugDraw)
         mWorld->setDebugDrawer(&mDebugRenderer);
+
+    installBulletProfilerHooks();
 }
 
 
@@ -45,30 +53,97 @@ PhysicsWorld::~PhysicsWorld()
 void PhysicsWorld::tick(const std::chrono::microseconds diff)
 {
     PROFILER_EVENT();
+    TEMPEST_PROFILE_SCOPE("Physics step")
+
+    {
+        TEMPEST_PROFILE_SCOPE("Physics commands")
+        std::vector<PhysicsCommand>& commands = mCommands[mRecordingCommands ^ 1];
+        for(const PhysicsCommand& command : commands)
+            executeCommand(command);
+        commands.clear();
+    }
 
     mWorld->stepSimulation(float(diff.count()) / 1000000.0f, 10);
+
+    writePoses();
+
+    // Nobody else is looking at the poses, publish them straight away.
+    if(!mDeferred)
+        mFrontPoses ^= 1;
 }
 
-void PhysicsWorld::updateDynamicObjects(Scene* scene)
+
+void PhysicsWorld::swapBuffers()
 {
-    const btAlignedObjectArray<btRigidBody*>& rigidBodies = mWorld->getNonStaticRigidBodies();
+    mRecordingCommands ^= 1;
+    mFrontPoses ^= 1;
 
-    for(uint32_t i = 0; i < rigidBodies.size(); ++i)
+    // The new poses were stepped before these removals got applied.
+    std::vector<BodyPose>& poses = mPoses[mFrontPoses];
+    for(const PhysicsCommand& command : mCommands[mRecordingCommands ^ 1])
     {
-        const btRigidBody* rigidBody = rigidBodies[i];
-        const InstanceID id = rigidBody->getUserIndex();
-        MeshInstance* instance = scene->getMeshInstance(id);
+        if(command.mType == PhysicsCommandType::Remove && command.mBodyIndex < poses.size())
+            poses[command.mBodyIndex].mInstance = kInvalidInstanceID;
+    }
+}
+
+
+void PhysicsWorld::writePoses()
+{
+    TEMPEST_PROFILE_SCOPE("Physics snapshot")
+
+    std::vector<BodyPose>& poses = mPoses[mFrontPoses ^ 1];
+    std::vector<uint32_t>& moved = mMovedBodies[mFrontPoses ^ 1];
+    poses.resize(mRigidBodies.size());
+    moved.clear();
+
+    for(uint32_t i = 0; i < mRigidBodies.size(); ++i)
+    {
+        if(const btRigidBody* body = mRigidBodies[i].get(); body)
+        {
+            writePose(body, poses[i]);
+            if(poses[i].mDynamic && poses[i].mActive)
+                moved.push_back(i);
+        }
+        else
+        {
+            poses[i].mInstance = kInvalidInstanceID;
+        }
+    }
+}
+
+
+void PhysicsWorld::writePose(const btRigidBody* body, BodyPose& pose)
+{
+    const btTransform& transform = body->getWorldTransform();
+    const btVector3& position = transform.getOrigin();
+    const btQuaternion rotation = transform.getRotation();
+    const btVector3& center = body->getCenterOfMassPosition();
+
+    pose.mInstance = body->getUserIndex();
+    pose.mPosition = {position.x(), position.y(), position.z()};
+    pose.mRotation = {rotation.w(), rotation.x(), rotation.y(), rotation.z()};
+    pose.mCenterOfMass = {center.x(), center.y(), center.z()};
+    pose.mDynamic = !body->isStaticObject();
+    pose.mActive = body->isActive();
+}
 
-        const btTransform& transform = rigidBody->getWorldTransform();
-        const btVector3& position = transform.getOrigin();
-        const btQuaternion& rotation = transform.getRotation();
+void PhysicsWorld::updateDynamicObjects(Scene* scene)
+{
+    TEMPEST_PROFILE_SCOPE("Physics sync")
 
-        instance->setPosition({position.x(), position.y(), position.z()});
-        instance->setRotation({rotation.w(), rotation.x(), rotation.y(), rotation.z()});
+    for(const BodyPose& pose : mPoses[mFrontPoses])
+    {
+        if(!pose.mDynamic || pose.mInstance == kInvalidInstanceID)
+            continue;
+
+        MeshInstance* instance = scene->getMeshInstance(pose.mInstance);
+        instance->setPosition(pose.mPosition);
+        instance->setRotation(pose.mRotation);
     }
 }
 
-void PhysicsWorld::addObject(const InstanceID id,
+uint32_t PhysicsWorld::addObject(const InstanceID id,
                              const PhysicsEntityType type,
                              const BasicCollisionGeometry collisionGeometry,
                              const float3& pos,
@@ -101,24 +176,10 @@ void PhysicsWorld::addObject(const InstanceID id,
     if(collisionGeometry == BasicCollisionGeometry::Capsule)
         body->setAngularFactor({0.0f, 1.0f, 0.0f});
 
-    if(mFreeRigidBodyIndices.empty())
-    {
-        const uint32_t index = mRigidBodies.size();
-        mRigidBodies.emplace_back(body);
-        mInstanceMap[id] = index;
-    }
-    else
-    {
-        const uint32_t index = mFreeRigidBodyIndices.back();
-        mFreeRigidBodyIndices.pop_back();
-
-        mRigidBodies[index] = std::unique_ptr<btRigidBody>(body);
-    }
-
-    mWorld->addRigidBody(body);
+    return insertRigidBody(id, body);
 }
 
-void PhysicsWorld::addObject(const InstanceID id,
+uint32_t PhysicsWorld::addObject(const InstanceID id,
                              const PhysicsEntityType type,
                              const StaticMesh* collisionGeometry,
                              const float3& pos,
@@ -177,31 +238,124 @@ void PhysicsWorld::addObject(const InstanceID id,
     body = new btRigidBody(rbInfo);
     body->setUserIndex(id);
 
-    if (mFreeRigidBodyIndices.empty())
+    return insertRigidBody(id, body);
+}
+
+uint32_t PhysicsWorld::insertRigidBody(const InstanceID id, btRigidBody* body)
+{
+    uint32_t index;
+    if(mFreeRigidBodyIndices.empty())
     {
-        const uint32_t index = mRigidBodies.size();
+        index = mRigidBodies.size();
         mRigidBodies.emplace_back(body);
-        mInstanceMap[id] = index;
-    } else
+    }
+    else
     {
-        const uint32_t index = mFreeRigidBodyIndices.back();
+        index = mFreeRigidBodyIndices.back();
         mFreeRigidBodyIndices.pop_back();
 
         mRigidBodies[index] = std::unique_ptr<btRigidBody>(body);
     }
 
+    mInstanceMap[id] = index;
     mWorld->addRigidBody(body);
+
+    // So it can be read before it's been stepped.
+    for(std::vector<BodyPose>& poses : mPoses)
+    {
+        if(index >= poses.size())
+            poses.resize(index + 1, {kInvalidInstanceID});
+        writePose(body, poses[index]);
+    }
+
+    return index;
 }
 
 void PhysicsWorld::removeObject(const InstanceID id)
 {
-    const uint32_t index = mInstanceMap[id];
-    btRigidBody* body = mRigidBodies[index].get();
-    mInstanceMap.erase(id);
-    mWorld->removeRigidBody(body);
-    delete body;
-    mRigidBodies[index] = nullptr;
-    mFreeRigidBodyIndices.push_back(index);
+    BELL_ASSERT(!mDeferred, "Instance lookup races with the physics thread")
+    if(auto it = mInstanceMap.find(id); it != mInstanceMap.end())
+        removeBody(it->second);
+}
+
+void PhysicsWorld::removeBody(const uint32_t index)
+{
+    submitCommand({PhysicsCommandType::Remove, index, {}, {}});
+}
+
+void PhysicsWorld::saveState(SavedState& state) const
+{
+    std::vector<BodyState>& bodies = state.mBodies;
+    bodies.resize(mRigidBodies.size());
+    for(uint32_t i = 0; i < mRigidBodies.size(); ++i)
+    {
+        const btRigidBody* body = mRigidBodies[i].get();
+        if(!body)
+        {
+            bodies[i].mInstance = kInvalidInstanceID;
+            continue;
+        }
+
+        BodyState& bodyState = bodies[i];
+        bodyState.mInstance = body->getUserIndex();
+        bodyState.mTransform = body->getWorldTransform();
+        bodyState.mLinearVelocity = body->getLinearVelocity();
+        bodyState.mAngularVelocity = body->getAngularVelocity();
+        bodyState.mActivationState = body->getActivationState();
+    }
+
+    state.mCommands = mCommands[mRecordingCommands];
+}
+
+void PhysicsWorld::restoreState(const SavedState& state)
+{
+    // Whether the body at this index is still the one that was saved.
+    auto sameBody = [&](const uint32_t index)
+    {
+        return index < state.mBodies.size() && index < mRigidBodies.size() && mRigidBodies[index] &&
+               state.mBodies[index].mInstance != kInvalidInstanceID &&
+               mRigidBodies[index]->getUserIndex() == state.mBodies[index].mInstance;
+    };
+
+    for(uint32_t i = 0; i < state.mBodies.size(); ++i)
+    {
+        if(!sameBody(i))
+            continue;
+
+        const BodyState& bodyState = state.mBodies[i];
+        btRigidBody* body = mRigidBodies[i].get();
+
+        body->setWorldTransform(bodyState.mTransform);
+        body->setInterpolationWorldTransform(bodyState.mTransform);
+        if(btMotionState* motionState = body->getMotionState(); motionState)
+            motionState->setWorldTransform(bodyState.mTransform);
+
+        body->setLinearVelocity(bodyState.mLinearVelocity);
+        body->setAngularVelocity(bodyState.mAngularVelocity);
+        body->setInterpolationLinearVelocity(bodyState.mLinearVelocity);
+        body->setInterpolationAngularVelocity(bodyState.mAngularVelocity);
+        body->clearForces();
+        body->forceActivationState(bodyState.mActivationState);
+        body->setDeactivationTime(0.0f);
+    }
+
+    // Whatever was recorded since is stale apart from removals, the index
+    // may have been reused since so saved commands only go back on the same body.
+    std::vector<PhysicsCommand>& commands = mCommands[mRecordingCommands];
+    commands.erase(std::remove_if(commands.begin(), commands.end(), [](const PhysicsCommand& command)
+    {
+        return command.mType != PhysicsCommandType::Remove;
+    }), commands.end());
+
+    for(const PhysicsCommand& command : state.mCommands)
+    {
+        if(command.mType != PhysicsCommandType::Remove && sameBody(command.mBodyIndex))
+            commands.push_back(command);
+    }
+
+    writePoses();
+    mPoses[mFrontPoses] = mPoses[mFrontPoses ^ 1];
+    mMovedBodies[mFrontPoses] = mMovedBodies[mFrontPoses ^ 1];
 }
 
 btCollisionShape* PhysicsWorld::getCollisionShape(const BasicCollisionGeometry type, const PhysicsEntityType entitytype, const float3& scale, const float mass, btVector3& outInertia)
@@ -290,60 +444,157 @@ btCollisionShape* PhysicsWorld::getCollisionShape(const BasicCollisionGeometry t
 
     void PhysicsWorld::setInstancePosition(const InstanceID id, const float3& v)
     {
-        btRigidBody* body = getRigidBody(id);
-        if(body)
-        {
-            btMotionState* state = body->getMotionState();
-            btTransform &transform = body->getWorldTransform();
-            transform.setOrigin({v.x, v.y, v.z});
-            state->setWorldTransform(transform);
-
-            if (!body->isActive())
-                body->activate(true);
-        }
+        if(btRigidBody* body = getRigidBody(id); body)
+            applyPosition(body, v);
     }
 
 
     void PhysicsWorld::translateInstance(const InstanceID id, const float3& v)
     {
-        btRigidBody* body = getRigidBody(id);
-        if(body) {
-            btMotionState* state = body->getMotionState();
-            btTransform &transform = body->getWorldTransform();
-            btVector3& origin = transform.getOrigin();
-            transform.setOrigin({origin.x() + v.x, origin.y() + v.y, origin.z() + v.z});
-            state->setWorldTransform(transform);
-
-            if (!body->isActive())
-                body->activate(true);
-        }
+        if(btRigidBody* body = getRigidBody(id); body)
+            applyTranslation(body, v);
     }
 
     void PhysicsWorld::setInstanceLinearVelocity(const InstanceID id, const float3& v)
     {
-        btRigidBody* body = getRigidBody(id);
-        if(body) {
-            body->setLinearVelocity({v.x, v.y, v.z});
+        if(btRigidBody* body = getRigidBody(id); body)
+            applyLinearVelocity(body, v);
+    }
+
+    void PhysicsWorld::setInstanceRotation(const InstanceID id, const quat& rot)
+    {
+        if(btRigidBody* body = getRigidBody(id); body)
+            applyRotation(body, rot);
+    }
+
+
+    void PhysicsWorld::setBodyPosition(const uint32_t bodyIndex, const float3& v)
+    {
+        submitCommand({PhysicsCommandType::SetPosition, bodyIndex, v, {}});
+    }
+
+    void PhysicsWorld::translateBody(const uint32_t bodyIndex, const float3& v)
+    {
+        submitCommand({PhysicsCommandType::Translate, bodyIndex, v, {}});
+    }
+
+    void PhysicsWorld::setBodyLinearVelocity(const uint32_t bodyIndex, const float3& v)
+    {
+        submitCommand({PhysicsCommandType::SetLinearVelocity, bodyIndex, v, {}});
+    }
+
+    void PhysicsWorld::setBodyRotation(const uint32_t bodyIndex, const quat& rot)
+    {
+        submitCommand({PhysicsCommandType::SetRotation, bodyIndex, {}, rot});
+    }
 
-            if (!body->isActive())
-                body->activate(true);
+    void PhysicsWorld::applyBodyImpulse(const uint32_t bodyIndex, const float3& impulse)
+    {
+        submitCommand({PhysicsCommandType::ApplyImpulse, bodyIndex, impulse, {}});
+    }
+
+
+    void PhysicsWorld::submitCommand(const PhysicsCommand& command)
+    {
+        if(!mDeferred)
+        {
+            executeCommand(command);
+            return;
         }
+
+        mCommands[mRecordingCommands].push_back(command);
+
+        // Stop syncing it straight away rather than after the next step.
+        if(command.mType == PhysicsCommandType::Remove && command.mBodyIndex < mPoses[mFrontPoses].size())
+            mPoses[mFrontPoses][command.mBodyIndex].mInstance = kInvalidInstanceID;
     }
 
-    void PhysicsWorld::setInstanceRotation(const InstanceID id, const quat& rot)
+    void PhysicsWorld::executeCommand(const PhysicsCommand& command)
     {
-        btRigidBody* body = getRigidBody(id);
-        if(body) {
-            btMotionState* state = body->getMotionState();
-            btTransform &transform = body->getWorldTransform();
-            btVector3& origin = transform.getOrigin();
-            transform.setRotation({rot.x, rot.y, rot.z, rot.w});
-            state->setWorldTransform(transform);
+        // Scripts can still poke a body later in the frame they removed it.
+        btRigidBody* body = getRigidBodyByIndex(command.mBodyIndex);
+        if(!body)
+            return;
+
+        switch(command.mType)
+        {
+            case PhysicsCommandType::SetPosition:
+                applyPosition(body, command.mVector);
+                break;
+
+            case PhysicsCommandType::Translate:
+                applyTranslation(body, command.mVector);
+                break;
+
+            case PhysicsCommandType::SetLinearVelocity:
+                applyLinearVelocity(body, command.mVector);
+                break;
+
+            case PhysicsCommandType::SetRotation:
+                applyRotation(body, command.mRotation);
+                break;
 
-            if (!body->isActive())
-                body->activate(true);
+            case PhysicsCommandType::ApplyImpulse:
+            {
+                if (!body->isActive())
+                    body->activate(true);
+                body->applyCentralImpulse({command.mVector.x, command.mVector.y, command.mVector.z});
+                break;
+            }
+
+            case PhysicsCommandType::Remove:
+            {
+                mInstanceMap.erase(body->getUserIndex());
+                mWorld->removeRigidBody(body);
+                mRigidBodies[command.mBodyIndex] = nullptr;
+                mFreeRigidBodyIndices.push_back(command.mBodyIndex);
+                break;
+            }
         }
     }
 
 
+    void PhysicsWorld::applyPosition(btRigidBody* body, const float3& v)
+    {
+        btMotionState* state = body->getMotionState();
+        btTransform &transform = body->getWorldTransform();
+        transform.setOrigin({v.x, v.y, v.z});
+        state->setWorldTransform(transform);
+
+        if (!body->isActive())
+            body->activate(true);
+    }
+
+    void PhysicsWorld::applyTranslation(btRigidBody* body, const float3& v)
+    {
+        btMotionState* state = body->getMotionState();
+        btTransform &transform = body->getWorldTransform();
+        btVector3& origin = transform.getOrigin();
+        transform.setOrigin({origin.x() + v.x, origin.y() + v.y, origin.z() + v.z});
+        state->setWorldTransform(transform);
+
+        if (!body->isActive())
+            body->activate(true);
+    }
+
+    void PhysicsWorld::applyLinearVelocity(btRigidBody* body, const float3& v)
+    {
+        body->setLinearVelocity({v.x, v.y, v.z});
+
+        if (!body->isActive())
+            body->activate(true);
+    }
+
+    void PhysicsWorld::applyRotation(btRigidBody* body, const quat& rot)
+    {
+        btMotionState* state = body->getMotionState();
+        btTransform &transform = body->getWorldTransform();
+        transform.setRotation({rot.x, rot.y, rot.z, rot.w});
+        state->setWorldTransform(transform);
+
+        if (!body->isActive())
+            body->activate(true);
+    }
+
+
 }
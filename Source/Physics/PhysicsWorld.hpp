@@ -8,6 +8,7 @@
 
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 namespace Tempest
 {
@@ -28,23 +29,109 @@ enum class BasicCollisionGeometry
     Mesh
 };
 
+enum class PhysicsCommandType : uint8_t
+{
+    SetPosition,
+    Translate,
+    SetLinearVelocity,
+    SetRotation,
+    ApplyImpulse,
+    Remove
+};
+
+// A change to a body made while the world is stepping on another thread.
+struct PhysicsCommand
+{
+    PhysicsCommandType mType;
+    uint32_t mBodyIndex;
+    float3 mVector;
+    quat mRotation;
+};
+
+// Where a body ended up after a step, indexed by body index.
+struct BodyPose
+{
+    InstanceID mInstance;
+    float3 mPosition;
+    quat mRotation;
+    float3 mCenterOfMass;
+    bool mDynamic;
+    // Moved this step, sleeping bodies keep their last pose.
+    bool mActive;
+};
+
+// Everything needed to put a body back where it was, see saveBodyStates.
+struct BodyState
+{
+    InstanceID mInstance;
+    btTransform mTransform;
+    btVector3 mLinearVelocity;
+    btVector3 mAngularVelocity;
+    int mActivationState;
+};
+
 class PhysicsWorld
 {
 public:
     PhysicsWorld(RenderEngine* debugDraw);
     ~PhysicsWorld();
 
+    // Applies queued commands, steps and writes the next pose snapshot.
     void tick(const std::chrono::microseconds diff);
+    // Copies the published snapshot in to the scene.
     void updateDynamicObjects(Scene*);
 
-    void addObject(const InstanceID id,
+    // While deferred, body changes from the setters below are recorded and
+    // only applied at the start of the next tick, and poses only change on
+    // swapBuffers. Lets tick run on another thread while the game thread
+    // carries on with last steps poses. Only change this while not ticking.
+    void setDeferred(const bool deferred)
+    {
+        mDeferred = deferred;
+    }
+
+    bool isDeferred() const
+    {
+        return mDeferred;
+    }
+
+    // Hands the recorded commands to the next tick and publishes the poses
+    // from the last one. Only call while not ticking.
+    void swapBuffers();
+
+    // nullptr once the body has been removed.
+    const BodyPose* getBodyPose(const uint32_t bodyIndex) const
+    {
+        const std::vector<BodyPose>& poses = mPoses[mFrontPoses];
+        if(bodyIndex < poses.size() && poses[bodyIndex].mInstance != kInvalidInstanceID)
+            return &poses[bodyIndex];
+
+        return nullptr;
+    }
+
+    // Published poses by body index, removed bodies have kInvalidInstanceID.
+    const std::vector<BodyPose>& getBodyPoses() const
+    {
+        return mPoses[mFrontPoses];
+    }
+
+    // Indices of the dynamic bodies that were awake for the published poses,
+    // may include bodies removed since.
+    const std::vector<uint32_t>& getMovedBodies() const
+    {
+        return mMovedBodies[mFrontPoses];
+    }
+
+    // Both return the body index, stable until the object is removed. Only
+    // call while not ticking.
+    uint32_t addObject(const InstanceID id,
                    const PhysicsEntityType type,
                    const StaticMesh* collisionGeometry,
                    const float3& pos,
                    const quat& rot,
                    const float3& scale);
 
-    void addObject(const InstanceID id,
+    uint32_t addObject(const InstanceID id,
                    const PhysicsEntityType type,
                    const BasicCollisionGeometry collisionGeometry,
                    const float3& pos,
@@ -53,7 +140,23 @@ public:
                    const float mass = 0.0f,
                    const float restitution = 0.0f);
 
+    // Not safe while deferred, use removeBody.
     void removeObject(const InstanceID id);
+    void removeBody(const uint32_t bodyIndex);
+
+    struct SavedState
+    {
+        // Indexed by body index.
+        std::vector<BodyState> mBodies;
+        // Changes waiting for the next tick.
+        std::vector<PhysicsCommand> mCommands;
+    };
+
+    // Restoring only touches bodies that still belong to the same instance,
+    // removals recorded since the save are kept. Poses get republished so
+    // both sides see the restored state. Only call while not ticking.
+    void saveState(SavedState&) const;
+    void restoreState(const SavedState&);
 
     btRigidBody* getRigidBody(const InstanceID id)
     {
@@ -66,6 +169,12 @@ public:
             return nullptr;
     }
 
+    btRigidBody* getRigidBodyByIndex(const uint32_t index)
+    {
+        BELL_ASSERT(index < mRigidBodies.size(), "Invalid rigid body index")
+        return mRigidBodies[index].get();
+    }
+
     const btAlignedObjectArray<btRigidBody*>& getDynamicObjects() const
     {
         return mWorld->getNonStaticRigidBodies();
@@ -96,8 +205,27 @@ public:
     void setInstanceLinearVelocity(const InstanceID, const float3&);
     void setInstanceRotation(const InstanceID, const quat&);
 
+    // Same as above without the instance lookup.
+    void setBodyPosition(const uint32_t bodyIndex, const float3&);
+    void translateBody(const uint32_t bodyIndex, const float3&);
+    void setBodyLinearVelocity(const uint32_t bodyIndex, const float3&);
+    void setBodyRotation(const uint32_t bodyIndex, const quat&);
+    void applyBodyImpulse(const uint32_t bodyIndex, const float3&);
+
 private:
 
+    uint32_t insertRigidBody(const InstanceID, btRigidBody*);
+
+    void submitCommand(const PhysicsCommand&);
+    void executeCommand(const PhysicsCommand&);
+    void writePoses();
+    static void writePose(const btRigidBody*, BodyPose&);
+
+    static void applyPosition(btRigidBody*, const float3&);
+    static void applyTranslation(btRigidBody*, const float3&);
+    static void applyLinearVelocity(btRigidBody*, const float3&);
+    static void applyRotation(btRigidBody*, const quat&);
+
     btCollisionShape* getCollisionShape(const BasicCollisionGeometry type,
                                         const PhysicsEntityType entitytype,
                                         const float3& scale,
@@ -119,6 +247,15 @@ private:
 
     std::unordered_map<InstanceID, uint32_t> mInstanceMap;
 
+    bool mDeferred;
+    // Double buffered, the game thread records in to one while tick applies
+    // the other, swapped in swapBuffers so neither side needs a lock.
+    std::vector<PhysicsCommand> mCommands[2];
+    uint32_t mRecordingCommands;
+    std::vector<BodyPose> mPoses[2];
+    std::vector<uint32_t> mMovedBodies[2];
+    uint32_t mFrontPoses;
+
     PhysicsWorldDebugRenderer mDebugRenderer;
 };
 
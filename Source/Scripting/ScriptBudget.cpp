@@ -0,0 +1,323 @@
+#include "ScriptBudget.hpp"
+#include "ScriptProfiler.hpp"
+#include "ScriptThrottle.hpp"
+#include "FrameProfiler.hpp"
+
+#include "Core/BellLogging.hpp"
+
+#include <algorithm>
+
+namespace Tempest
+{
+
+namespace
+{
+    // Registry key for finding the budget from inside the hook.
+    const char kBudgetKey = 0;
+}
+
+
+ScriptBudget::ScriptBudget(lua_State* L, ScriptProfiler* profiler) :
+    mState(L),
+    mProfiler(profiler),
+    mFrameBudget(0),
+    mFrameUsed(0),
+    mDirty(true),
+    mRunning(nullptr),
+    mYieldedForBudget(false)
+{
+    lua_pushlightuserdata(mState, this);
+    lua_rawsetp(mState, LUA_REGISTRYINDEX, &kBudgetKey);
+}
+
+
+ScriptBudget::~ScriptBudget()
+{
+    releaseTasks();
+}
+
+
+void ScriptBudget::setScriptBudget(const std::string& func, const uint32_t instructions, const int32_t priority)
+{
+    mSettings[func] = {instructions, priority};
+    mDirty = true;
+}
+
+
+void ScriptBudget::setFrameBudget(const uint64_t instructions)
+{
+    mFrameBudget = instructions;
+}
+
+
+void ScriptBudget::addTask(const std::string& func, const int64_t entity)
+{
+    // Nothing runs tasks while disabled, rebuild once it's turned on.
+    if(!isEnabled())
+        mDirty = true;
+
+    // The rebuild picks it up anyway.
+    if(mDirty)
+        return;
+
+    mPendingTasks.push_back({&func, entity});
+}
+
+
+void ScriptBudget::removeEntity(const int64_t entity)
+{
+    BELL_ASSERT(!mRunning, "Can't remove tasks while one is running")
+    if(mDirty)
+        return;
+
+    mPendingTasks.erase(std::remove_if(mPendingTasks.begin(), mPendingTasks.end(), [entity](const PendingTask& task) { return task.mEntity == entity; }), mPendingTasks.end());
+
+    for(PriorityGroup& group : mGroups)
+    {
+        // Suspended or not, the entity is gone so its thread goes too.
+        auto removed = std::remove_if(group.mTasks.begin(), group.mTasks.end(), [entity](const Task& task) { return task.mEntity == entity; });
+        for(auto it = removed; it != group.mTasks.end(); ++it)
+            luaL_unref(mState, LUA_REGISTRYINDEX, it->mRef);
+        group.mTasks.erase(removed, group.mTasks.end());
+
+        if(group.mNext >= group.mTasks.size())
+            group.mNext = 0;
+    }
+}
+
+
+void ScriptBudget::releaseTasks()
+{
+    for(PriorityGroup& group : mGroups)
+    {
+        for(Task& task : group.mTasks)
+            luaL_unref(mState, LUA_REGISTRYINDEX, task.mRef);
+    }
+
+    mGroups.clear();
+    mPendingTasks.clear();
+}
+
+
+void ScriptBudget::rebuild(const std::unordered_map<std::string, std::vector<int64_t>>& scripts)
+{
+    // Anything suspended mid function is dropped, only happens on the first
+    // run and when budgets change. Entities come and go through addTask.
+    releaseTasks();
+
+    for(const auto& [name, entities] : scripts)
+    {
+        for(const int64_t entity : entities)
+            createTask(name, entity);
+    }
+
+    std::sort(mGroups.begin(), mGroups.end(), [](const PriorityGroup& lhs, const PriorityGroup& rhs) { return lhs.mPriority > rhs.mPriority; });
+
+    mDirty = false;
+}
+
+
+void ScriptBudget::createTask(const std::string& func, const int64_t entity)
+{
+    // Components that only run coroutines don't get a task.
+    const bool hasTick = lua_getglobal(mState, func.c_str()) == LUA_TFUNCTION;
+    lua_pop(mState, 1);
+    if(!hasTick)
+        return;
+
+    const Settings settings = mSettings.count(func) ? mSettings[func] : Settings{};
+
+    auto groupIt = std::find_if(mGroups.begin(), mGroups.end(), [&](const PriorityGroup& g) { return g.mPriority == settings.mPriority; });
+    if(groupIt == mGroups.end())
+    {
+        mGroups.push_back({settings.mPriority, {}, 0});
+        groupIt = mGroups.end() - 1;
+    }
+
+    lua_State* thread = lua_newthread(mState);
+    const int ref = luaL_ref(mState, LUA_REGISTRYINDEX);
+    updateHook(thread);
+
+    groupIt->mTasks.push_back({func.c_str(), entity, settings.mInstructionBudget, thread, ref, false, 0, &mStats[func]});
+}
+
+
+void ScriptBudget::addPendingTasks()
+{
+    for(const PendingTask& pending : mPendingTasks)
+        createTask(*pending.mFunc, pending.mEntity);
+    mPendingTasks.clear();
+
+    // Could have started a new priority.
+    std::sort(mGroups.begin(), mGroups.end(), [](const PriorityGroup& lhs, const PriorityGroup& rhs) { return lhs.mPriority > rhs.mPriority; });
+}
+
+
+void ScriptBudget::run(const std::unordered_map<std::string, std::vector<int64_t>>& scripts, const std::chrono::microseconds delta, ScriptThrottle& throttle)
+{
+    if(mDirty)
+        rebuild(scripts);
+    else if(!mPendingTasks.empty())
+        addPendingTasks();
+
+    for(auto& [name, stats] : mStats)
+    {
+        stats.mInstructionsLastFrame = 0;
+        stats.mThrottledLastFrame = 0;
+        stats.mDeferredLastFrame = 0;
+    }
+
+    mFrameUsed = 0;
+    bool outOfBudget = false;
+    for(PriorityGroup& group : mGroups)
+    {
+        const uint32_t taskCount = static_cast<uint32_t>(group.mTasks.size());
+        for(uint32_t i = 0; i < taskCount; ++i)
+        {
+            const uint32_t index = (group.mNext + i) % taskCount;
+            Task& task = group.mTasks[index];
+
+            if(outOfBudget)
+            {
+                ++task.mStats->mDeferredLastFrame;
+                ++task.mStats->mTotalDeferred;
+                continue;
+            }
+
+            std::chrono::microseconds taskDelta = delta;
+            if(!task.mSuspended && !throttle.shouldRun(task.mEntity, taskDelta))
+                continue;
+
+            if(!runTask(task, taskDelta))
+            {
+                outOfBudget = true;
+                // Whoever didn't get a go this frame goes first next frame.
+                group.mNext = (index + 1) % taskCount;
+            }
+        }
+    }
+}
+
+
+bool ScriptBudget::runTask(Task& task, const std::chrono::microseconds delta)
+{
+    TEMPEST_PROFILE_SCOPE(task.mFunc)
+
+    int nargs = 0;
+    if(!task.mSuspended)
+    {
+        lua_getglobal(task.mThread, task.mFunc);
+        lua_pushinteger(task.mThread, task.mEntity);
+        lua_pushinteger(task.mThread, delta.count());
+        nargs = 2;
+    }
+
+    updateHook(task.mThread);
+
+    // The script can start or stop profiling itself, so decide once.
+    const bool profiling = mProfiler->isEnabled();
+    const uint64_t start = profiling ? ScriptProfiler::now() : 0;
+
+    task.mUsed = 0;
+    mRunning = &task;
+    mYieldedForBudget = false;
+
+    mProfiler->enterCall();
+    int results = 0;
+    const int status = lua_resume(task.mThread, mState, nargs, &results);
+
+    mRunning = nullptr;
+
+    if(profiling)
+        mProfiler->recordFunction(task.mFunc, ScriptProfiler::now() - start);
+    mProfiler->leaveCall();
+
+    task.mStats->mInstructionsLastFrame += task.mUsed;
+
+    if(status == LUA_YIELD)
+    {
+        lua_pop(task.mThread, results);
+        task.mSuspended = true;
+
+        if(mYieldedForBudget)
+        {
+            ++task.mStats->mThrottledLastFrame;
+            ++task.mStats->mTotalThrottled;
+        }
+    }
+    else if(status == LUA_OK)
+    {
+        lua_settop(task.mThread, 0);
+        task.mSuspended = false;
+    }
+    else
+    {
+        BELL_LOG_ARGS("error running function %s: %s\n", task.mFunc, lua_tostring(task.mThread, -1));
+        lua_resetthread(task.mThread);
+        task.mSuspended = false;
+        BELL_TRAP;
+    }
+
+    return mFrameBudget == 0 || mFrameUsed < mFrameBudget;
+}
+
+
+void ScriptBudget::updateHook(lua_State* thread) const
+{
+    int mask = LUA_MASKCOUNT;
+    int count = kSliceInstructions;
+    if(mProfiler->isEnabled())
+    {
+        mask |= mProfiler->getHookMask() & LUA_MASKCALL;
+        if(mProfiler->getInstructionInterval() > 0)
+            count = std::min(count, static_cast<int>(mProfiler->getInstructionInterval()));
+    }
+
+    if(lua_gethookmask(thread) != mask || lua_gethookcount(thread) != count)
+        lua_sethook(thread, luaHook, mask, count);
+}
+
+
+void ScriptBudget::luaHook(lua_State* L, lua_Debug* ar)
+{
+    lua_rawgetp(L, LUA_REGISTRYINDEX, &kBudgetKey);
+    ScriptBudget* budget = static_cast<ScriptBudget*>(lua_touserdata(L, -1));
+    lua_pop(L, 1);
+
+    if(!budget)
+        return;
+
+    if(ar->event == LUA_HOOKCALL)
+    {
+        if(budget->mProfiler->isEnabled())
+            ScriptProfiler::luaHook(L, ar);
+        return;
+    }
+
+    // Fires more often than a slice while profiling, count what actually ran.
+    const uint32_t instructions = static_cast<uint32_t>(lua_gethookcount(L));
+    if(budget->mProfiler->isEnabled())
+        budget->mProfiler->countInstructions(L, instructions);
+
+    Task* task = budget->mRunning;
+    if(!task)
+        return;
+
+    task->mUsed += instructions;
+    budget->mFrameUsed += instructions;
+
+    // Coroutines started from the script inherit this hook, only the task itself gets suspended.
+    if(L != task->mThread || !lua_isyieldable(L))
+        return;
+
+    const bool overTaskBudget = task->mInstructionBudget > 0 && task->mUsed >= task->mInstructionBudget;
+    const bool overFrameBudget = budget->mFrameBudget > 0 && budget->mFrameUsed >= budget->mFrameBudget;
+    if(overTaskBudget || overFrameBudget)
+    {
+        budget->mYieldedForBudget = true;
+        // Has to be the last thing the hook does.
+        lua_yield(L, 0);
+    }
+}
+
+}
@@ -0,0 +1,134 @@
+#ifndef SCRIPT_BUDGET_HPP
+#define SCRIPT_BUDGET_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lua.hpp"
+
+namespace Tempest
+{
+    class ScriptProfiler;
+    class ScriptThrottle;
+
+struct ScriptBudgetStats
+{
+    uint64_t mInstructionsLastFrame = 0;
+    // Entities that hit their own budget and were suspended until next frame.
+    uint32_t mThrottledLastFrame = 0;
+    // Entities that didn't get to run at all because the frame budget ran out.
+    uint32_t mDeferredLastFrame = 0;
+    uint64_t mTotalThrottled = 0;
+    uint64_t mTotalDeferred = 0;
+};
+
+// Runs component script functions on their own lua threads with a count hook
+// so they can be suspended mid function when over budget. A suspended entity
+// picks up where it left off next frame. Higher priority scripts run first,
+// entities within a priority are round robined so the same ones don't starve.
+class ScriptBudget
+{
+public:
+    ScriptBudget(lua_State*, ScriptProfiler*);
+    ~ScriptBudget();
+
+    // 0 instructions means unlimited.
+    void setScriptBudget(const std::string& func, const uint32_t instructions, const int32_t priority);
+    void setFrameBudget(const uint64_t instructions);
+
+    bool isEnabled() const
+    {
+        return mFrameBudget > 0 || !mSettings.empty();
+    }
+
+    // Rebuilds every task next run, dropping anything suspended.
+    void invalidate()
+    {
+        mDirty = true;
+    }
+
+    // func has to outlive the task, it's the component scripts key. Added
+    // at the start of the next run so it's safe from inside a script.
+    void addTask(const std::string& func, const int64_t entity);
+    // Not while running.
+    void removeEntity(const int64_t entity);
+
+    // Suspended entities always resume, the throttle only decides whether new calls start.
+    void run(const std::unordered_map<std::string, std::vector<int64_t>>& scripts, const std::chrono::microseconds delta, ScriptThrottle&);
+
+    const std::unordered_map<std::string, ScriptBudgetStats>& getStats() const
+    {
+        return mStats;
+    }
+
+    // Instructions between budget checks.
+    static constexpr int kSliceInstructions = 1000;
+
+private:
+
+    static void luaHook(lua_State*, lua_Debug*);
+    // Budget slices plus whatever the profiler wants, kept up to date as profiling starts and stops.
+    void updateHook(lua_State* thread) const;
+
+    struct Settings
+    {
+        uint32_t mInstructionBudget = 0;
+        int32_t mPriority = 0;
+    };
+
+    struct Task
+    {
+        const char* mFunc;
+        int64_t mEntity;
+        uint32_t mInstructionBudget;
+        lua_State* mThread;
+        int mRef;
+        bool mSuspended;
+        uint64_t mUsed;
+        ScriptBudgetStats* mStats;
+    };
+
+    struct PriorityGroup
+    {
+        int32_t mPriority;
+        std::vector<Task> mTasks;
+        // Where to start next frame.
+        uint32_t mNext;
+    };
+
+    void rebuild(const std::unordered_map<std::string, std::vector<int64_t>>& scripts);
+    void createTask(const std::string& func, const int64_t entity);
+    void addPendingTasks();
+    void releaseTasks();
+    // Returns false if the frame budget ran out.
+    bool runTask(Task&, const std::chrono::microseconds delta);
+
+    lua_State* mState;
+    ScriptProfiler* mProfiler;
+
+    std::unordered_map<std::string, Settings> mSettings;
+    uint64_t mFrameBudget;
+    uint64_t mFrameUsed;
+
+    std::vector<PriorityGroup> mGroups;
+    bool mDirty;
+
+    struct PendingTask
+    {
+        const std::string* mFunc;
+        int64_t mEntity;
+    };
+    std::vector<PendingTask> mPendingTasks;
+
+    Task* mRunning;
+    bool mYieldedForBudget;
+
+    std::unordered_map<std::string, ScriptBudgetStats> mStats;
+};
+
+}
+
+#endif
@@ -0,0 +1,186 @@
+#include "ScriptCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace Tempest
+{
+
+namespace
+{
+    constexpr uint32_t kCacheMagic = 0x43424C54; // "TLBC"
+
+    struct CacheHeader
+    {
+        uint32_t mMagic;
+        uint32_t mLuaVersion;
+        uint32_t mNumberSize;
+        uint32_t mIntegerSize;
+        uint64_t mSourceHash;
+    };
+
+    // FNV-1a, only needs to catch edits not be cryptographic.
+    uint64_t hashSource(const std::vector<char>& source)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for(const char c : source)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    bool readFile(const std::filesystem::path& path, std::vector<char>& out)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if(!file.is_open())
+            return false;
+
+        const std::streamsize size = file.tellg();
+        file.seekg(0, std::ios::beg);
+
+        out.resize(static_cast<size_t>(size));
+        return static_cast<bool>(file.read(out.data(), size));
+    }
+
+    int writeChunk(lua_State*, const void* data, size_t size, void* ud)
+    {
+        std::vector<char>* blob = static_cast<std::vector<char>*>(ud);
+        const char* bytes = static_cast<const char*>(data);
+        blob->insert(blob->end(), bytes, bytes + size);
+
+        return 0;
+    }
+
+    CacheHeader makeHeader(const uint64_t sourceHash)
+    {
+        return {kCacheMagic, LUA_VERSION_NUM, sizeof(lua_Number), sizeof(lua_Integer), sourceHash};
+    }
+
+    bool headerMatches(const CacheHeader& header, const CacheHeader& expected, const bool checkHash)
+    {
+        return header.mMagic == expected.mMagic &&
+               header.mLuaVersion == expected.mLuaVersion &&
+               header.mNumberSize == expected.mNumberSize &&
+               header.mIntegerSize == expected.mIntegerSize &&
+               (!checkHash || header.mSourceHash == expected.mSourceHash);
+    }
+
+    // Compiles source and dumps the function at the top of the stack to the cache file.
+    bool writeCache(lua_State* L, const std::filesystem::path& cachePath, const uint64_t sourceHash)
+    {
+        std::vector<char> blob(sizeof(CacheHeader));
+        const CacheHeader header = makeHeader(sourceHash);
+        memcpy(blob.data(), &header, sizeof(CacheHeader));
+
+        // Keep debug info, the script profiler and error messages want line numbers.
+        if(lua_dump(L, writeChunk, &blob, 0) != 0)
+            return false;
+
+        std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+        if(!file.is_open())
+            return false;
+
+        file.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+        return file.good();
+    }
+}
+
+
+std::filesystem::path getCachedScriptPath(const std::filesystem::path& source)
+{
+    std::filesystem::path cachePath = source;
+    cachePath.replace_extension(".luac");
+
+    return cachePath;
+}
+
+
+int loadCachedScript(lua_State* L, const std::filesystem::path& source, const bool shouldWriteCache)
+{
+    const std::string chunkName = "@" + source.string();
+    const std::filesystem::path cachePath = getCachedScriptPath(source);
+
+    std::vector<char> sourceData;
+    const bool haveSource = readFile(source, sourceData);
+    const uint64_t sourceHash = haveSource ? hashSource(sourceData) : 0;
+
+    std::vector<char> blob;
+    if(readFile(cachePath, blob) && blob.size() > sizeof(CacheHeader))
+    {
+        CacheHeader header;
+        memcpy(&header, blob.data(), sizeof(CacheHeader));
+
+        if(headerMatches(header, makeHeader(sourceHash), haveSource))
+        {
+            const int status = luaL_loadbufferx(L, blob.data() + sizeof(CacheHeader), blob.size() - sizeof(CacheHeader), chunkName.c_str(), "b");
+            if(status == LUA_OK)
+                return status;
+
+            // Corrupt or from an incompatible build, fall back to source.
+            lua_pop(L, 1);
+        }
+    }
+
+    if(!haveSource)
+    {
+        lua_pushfstring(L, "cannot open %s", source.string().c_str());
+        return LUA_ERRFILE;
+    }
+
+    const int status = luaL_loadbufferx(L, sourceData.data(), sourceData.size(), chunkName.c_str(), "t");
+    if(status == LUA_OK && shouldWriteCache)
+    {
+        // Not fatal, e.g. the asset directory might be read only.
+        if(!writeCache(L, cachePath, sourceHash))
+            printf("Failed to write script cache %s\n", cachePath.string().c_str());
+    }
+
+    return status;
+}
+
+
+uint32_t precompileScripts(const std::filesystem::path& dir)
+{
+    lua_State* L = luaL_newstate();
+
+    uint32_t failed = 0;
+    for(const auto& entry : std::filesystem::recursive_directory_iterator(dir))
+    {
+        if(!entry.is_regular_file() || entry.path().extension() != ".lua")
+            continue;
+
+        std::vector<char> sourceData;
+        const std::string chunkName = "@" + entry.path().string();
+        if(!readFile(entry.path(), sourceData) ||
+           luaL_loadbufferx(L, sourceData.data(), sourceData.size(), chunkName.c_str(), "t") != LUA_OK)
+        {
+            printf("Failed to compile %s: %s\n", entry.path().string().c_str(), lua_isstring(L, -1) ? lua_tostring(L, -1) : "unreadable");
+            lua_settop(L, 0);
+            ++failed;
+            continue;
+        }
+
+        if(!writeCache(L, getCachedScriptPath(entry.path()), hashSource(sourceData)))
+        {
+            printf("Failed to write %s\n", getCachedScriptPath(entry.path()).string().c_str());
+            ++failed;
+        }
+        else
+        {
+            printf("Compiled %s\n", entry.path().string().c_str());
+        }
+
+        lua_settop(L, 0);
+    }
+
+    lua_close(L);
+
+    return failed;
+}
+
+}
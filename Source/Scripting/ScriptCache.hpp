@@ -0,0 +1,25 @@
+#ifndef SCRIPT_CACHE_HPP
+#define SCRIPT_CACHE_HPP
+
+#include <cstdint>
+#include <filesystem>
+
+#include "lua.hpp"
+
+namespace Tempest
+{
+
+// Compiled chunks live next to their source as foo.luac. The header stores the
+// lua version and a hash of the source so stale blobs get rebuilt, if the
+// source is missing (baked builds) the blob is used as is.
+std::filesystem::path getCachedScriptPath(const std::filesystem::path& source);
+
+// Same contract as luaL_loadfile, leaves the chunk or an error message on the stack.
+int loadCachedScript(lua_State*, const std::filesystem::path& source, const bool writeCache = true);
+
+// Offline step, builds a blob for every .lua under dir. Returns the number that failed.
+uint32_t precompileScripts(const std::filesystem::path& dir);
+
+}
+
+#endif
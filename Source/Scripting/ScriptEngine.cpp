@@ -2,28 +2,47 @@
 #include "ScriptableScene.hpp"
 #include "ScriptableEngine.hpp"
 #include "ScriptableRenderer.hpp"
+#include "ScriptCache.hpp"
+#include "ScriptSnapshot.hpp"
+#include "FrameProfiler.hpp"
 
 #include "Include/Engine/Engine.hpp"
 #include "Include/Engine/Scene.h"
 
+#include <algorithm>
+
 namespace Tempest
 {
 
-ScriptEngine* s_scriptEngine;
-std::unordered_map<std::string, int(*)(lua_State*)> s_dispatchFunctions;
-
 ScriptEngine::ScriptEngine() :
-    mState(nullptr)
+    mState(nullptr),
+    mProfiler(nullptr),
+    mScheduler(nullptr),
+    mBudget(nullptr),
+    mGarbageCollectionMode(GarbageCollectionMode::Incremental),
+    mGarbageCollectionBudget(250),
+    mGarbageCollectionIdle(false)
 {
     mState = luaL_newstate();
+    // Before anything creates threads, they copy the main threads extra space.
+    *static_cast<ScriptEngine**>(lua_getextraspace(mState)) = this;
     luaL_openlibs(mState);
 
-    s_scriptEngine = this;
+    mProfiler = new ScriptProfiler(mState);
+    mScheduler = new ScriptScheduler(mState);
+    mBudget = new ScriptBudget(mState, mProfiler);
+
+    // We pace the collector ourselves from collectGarbage.
+    lua_gc(mState, LUA_GCSTOP);
+    setGarbageCollectionMode(mGarbageCollectionMode);
 }
 
 
 ScriptEngine::~ScriptEngine()
 {
+    delete mBudget;
+    delete mScheduler;
+    delete mProfiler;
     lua_close(mState);
 }
 
@@ -37,24 +56,42 @@ void ScriptEngine::loadScript(const std::string& s)
 
 void ScriptEngine::init()
 {
+    // Handles from a previous level could come back as new entities.
+    mThrottle.reset();
+
     lua_getglobal(mState, "init");
     call_lua_func("init", 0, 0);
 
     for(const auto&[name, entities] : mComponentScripts)
     {
         for(const auto entity : entities)
-        {
-            const std::string init_name = name + "_init";
+            call_init_func(name, entity);
+    }
+}
 
-            lua_getglobal(mState, init_name.c_str());
 
-            lua_pushinteger(mState, entity);
-            call_lua_func(init_name.c_str(), 1, 0);
-        }
+void ScriptEngine::initEntity(const int64_t entity)
+{
+    for(const auto&[name, entities] : mComponentScripts)
+    {
+        if(std::find(entities.begin(), entities.end(), entity) != entities.end())
+            call_init_func(name, entity);
     }
 }
 
 
+void ScriptEngine::call_init_func(const std::string& func, const int64_t entity)
+{
+    // interned so the profiler can keep hold of the name.
+    const char* init_name = FrameProfiler::get().internName(func + "_init");
+
+    lua_getglobal(mState, init_name);
+
+    lua_pushinteger(mState, entity);
+    call_lua_func(init_name, 1, 0);
+}
+
+
 void ScriptEngine::tick(const std::chrono::microseconds delta)
 {
     lua_getglobal(mState, "main");
@@ -62,17 +99,149 @@ void ScriptEngine::tick(const std::chrono::microseconds delta)
     lua_pushinteger(mState, delta.count());
     call_lua_func("main", 1, 0);
 
-    for(const auto&[name, entities] : mComponentScripts)
+    removePendingEntities();
+    mThrottle.beginFrame(delta);
+
+    if(mBudget->isEnabled())
     {
-        for(const auto entity : entities)
+        mBudget->run(mComponentScripts, delta, mThrottle);
+    }
+    else
+    {
+        for(const auto&[name, entities] : mComponentScripts)
         {
-            lua_getglobal(mState, name.c_str());
-
-            lua_pushinteger(mState, entity);
-            lua_pushinteger(mState, delta.count());
-            call_lua_func(name.c_str(), 2, 0);
+            // Components that only run coroutines don't need a per frame function.
+            const bool hasTick = lua_getglobal(mState, name.c_str()) == LUA_TFUNCTION;
+            lua_pop(mState, 1);
+            if(!hasTick)
+                continue;
+
+            for(const auto entity : entities)
+            {
+                std::chrono::microseconds entityDelta = delta;
+                if(!mThrottle.shouldRun(entity, entityDelta))
+                    continue;
+
+                lua_getglobal(mState, name.c_str());
+
+                lua_pushinteger(mState, entity);
+                lua_pushinteger(mState, entityDelta.count());
+                call_lua_func(name.c_str(), 2, 0);
+            }
         }
     }
+
+    {
+        TEMPEST_PROFILE_SCOPE("Coroutines")
+        mScheduler->update(delta);
+    }
+
+    mProfiler->endFrame();
+}
+
+
+uint64_t ScriptEngine::startCoroutine(const std::string& func, const int64_t entity)
+{
+    lua_getglobal(mState, func.c_str());
+    BELL_ASSERT(lua_isfunction(mState, -1), "Coroutine function doesn't exist")
+
+    lua_pushinteger(mState, entity);
+    return mScheduler->spawn(mState, 1);
+}
+
+
+void ScriptEngine::signalEvent(const std::string& name, const int64_t data)
+{
+    mScheduler->signalEvent(name, data);
+}
+
+
+void ScriptEngine::setRandomSeed(const uint64_t seed)
+{
+    lua_getglobal(mState, "math");
+    lua_getfield(mState, -1, "randomseed");
+    lua_pushinteger(mState, static_cast<lua_Integer>(seed));
+    if(lua_pcall(mState, 1, 0, 0) != LUA_OK)
+    {
+        BELL_LOG_ARGS("error seeding math.random: %s\n", lua_tostring(mState, -1));
+        lua_pop(mState, 1);
+    }
+    lua_pop(mState, 1);
+}
+
+
+void ScriptEngine::saveState(ScriptSnapshot& snapshot)
+{
+    snapshot.save(mState);
+}
+
+
+void ScriptEngine::restoreState(const ScriptSnapshot& snapshot)
+{
+    snapshot.restore(mState);
+}
+
+
+void ScriptEngine::collectGarbage()
+{
+    const auto start = std::chrono::steady_clock::now();
+    const uint32_t heapKB = static_cast<uint32_t>(lua_gc(mState, LUA_GCCOUNT));
+    GarbageCollectionStats& stats = mGarbageCollectionStats;
+
+    // Same idea as lua's own pause, don't start a new cycle until the heap has grown a bit.
+    const bool startCycle = !mGarbageCollectionIdle || heapKB > (stats.mHeapAfterCycleKB * 3) / 2;
+
+    // If scripts are making garbage faster than we clear it let the collector catch up.
+    std::chrono::microseconds budget = mGarbageCollectionBudget;
+    if(stats.mHeapAfterCycleKB > 0 && heapKB > stats.mHeapAfterCycleKB * 2)
+        budget *= 4;
+
+    uint32_t steps = 0;
+    if(startCycle)
+    {
+        mGarbageCollectionIdle = false;
+
+        do
+        {
+            ++steps;
+
+            // Each basic step does roughly 2^stepsize bytes of work, in generational
+            // mode it's a whole young collection so one is enough.
+            const bool cycleDone = lua_gc(mState, LUA_GCSTEP, 0);
+            if(mGarbageCollectionMode == GarbageCollectionMode::Generational)
+                break;
+
+            if(cycleDone)
+            {
+                ++stats.mCompletedCycles;
+                stats.mHeapAfterCycleKB = static_cast<uint32_t>(lua_gc(mState, LUA_GCCOUNT));
+                mGarbageCollectionIdle = true;
+                break;
+            }
+        } while(std::chrono::steady_clock::now() - start < budget);
+    }
+
+    const auto pause = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    stats.mHeapKB = static_cast<uint32_t>(lua_gc(mState, LUA_GCCOUNT));
+    stats.mLastPause = pause;
+    stats.mMaxPause = std::max(stats.mMaxPause, pause);
+    stats.mStepsLastFrame = steps;
+}
+
+
+void ScriptEngine::setGarbageCollectionMode(const GarbageCollectionMode mode)
+{
+    mGarbageCollectionMode = mode;
+
+    if(mode == GarbageCollectionMode::Generational)
+    {
+        lua_gc(mState, LUA_GCGEN, 0, 0);
+    }
+    else
+    {
+        // Small step size so the budget can be hit fairly precisely.
+        lua_gc(mState, LUA_GCINC, 0, 0, 10);
+    }
 }
 
 
@@ -85,24 +254,59 @@ void ScriptEngine::registerScript(const std::string& path, const std::string& fu
 
 void ScriptEngine::registerEntityWithScript(const std::string& func, const int64_t entity)
 {
-    mComponentScripts[func].push_back(entity);
+    auto it = mComponentScripts.try_emplace(func).first;
+    it->second.push_back(entity);
+    mBudget->addTask(it->first, entity);
+}
+
+
+void ScriptEngine::unregisterEntity(const int64_t entity)
+{
+    mRemovedEntities.push_back(entity);
+}
+
+
+void ScriptEngine::removePendingEntities()
+{
+    for(const int64_t entity : mRemovedEntities)
+    {
+        for(auto&[name, entities] : mComponentScripts)
+            entities.erase(std::remove(entities.begin(), entities.end(), entity), entities.end());
+
+        mBudget->removeEntity(entity);
+        mThrottle.removeEntity(entity);
+    }
+    mRemovedEntities.clear();
 }
 
 
 
 void ScriptEngine::call_lua_func(const char* f, const uint32_t args, const uint32_t returns)
 {
+    TEMPEST_PROFILE_SCOPE(f)
+
+    // The script can start or stop profiling itself, so decide once.
+    const bool profiling = mProfiler->isEnabled();
+    const uint64_t start = profiling ? ScriptProfiler::now() : 0;
+
+    mProfiler->enterCall();
     if (lua_pcall(mState, args, returns, 0) != 0)
     {
         BELL_LOG_ARGS("error running function %s: %s\n", f, lua_tostring(mState, -1));
         BELL_TRAP;
     }
+
+    if(profiling)
+        mProfiler->recordFunction(f, ScriptProfiler::now() - start);
+    mProfiler->leaveCall();
 }
 
 
 void ScriptEngine::load_script(const char* f)
 {
-    bool error = luaL_loadfile(mState, f);
+    bool error = loadCachedScript(mState, f) != LUA_OK;
+    if(error)
+        BELL_LOG_ARGS("%s\n", lua_tostring(mState, -1));
     BELL_ASSERT(!error, "Failed to load script file")
     error = error || lua_pcall(mState, 0, 0, 0);
 
@@ -126,10 +330,4 @@ void ScriptEngine::registerPhysicsHooks(PhysicsWorld*)
 
 }
 
-
-ScriptEngine* getScriptEngine()
-{
-    return s_scriptEngine;
-}
-
 }
@@ -2,6 +2,10 @@
 #define SCRIPT_ENGINE_HPP
 
 #include "ScriptHooks.hpp"
+#include "ScriptProfiler.hpp"
+#include "ScriptScheduler.hpp"
+#include "ScriptBudget.hpp"
+#include "ScriptThrottle.hpp"
 
 #include <chrono>
 #include <type_traits>
@@ -17,6 +21,7 @@ namespace Tempest
 {
     class PhysicsWorld;
     class TempestEngine;
+    class ScriptSnapshot;
 
 template<typename T>
 struct ExtractClassType
@@ -48,8 +53,6 @@ public:
     virtual int callFunction(lua_State* L) = 0;
 };
 
-extern std::unordered_map<std::string, int(*)(lua_State*)> s_dispatchFunctions;
-
 template<typename F, typename ...Args>
 class ScriptableCallable : public ScriptableCallableBase
 {
@@ -77,19 +80,43 @@ public:
     CallablesRegistrar() {}
     ~CallablesRegistrar() = default;
 
-    void registerLuaCallable(const std::string& name, ScriptableCallableBase* callable)
+    struct Entry
+    {
+        ScriptableCallableBase* mCallable;
+        // What lua calls, forwards to the callable through ScriptEngine::dispatchCallable.
+        lua_CFunction mFunction;
+    };
+
+    void registerLuaCallable(const std::string& name, ScriptableCallableBase* callable, lua_CFunction function)
     {
-        mCallables.insert({name, callable});
+        mCallables.insert({name, {callable, function}});
     }
 
-    const std::unordered_map<std::string, ScriptableCallableBase*>& getCallables() const
+    const std::unordered_map<std::string, Entry>& getCallables() const
     {
         return mCallables;
     }
 
 private:
 
-    std::unordered_map<std::string, ScriptableCallableBase*> mCallables;
+    std::unordered_map<std::string, Entry> mCallables;
+};
+
+
+enum class GarbageCollectionMode
+{
+    Incremental,
+    Generational
+};
+
+struct GarbageCollectionStats
+{
+    uint32_t mHeapKB = 0;
+    uint32_t mHeapAfterCycleKB = 0;
+    std::chrono::microseconds mLastPause{0};
+    std::chrono::microseconds mMaxPause{0};
+    uint32_t mStepsLastFrame = 0;
+    uint64_t mCompletedCycles = 0;
 };
 
 
@@ -108,9 +135,69 @@ public:
 
     void tick(const std::chrono::microseconds);
 
+    // The collector never runs on its own, call this once a frame when the
+    // game thread would otherwise be idle. Steps until the budget is used.
+    void collectGarbage();
+
+    void setGarbageCollectionMode(const GarbageCollectionMode);
+    void setGarbageCollectionBudget(const std::chrono::microseconds budget)
+    {
+        mGarbageCollectionBudget = budget;
+    }
+
+    const GarbageCollectionStats& getGarbageCollectionStats() const
+    {
+        return mGarbageCollectionStats;
+    }
+
     void registerScript(const std::string& path, const std::string& func);
 
     void registerEntityWithScript(const std::string& func, const int64_t entity);
+    // Stops its component scripts from the next tick.
+    void unregisterEntity(const int64_t entity);
+    // Runs the init functions for an entity registered after init.
+    void initEntity(const int64_t entity);
+
+    // Instruction budgets for component scripts, 0 is unlimited. Without any budgets
+    // set component functions are called directly.
+    void setScriptBudget(const std::string& func, const uint32_t instructions, const int32_t priority)
+    {
+        mBudget->setScriptBudget(func, instructions, priority);
+    }
+
+    void setFrameScriptBudget(const uint64_t instructions)
+    {
+        mBudget->setFrameBudget(instructions);
+    }
+
+    const std::unordered_map<std::string, ScriptBudgetStats>& getScriptBudgetStats() const
+    {
+        return mBudget->getStats();
+    }
+
+    // Component scripts on entities the function says aren't relevant only
+    // tick every farInterval frames, 1 or less ticks everything every frame.
+    void setScriptRelevance(ScriptThrottle::RelevanceFunction relevance, const uint32_t farInterval)
+    {
+        mThrottle.setRelevance(std::move(relevance), farInterval);
+    }
+
+    uint32_t getSkippedScriptCount() const
+    {
+        return mThrottle.getSkippedLastFrame();
+    }
+
+    // Runs a global function as a coroutine with the entity as its argument.
+    uint64_t startCoroutine(const std::string& func, const int64_t entity);
+    void signalEvent(const std::string& name, const int64_t data);
+
+    // Seeds math.random.
+    void setRandomSeed(const uint64_t seed);
+
+    // Script globals and file level locals for world snapshots. Running
+    // coroutines aren't captured and carry on after a restore.
+    void saveState(ScriptSnapshot&);
+    void restoreState(const ScriptSnapshot&);
 
     CallablesRegistrar* createCallablesRegistrar()
     {
@@ -119,13 +206,12 @@ public:
 
     void registerCallables(CallablesRegistrar* registrar)
     {
-        const std::unordered_map<std::string, ScriptableCallableBase*>& callables = registrar->getCallables();
-        for(const auto& [name, callable] : callables)
+        const std::unordered_map<std::string, CallablesRegistrar::Entry>& callables = registrar->getCallables();
+        for(const auto& [name, entry] : callables)
         {
-            int(*f)(lua_State*) = s_dispatchFunctions[name];
-            lua_register(mState, name.c_str(), f);
+            lua_register(mState, name.c_str(), entry.mFunction);
 
-            mCallables.insert({name, callable});
+            mCallables.insert({name, entry.mCallable});
         }
 
         delete registrar;
@@ -137,6 +223,38 @@ public:
         return mCallables[name];
     }
 
+    // Each lua state belongs to one engine, hooks find theirs through the
+    // states extra space which coroutines and budget threads inherit.
+    static ScriptEngine* fromState(lua_State* L)
+    {
+        return *static_cast<ScriptEngine**>(lua_getextraspace(L));
+    }
+
+    // Entry point for every engine hook called from lua, name must be a literal.
+    int dispatchCallable(const char* name, lua_State* L)
+    {
+        ScriptableCallableBase* callable = getCallableByName(name);
+        if(!mProfiler->isEnabled())
+            return callable->callFunction(L);
+
+        const uint64_t start = ScriptProfiler::now();
+        const int results = callable->callFunction(L);
+        mProfiler->recordHook(name, ScriptProfiler::now() - start);
+
+        return results;
+    }
+
+    ScriptProfiler& getProfiler()
+    {
+        return *mProfiler;
+    }
+
+    // For hooks that keep lua side state of their own.
+    lua_State* getState()
+    {
+        return mState;
+    }
+
     void registerSceneHooks(Scene*);
     void registerEngineHooks(TempestEngine*);
     void registerPhysicsHooks(PhysicsWorld*);
@@ -144,18 +262,30 @@ public:
 private:
 
     void call_lua_func(const char *f, const uint32_t args, const uint32_t returns);
+    void call_init_func(const std::string& func, const int64_t entity);
 
     void load_script(const char* f);
 
+    // Removals are held back so scripts can remove entities mid tick.
+    void removePendingEntities();
+
     std::unordered_map<std::string, std::vector<int64_t>> mComponentScripts;
+    std::vector<int64_t> mRemovedEntities;
 
     std::unordered_map<std::string, ScriptableCallableBase*> mCallables;
 
     lua_State* mState;
+    ScriptProfiler* mProfiler;
+    ScriptScheduler* mScheduler;
+    ScriptBudget* mBudget;
+    ScriptThrottle mThrottle;
+
+    GarbageCollectionMode mGarbageCollectionMode;
+    std::chrono::microseconds mGarbageCollectionBudget;
+    GarbageCollectionStats mGarbageCollectionStats;
+    bool mGarbageCollectionIdle;
 };
 
-ScriptEngine* getScriptEngine();
-
 }
 
 #endif
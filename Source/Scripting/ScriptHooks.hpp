@@ -18,17 +18,15 @@
 
 #define LUA_SCRIPT_HOOK_DEFINITION(C, F) int C ## _ ## F(lua_State* L)  \
 {									\
-    Tempest::ScriptEngine* se = Tempest::getScriptEngine();				\
-    Tempest::ScriptableCallableBase* callable = se->getCallableByName(LUA_SCRIPT_HOOK_NAME(C, F)); \
-    return callable->callFunction(L);					\
+    Tempest::ScriptEngine* se = Tempest::ScriptEngine::fromState(L);		\
+    return se->dispatchCallable(LUA_SCRIPT_HOOK_NAME(C, F), L);		\
 }
 
 #define LUA_REGISTER_HOOK(C, F, I, ...) \
     { \
-        auto* callable = new Tempest::ScriptableCallable<decltype(&C::F), __VA_ARGS__>(&C::F, I); \
+        auto* callable = new Tempest::ScriptableCallable<decltype(&C::F), ##__VA_ARGS__>(&C::F, I); \
         const std::string name = LUA_SCRIPT_HOOK_NAME(C, F); \
-        registrar->registerLuaCallable(name, callable); \
-        Tempest::s_dispatchFunctions[name] = &C ## _ ## F;      \
+        registrar->registerLuaCallable(name, callable, &C ## _ ## F); \
     }
 
 namespace Tempest {
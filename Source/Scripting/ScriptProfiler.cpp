@@ -0,0 +1,286 @@
+#include "ScriptProfiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace Tempest
+{
+
+namespace
+{
+    // Registry key for finding the profiler from inside the hook.
+    const char kProfilerKey = 0;
+
+    constexpr int kMaxSampleDepth = 64;
+
+    void appendFrameName(std::string& out, lua_Debug& ar)
+    {
+        if(ar.name)
+            out += ar.name;
+        else if(*ar.what == 'm')
+            out += "main chunk";
+        else
+            out += "?";
+
+        if(*ar.what != 'C')
+        {
+            out += " (";
+            out += ar.short_src;
+            out += ':';
+            out += std::to_string(ar.linedefined);
+            out += ')';
+        }
+    }
+
+    template<typename T>
+    std::vector<std::pair<typename T::key_type, typename T::mapped_type>> toVector(const T& map)
+    {
+        std::vector<std::pair<typename T::key_type, typename T::mapped_type>> sorted(map.begin(), map.end());
+        return sorted;
+    }
+}
+
+
+ScriptProfiler::ScriptProfiler(lua_State* L) :
+    mState(L),
+    mEnabled(false),
+    mWindowFrames(0),
+    mFrameIndex(0),
+    mWindowIndex(0),
+    mTotalSamples(0),
+    mInstructionInterval(0),
+    mHookMask(0),
+    mPendingInstructions(0),
+    mCallDepth(0),
+    mStartPending(false),
+    mPendingWindowFrames(0),
+    mPendingInstructionInterval(0),
+    mPendingCountCalls(false)
+{
+    lua_pushlightuserdata(mState, this);
+    lua_rawsetp(mState, LUA_REGISTRYINDEX, &kProfilerKey);
+}
+
+
+ScriptProfiler::~ScriptProfiler()
+{
+    stop();
+}
+
+
+void ScriptProfiler::start(const uint32_t windowFrames, const std::filesystem::path& outputDir, const uint32_t instructionInterval, const bool countCalls)
+{
+    mPendingWindowFrames = windowFrames;
+    mPendingOutputDirectory = outputDir;
+    mPendingInstructionInterval = instructionInterval;
+    mPendingCountCalls = countCalls;
+    mStartPending = true;
+
+    if(mCallDepth == 0)
+        applyStart();
+}
+
+
+void ScriptProfiler::applyStart()
+{
+    mStartPending = false;
+    reset();
+
+    const uint32_t instructionInterval = mPendingInstructionInterval;
+    const bool countCalls = mPendingCountCalls;
+
+    mWindowFrames = mPendingWindowFrames;
+    mOutputDirectory = mPendingOutputDirectory;
+    mInstructionInterval = instructionInterval;
+    mFrameIndex = 0;
+    mEnabled = true;
+
+    if(!mOutputDirectory.empty())
+        std::filesystem::create_directories(mOutputDirectory);
+
+    int mask = 0;
+    if(instructionInterval > 0)
+        mask |= LUA_MASKCOUNT;
+    if(countCalls)
+        mask |= LUA_MASKCALL;
+
+    mHookMask = mask;
+    mPendingInstructions = 0;
+    lua_sethook(mState, mask ? luaHook : nullptr, mask, static_cast<int>(instructionInterval));
+}
+
+
+void ScriptProfiler::stop()
+{
+    mStartPending = false;
+    if(!mEnabled)
+        return;
+
+    lua_sethook(mState, nullptr, 0, 0);
+    mHookMask = 0;
+    mEnabled = false;
+}
+
+
+void ScriptProfiler::endFrame()
+{
+    if(!mEnabled || mWindowFrames == 0)
+        return;
+
+    if(++mFrameIndex < mWindowFrames)
+        return;
+
+    if(!mOutputDirectory.empty())
+    {
+        const std::string base = "window_" + std::to_string(mWindowIndex);
+        writeReport(mOutputDirectory / (base + ".txt"));
+        writeCollapsedStacks(mOutputDirectory / (base + ".folded"));
+    }
+
+    ++mWindowIndex;
+    mFrameIndex = 0;
+    reset();
+}
+
+
+void ScriptProfiler::reset()
+{
+    mFunctions.clear();
+    mHooks.clear();
+    mSamples.clear();
+    mCalls.clear();
+    mTotalSamples = 0;
+}
+
+
+void ScriptProfiler::luaHook(lua_State* L, lua_Debug* ar)
+{
+    lua_rawgetp(L, LUA_REGISTRYINDEX, &kProfilerKey);
+    ScriptProfiler* profiler = static_cast<ScriptProfiler*>(lua_touserdata(L, -1));
+    lua_pop(L, 1);
+
+    if(!profiler)
+        return;
+
+    if(ar->event == LUA_HOOKCOUNT)
+        profiler->sample(L);
+    else if(ar->event == LUA_HOOKCALL)
+        profiler->countCall(L, ar);
+}
+
+
+void ScriptProfiler::sample(lua_State* L)
+{
+    lua_Debug frames[kMaxSampleDepth];
+    int depth = 0;
+    while(depth < kMaxSampleDepth && lua_getstack(L, depth, &frames[depth]))
+    {
+        lua_getinfo(L, "Sn", &frames[depth]);
+        ++depth;
+    }
+
+    // Collapsed stacks go root first.
+    mStackScratch.clear();
+    for(int i = depth - 1; i >= 0; --i)
+    {
+        appendFrameName(mStackScratch, frames[i]);
+        if(i > 0)
+            mStackScratch += ';';
+    }
+
+    ++mSamples[mStackScratch];
+    ++mTotalSamples;
+}
+
+
+void ScriptProfiler::countCall(lua_State* L, lua_Debug* ar)
+{
+    lua_getinfo(L, "Sn", ar);
+
+    mStackScratch.clear();
+    appendFrameName(mStackScratch, *ar);
+    ++mCalls[mStackScratch];
+}
+
+
+void ScriptProfiler::writeReport(const std::filesystem::path& path) const
+{
+    std::ofstream file(path);
+    if(!file.is_open())
+    {
+        printf("Failed to write script profile %s\n", path.string().c_str());
+        return;
+    }
+
+    auto writeTimings = [&](const char* title, const std::unordered_map<const char*, Timing>& timings)
+    {
+        auto sorted = toVector(timings);
+        std::sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) { return lhs.second.mTotal > rhs.second.mTotal; });
+
+        file << title << "\n";
+        file << "total ms    calls     avg us    max us    name\n";
+        for(const auto& [name, timing] : sorted)
+        {
+            char line[128];
+            snprintf(line, sizeof(line), "%-11.3f %-9llu %-9.2f %-9.2f ",
+                     timing.mTotal / 1000000.0,
+                     static_cast<unsigned long long>(timing.mCalls),
+                     (timing.mTotal / 1000.0) / std::max<uint64_t>(timing.mCalls, 1),
+                     timing.mMax / 1000.0);
+            file << line << name << "\n";
+        }
+        file << "\n";
+    };
+
+    file << "Script profile over " << mFrameIndex << " frames\n\n";
+
+    writeTimings("Script functions (inclusive)", mFunctions);
+    writeTimings("Engine hooks", mHooks);
+
+    // Self samples are attributed to the leaf of each stack.
+    std::unordered_map<std::string, uint64_t> selfSamples;
+    for(const auto& [stack, count] : mSamples)
+    {
+        const size_t leaf = stack.find_last_of(';');
+        selfSamples[leaf == std::string::npos ? stack : stack.substr(leaf + 1)] += count;
+    }
+
+    auto sortedSamples = toVector(selfSamples);
+    std::sort(sortedSamples.begin(), sortedSamples.end(), [](const auto& lhs, const auto& rhs) { return lhs.second > rhs.second; });
+
+    file << "Sampled self time (" << mTotalSamples << " samples every " << mInstructionInterval << " instructions)\n";
+    for(const auto& [name, count] : sortedSamples)
+    {
+        char line[64];
+        snprintf(line, sizeof(line), "%6.2f%%  %-9llu ", (100.0 * count) / std::max<uint64_t>(mTotalSamples, 1), static_cast<unsigned long long>(count));
+        file << line << name << "\n";
+    }
+
+    if(!mCalls.empty())
+    {
+        auto sortedCalls = toVector(mCalls);
+        std::sort(sortedCalls.begin(), sortedCalls.end(), [](const auto& lhs, const auto& rhs) { return lhs.second > rhs.second; });
+
+        file << "\nCall counts\n";
+        for(const auto& [name, count] : sortedCalls)
+            file << count << "  " << name << "\n";
+    }
+}
+
+
+void ScriptProfiler::writeCollapsedStacks(const std::filesystem::path& path) const
+{
+    std::ofstream file(path);
+    if(!file.is_open())
+    {
+        printf("Failed to write script profile %s\n", path.string().c_str());
+        return;
+    }
+
+    for(const auto& [stack, count] : mSamples)
+        file << stack << " " << count << "\n";
+}
+
+}
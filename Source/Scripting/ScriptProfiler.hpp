@@ -0,0 +1,156 @@
+#ifndef SCRIPT_PROFILER_HPP
+#define SCRIPT_PROFILER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+#include "lua.hpp"
+
+namespace Tempest
+{
+
+// Timing for script entry points and engine hooks plus a sampled view of
+// where the lua vm is spending instructions. Everything is accumulated over a
+// window of frames and then written out as a report and a collapsed stack
+// file that flamegraph.pl / speedscope can load.
+class ScriptProfiler
+{
+public:
+    ScriptProfiler(lua_State*);
+    ~ScriptProfiler();
+
+    // Every instructionInterval vm instructions the lua call stack is sampled.
+    // countCalls also hooks every function entry, which is a lot slower.
+    // Called from inside a script it takes effect once the outermost call returns.
+    void start(const uint32_t windowFrames, const std::filesystem::path& outputDir, const uint32_t instructionInterval = 1000, const bool countCalls = false);
+    void stop();
+
+    // Entry points bracket running lua with these so start doesn't reset
+    // everything under a call that's still going to be recorded.
+    void enterCall()
+    {
+        ++mCallDepth;
+    }
+
+    void leaveCall()
+    {
+        if(--mCallDepth == 0 && mStartPending)
+            applyStart();
+    }
+
+    bool isEnabled() const
+    {
+        return mEnabled;
+    }
+
+    void endFrame();
+
+    // Inclusive wall time of a call_lua_func target.
+    void recordFunction(const char* name, const uint64_t nanoseconds)
+    {
+        Timing& timing = mFunctions[name];
+        timing.add(nanoseconds);
+    }
+
+    // Wall time of a single ScriptableCallable dispatch, name must be a literal.
+    void recordHook(const char* name, const uint64_t nanoseconds)
+    {
+        Timing& timing = mHooks[name];
+        timing.add(nanoseconds);
+    }
+
+    static uint64_t now()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void writeReport(const std::filesystem::path&) const;
+    void writeCollapsedStacks(const std::filesystem::path&) const;
+
+    void reset();
+
+    // Public so other hooks (script budgets) can forward to it.
+    static void luaHook(lua_State*, lua_Debug*);
+
+    // What start installed on the main state, for hooks that replace it on other threads.
+    int getHookMask() const
+    {
+        return mHookMask;
+    }
+
+    uint32_t getInstructionInterval() const
+    {
+        return mInstructionInterval;
+    }
+
+    // For count hooks firing at their own interval, samples every
+    // instructionInterval instructions counted.
+    void countInstructions(lua_State* L, const uint32_t instructions)
+    {
+        if(mInstructionInterval == 0)
+            return;
+
+        mPendingInstructions += instructions;
+        if(mPendingInstructions >= mInstructionInterval)
+        {
+            mPendingInstructions %= mInstructionInterval;
+            sample(L);
+        }
+    }
+
+private:
+
+    void applyStart();
+    void sample(lua_State*);
+    void countCall(lua_State*, lua_Debug*);
+
+    struct Timing
+    {
+        uint64_t mCalls = 0;
+        uint64_t mTotal = 0;
+        uint64_t mMax = 0;
+
+        void add(const uint64_t nanoseconds)
+        {
+            ++mCalls;
+            mTotal += nanoseconds;
+            if(nanoseconds > mMax)
+                mMax = nanoseconds;
+        }
+    };
+
+    lua_State* mState;
+    bool mEnabled;
+
+    uint32_t mWindowFrames;
+    uint32_t mFrameIndex;
+    uint32_t mWindowIndex;
+    std::filesystem::path mOutputDirectory;
+
+    // Keyed by pointer, the names are either literals or owned by the script engine.
+    std::unordered_map<const char*, Timing> mFunctions;
+    std::unordered_map<const char*, Timing> mHooks;
+
+    std::unordered_map<std::string, uint64_t> mSamples;
+    std::unordered_map<std::string, uint64_t> mCalls;
+    uint64_t mTotalSamples;
+    uint32_t mInstructionInterval;
+    int mHookMask;
+    uint32_t mPendingInstructions;
+
+    std::string mStackScratch;
+
+    uint32_t mCallDepth;
+    bool mStartPending;
+    uint32_t mPendingWindowFrames;
+    std::filesystem::path mPendingOutputDirectory;
+    uint32_t mPendingInstructionInterval;
+    bool mPendingCountCalls;
+};
+
+}
+
+#endif
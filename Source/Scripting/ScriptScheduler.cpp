@@ -0,0 +1,342 @@
+#include "ScriptScheduler.hpp"
+
+#include "Core/BellLogging.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Tempest
+{
+
+namespace
+{
+    constexpr uint32_t kTimeWheelSlots = 1024;
+    constexpr uint32_t kFrameWheelSlots = 256;
+}
+
+
+ScriptScheduler::ScriptScheduler(lua_State* L) :
+    mState(L),
+    mActiveCount(0),
+    mTimeWheel(kTimeWheelSlots),
+    mFrameWheel(kFrameWheelSlots),
+    mTime(0)
+{
+    const luaL_Reg functions[] =
+    {
+        {"spawn", lua_spawn},
+        {"cancel", lua_cancel},
+        {"wait", lua_wait},
+        {"waitFrames", lua_waitFrames},
+        {"waitEvent", lua_waitEvent},
+        {"signalEvent", lua_signalEvent}
+    };
+
+    for(const luaL_Reg& function : functions)
+    {
+        lua_pushlightuserdata(mState, this);
+        lua_pushcclosure(mState, function.func, 1);
+        lua_setglobal(mState, function.name);
+    }
+}
+
+
+ScriptScheduler::~ScriptScheduler()
+{
+    for(uint32_t i = 0; i < mCoroutines.size(); ++i)
+    {
+        if(mCoroutines[i].mThread)
+            release(i);
+    }
+}
+
+
+uint64_t ScriptScheduler::spawn(lua_State* L, const int nargs)
+{
+    lua_State* thread = lua_newthread(mState);
+    const int ref = luaL_ref(mState, LUA_REGISTRYINDEX);
+
+    // Function and arguments go over to the new thread.
+    if(!lua_checkstack(thread, nargs + 1))
+    {
+        BELL_LOG_ARGS("Can't spawn a coroutine with %d arguments\n", nargs);
+        luaL_unref(mState, LUA_REGISTRYINDEX, ref);
+        lua_pop(L, nargs + 1);
+        return kInvalidHandle;
+    }
+    lua_xmove(L, thread, nargs + 1);
+
+    uint32_t index;
+    if(mFreeCoroutines.empty())
+    {
+        index = static_cast<uint32_t>(mCoroutines.size());
+        mCoroutines.emplace_back();
+    }
+    else
+    {
+        index = mFreeCoroutines.back();
+        mFreeCoroutines.pop_back();
+    }
+
+    Coroutine& coroutine = mCoroutines[index];
+    coroutine.mThread = thread;
+    coroutine.mRef = ref;
+    mThreadIndices[thread] = index;
+    ++mActiveCount;
+
+    const uint64_t handle = (static_cast<uint64_t>(coroutine.mGeneration) << 32) | index;
+    resume(handle, nargs, L);
+
+    return handle;
+}
+
+
+void ScriptScheduler::cancel(const uint64_t handle)
+{
+    const uint32_t index = getIndex(handle);
+    if(index >= mCoroutines.size() || mCoroutines[index].mGeneration != getGeneration(handle) || !mCoroutines[index].mThread)
+        return;
+
+    // Can't free a thread that is somewhere up the C stack, let resume do it.
+    if(mCoroutines[index].mRunning)
+        mCoroutines[index].mCancelled = true;
+    else
+        release(index);
+}
+
+
+void ScriptScheduler::signalEvent(const std::string& name, const int64_t data)
+{
+    auto it = mEventWaiters.find(name);
+    if(it == mEventWaiters.end())
+        return;
+
+    for(const uint64_t handle : it->second)
+    {
+        mSignalled.push_back({handle, data});
+        if(getThread(handle))
+            mCoroutines[getIndex(handle)].mWaitingEvent.clear();
+    }
+
+    mEventWaiters.erase(it);
+}
+
+
+void ScriptScheduler::update(const std::chrono::microseconds delta)
+{
+    mDue.clear();
+    auto collect = [this](const uint64_t handle) { mDue.push_back(handle); };
+
+    mFrameWheel.advance(mFrameWheel.getCurrentTick() + 1, collect);
+
+    mTime += delta;
+    mTimeWheel.advance(static_cast<uint64_t>(mTime.count() / 1000), collect);
+
+    // Anything scheduled while resuming these goes on the wheels, not mDue.
+    std::vector<uint64_t> due;
+    due.swap(mDue);
+    for(const uint64_t handle : due)
+        resume(handle, 0, mState);
+
+    std::vector<std::pair<uint64_t, int64_t>> signalled;
+    signalled.swap(mSignalled);
+    for(const auto& [handle, data] : signalled)
+    {
+        if(lua_State* thread = getThread(handle); thread)
+        {
+            lua_pushinteger(thread, data);
+            resume(handle, 1, mState);
+        }
+    }
+}
+
+
+lua_State* ScriptScheduler::getThread(const uint64_t handle) const
+{
+    const uint32_t index = getIndex(handle);
+    if(index >= mCoroutines.size() || mCoroutines[index].mGeneration != getGeneration(handle))
+        return nullptr;
+
+    return mCoroutines[index].mThread;
+}
+
+
+uint64_t ScriptScheduler::getRunningHandle(lua_State* L) const
+{
+    auto it = mThreadIndices.find(L);
+    if(it == mThreadIndices.end())
+        return kInvalidHandle;
+
+    const uint32_t index = it->second;
+    return (static_cast<uint64_t>(mCoroutines[index].mGeneration) << 32) | index;
+}
+
+
+void ScriptScheduler::resume(const uint64_t handle, const int nargs, lua_State* from)
+{
+    lua_State* thread = getThread(handle);
+    if(!thread)
+        return;
+
+    const uint32_t index = getIndex(handle);
+    mCoroutines[index].mWaiting = false;
+    mCoroutines[index].mRunning = true;
+
+    int results = 0;
+    const int status = lua_resume(thread, from, nargs, &results);
+
+    // mCoroutines may have grown while the coroutine ran.
+    Coroutine& coroutine = mCoroutines[index];
+    coroutine.mRunning = false;
+
+    if(status == LUA_YIELD)
+    {
+        lua_pop(thread, results);
+
+        if(coroutine.mCancelled)
+            release(index);
+        // A plain coroutine.yield() just means try again next frame.
+        else if(!coroutine.mWaiting)
+            mFrameWheel.schedule(mFrameWheel.getCurrentTick() + 1, handle);
+    }
+    else if(status == LUA_OK)
+    {
+        release(index);
+    }
+    else
+    {
+        luaL_traceback(mState, thread, lua_tostring(thread, -1), 0);
+        BELL_LOG_ARGS("error running coroutine: %s\n", lua_tostring(mState, -1));
+        lua_pop(mState, 1);
+
+        release(index);
+        BELL_TRAP;
+    }
+}
+
+
+void ScriptScheduler::release(const uint32_t index)
+{
+    Coroutine& coroutine = mCoroutines[index];
+
+    mThreadIndices.erase(coroutine.mThread);
+    luaL_unref(mState, LUA_REGISTRYINDEX, coroutine.mRef);
+
+    // Cancelled while waiting on an event, don't leave it queued until the event fires.
+    if(!coroutine.mWaitingEvent.empty())
+    {
+        auto waiters = mEventWaiters.find(coroutine.mWaitingEvent);
+        if(waiters != mEventWaiters.end())
+        {
+            const uint64_t handle = (static_cast<uint64_t>(coroutine.mGeneration) << 32) | index;
+            std::vector<uint64_t>& handles = waiters->second;
+            handles.erase(std::remove(handles.begin(), handles.end(), handle), handles.end());
+            if(handles.empty())
+                mEventWaiters.erase(waiters);
+        }
+        coroutine.mWaitingEvent.clear();
+    }
+
+    // Bumping the generation invalidates any timers or event waits still pointing at it.
+    coroutine.mThread = nullptr;
+    coroutine.mRef = LUA_NOREF;
+    coroutine.mWaiting = false;
+    coroutine.mCancelled = false;
+    ++coroutine.mGeneration;
+
+    mFreeCoroutines.push_back(index);
+    --mActiveCount;
+}
+
+
+ScriptScheduler* ScriptScheduler::getScheduler(lua_State* L)
+{
+    return static_cast<ScriptScheduler*>(lua_touserdata(L, lua_upvalueindex(1)));
+}
+
+
+// spawn(f, ...) -> handle
+int ScriptScheduler::lua_spawn(lua_State* L)
+{
+    luaL_checktype(L, 1, LUA_TFUNCTION);
+
+    ScriptScheduler* scheduler = getScheduler(L);
+    const uint64_t handle = scheduler->spawn(L, lua_gettop(L) - 1);
+
+    lua_pushinteger(L, static_cast<lua_Integer>(handle));
+    return 1;
+}
+
+
+// cancel(handle)
+int ScriptScheduler::lua_cancel(lua_State* L)
+{
+    getScheduler(L)->cancel(static_cast<uint64_t>(luaL_checkinteger(L, 1)));
+    return 0;
+}
+
+
+// wait(seconds)
+int ScriptScheduler::lua_wait(lua_State* L)
+{
+    ScriptScheduler* scheduler = getScheduler(L);
+    const lua_Number seconds = luaL_checknumber(L, 1);
+
+    const uint64_t handle = scheduler->getRunningHandle(L);
+    if(handle == kInvalidHandle)
+        return luaL_error(L, "wait can only be called from a coroutine started with spawn");
+
+    const uint64_t milliseconds = static_cast<uint64_t>(std::max(std::ceil(seconds * 1000.0), 1.0));
+    scheduler->mTimeWheel.schedule(scheduler->mTimeWheel.getCurrentTick() + milliseconds, handle);
+    scheduler->mCoroutines[getIndex(handle)].mWaiting = true;
+
+    return lua_yield(L, 0);
+}
+
+
+// waitFrames(n)
+int ScriptScheduler::lua_waitFrames(lua_State* L)
+{
+    ScriptScheduler* scheduler = getScheduler(L);
+    const lua_Integer frames = luaL_checkinteger(L, 1);
+
+    const uint64_t handle = scheduler->getRunningHandle(L);
+    if(handle == kInvalidHandle)
+        return luaL_error(L, "waitFrames can only be called from a coroutine started with spawn");
+
+    scheduler->mFrameWheel.schedule(scheduler->mFrameWheel.getCurrentTick() + std::max<lua_Integer>(frames, 1), handle);
+    scheduler->mCoroutines[getIndex(handle)].mWaiting = true;
+
+    return lua_yield(L, 0);
+}
+
+
+// waitEvent(name) -> data passed to signalEvent
+int ScriptScheduler::lua_waitEvent(lua_State* L)
+{
+    ScriptScheduler* scheduler = getScheduler(L);
+    const char* name = luaL_checkstring(L, 1);
+
+    const uint64_t handle = scheduler->getRunningHandle(L);
+    if(handle == kInvalidHandle)
+        return luaL_error(L, "waitEvent can only be called from a coroutine started with spawn");
+
+    scheduler->mEventWaiters[name].push_back(handle);
+    scheduler->mCoroutines[getIndex(handle)].mWaiting = true;
+    scheduler->mCoroutines[getIndex(handle)].mWaitingEvent = name;
+
+    return lua_yield(L, 0);
+}
+
+
+// signalEvent(name, [data])
+int ScriptScheduler::lua_signalEvent(lua_State* L)
+{
+    const char* name = luaL_checkstring(L, 1);
+    const lua_Integer data = luaL_optinteger(L, 2, 0);
+
+    getScheduler(L)->signalEvent(name, data);
+    return 0;
+}
+
+}
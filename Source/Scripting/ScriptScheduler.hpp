@@ -0,0 +1,103 @@
+#ifndef SCRIPT_SCHEDULER_HPP
+#define SCRIPT_SCHEDULER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lua.hpp"
+#include "TimerWheel.hpp"
+
+namespace Tempest
+{
+
+// Runs lua functions as coroutines that sleep until they are due. Exposes
+// spawn/cancel/wait/waitFrames/waitEvent/signalEvent to scripts, a waiting
+// coroutine costs nothing until its timer or event fires.
+class ScriptScheduler
+{
+public:
+    ScriptScheduler(lua_State*);
+    ~ScriptScheduler();
+
+    // Expects the function and nargs arguments on top of L, runs until the
+    // first wait. Returns kInvalidHandle, having popped them, if the new
+    // thread can't fit the arguments.
+    uint64_t spawn(lua_State* L, const int nargs);
+    void cancel(const uint64_t handle);
+
+    // Wakes everything waiting on name, data is returned from waitEvent.
+    void signalEvent(const std::string& name, const int64_t data);
+
+    // Resumes everything that's due this frame.
+    void update(const std::chrono::microseconds delta);
+
+    uint32_t getActiveCount() const
+    {
+        return mActiveCount;
+    }
+
+    static constexpr uint64_t kInvalidHandle = ~0ull;
+
+private:
+
+    static int lua_spawn(lua_State*);
+    static int lua_cancel(lua_State*);
+    static int lua_wait(lua_State*);
+    static int lua_waitFrames(lua_State*);
+    static int lua_waitEvent(lua_State*);
+    static int lua_signalEvent(lua_State*);
+
+    static ScriptScheduler* getScheduler(lua_State*);
+
+    lua_State* getThread(const uint64_t handle) const;
+    uint64_t getRunningHandle(lua_State*) const;
+    // Arguments are expected on the coroutines stack already.
+    void resume(const uint64_t handle, const int nargs, lua_State* from);
+    void release(const uint32_t index);
+
+    static uint32_t getIndex(const uint64_t handle)
+    {
+        return static_cast<uint32_t>(handle);
+    }
+
+    static uint32_t getGeneration(const uint64_t handle)
+    {
+        return static_cast<uint32_t>(handle >> 32);
+    }
+
+    struct Coroutine
+    {
+        lua_State* mThread = nullptr;
+        int mRef = LUA_NOREF;
+        uint32_t mGeneration = 0;
+        // Set by the wait functions so a bare coroutine.yield can be told apart.
+        bool mWaiting = false;
+        bool mRunning = false;
+        bool mCancelled = false;
+        // Event it's in mEventWaiters for, if any.
+        std::string mWaitingEvent;
+    };
+
+    lua_State* mState;
+
+    std::vector<Coroutine> mCoroutines;
+    std::vector<uint32_t> mFreeCoroutines;
+    std::unordered_map<lua_State*, uint32_t> mThreadIndices;
+    uint32_t mActiveCount;
+
+    // Milliseconds for wait, frames for waitFrames.
+    TimerWheel mTimeWheel;
+    TimerWheel mFrameWheel;
+    std::chrono::microseconds mTime;
+
+    std::unordered_map<std::string, std::vector<uint64_t>> mEventWaiters;
+    std::vector<std::pair<uint64_t, int64_t>> mSignalled;
+    std::vector<uint64_t> mDue;
+};
+
+}
+
+#endif
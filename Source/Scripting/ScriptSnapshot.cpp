@@ -0,0 +1,624 @@
+#include "ScriptSnapshot.hpp"
+
+#include "Core/BellLogging.hpp"
+
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Tempest
+{
+
+namespace
+{
+    enum class Tag : uint8_t
+    {
+        Nil,
+        False,
+        True,
+        Integer,
+        Number,
+        String,
+        Table,
+        // A table that was already written, by order of appearance.
+        TableReference,
+        Global,
+        Upvalue,
+        End
+    };
+
+    // Cyclic tables are handled by references, this only stops runaway nesting.
+    constexpr uint32_t kMaxDepth = 32;
+
+    // Stack slots each table level needs on top of its parents.
+    constexpr int kWriteSlots = 3;
+    constexpr int kReadSlots = 6;
+
+    const char* kLibraries[] = {"_G", "package", "coroutine", "table", "io", "os", "string", "math", "utf8", "debug"};
+
+    bool isLibrary(const char* name)
+    {
+        for(const char* library : kLibraries)
+        {
+            if(strcmp(name, library) == 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    // The global table and the libraries, never saved or refilled.
+    std::unordered_set<const void*> findOpaqueTables(lua_State* L)
+    {
+        std::unordered_set<const void*> tables;
+
+        lua_pushglobaltable(L);
+        tables.insert(lua_topointer(L, -1));
+        lua_pop(L, 1);
+
+        for(const char* library : kLibraries)
+        {
+            if(lua_getglobal(L, library) == LUA_TTABLE)
+                tables.insert(lua_topointer(L, -1));
+            lua_pop(L, 1);
+        }
+
+        return tables;
+    }
+
+    bool isKey(lua_State* L, const int index)
+    {
+        const int type = lua_type(L, index);
+        return type == LUA_TBOOLEAN || type == LUA_TNUMBER || type == LUA_TSTRING;
+    }
+
+    bool isData(lua_State* L, const int index, const std::unordered_set<const void*>& opaque)
+    {
+        const int type = lua_type(L, index);
+        if(type == LUA_TTABLE)
+            return opaque.find(lua_topointer(L, index)) == opaque.end();
+
+        return type == LUA_TNIL || isKey(L, index);
+    }
+
+
+    class Writer
+    {
+    public:
+        Writer(lua_State* L, std::vector<uint8_t>& data) :
+            mState(L),
+            mData(data),
+            mOpaque(findOpaqueTables(L)),
+            mFailed(false) {}
+
+        void writeTag(const Tag tag)
+        {
+            mData.push_back(static_cast<uint8_t>(tag));
+        }
+
+        void writeString(const char* str, const size_t length)
+        {
+            const uint32_t size = static_cast<uint32_t>(length);
+            write(&size, sizeof(uint32_t));
+            write(str, length);
+        }
+
+        void write(const void* data, const size_t size)
+        {
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            mData.insert(mData.end(), bytes, bytes + size);
+        }
+
+        bool isData(const int index) const
+        {
+            return Tempest::isData(mState, index, mOpaque);
+        }
+
+        // Ran out of lua stack, what was written is incomplete.
+        bool hasFailed() const
+        {
+            return mFailed;
+        }
+
+        void writeValue(int index, const uint32_t depth)
+        {
+            lua_State* L = mState;
+            index = lua_absindex(L, index);
+
+            switch(lua_type(L, index))
+            {
+                case LUA_TBOOLEAN:
+                    writeTag(lua_toboolean(L, index) ? Tag::True : Tag::False);
+                    break;
+
+                case LUA_TNUMBER:
+                {
+                    if(lua_isinteger(L, index))
+                    {
+                        const lua_Integer value = lua_tointeger(L, index);
+                        writeTag(Tag::Integer);
+                        write(&value, sizeof(lua_Integer));
+                    }
+                    else
+                    {
+                        const lua_Number value = lua_tonumber(L, index);
+                        writeTag(Tag::Number);
+                        write(&value, sizeof(lua_Number));
+                    }
+                    break;
+                }
+
+                case LUA_TSTRING:
+                {
+                    size_t length = 0;
+                    const char* str = lua_tolstring(L, index, &length);
+                    writeTag(Tag::String);
+                    writeString(str, length);
+                    break;
+                }
+
+                case LUA_TTABLE:
+                {
+                    if(depth >= kMaxDepth)
+                    {
+                        writeTag(Tag::Nil);
+                        break;
+                    }
+
+                    if(mFailed || !lua_checkstack(L, kWriteSlots))
+                    {
+                        mFailed = true;
+                        writeTag(Tag::Nil);
+                        break;
+                    }
+
+                    const void* table = lua_topointer(L, index);
+                    if(auto it = mTables.find(table); it != mTables.end())
+                    {
+                        writeTag(Tag::TableReference);
+                        write(&it->second, sizeof(uint32_t));
+                        break;
+                    }
+
+                    mTables.insert({table, static_cast<uint32_t>(mTables.size())});
+                    writeTag(Tag::Table);
+
+                    lua_pushnil(L);
+                    while(lua_next(L, index))
+                    {
+                        if(isKey(L, -2) && isData(-1))
+                        {
+                            writeValue(-2, depth + 1);
+                            writeValue(-1, depth + 1);
+                        }
+                        lua_pop(L, 1);
+                    }
+                    writeTag(Tag::End);
+                    break;
+                }
+
+                default:
+                    writeTag(Tag::Nil);
+                    break;
+            }
+        }
+
+    private:
+        lua_State* mState;
+        std::vector<uint8_t>& mData;
+        std::unordered_set<const void*> mOpaque;
+        std::unordered_map<const void*, uint32_t> mTables;
+        bool mFailed;
+    };
+
+
+    class Reader
+    {
+    public:
+        Reader(lua_State* L, const std::vector<uint8_t>& data) :
+            mState(L),
+            mData(data),
+            mOffset(0),
+            mTableCount(0),
+            mOpaque(findOpaqueTables(L)),
+            mFailed(false)
+        {
+            // Restored tables by reference index.
+            lua_newtable(L);
+            mTables = lua_gettop(L);
+        }
+
+        ~Reader()
+        {
+            lua_remove(mState, mTables);
+        }
+
+        Tag peekTag() const
+        {
+            BELL_ASSERT(mOffset < mData.size(), "Truncated script snapshot")
+            return static_cast<Tag>(mData[mOffset]);
+        }
+
+        Tag readTag()
+        {
+            const Tag tag = peekTag();
+            ++mOffset;
+            return tag;
+        }
+
+        void read(void* data, const size_t size)
+        {
+            BELL_ASSERT(mOffset + size <= mData.size(), "Truncated script snapshot")
+            memcpy(data, mData.data() + mOffset, size);
+            mOffset += size;
+        }
+
+        std::string readString()
+        {
+            uint32_t size = 0;
+            read(&size, sizeof(uint32_t));
+
+            std::string str(size, '\0');
+            read(str.data(), size);
+            return str;
+        }
+
+        bool isData(const int index) const
+        {
+            return Tempest::isData(mState, index, mOpaque);
+        }
+
+        // Some tables were nested too deep to restore and were left out.
+        bool hasFailed() const
+        {
+            return mFailed;
+        }
+
+        // Pushes the next value. If target (0 for none) is a table that can
+        // be reused it's refilled rather than replaced.
+        void readValue(const int target, const uint32_t depth = 0)
+        {
+            lua_State* L = mState;
+
+            switch(readTag())
+            {
+                case Tag::False:
+                    lua_pushboolean(L, false);
+                    break;
+
+                case Tag::True:
+                    lua_pushboolean(L, true);
+                    break;
+
+                case Tag::Integer:
+                {
+                    lua_Integer value;
+                    read(&value, sizeof(lua_Integer));
+                    lua_pushinteger(L, value);
+                    break;
+                }
+
+                case Tag::Number:
+                {
+                    lua_Number value;
+                    read(&value, sizeof(lua_Number));
+                    lua_pushnumber(L, value);
+                    break;
+                }
+
+                case Tag::String:
+                {
+                    const std::string str = readString();
+                    lua_pushlstring(L, str.data(), str.size());
+                    break;
+                }
+
+                case Tag::TableReference:
+                {
+                    uint32_t reference = 0;
+                    read(&reference, sizeof(uint32_t));
+                    lua_rawgeti(L, mTables, static_cast<lua_Integer>(reference) + 1);
+                    break;
+                }
+
+                case Tag::Table:
+                {
+                    if(depth >= kMaxDepth || !lua_checkstack(L, kReadSlots))
+                    {
+                        mFailed = true;
+                        skipTable();
+                        lua_pushnil(L);
+                        break;
+                    }
+
+                    readTable(target, depth);
+                    break;
+                }
+
+                default:
+                    lua_pushnil(L);
+                    break;
+            }
+        }
+
+    private:
+
+        // Steps over a table without pushing anything, keeps the rest of the data readable.
+        // Skipped tables still take a reference index, like they did when written, their
+        // slot is just left empty so later references to them read back as nil.
+        void skipTable()
+        {
+            ++mTableCount;
+            for(uint32_t open = 1; open > 0;)
+            {
+                switch(readTag())
+                {
+                    case Tag::Integer:
+                    {
+                        lua_Integer value;
+                        read(&value, sizeof(lua_Integer));
+                        break;
+                    }
+
+                    case Tag::Number:
+                    {
+                        lua_Number value;
+                        read(&value, sizeof(lua_Number));
+                        break;
+                    }
+
+                    case Tag::String:
+                        readString();
+                        break;
+
+                    case Tag::TableReference:
+                    {
+                        uint32_t reference;
+                        read(&reference, sizeof(uint32_t));
+                        break;
+                    }
+
+                    case Tag::Table:
+                        ++mTableCount;
+                        ++open;
+                        break;
+
+                    case Tag::End:
+                        --open;
+                        break;
+
+                    default:
+                        break;
+                }
+            }
+        }
+
+        void readTable(const int target, const uint32_t depth)
+        {
+            lua_State* L = mState;
+
+            const bool reuse = target != 0 && lua_type(L, target) == LUA_TTABLE && isData(target) &&
+                               mReused.insert(lua_topointer(L, target)).second;
+            if(reuse)
+                lua_pushvalue(L, target);
+            else
+                lua_newtable(L);
+
+            const int table = lua_gettop(L);
+            lua_pushvalue(L, table);
+            lua_rawseti(L, mTables, static_cast<lua_Integer>(mTableCount++) + 1);
+
+            // Keys that were restored, anything else holding data gets cleared after.
+            lua_newtable(L);
+            const int restored = lua_gettop(L);
+
+            while(peekTag() != Tag::End)
+            {
+                readValue(0, depth + 1);
+                const int key = lua_gettop(L);
+
+                lua_pushvalue(L, key);
+                lua_rawget(L, table);
+                readValue(key + 1, depth + 1);
+                lua_remove(L, key + 1);
+
+                lua_pushvalue(L, key);
+                lua_pushboolean(L, true);
+                lua_rawset(L, restored);
+
+                lua_rawset(L, table);
+            }
+            readTag();
+
+            if(reuse)
+            {
+                lua_pushnil(L);
+                while(lua_next(L, table))
+                {
+                    bool stale = false;
+                    if(isData(-1))
+                    {
+                        lua_pushvalue(L, -2);
+                        stale = lua_rawget(L, restored) == LUA_TNIL;
+                        lua_pop(L, 1);
+                    }
+                    lua_pop(L, 1);
+
+                    // Clearing fields mid traversal is allowed.
+                    if(stale)
+                    {
+                        lua_pushvalue(L, -1);
+                        lua_pushnil(L);
+                        lua_rawset(L, table);
+                    }
+                }
+            }
+
+            lua_pop(L, 1);
+        }
+
+        lua_State* mState;
+        const std::vector<uint8_t>& mData;
+        size_t mOffset;
+
+        int mTables;
+        uint32_t mTableCount;
+        std::unordered_set<const void*> mOpaque;
+        std::unordered_set<const void*> mReused;
+        bool mFailed;
+    };
+}
+
+
+void ScriptSnapshot::save(lua_State* L)
+{
+    // Written to the side so a failed save keeps the last good snapshot.
+    std::vector<uint8_t> data;
+    Writer writer(L, data);
+    const int top = lua_gettop(L);
+
+    // Functions share upvalues, only write each one once.
+    std::unordered_set<void*> upvalues;
+
+    lua_pushglobaltable(L);
+    const int globals = lua_gettop(L);
+
+    lua_pushnil(L);
+    while(lua_next(L, globals))
+    {
+        if(lua_type(L, -2) != LUA_TSTRING)
+        {
+            lua_pop(L, 1);
+            continue;
+        }
+
+        size_t nameLength = 0;
+        const char* name = lua_tolstring(L, -2, &nameLength);
+        if(isLibrary(name))
+        {
+            lua_pop(L, 1);
+            continue;
+        }
+
+        if(lua_isfunction(L, -1) && !lua_iscfunction(L, -1))
+        {
+            const int function = lua_gettop(L);
+            for(int i = 1; const char* upvalueName = lua_getupvalue(L, function, i); ++i)
+            {
+                const bool environment = strcmp(upvalueName, "_ENV") == 0;
+                if(!environment && writer.isData(-1) && upvalues.insert(lua_upvalueid(L, function, i)).second)
+                {
+                    const int32_t index = i;
+                    writer.writeTag(Tag::Upvalue);
+                    writer.writeString(name, nameLength);
+                    writer.write(&index, sizeof(int32_t));
+                    writer.writeValue(-1, 0);
+                }
+                lua_pop(L, 1);
+            }
+        }
+        else if(writer.isData(-1))
+        {
+            writer.writeTag(Tag::Global);
+            writer.writeString(name, nameLength);
+            writer.writeValue(-1, 0);
+        }
+
+        lua_pop(L, 1);
+
+        if(writer.hasFailed())
+        {
+            BELL_LOG_ARGS("Out of lua stack saving script snapshot, keeping the previous one");
+            lua_settop(L, top);
+            return;
+        }
+    }
+    lua_pop(L, 1);
+
+    writer.writeTag(Tag::End);
+    mData = std::move(data);
+}
+
+
+void ScriptSnapshot::restore(lua_State* L) const
+{
+    if(mData.empty())
+        return;
+
+    // Reserve for the deepest nesting the writer allows before touching
+    // anything, so running out of stack can't leave a half restored state.
+    if(!lua_checkstack(L, static_cast<int>(kMaxDepth + 1) * kReadSlots + 8))
+    {
+        BELL_LOG_ARGS("Out of lua stack restoring script snapshot, skipping it");
+        return;
+    }
+
+    const std::unordered_set<const void*> opaque = findOpaqueTables(L);
+
+    // Data globals that exist now, whatever isn't restored gets cleared.
+    std::unordered_set<std::string> added;
+    lua_pushglobaltable(L);
+    lua_pushnil(L);
+    while(lua_next(L, -2))
+    {
+        if(lua_type(L, -2) == LUA_TSTRING && isData(L, -1, opaque))
+        {
+            const char* name = lua_tostring(L, -2);
+            if(!isLibrary(name))
+                added.insert(name);
+        }
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+
+    {
+        Reader reader(L, mData);
+        for(Tag tag = reader.readTag(); tag != Tag::End; tag = reader.readTag())
+        {
+            const std::string name = reader.readString();
+
+            if(tag == Tag::Global)
+            {
+                lua_getglobal(L, name.c_str());
+                reader.readValue(lua_gettop(L));
+                lua_remove(L, -2);
+                lua_setglobal(L, name.c_str());
+
+                added.erase(name);
+                continue;
+            }
+
+            int32_t index = 0;
+            reader.read(&index, sizeof(int32_t));
+
+            lua_getglobal(L, name.c_str());
+            const int function = lua_gettop(L);
+            const bool found = lua_isfunction(L, function) && !lua_iscfunction(L, function) && lua_getupvalue(L, function, index);
+            if(found)
+            {
+                reader.readValue(lua_gettop(L));
+                lua_remove(L, -2);
+                lua_setupvalue(L, function, index);
+            }
+            else
+            {
+                // Function was redefined or removed, still have to skip the value.
+                reader.readValue(0);
+                lua_pop(L, 1);
+            }
+            lua_pop(L, 1);
+        }
+
+        if(reader.hasFailed())
+            BELL_LOG_ARGS("Script snapshot nested too deep, some tables were left empty");
+    }
+
+    for(const std::string& name : added)
+    {
+        lua_pushnil(L);
+        lua_setglobal(L, name.c_str());
+    }
+}
+
+}
@@ -0,0 +1,39 @@
+#ifndef SCRIPT_SNAPSHOT_HPP
+#define SCRIPT_SNAPSHOT_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "lua.hpp"
+
+namespace Tempest
+{
+
+// Copy of the data scripts keep between frames: globals holding numbers,
+// strings, booleans or tables of them, plus the upvalues of global lua
+// functions since that's where file level locals end up. Functions, userdata,
+// coroutines and the standard libraries are left out, as are metatables.
+class ScriptSnapshot
+{
+public:
+
+    void save(lua_State*);
+
+    // Tables still around are refilled in place so anything else holding on
+    // to them sees the restored contents. Data globals added since the save
+    // get cleared.
+    void restore(lua_State*) const;
+
+    size_t getSize() const
+    {
+        return mData.size();
+    }
+
+private:
+
+    std::vector<uint8_t> mData;
+};
+
+}
+
+#endif
@@ -0,0 +1,76 @@
+#include "ScriptThrottle.hpp"
+
+namespace Tempest
+{
+
+ScriptThrottle::ScriptThrottle() :
+    mFarInterval(0),
+    mFrame(0),
+    mTime(0),
+    mSkipped(0),
+    mSkippedLastFrame(0)
+{
+}
+
+
+void ScriptThrottle::setRelevance(RelevanceFunction relevance, const uint32_t farInterval)
+{
+    mRelevance = std::move(relevance);
+    mFarInterval = farInterval;
+    reset();
+}
+
+
+void ScriptThrottle::beginFrame(const std::chrono::microseconds delta)
+{
+    ++mFrame;
+    mTime += delta;
+    mSkippedLastFrame = mSkipped;
+    mSkipped = 0;
+}
+
+
+bool ScriptThrottle::shouldRun(const int64_t entity, std::chrono::microseconds& delta)
+{
+    if(!isEnabled())
+        return true;
+
+    auto it = mEntries.find(entity);
+    if(!mRelevance(entity) && (mFrame + static_cast<uint64_t>(entity)) % mFarInterval != 0)
+    {
+        if(it == mEntries.end())
+            mEntries.insert({entity, {mTime - delta, delta, mFrame - 1}});
+
+        ++mSkipped;
+        return false;
+    }
+
+    if(it != mEntries.end())
+    {
+        Entry& entry = it->second;
+        if(entry.mFrame != mFrame)
+        {
+            entry.mDelta = mTime - entry.mLastRun;
+            entry.mLastRun = mTime;
+            entry.mFrame = mFrame;
+        }
+
+        delta = entry.mDelta;
+    }
+
+    return true;
+}
+
+
+void ScriptThrottle::reset()
+{
+    mEntries.clear();
+}
+
+
+void ScriptThrottle::removeEntity(const int64_t entity)
+{
+    mEntries.erase(entity);
+}
+
+}
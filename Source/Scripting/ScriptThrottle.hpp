@@ -0,0 +1,70 @@
+#ifndef SCRIPT_THROTTLE_HPP
+#define SCRIPT_THROTTLE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+namespace Tempest
+{
+
+// Lets component scripts on entities nobody is near tick every few frames
+// instead of every frame. The frames an entity sits out are added up and
+// handed over as its delta when it does run, so timers in scripts still see
+// real time. Far entities are staggered by handle so they don't all land on
+// the same frame. Every script on an entity makes the same call each frame.
+class ScriptThrottle
+{
+public:
+    using RelevanceFunction = std::function<bool(const int64_t entity)>;
+
+    ScriptThrottle();
+
+    // An interval of 1 or less turns throttling off.
+    void setRelevance(RelevanceFunction, const uint32_t farInterval);
+
+    bool isEnabled() const
+    {
+        return mFarInterval > 1 && mRelevance;
+    }
+
+    void beginFrame(const std::chrono::microseconds delta);
+
+    // False if the entity skips this frame, otherwise delta is set to the time
+    // since it last ran.
+    bool shouldRun(const int64_t entity, std::chrono::microseconds& delta);
+
+    uint32_t getSkippedLastFrame() const
+    {
+        return mSkippedLastFrame;
+    }
+
+    // Forget accumulated time, when entities go away or state is restored.
+    void reset();
+    void removeEntity(const int64_t entity);
+
+private:
+
+    struct Entry
+    {
+        std::chrono::microseconds mLastRun;
+        std::chrono::microseconds mDelta;
+        uint64_t mFrame;
+    };
+
+    RelevanceFunction mRelevance;
+    uint32_t mFarInterval;
+    uint64_t mFrame;
+    std::chrono::microseconds mTime;
+
+    // Only entities that have been far at some point.
+    std::unordered_map<int64_t, Entry> mEntries;
+
+    uint32_t mSkipped;
+    uint32_t mSkippedLastFrame;
+};
+
+}
+
+#endif
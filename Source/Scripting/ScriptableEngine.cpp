@@ -2,6 +2,8 @@
 #include "ScriptEngine.hpp"
 #include "Controller.hpp"
 
+#include <cstring>
+
 namespace Tempest
 {
     LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, getInstancePosition)
@@ -16,7 +18,7 @@ namespace Tempest
 
     LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, terminateAnimation)
 
-    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, getInstanceIDByName)
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, getInstanceHandle)
 
     LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, getSceneIDByName)
 
@@ -58,23 +60,109 @@ namespace Tempest
 
     LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, setInstanceLinearVelocity)
 
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, getAnimationClipHandle)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, startAnimationClip)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, terminateAnimationClip)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, getAnimationParameterHandle)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, setAnimationFloatParameter)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, setAnimationIntParameter)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, getAnimationStateHandle)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, getCurrentAnimationState)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, captureProfile)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, setProfilerHitchThreshold)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, startScriptProfiling)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, getScriptHeapSize)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, getScriptGarbageCollectionPause)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, setScriptGarbageCollectionBudget)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, setScriptFrameBudget)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, getScriptThrottleCount)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, getCameraHandle)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, setMainCamera)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, setShadowCamera)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, attachCameraHandleToPlayer)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, attachShadowCameraHandleToPlayer)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, getCameraDirection)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, getCameraRight)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, getCameraPosition)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, writeSystemGraph)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, randomFloat)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, randomInt)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, startInputRecording)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, stopInputRecording)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, saveSnapshot)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, restoreSnapshot)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, replicateInstance)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, setReplicatedValue)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, getReplicatedValue)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, setInterestRadius)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, setFarScriptInterval)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, spawnBots)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, setBotInput)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, startBotLoadTest)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, logFrameStatistics)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, setFrameRateLimit)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, setDeltaSmoothing)
+
+    LUA_SCRIPT_HOOK_DEFINITION(TempestEngine, getHitchCount)
+
     void registerEngineLuaHooks(ScriptEngine *scriptEngine, TempestEngine *engine)
     {
         CallablesRegistrar *registrar = scriptEngine->createCallablesRegistrar();
 
-        LUA_REGISTER_HOOK(TempestEngine, getInstancePosition, engine, InstanceID)
+        LUA_REGISTER_HOOK(TempestEngine, getInstancePosition, engine, InstanceHandle)
 
-        LUA_REGISTER_HOOK(TempestEngine, setInstancePosition, engine, InstanceID, float3)
+        LUA_REGISTER_HOOK(TempestEngine, setInstancePosition, engine, InstanceHandle, float3)
 
-        LUA_REGISTER_HOOK(TempestEngine, setInstanceRotation, engine, InstanceID, quat)
+        LUA_REGISTER_HOOK(TempestEngine, setInstanceRotation, engine, InstanceHandle, quat)
 
-        LUA_REGISTER_HOOK(TempestEngine, translateInstance, engine, InstanceID, float3)
+        LUA_REGISTER_HOOK(TempestEngine, translateInstance, engine, InstanceHandle, float3)
 
-        LUA_REGISTER_HOOK(TempestEngine, startAnimation, engine, InstanceID, std::string, bool, float)
+        LUA_REGISTER_HOOK(TempestEngine, startAnimation, engine, InstanceHandle, std::string, bool, float)
 
-        LUA_REGISTER_HOOK(TempestEngine, terminateAnimation, engine, InstanceID, std::string)
+        LUA_REGISTER_HOOK(TempestEngine, terminateAnimation, engine, InstanceHandle, std::string)
 
-        LUA_REGISTER_HOOK(TempestEngine, getInstanceIDByName, engine, std::string)
+        LUA_REGISTER_HOOK(TempestEngine, getInstanceHandle, engine, std::string)
 
         LUA_REGISTER_HOOK(TempestEngine, getSceneIDByName, engine, std::string)
 
@@ -82,25 +170,25 @@ namespace Tempest
 
         LUA_REGISTER_HOOK(TempestEngine, setShadowCameraByName, engine, std::string)
 
-        LUA_REGISTER_HOOK(TempestEngine, createPlayerInstance, engine, InstanceID, float3, float3)
+        LUA_REGISTER_HOOK(TempestEngine, createPlayerInstance, engine, InstanceHandle, float3, float3)
 
-        LUA_REGISTER_HOOK(TempestEngine, getControllerForInstance, engine, InstanceID)
+        LUA_REGISTER_HOOK(TempestEngine, getControllerForInstance, engine, InstanceHandle)
 
-        LUA_REGISTER_HOOK(TempestEngine, attachCameraToPlayer, engine, InstanceID, std::string, float)
+        LUA_REGISTER_HOOK(TempestEngine, attachCameraToPlayer, engine, InstanceHandle, std::string, float)
 
-        LUA_REGISTER_HOOK(TempestEngine, attachShadowCameraToPlayer, engine, InstanceID, std::string)
+        LUA_REGISTER_HOOK(TempestEngine, attachShadowCameraToPlayer, engine, InstanceHandle, std::string)
 
-        LUA_REGISTER_HOOK(TempestEngine, createControllerInstance, engine, InstanceID, uint32_t)
+        LUA_REGISTER_HOOK(TempestEngine, createControllerInstance, engine, InstanceHandle, uint32_t)
 
-        LUA_REGISTER_HOOK(TempestEngine, updateControllerInstance, engine, InstanceID)
+        LUA_REGISTER_HOOK(TempestEngine, updateControllerInstance, engine, InstanceHandle)
 
-        LUA_REGISTER_HOOK(TempestEngine, getPhysicsBodyPosition, engine, InstanceID)
+        LUA_REGISTER_HOOK(TempestEngine, getPhysicsBodyPosition, engine, InstanceHandle)
 
-        LUA_REGISTER_HOOK(TempestEngine, applyImpulseToInstance, engine, InstanceID, float3)
+        LUA_REGISTER_HOOK(TempestEngine, applyImpulseToInstance, engine, InstanceHandle, float3)
 
-        LUA_REGISTER_HOOK(TempestEngine, setGraphicsInstancePosition, engine, InstanceID, float3)
+        LUA_REGISTER_HOOK(TempestEngine, setGraphicsInstancePosition, engine, InstanceHandle, float3)
 
-        LUA_REGISTER_HOOK(TempestEngine, updatePlayersAttachedCameras, engine, InstanceID)
+        LUA_REGISTER_HOOK(TempestEngine, updatePlayersAttachedCameras, engine, InstanceHandle)
 
         LUA_REGISTER_HOOK(TempestEngine, getCameraDirectionByName, engine, std::string)
 
@@ -108,26 +196,193 @@ namespace Tempest
 
         LUA_REGISTER_HOOK(TempestEngine, getCameraRightByName, engine, std::string)
 
-        LUA_REGISTER_HOOK(TempestEngine, getInstanceSize, engine, InstanceID)
+        LUA_REGISTER_HOOK(TempestEngine, getInstanceSize, engine, InstanceHandle)
+
+        LUA_REGISTER_HOOK(TempestEngine, getInstanceCenter, engine, InstanceHandle)
+
+        LUA_REGISTER_HOOK(TempestEngine, startInstanceFrame, engine, InstanceHandle)
+
+        LUA_REGISTER_HOOK(TempestEngine, setInstanceLinearVelocity, engine, InstanceHandle, float3)
 
-        LUA_REGISTER_HOOK(TempestEngine, getInstanceCenter, engine, InstanceID)
+        LUA_REGISTER_HOOK(TempestEngine, getAnimationClipHandle, engine, std::string)
 
-        LUA_REGISTER_HOOK(TempestEngine, startInstanceFrame, engine, InstanceID)
+        LUA_REGISTER_HOOK(TempestEngine, startAnimationClip, engine, InstanceHandle, uint64_t, bool, float)
 
-        LUA_REGISTER_HOOK(TempestEngine, setInstanceLinearVelocity, engine, InstanceID, float3)
+        LUA_REGISTER_HOOK(TempestEngine, terminateAnimationClip, engine, InstanceHandle, uint64_t)
+
+        LUA_REGISTER_HOOK(TempestEngine, getAnimationParameterHandle, engine, InstanceHandle, std::string)
+
+        LUA_REGISTER_HOOK(TempestEngine, setAnimationFloatParameter, engine, InstanceHandle, uint32_t, float)
+
+        LUA_REGISTER_HOOK(TempestEngine, setAnimationIntParameter, engine, InstanceHandle, uint32_t, int)
+
+        LUA_REGISTER_HOOK(TempestEngine, getAnimationStateHandle, engine, InstanceHandle, std::string)
+
+        LUA_REGISTER_HOOK(TempestEngine, getCurrentAnimationState, engine, InstanceHandle)
+
+        LUA_REGISTER_HOOK(TempestEngine, captureProfile, engine, std::string, uint32_t)
+
+        LUA_REGISTER_HOOK(TempestEngine, setProfilerHitchThreshold, engine, uint32_t)
+
+        LUA_REGISTER_HOOK(TempestEngine, startScriptProfiling, engine, uint32_t, uint32_t)
+
+        LUA_REGISTER_HOOK(TempestEngine, getScriptHeapSize, engine)
+
+        LUA_REGISTER_HOOK(TempestEngine, getScriptGarbageCollectionPause, engine)
+
+        LUA_REGISTER_HOOK(TempestEngine, setScriptGarbageCollectionBudget, engine, uint32_t)
+
+        LUA_REGISTER_HOOK(TempestEngine, setScriptFrameBudget, engine, uint32_t)
+
+        LUA_REGISTER_HOOK(TempestEngine, getScriptThrottleCount, engine, std::string)
+
+        LUA_REGISTER_HOOK(TempestEngine, getCameraHandle, engine, std::string)
+
+        LUA_REGISTER_HOOK(TempestEngine, setMainCamera, engine, CameraHandle)
+
+        LUA_REGISTER_HOOK(TempestEngine, setShadowCamera, engine, CameraHandle)
+
+        LUA_REGISTER_HOOK(TempestEngine, attachCameraHandleToPlayer, engine, InstanceHandle, CameraHandle, float)
+
+        LUA_REGISTER_HOOK(TempestEngine, attachShadowCameraHandleToPlayer, engine, InstanceHandle, CameraHandle)
+
+        LUA_REGISTER_HOOK(TempestEngine, getCameraDirection, engine, CameraHandle)
+
+        LUA_REGISTER_HOOK(TempestEngine, getCameraRight, engine, CameraHandle)
+
+        LUA_REGISTER_HOOK(TempestEngine, getCameraPosition, engine, CameraHandle)
+
+        LUA_REGISTER_HOOK(TempestEngine, writeSystemGraph, engine, std::string)
+
+        LUA_REGISTER_HOOK(TempestEngine, randomFloat, engine, float, float)
+
+        LUA_REGISTER_HOOK(TempestEngine, randomInt, engine, int, int)
+
+        LUA_REGISTER_HOOK(TempestEngine, startInputRecording, engine, std::string)
+
+        LUA_REGISTER_HOOK(TempestEngine, stopInputRecording, engine)
+
+        LUA_REGISTER_HOOK(TempestEngine, saveSnapshot, engine, std::string)
+
+        LUA_REGISTER_HOOK(TempestEngine, restoreSnapshot, engine, std::string)
+
+        LUA_REGISTER_HOOK(TempestEngine, replicateInstance, engine, InstanceHandle)
+
+        LUA_REGISTER_HOOK(TempestEngine, setReplicatedValue, engine, InstanceHandle, uint32_t, int)
+
+        LUA_REGISTER_HOOK(TempestEngine, getReplicatedValue, engine, InstanceHandle, uint32_t)
+
+        LUA_REGISTER_HOOK(TempestEngine, setInterestRadius, engine, InstanceHandle, uint32_t)
+
+        LUA_REGISTER_HOOK(TempestEngine, setFarScriptInterval, engine, uint32_t)
+
+        LUA_REGISTER_HOOK(TempestEngine, spawnBots, engine, std::string, uint32_t, float)
+
+        LUA_REGISTER_HOOK(TempestEngine, setBotInput, engine, InstanceHandle, float, float, bool, bool)
+
+        LUA_REGISTER_HOOK(TempestEngine, startBotLoadTest, engine, std::string, uint32_t, uint32_t, uint32_t)
+
+        LUA_REGISTER_HOOK(TempestEngine, logFrameStatistics, engine)
+
+        LUA_REGISTER_HOOK(TempestEngine, setFrameRateLimit, engine, uint32_t)
+
+        LUA_REGISTER_HOOK(TempestEngine, setDeltaSmoothing, engine, float)
+
+        LUA_REGISTER_HOOK(TempestEngine, getHitchCount, engine)
 
         scriptEngine->registerCallables(registrar);
     }
 
+    namespace
+    {
+        const char* kControllerMetatable = "Tempest.Controller";
+        const char* kControllerViews = "Tempest.ControllerViews";
+
+        int controllerIndex(lua_State* L)
+        {
+            const Controller* c = *static_cast<const Controller**>(luaL_checkudata(L, 1, kControllerMetatable));
+            const char* key = luaL_checkstring(L, 2);
+
+            // The controller was deleted.
+            if(!c)
+                lua_pushnil(L);
+            else if(strcmp(key, "Lx") == 0)
+                lua_pushnumber(L, c->getLeftAxisX());
+            else if(strcmp(key, "Ly") == 0)
+                lua_pushnumber(L, c->getLeftAxisY());
+            else if(strcmp(key, "Rx") == 0)
+                lua_pushnumber(L, c->getRightAxisX());
+            else if(strcmp(key, "Ry") == 0)
+                lua_pushnumber(L, c->getRightAxisY());
+            else if(strcmp(key, "LCtl") == 0)
+                lua_pushboolean(L, c->ctrlPressed());
+            else if(strcmp(key, "LShft") == 0)
+                lua_pushboolean(L, c->shftPressed());
+            else if(strcmp(key, "X") == 0)
+                lua_pushboolean(L, c->pressedX());
+            else
+                lua_pushnil(L);
+
+            return 1;
+        }
+
+        int controllerNewIndex(lua_State* L)
+        {
+            return luaL_error(L, "controller state is read only");
+        }
+    }
+
+    // Each controller gets a single userdata view cached in the registry that
+    // reads straight from it, bots have theirs released when they're deleted.
     void pushLuaStack(lua_State *L, const Controller& c)
     {
-        lua_createtable(L, 0, 7);
-        setLuaTableEntry(L, "Lx", c.getLeftAxisX());
-        setLuaTableEntry(L, "Ly", c.getLeftAxisY());
-        setLuaTableEntry(L, "Rx", c.getRightAxisX());
-        setLuaTableEntry(L, "Ry", c.getRightAxisY());
-        setLuaTableEntry(L, "LCtl", c.ctrlPressed());
-        setLuaTableEntry(L, "LShft", c.shftPressed());
-        setLuaTableEntry(L, "X", c.pressedX());
+        if(lua_getfield(L, LUA_REGISTRYINDEX, kControllerViews) != LUA_TTABLE)
+        {
+            lua_pop(L, 1);
+            lua_newtable(L);
+            lua_pushvalue(L, -1);
+            lua_setfield(L, LUA_REGISTRYINDEX, kControllerViews);
+        }
+
+        if(lua_rawgetp(L, -1, &c) != LUA_TUSERDATA)
+        {
+            lua_pop(L, 1);
+
+            const Controller** view = static_cast<const Controller**>(lua_newuserdatauv(L, sizeof(const Controller*), 0));
+            *view = &c;
+
+            if(luaL_newmetatable(L, kControllerMetatable))
+            {
+                lua_pushcfunction(L, controllerIndex);
+                lua_setfield(L, -2, "__index");
+                lua_pushcfunction(L, controllerNewIndex);
+                lua_setfield(L, -2, "__newindex");
+            }
+            lua_setmetatable(L, -2);
+
+            lua_pushvalue(L, -1);
+            lua_rawsetp(L, -3, &c);
+        }
+
+        // Leave just the view.
+        lua_remove(L, -2);
+    }
+
+    void releaseLuaView(lua_State *L, const Controller& c)
+    {
+        if(lua_getfield(L, LUA_REGISTRYINDEX, kControllerViews) != LUA_TTABLE)
+        {
+            lua_pop(L, 1);
+            return;
+        }
+
+        if(lua_rawgetp(L, -1, &c) == LUA_TUSERDATA)
+            *static_cast<const Controller**>(lua_touserdata(L, -1)) = nullptr;
+        lua_pop(L, 1);
+
+        // Another controller could be allocated at the same address.
+        lua_pushnil(L);
+        lua_rawsetp(L, -2, &c);
+        lua_pop(L, 1);
     }
 }
\ No newline at end of file
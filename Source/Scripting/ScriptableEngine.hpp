@@ -20,7 +20,7 @@ namespace Tempest {
 
     LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, terminateAnimation)
 
-    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, getInstanceIDByName)
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, getInstanceHandle)
 
     LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, getSceneIDByName)
 
@@ -64,9 +64,97 @@ namespace Tempest {
 
     LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, setInstanceLinearVelocity)
 
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, getAnimationClipHandle)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, startAnimationClip)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, terminateAnimationClip)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, getAnimationParameterHandle)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, setAnimationFloatParameter)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, setAnimationIntParameter)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, getAnimationStateHandle)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, getCurrentAnimationState)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, captureProfile)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, setProfilerHitchThreshold)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, startScriptProfiling)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, getScriptHeapSize)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, getScriptGarbageCollectionPause)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, setScriptGarbageCollectionBudget)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, setScriptFrameBudget)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, getScriptThrottleCount)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, getCameraHandle)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, setMainCamera)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, setShadowCamera)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, attachCameraHandleToPlayer)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, attachShadowCameraHandleToPlayer)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, getCameraDirection)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, getCameraRight)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, getCameraPosition)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, writeSystemGraph)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, randomFloat)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, randomInt)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, startInputRecording)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, stopInputRecording)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, saveSnapshot)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, restoreSnapshot)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, replicateInstance)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, setReplicatedValue)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, getReplicatedValue)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, setInterestRadius)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, setFarScriptInterval)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, spawnBots)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, setBotInput)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, startBotLoadTest)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, logFrameStatistics)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, setFrameRateLimit)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, setDeltaSmoothing)
+
+    LUA_SCRIPT_HOOK_DECLARATION(TempestEngine, getHitchCount)
+
     void registerEngineLuaHooks(ScriptEngine *eng, TempestEngine *scene);
 
     void pushLuaStack(lua_State *L, const Controller&);
+    // Call before deleting a controller, views scripts still hold read nil after.
+    void releaseLuaView(lua_State *L, const Controller&);
 }
 
 #endif
\ No newline at end of file
@@ -1,180 +1,599 @@
 #include "TempestEngine.hpp"
 #include "RenderThread.hpp"
 #include "ScriptEngine.hpp"
+#include "ScriptableEngine.hpp"
 #include "PhysicsWorld.hpp"
 #include "Level.hpp"
 #include "Player.hpp"
 #include "Controller.hpp"
+#include "JobSystem.hpp"
+#include "BulletTaskScheduler.hpp"
+#include "PhysicsThread.hpp"
+#include "InputSampler.hpp"
+#include "AnimationSystem.hpp"
+#include "HitBoxQuery.hpp"
+#include "FrameProfiler.hpp"
+#include "SystemGraph.hpp"
+#include "WorldSnapshot.hpp"
+#include "UdpTransport.hpp"
+#include "Replication.hpp"
+#include "Quantization.hpp"
+#include "InterestGrid.hpp"
+#include "BotController.hpp"
+
+#include <algorithm>
 
 #include "Engine/Engine.hpp"
 
 namespace Tempest
 {
-    TempestEngine::TempestEngine(GLFWwindow *window, const std::filesystem::path& path) :
+    namespace
+    {
+        // What the frame systems touch, see run.
+        enum FrameResource : SystemGraph::ResourceMask
+        {
+            kInputResource = 1 << 0,
+            kPhysicsResource = 1 << 1,
+            kSceneResource = 1 << 2,
+            kScriptResource = 1 << 3,
+            kAnimationResource = 1 << 4,
+            kPlayerResource = 1 << 5,
+            kNetworkResource = 1 << 6,
+            kInterestResource = 1 << 7
+        };
+
+        // Cells either side of a player that count as near it, in 16m cells.
+        constexpr uint32_t kDefaultInterestRadius = 4;
+
+        // Clear of the glfw joysticks.
+        constexpr int kFirstBotID = 1000;
+        // Frames after spawning a load test step that don't count, spawning hitches.
+        constexpr uint32_t kLoadTestWarmupFrames = 60;
+        // Metres either side of the template the load test spawns in.
+        constexpr float kLoadTestSpread = 20.0f;
+
+        // Hitches tend to come in runs, don't flood the log.
+        constexpr std::chrono::seconds kHitchLogInterval{1};
+        // Systems quicker than this are left out of hitch reports.
+        constexpr uint64_t kHitchReportMinimumNs = 100000;
+    }
+
+    TempestEngine::TempestEngine(GLFWwindow *window, const std::filesystem::path& path, const JobSystemSettings& jobSettings) :
+        mWindow(window),
+        mCurrentLevel{nullptr},
+        mRootDir(path)
+    {
+        mJobSystem = new JobSystem(jobSettings);
+        mBulletScheduler = new BulletTaskScheduler(mJobSystem);
+        btSetTaskScheduler(mBulletScheduler);
+        mOwnsJobSystem = true;
+
+        createSubsystems();
+    }
+
+
+    TempestEngine::TempestEngine(GLFWwindow *window, const std::filesystem::path& path, JobSystem* jobs) :
         mWindow(window),
         mCurrentLevel{nullptr},
         mRootDir(path)
+    {
+        // Whoever owns the jobs installs bullets scheduler, it's process wide.
+        mJobSystem = jobs;
+        mBulletScheduler = nullptr;
+        mOwnsJobSystem = false;
+
+        createSubsystems();
+    }
+
+
+    void TempestEngine::createSubsystems()
     {
         mRenderEngine = new RenderEngine(mWindow, {DeviceFeaturesFlags::Compute | DeviceFeaturesFlags::Subgroup, true});
         mRenderThread = nullptr;
+        mPhysicsThread = nullptr;
         mPhysicsEngine = new PhysicsWorld(mRenderEngine);
         mScriptEngine = new ScriptEngine();
+        mInputSampler = new InputSampler(mWindow);
+
+        mAnimationSystem = new AnimationSystem(mJobSystem);
+        mHitBoxQuery = new HitBoxQuery();
+        mSystemGraph = new SystemGraph();
 
         mScriptEngine->registerEngineHooks(this);
         mScriptEngine->registerPhysicsHooks(mPhysicsEngine);
 
         mRenderEngine->startFrame(std::chrono::microseconds(0));
 
-        // init c rand
-        srand((unsigned)time(0));
+        mInputRecorder = nullptr;
+        mInputReplay = nullptr;
+        mTransport = nullptr;
+        mReplicationServer = nullptr;
+        mReplicationClient = nullptr;
+        mInterestGrid = new InterestGrid();
+        mBotLoadTest = nullptr;
+        mIdleController = new BotController(kFirstBotID - 1, 0, BotPolicy::Scripted);
+        mUnloggedHitches = 0;
+        mFrameTimeChannel = mFrameStatistics.addChannel("Frame");
+        mWorkTimeChannel = mFrameStatistics.addChannel("Work");
+        mPhysicsTimeChannel = mFrameStatistics.addChannel("Physics");
+        mScriptTimeChannel = mFrameStatistics.addChannel("Scripts");
+        setRandomSeed(static_cast<uint64_t>(time(0)));
     }
 
 
     TempestEngine::~TempestEngine()
     {
+        delete mPhysicsThread;
         delete mRenderThread;
         delete mRenderEngine;
         delete mPhysicsEngine;
+        // Bots release their lua views.
+        clearBots();
         delete mScriptEngine;
+        delete mAnimationSystem;
+        delete mHitBoxQuery;
+        delete mInputRecorder;
+        delete mInputReplay;
+        delete mReplicationServer;
+        delete mReplicationClient;
+        delete mTransport;
+        delete mInterestGrid;
+        delete mBotLoadTest;
+        delete mIdleController;
+        delete mInputSampler;
+        clearSnapshots();
+        delete mSystemGraph;
+
+        if(mOwnsJobSystem)
+        {
+            btSetTaskScheduler(nullptr);
+            delete mBulletScheduler;
+            delete mJobSystem;
+        }
     }
 
 
     void TempestEngine::loadLevel(const std::filesystem::path& path)
     {
+        // Bodies can only be added while the world isn't stepping.
+        if(mPhysicsThread)
+            mPhysicsThread->wait();
+
+        // Snapshots refer to instances and bodies of the old level.
+        clearSnapshots();
+
         delete mCurrentLevel;
-        mCurrentLevel = new Level(mRenderEngine, mPhysicsEngine, mScriptEngine, mRootDir / path);
+        mCurrentLevel = new Level(mRenderEngine, mPhysicsEngine, mScriptEngine, mJobSystem, mRootDir / path);
 
         mRenderEngine->setScene(mCurrentLevel->getScene());
         mScriptEngine->registerSceneHooks(mCurrentLevel->getScene());
+        mCurrentLevel->setInstanceRemovedCallback([this](const InstanceHandle handle, const InstanceID id)
+        {
+            removeInstanceComponents(handle, id);
+        });
+
+        mPlayers.clear();
+        mControllers.clear();
+        clearBots();
+        mInterestGrid->clear();
+        mMovedInstances.clear();
+        if(mReplicationServer)
+            mReplicationServer->clearInstances();
+        mAnimationSystem->setScene(mCurrentLevel->getScene());
+        for(const auto& [name, id] : mCurrentLevel->getInstances())
+        {
+            mAnimationSystem->registerInstance(id);
+            mInterestGrid->addObject(id, mCurrentLevel->getScene()->getInstancePosition(id));
+
+            const StaticMesh* mesh = mCurrentLevel->getScene()->getMeshInstance(id)->getMesh();
+            if(const AnimationGraph* graph = mCurrentLevel->getAnimationGraph(mesh); graph)
+                mAnimationSystem->setAnimationGraph(id, graph);
+        }
 
         mScriptEngine->init();
     }
 
 
     void TempestEngine::run()
+    {
+        FrameProfiler& profiler = FrameProfiler::get();
+
+        bool running = true;
+        while(running)
+        {
+            PROFILER_START_FRAME("Start frame");
+            profiler.beginFrame();
+
+            running = runFrame();
+
+            profiler.endFrame();
+        }
+    }
+
+
+    bool TempestEngine::runFrame()
+    {
+        if(mShouldClose)
+            return false;
+
+        if(!mRenderThread)
+            startRunning();
+
+        mShouldClose = glfwWindowShouldClose(mWindow);
+
+        // Waits out the rest of the frame if there's a limit set.
+        mFramePacer.beginFrame();
+        mFrameDelta = mFramePacer.getSmoothedDelta();
+
+        // Replays drive the controllers and timing themselves, the last
+        // frame runs with the previous delta so everything shuts down normally.
+        if(mInputReplay && !mInputReplay->nextFrame(mFrameDelta, *mInputSampler))
+            mShouldClose = true;
+
+        mSystemGraph->run(*mJobSystem);
+
+        const bool hitch = mFramePacer.endFrame();
+        if(!mFirstFrame)
+        {
+            if(hitch)
+                logHitch();
+
+            mFrameStatistics.record(mFrameTimeChannel, mFramePacer.getDelta());
+            mFrameStatistics.record(mWorkTimeChannel, mFramePacer.getWorkTime());
+            mFrameStatistics.record(mPhysicsTimeChannel, mPhysicsThread->getLastStepTime());
+            mFrameStatistics.record(mScriptTimeChannel, std::chrono::microseconds(mSystemGraph->getLastDuration(mScriptsSystem) / 1000));
+        }
+
+        if(mBotLoadTest)
+            updateBotLoadTest();
+
+        mFirstFrame = false;
+
+        return !mShouldClose;
+    }
+
+
+    void TempestEngine::startRunning()
     {
         setupGraphicsState();
 
         mRenderEngine->setShadowMapResolution({1024.0f, 1024.0f});
 
         mRenderThread  = new RenderThread(mRenderEngine);
-        auto frameStartTime = std::chrono::system_clock::now();
+        mPhysicsThread = new PhysicsThread(mPhysicsEngine);
+        // Events get stamped as they come in while the frame is held back.
+        mFramePacer.setWaitFunction([this](const std::chrono::microseconds timeout)
+        {
+            mInputSampler->waitForEvents(timeout);
+        });
+        mFramePacer.reset();
+        mFrameDelta = std::chrono::microseconds{0};
+        mLastHitchLog = FramePacer::Clock::now() - kHitchLogInterval;
+
+        FrameProfiler::get().setThreadName("Game Thread");
 
-        while (!mShouldClose)
+        // Added in the order they used to run serially, the graph works out what can overlap.
+        mSystemGraph->addSyncPoint("Wait for render thread", [this]()
         {
-            PROFILER_START_FRAME("Start frame");
+            mRenderThread->update(mShouldClose, mFirstFrame);
+            mRenderLock = mRenderThread->lock();
+        });
 
-            glfwPollEvents();
+        // Needs the render lock and has to get in before physics starts the next step.
+        mSystemGraph->addSyncPoint("Snapshots", [this]()
+        {
+            processSnapshotRequests();
+        });
 
-            mShouldClose = glfwWindowShouldClose(mWindow);
+        // Adds bodies so it needs physics idle too.
+        mSystemGraph->addSyncPoint("Spawn bots", [this]()
+        {
+            spawnPendingBots();
+        });
 
-            const auto currentTime = std::chrono::system_clock::now();
-            std::chrono::microseconds frameDelta = std::chrono::duration_cast<std::chrono::microseconds>(currentTime - frameStartTime);
-            frameStartTime = currentTime;
+        // Physics steps one frame behind on its own thread, everything this
+        // frame sees the poses from the step that just finished.
+        mSystemGraph->addSyncPoint("Physics sync", [this]()
+        {
+            mPhysicsThread->sync(mFrameDelta);
+        });
 
-            mPhysicsEngine->tick(frameDelta);
+        mSystemGraph->addSystem("Transform sync", kPhysicsResource, kSceneResource, [this]()
+        {
+            mPhysicsEngine->updateDynamicObjects(mCurrentLevel->getScene());
+        });
 
-            {
-                mRenderThread->update(mShouldClose, mFirstFrame);
-                std::unique_lock lock = mRenderThread->lock();
+        // The servers transforms win over whatever the local simulation did.
+        mSystemGraph->addSystem("Replication receive", 0, kSceneResource | kNetworkResource, [this]()
+        {
+            if(mReplicationClient)
+                applyReplicatedState();
+        });
 
-                mPhysicsEngine->updateDynamicObjects(mCurrentLevel->getScene());
+        // As late as possible so scripts see the freshest input.
+        mSystemGraph->addSystem("Input", 0, kInputResource, [this]()
+        {
+            mInputSampler->sample();
+            for(BotController* bot : mBots.getComponents())
+                bot->update(*mInputSampler);
 
-                mScriptEngine->tick(frameDelta);
+            if(mInputRecorder)
+                mInputRecorder->recordFrame(mFrameDelta, *mInputSampler);
+        }, SystemGraph::Affinity::MainThread);
 
-                mRenderThread->unlock(lock);
-            }
+        mScriptsSystem = mSystemGraph->addSystem("Scripts", kInputResource | kInterestResource, kScriptResource | kSceneResource | kPhysicsResource | kAnimationResource | kPlayerResource | kNetworkResource, [this]()
+        {
+            mScriptEngine->tick(mFrameDelta);
+        }, SystemGraph::Affinity::MainThread);
 
-            mFirstFrame = false;
-        }
+        // Only bodies that moved and instances scripts placed, everything else stays put.
+        mSystemGraph->addSystem("Interest", kSceneResource | kPhysicsResource, kInterestResource, [this]()
+        {
+            updateInterest();
+        });
+
+        mSystemGraph->addSystem("Animation", kSceneResource, kAnimationResource, [this]()
+        {
+            mAnimationSystem->tick(mFrameDelta);
+        });
+
+        mSystemGraph->addSystem("Hitboxes", kAnimationResource | kSceneResource, kPlayerResource, [this]()
+        {
+            updateHitBoxes();
+        });
+
+        mSystemGraph->addSystem("Replication send", kSceneResource | kNetworkResource | kInterestResource, 0, [this]()
+        {
+            if(mReplicationServer)
+                mReplicationServer->update(mCurrentLevel->getScene());
+        });
+
+        mSystemGraph->addSyncPoint("Kick render thread", [this]()
+        {
+            mRenderThread->unlock(mRenderLock);
+        });
+
+        // The render thread has the scene now so this overlaps with rendering.
+        // Main thread like the scripts, __gc metamethods can call engine hooks.
+        mSystemGraph->addSystem("Lua GC", 0, kScriptResource, [this]()
+        {
+            mScriptEngine->collectGarbage();
+        }, SystemGraph::Affinity::MainThread);
     }
 
-    void TempestEngine::startInstanceFrame(const InstanceID id)
+    void TempestEngine::startInstanceFrame(const InstanceHandle instance)
     {
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return;
+
+        const InstanceID id = slot->mInstance;
         Instance* inst = mCurrentLevel->getScene()->getMeshInstance(id);
         inst->newFrame();
     }
 
-    void TempestEngine::setInstanceLinearVelocity(const InstanceID id, const float3& v)
+    void TempestEngine::setInstanceLinearVelocity(const InstanceHandle instance, const float3& v)
     {
-        mPhysicsEngine->setInstanceLinearVelocity(id, v);
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return;
+
+        if(slot->mPhysicsIndex != InstanceTable::kInvalidIndex)
+            mPhysicsEngine->setBodyLinearVelocity(slot->mPhysicsIndex, v);
     }
 
-    void TempestEngine::translateInstance(const InstanceID id, const float3& v)
+    void TempestEngine::translateInstance(const InstanceHandle instance, const float3& v)
     {
-        mCurrentLevel->getScene()->translateInstance(id, v);
-        mPhysicsEngine->translateInstance(id, v);
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return;
+
+        mCurrentLevel->getScene()->translateInstance(slot->mInstance, v);
+        mMovedInstances.push_back(slot->mInstance);
+        if(slot->mPhysicsIndex != InstanceTable::kInvalidIndex)
+            mPhysicsEngine->translateBody(slot->mPhysicsIndex, v);
     }
 
-    float3 TempestEngine::getInstancePosition(const InstanceID id) const
+    float3 TempestEngine::getInstancePosition(const InstanceHandle instance) const
     {
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return float3{0.0f, 0.0f, 0.0f};
+
+        const InstanceID id = slot->mInstance;
         return mCurrentLevel->getScene()->getInstancePosition(id);
     }
 
 
-    void   TempestEngine::setInstancePosition(const InstanceID id, const float3& v)
+    void   TempestEngine::setInstancePosition(const InstanceHandle instance, const float3& v)
     {
-        mCurrentLevel->getScene()->setInstancePosition(id, v);
-        mPhysicsEngine->setInstancePosition(id, v);
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return;
+
+        mCurrentLevel->getScene()->setInstancePosition(slot->mInstance, v);
+        mMovedInstances.push_back(slot->mInstance);
+        if(slot->mPhysicsIndex != InstanceTable::kInvalidIndex)
+            mPhysicsEngine->setBodyPosition(slot->mPhysicsIndex, v);
     }
 
-    void   TempestEngine::setInstanceRotation(const InstanceID id, const quat& rot)
+    void   TempestEngine::setInstanceRotation(const InstanceHandle instance, const quat& rot)
     {
-        mCurrentLevel->getScene()->getMeshInstance(id)->setRotation(rot);
-        mPhysicsEngine->setInstanceRotation(id, rot);
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return;
+
+        mCurrentLevel->getScene()->getMeshInstance(slot->mInstance)->setRotation(rot);
+        if(slot->mPhysicsIndex != InstanceTable::kInvalidIndex)
+            mPhysicsEngine->setBodyRotation(slot->mPhysicsIndex, rot);
     }
 
-    void   TempestEngine::setGraphicsInstancePosition(const InstanceID id, const float3& v)
+    void   TempestEngine::setGraphicsInstancePosition(const InstanceHandle instance, const float3& v)
     {
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return;
+
+        const InstanceID id = slot->mInstance;
         mCurrentLevel->getScene()->setInstancePosition(id, v);
+        mMovedInstances.push_back(id);
     }
 
-    float3 TempestEngine::getInstanceSize(const InstanceID id) const
+    float3 TempestEngine::getInstanceSize(const InstanceHandle instance) const
     {
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return float3{0.0f, 0.0f, 0.0f};
+
+        const InstanceID id = slot->mInstance;
         const MeshInstance* meshInstance = mCurrentLevel->getScene()->getMeshInstance(id);
 
         AABB transformedAABB = meshInstance->getMesh()->getAABB() * meshInstance->getTransMatrix();
         return transformedAABB.getSideLengths();
     }
 
-    float3 TempestEngine::getInstanceCenter(const InstanceID id) const
+    float3 TempestEngine::getInstanceCenter(const InstanceHandle instance) const
     {
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return float3{0.0f, 0.0f, 0.0f};
+
+        const InstanceID id = slot->mInstance;
         const MeshInstance* meshInstance = mCurrentLevel->getScene()->getMeshInstance(id);
 
         AABB transformedAABB = meshInstance->getMesh()->getAABB() * meshInstance->getTransMatrix();
         return transformedAABB.getCentralPoint();
     }
 
-    float3 TempestEngine::getPhysicsBodyPosition(const InstanceID id)
+    float3 TempestEngine::getPhysicsBodyPosition(const InstanceHandle instance)
     {
-        btRigidBody* body = mPhysicsEngine->getRigidBody(id);
-        const btVector3& center = body->getCenterOfMassPosition();
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        const BodyPose* pose = slot ? mPhysicsEngine->getBodyPose(slot->mPhysicsIndex) : nullptr;
+        if(!pose)
+            return float3{0.0f, 0.0f, 0.0f};
 
-        return {center.x(), center.y(), center.z()};
+        return pose->mCenterOfMass;
     }
 
-    void TempestEngine::updatePlayersAttachedCameras(const InstanceID id)
+    void TempestEngine::updatePlayersAttachedCameras(const InstanceHandle instance)
     {
-        auto& p = mPlayers[id];
-        auto& camera = mControllers[id];
-        p->updateCameras(camera.get());
+        const uint32_t entity = resolveEntity(instance);
+        if(entity == InstanceTable::kInvalidIndex)
+            return;
+
+        // Scripts can ask for any instance, not just ones with a player and controller.
+        Player* player = mPlayers.tryGet(entity);
+        Controller** controller = mControllers.tryGet(entity);
+        if(!player || !controller)
+            return;
+
+        player->updateCameras(*controller);
     }
 
-    void TempestEngine::startAnimation(const InstanceID id, const std::string& name, const bool loop, const float speedModifer)
+    void TempestEngine::startAnimation(const InstanceHandle instance, const std::string& name, const bool loop, const float speedModifer)
     {
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return;
+
+        const InstanceID id = slot->mInstance;
         mRenderEngine->getScene()->getMeshInstance(id)->setActiveAnimation(name, loop);
+        mAnimationSystem->playClip(id, mAnimationSystem->registerClip(name), loop, speedModifer);
     }
 
 
-    void TempestEngine::terminateAnimation(const InstanceID id, const std::string& name)
+    void TempestEngine::terminateAnimation(const InstanceHandle instance, const std::string& name)
     {
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return;
+
+        const InstanceID id = slot->mInstance;
         mRenderEngine->getScene()->getMeshInstance(id)->endActiveAnimation();
+        mAnimationSystem->stopClip(id);
+    }
+
+    uint64_t TempestEngine::getAnimationClipHandle(const std::string& name)
+    {
+        return mAnimationSystem->registerClip(name);
     }
 
-    InstanceID TempestEngine::getInstanceIDByName(const std::string& name) const
+    void TempestEngine::startAnimationClip(const InstanceHandle instance, const uint64_t clip, const bool loop, const float speedModifer)
+    {
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return;
+
+        const InstanceID id = slot->mInstance;
+        mRenderEngine->getScene()->getMeshInstance(id)->setActiveAnimation(mAnimationSystem->getClipName(clip), loop);
+        mAnimationSystem->playClip(id, clip, loop, speedModifer);
+    }
+
+    void TempestEngine::terminateAnimationClip(const InstanceHandle instance, const uint64_t)
+    {
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return;
+
+        const InstanceID id = slot->mInstance;
+        mRenderEngine->getScene()->getMeshInstance(id)->endActiveAnimation();
+        mAnimationSystem->stopClip(id);
+    }
+
+    uint32_t TempestEngine::getAnimationParameterHandle(const InstanceHandle instance, const std::string& name)
+    {
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return kInvalidAnimationParameter;
+
+        const InstanceID id = slot->mInstance;
+        return mAnimationSystem->getParameterHandle(id, name);
+    }
+
+    void TempestEngine::setAnimationFloatParameter(const InstanceHandle instance, const uint32_t parameter, const float value)
+    {
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return;
+
+        const InstanceID id = slot->mInstance;
+        mAnimationSystem->setParameter(id, parameter, value);
+    }
+
+    void TempestEngine::setAnimationIntParameter(const InstanceHandle instance, const uint32_t parameter, const int value)
+    {
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return;
+
+        const InstanceID id = slot->mInstance;
+        mAnimationSystem->setParameter(id, parameter, static_cast<float>(value));
+    }
+
+    uint32_t TempestEngine::getAnimationStateHandle(const InstanceHandle instance, const std::string& name)
+    {
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return kInvalidAnimationState;
+
+        const InstanceID id = slot->mInstance;
+        return mAnimationSystem->getStateHandle(id, name);
+    }
+
+    uint32_t TempestEngine::getCurrentAnimationState(const InstanceHandle instance)
+    {
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return kInvalidAnimationState;
+
+        const InstanceID id = slot->mInstance;
+        return mAnimationSystem->getCurrentState(id);
+    }
+
+    InstanceHandle TempestEngine::getInstanceHandle(const std::string& name) const
     {
         BELL_ASSERT(mCurrentLevel, "No level loaded")
-        return mCurrentLevel->getInstanceIDByName(name);
+        return mCurrentLevel->getInstanceHandleByName(name);
     }
 
     SceneID TempestEngine::getSceneIDByName(const std::string& name) const
@@ -195,78 +614,723 @@ namespace Tempest
         mCurrentLevel->setShadowCameraByName(name);
     }
 
-    void TempestEngine::createPlayerInstance(const InstanceID id, const float3& pos, const float3& dir)
+    CameraHandle TempestEngine::getCameraHandle(const std::string& name) const
     {
-        auto p = std::make_unique<Player>(id, mCurrentLevel->getScene(), pos, dir);
-        mPlayers[id] = std::move(p);
+        BELL_ASSERT(mCurrentLevel, "No level loaded")
+        return mCurrentLevel->getCameraHandle(name);
     }
 
-    const Controller& TempestEngine::getControllerForInstance(const InstanceID id)
+    void TempestEngine::setMainCamera(const CameraHandle handle)
     {
-        BELL_ASSERT(mControllers.find(id) != mControllers.end(), "No controller created for this instance")
-        auto& controller = mControllers[id];
+        BELL_ASSERT(mCurrentLevel, "No level loaded")
+        mCurrentLevel->setMainCamera(handle);
+    }
 
-        return *controller.get();
+    void TempestEngine::setShadowCamera(const CameraHandle handle)
+    {
+        BELL_ASSERT(mCurrentLevel, "No level loaded")
+        mCurrentLevel->setShadowCamera(handle);
     }
 
-    void TempestEngine::createControllerInstance(const InstanceID id, const uint32_t joyStickIndex)
+    void TempestEngine::createPlayerInstance(const InstanceHandle instance, const float3& pos, const float3& dir)
     {
-        auto c = std::make_unique<Controller>(joyStickIndex);
-        mControllers[id] = std::move(c);
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(!slot)
+            return;
+
+        const InstanceID id = slot->mInstance;
+        mPlayers.emplace(InstanceTable::getIndex(instance), id, mCurrentLevel->getScene(), pos, dir);
+
+        mAnimationSystem->registerInstance(id);
+        mInterestGrid->addObserver(id, kDefaultInterestRadius);
     }
 
-    const Controller& TempestEngine::updateControllerInstance(const InstanceID id)
+    const Controller& TempestEngine::getControllerForInstance(const InstanceHandle instance)
     {
-        BELL_ASSERT(mControllers.find(id) != mControllers.end(), "No controller created for this instance")
-        auto& controller = mControllers[id];
+        // Stale handles get a controller that never presses anything.
+        const uint32_t entity = resolveEntity(instance);
+        Controller** controller = entity != InstanceTable::kInvalidIndex ? mControllers.tryGet(entity) : nullptr;
+        return controller ? **controller : *mIdleController;
+    }
 
-        controller->update(mWindow);
+    void TempestEngine::createControllerInstance(const InstanceHandle instance, const uint32_t joyStickIndex)
+    {
+        const uint32_t entity = resolveEntity(instance);
+        if(entity == InstanceTable::kInvalidIndex)
+            return;
 
-        return *controller.get();
+        mControllers.emplace(entity, &mInputSampler->getController(joyStickIndex));
     }
 
-    void TempestEngine::attachCameraToPlayer(const InstanceID id, const std::string& n, const float armatureLenght)
+    const Controller& TempestEngine::updateControllerInstance(const InstanceHandle instance)
     {
-        BELL_ASSERT(mPlayers.find(id) != mPlayers.end(), "No player created for this instance")
-        auto& p = mPlayers[id];
-        Camera& cam = mCurrentLevel->getCameraByName(n);
+        // Sampled once a frame now, kept so older scripts still work.
+        return getControllerForInstance(instance);
+    }
 
-        p->attachCamera(cam, armatureLenght);
+    void TempestEngine::attachCameraToPlayer(const InstanceHandle instance, const std::string& n, const float armatureLenght)
+    {
+        attachCameraHandleToPlayer(instance, mCurrentLevel->getCameraHandle(n), armatureLenght);
     }
 
-    void TempestEngine::attachShadowCameraToPlayer(const InstanceID id, const std::string& n)
+    void TempestEngine::attachShadowCameraToPlayer(const InstanceHandle instance, const std::string& n)
     {
-        BELL_ASSERT(mPlayers.find(id) != mPlayers.end(), "No player created for this instance")
-        auto& p = mPlayers[id];
-        Camera& cam = mCurrentLevel->getCameraByName(n);
+        attachShadowCameraHandleToPlayer(instance, mCurrentLevel->getCameraHandle(n));
+    }
+
+    void TempestEngine::attachCameraHandleToPlayer(const InstanceHandle instance, const CameraHandle handle, const float armatureLenght)
+    {
+        if(!checkCamera(handle))
+            return;
+
+        Camera& cam = mCurrentLevel->getCamera(handle);
+        const uint32_t entity = resolveEntity(instance);
+        if(entity == InstanceTable::kInvalidIndex)
+            return;
+
+        mPlayers.get(entity).attachCamera(cam, armatureLenght);
+    }
 
-        p->attachShadowCamera(cam);
+    void TempestEngine::attachShadowCameraHandleToPlayer(const InstanceHandle instance, const CameraHandle handle)
+    {
+        if(!checkCamera(handle))
+            return;
+
+        Camera& cam = mCurrentLevel->getCamera(handle);
+        const uint32_t entity = resolveEntity(instance);
+        if(entity == InstanceTable::kInvalidIndex)
+            return;
+
+        mPlayers.get(entity).attachShadowCamera(cam);
     }
 
-    void TempestEngine::applyImpulseToInstance(const InstanceID id, const float3& impulse)
+    void TempestEngine::applyImpulseToInstance(const InstanceHandle instance, const float3& impulse)
     {
-        btRigidBody* body = mPhysicsEngine->getRigidBody(id);
-        if (!body->isActive())
-            body->activate(true);
-        body->applyCentralImpulse({impulse.x, impulse.y, impulse.z});
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(slot && slot->mPhysicsIndex != InstanceTable::kInvalidIndex)
+            mPhysicsEngine->applyBodyImpulse(slot->mPhysicsIndex, impulse);
     }
 
     float3 TempestEngine::getCameraDirectionByName(const std::string& n) const
     {
-        const Camera& cam = mCurrentLevel->getCameraByName(n);
-        return cam.getDirection();
+        return getCameraDirection(mCurrentLevel->getCameraHandle(n));
     }
 
     float3 TempestEngine::getCameraRightByName(const std::string& n) const
     {
-        const Camera& cam = mCurrentLevel->getCameraByName(n);
-        return cam.getRight();
+        return getCameraRight(mCurrentLevel->getCameraHandle(n));
     }
 
     float3 TempestEngine::getCameraPositionByName(const std::string& n) const
     {
-        const Camera& cam = mCurrentLevel->getCameraByName(n);
-        return cam.getPosition();
+        return getCameraPosition(mCurrentLevel->getCameraHandle(n));
+    }
+
+    float3 TempestEngine::getCameraDirection(const CameraHandle handle) const
+    {
+        if(!checkCamera(handle))
+            return float3{0.0f, 0.0f, 0.0f};
+
+        return mCurrentLevel->getCamera(handle).getDirection();
+    }
+
+    float3 TempestEngine::getCameraRight(const CameraHandle handle) const
+    {
+        if(!checkCamera(handle))
+            return float3{0.0f, 0.0f, 0.0f};
+
+        return mCurrentLevel->getCamera(handle).getRight();
+    }
+
+    float3 TempestEngine::getCameraPosition(const CameraHandle handle) const
+    {
+        if(!checkCamera(handle))
+            return float3{0.0f, 0.0f, 0.0f};
+
+        return mCurrentLevel->getCamera(handle).getPosition();
+    }
+
+    bool TempestEngine::checkCamera(const CameraHandle handle) const
+    {
+        if(mCurrentLevel->isValidCamera(handle))
+            return true;
+
+        BELL_LOG_ARGS("Ignoring invalid camera handle %u", handle);
+        return false;
+    }
+
+    const InstanceTable::Slot* TempestEngine::resolveInstance(const InstanceHandle handle) const
+    {
+        const InstanceTable::Slot* slot = mCurrentLevel->getInstanceTable().get(handle);
+        if(!slot)
+            BELL_LOG_ARGS("Stale instance handle %llx, the instance has been removed", static_cast<unsigned long long>(handle));
+
+        return slot;
+    }
+
+    uint32_t TempestEngine::resolveEntity(const InstanceHandle handle) const
+    {
+        if(!resolveInstance(handle))
+            return InstanceTable::kInvalidIndex;
+
+        return InstanceTable::getIndex(handle);
+    }
+
+    void TempestEngine::updateHitBoxes()
+    {
+        std::vector<Player>& players = mPlayers.getComponents();
+        mJobSystem->parallelFor(static_cast<uint32_t>(players.size()), [&](const uint32_t i)
+        {
+            players[i].updateHitBoxes(*mAnimationSystem);
+        });
+
+        mHitBoxQuery->beginFrame();
+        for(const Player& player : players)
+            mHitBoxQuery->addPlayer(player.getInstanceID(), player);
+        mHitBoxQuery->execute();
+    }
+
+    void TempestEngine::writeSystemGraph(const std::string& name) const
+    {
+        const std::filesystem::path dir = mRootDir / "Profiles";
+        std::filesystem::create_directories(dir);
+
+        mSystemGraph->writeGraph(dir / (name + ".dot"));
+    }
+
+    void TempestEngine::setRandomSeed(const uint64_t seed)
+    {
+        mRandom.setSeed(seed);
+        mScriptEngine->setRandomSeed(seed);
+    }
+
+    bool TempestEngine::startInputReplay(const std::filesystem::path& path, const ReplayTiming timing)
+    {
+        InputReplay* replay = new InputReplay(path, timing);
+        if(!replay->isValid())
+        {
+            delete replay;
+            return false;
+        }
+
+        delete mInputReplay;
+        mInputReplay = replay;
+        mInputSampler->setLive(false);
+        setRandomSeed(mInputReplay->getSeed());
+
+        return true;
+    }
+
+    float TempestEngine::randomFloat(const float min, const float max)
+    {
+        return mRandom.range(min, max);
+    }
+
+    int TempestEngine::randomInt(const int min, const int max)
+    {
+        return mRandom.range(min, max);
+    }
+
+    void TempestEngine::startInputRecording(const std::string& name)
+    {
+        const std::filesystem::path dir = mRootDir / "Recordings";
+        std::filesystem::create_directories(dir);
+
+        delete mInputRecorder;
+        mInputRecorder = new InputRecorder(dir / (name + ".trec"), mRandom.getSeed());
+    }
+
+    void TempestEngine::stopInputRecording()
+    {
+        delete mInputRecorder;
+        mInputRecorder = nullptr;
+    }
+
+    void TempestEngine::saveSnapshot(const std::string& name)
+    {
+        mPendingSnapshots.push_back(name);
+    }
+
+    void TempestEngine::restoreSnapshot(const std::string& name)
+    {
+        mPendingRestore = name;
+    }
+
+    void TempestEngine::spawnBots(const std::string& templateName, const uint32_t count, const float spread)
+    {
+        mPendingBots.push_back({templateName, count, spread});
+    }
+
+    void TempestEngine::setBotInput(const InstanceHandle instance, const float x, const float y, const bool jump, const bool sprint)
+    {
+        const uint32_t entity = resolveEntity(instance);
+        BotController** bot = entity != InstanceTable::kInvalidIndex ? mBots.tryGet(entity) : nullptr;
+        if(!bot)
+            return;
+
+        ControllerState state{};
+        state.mAxis[0] = x;
+        state.mAxis[1] = y;
+        state.mButtons[0] = jump ? GLFW_PRESS : GLFW_RELEASE;
+        state.mShftPressed = sprint;
+        (*bot)->setScriptedState(state);
+    }
+
+    void TempestEngine::spawnPendingBots()
+    {
+        if(mPendingBots.empty())
+            return;
+
+        TEMPEST_PROFILE_SCOPE("Spawn bots")
+
+        if(mPhysicsThread)
+            mPhysicsThread->wait();
+
+        Scene* scene = mCurrentLevel->getScene();
+        for(const BotRequest& request : mPendingBots)
+        {
+            const InstanceHandle templateHandle = mCurrentLevel->getInstanceHandleByName(request.mTemplate);
+            const InstanceTable::Slot* templateSlot = resolveInstance(templateHandle);
+            if(!templateSlot)
+            {
+                BELL_LOG_ARGS("Bot template instance %s doesn't exist", request.mTemplate.c_str());
+                continue;
+            }
+            const float3 origin = scene->getInstancePosition(templateSlot->mInstance);
+
+            for(uint32_t i = 0; i < request.mCount; ++i)
+            {
+                const uint32_t botIndex = mBots.size();
+                const float3 position{origin.x + mRandom.range(-request.mSpread, request.mSpread),
+                                      origin.y,
+                                      origin.z + mRandom.range(-request.mSpread, request.mSpread)};
+
+                const InstanceHandle handle = mCurrentLevel->cloneInstance(request.mTemplate, request.mTemplate + "_Bot" + std::to_string(botIndex), position);
+                const InstanceID id = resolveInstance(handle)->mInstance;
+
+                mAnimationSystem->registerInstance(id);
+                if(const AnimationGraph* graph = mCurrentLevel->getAnimationGraph(scene->getMeshInstance(id)->getMesh()); graph)
+                    mAnimationSystem->setAnimationGraph(id, graph);
+                mInterestGrid->addObject(id, position);
+
+                // The players script sets up the player and a controller, the bot then takes the controller over.
+                mScriptEngine->initEntity(static_cast<int64_t>(handle));
+
+                const uint32_t entity = InstanceTable::getIndex(handle);
+                BotController* bot = new BotController(kFirstBotID + static_cast<int>(botIndex), mRandom.next(), BotPolicy::RandomWalk);
+                mBots.emplace(entity, bot);
+                if(Controller** controller = mControllers.tryGet(entity); controller)
+                    *controller = bot;
+                else
+                    mControllers.emplace(entity, bot);
+            }
+        }
+        mPendingBots.clear();
+    }
+
+    void TempestEngine::removeInstanceComponents(const InstanceHandle handle, const InstanceID id)
+    {
+        // The slot gets reused, nothing can be left behind for the next instance in it.
+        const uint32_t entity = InstanceTable::getIndex(handle);
+        mPlayers.remove(entity);
+        mControllers.remove(entity);
+        if(BotController** bot = mBots.tryGet(entity); bot)
+        {
+            destroyBot(*bot);
+            mBots.remove(entity);
+        }
+
+        mInterestGrid->removeObject(id);
+        mAnimationSystem->unregisterInstance(id);
+        if(mReplicationServer)
+            mReplicationServer->removeInstance(id);
+        mScriptEngine->unregisterEntity(static_cast<int64_t>(handle));
+    }
+
+    void TempestEngine::clearBots()
+    {
+        for(BotController* bot : mBots.getComponents())
+            destroyBot(bot);
+        mBots.clear();
+        mPendingBots.clear();
+    }
+
+    void TempestEngine::destroyBot(BotController* bot)
+    {
+        releaseLuaView(mScriptEngine->getState(), *bot);
+        delete bot;
+    }
+
+    void TempestEngine::startBotLoadTest(const std::string& templateName, const uint32_t maxBots, const uint32_t step, const uint32_t framesPerStep)
+    {
+        BELL_ASSERT(!mBotLoadTest, "Load test already running")
+
+        const std::filesystem::path dir = mRootDir / "Profiles";
+        std::filesystem::create_directories(dir);
+
+        mBotLoadTest = new BotLoadTest{templateName, maxBots, std::max(step, 1u), std::max(framesPerStep, kLoadTestWarmupFrames + 1), 0, {}};
+        mBotLoadTest->mFile.open(dir / "BotScaling.csv");
+        mBotLoadTest->mFile << "bots,frame_p50_ms,frame_p90_ms,frame_p99_ms,frame_max_ms,physics_p50_ms,physics_p99_ms,scripts_p50_ms,scripts_p99_ms\n";
+
+        spawnBots(templateName, std::min(mBotLoadTest->mStep, maxBots), kLoadTestSpread);
+    }
+
+    void TempestEngine::updateBotLoadTest()
+    {
+        BotLoadTest& test = *mBotLoadTest;
+
+        ++test.mFrame;
+        if(test.mFrame == kLoadTestWarmupFrames)
+            mFrameStatistics.reset();
+        if(test.mFrame < test.mFramesPerStep)
+            return;
+
+        const FramePercentiles frame = mFrameStatistics.getPercentiles(mFrameTimeChannel);
+        const FramePercentiles physics = mFrameStatistics.getPercentiles(mPhysicsTimeChannel);
+        const FramePercentiles scripts = mFrameStatistics.getPercentiles(mScriptTimeChannel);
+        auto ms = [](const std::chrono::microseconds t) { return t.count() / 1000.0; };
+
+        test.mFile << mBots.size() << ','
+                   << ms(frame.mP50) << ',' << ms(frame.mP90) << ',' << ms(frame.mP99) << ',' << ms(frame.mMax) << ','
+                   << ms(physics.mP50) << ',' << ms(physics.mP99) << ','
+                   << ms(scripts.mP50) << ',' << ms(scripts.mP99) << '\n';
+
+        BELL_LOG_ARGS("%u bots:", mBots.size());
+        mFrameStatistics.log();
+
+        if(mBots.size() >= test.mMaxBots)
+        {
+            delete mBotLoadTest;
+            mBotLoadTest = nullptr;
+            mShouldClose = true;
+            return;
+        }
+
+        spawnBots(test.mTemplate, std::min(test.mStep, test.mMaxBots - mBots.size()), kLoadTestSpread);
+        test.mFrame = 0;
+    }
+
+    void TempestEngine::logFrameStatistics() const
+    {
+        mFrameStatistics.log();
+    }
+
+    void TempestEngine::setFrameRateLimit(const uint32_t hz)
+    {
+        mFramePacer.setTargetRate(hz);
+    }
+
+    void TempestEngine::setDeltaSmoothing(const float weight)
+    {
+        mFramePacer.setSmoothing(weight);
+    }
+
+    uint32_t TempestEngine::getHitchCount() const
+    {
+        return mFramePacer.getHitchCount();
+    }
+
+    void TempestEngine::logHitch()
+    {
+        const auto now = FramePacer::Clock::now();
+        if(now - mLastHitchLog < kHitchLogInterval)
+        {
+            ++mUnloggedHitches;
+            return;
+        }
+        mLastHitchLog = now;
+
+        BELL_LOG_ARGS("Hitch: %.2fms of work against %.2fms (%u more since the last report)",
+                      mFramePacer.getWorkTime().count() / 1000.0,
+                      mFramePacer.getHitchBudget().count() / 1000.0,
+                      mUnloggedHitches);
+        mUnloggedHitches = 0;
+
+        for(uint32_t i = 0; i < mSystemGraph->getSystemCount(); ++i)
+        {
+            const uint64_t duration = mSystemGraph->getLastDuration(i);
+            if(duration >= kHitchReportMinimumNs)
+                BELL_LOG_ARGS("    %-24s %6.2fms", mSystemGraph->getName(i), duration / 1000000.0);
+        }
+
+        // Overlaps the frame on its own thread so it's not in the graph.
+        BELL_LOG_ARGS("    %-24s %6.2fms", "Physics step", mPhysicsThread->getLastStepTime().count() / 1000.0);
+    }
+
+    void TempestEngine::processSnapshotRequests()
+    {
+        if(mPendingSnapshots.empty() && mPendingRestore.empty())
+            return;
+
+        TEMPEST_PROFILE_SCOPE("World snapshots")
+
+        if(mPhysicsThread)
+            mPhysicsThread->wait();
+
+        // Saves first so saving and restoring the same name in a frame is a no-op.
+        for(const std::string& name : mPendingSnapshots)
+        {
+            WorldSnapshot*& snapshot = mSnapshots[name];
+            if(!snapshot)
+                snapshot = new WorldSnapshot();
+
+            captureSnapshot(*snapshot);
+        }
+        mPendingSnapshots.clear();
+
+        if(!mPendingRestore.empty())
+        {
+            if(auto it = mSnapshots.find(mPendingRestore); it != mSnapshots.end())
+                applySnapshot(*it->second);
+            else
+                BELL_LOG_ARGS("No snapshot named %s", mPendingRestore.c_str());
+
+            mPendingRestore.clear();
+        }
+    }
+
+    void TempestEngine::captureSnapshot(WorldSnapshot& snapshot)
+    {
+        Scene* scene = mCurrentLevel->getScene();
+
+        snapshot.mTransforms.clear();
+        for(const auto& [name, id] : mCurrentLevel->getInstances())
+        {
+            const MeshInstance* instance = scene->getMeshInstance(id);
+            snapshot.mTransforms[id] = {instance->getPosition(), instance->getRotation()};
+        }
+
+        snapshot.mCameras.clear();
+        for(const auto& [name, handle] : mCurrentLevel->getCameras())
+            snapshot.mCameras.push_back({handle, mCurrentLevel->getCamera(handle)});
+
+        mPhysicsEngine->saveState(snapshot.mPhysics);
+        mAnimationSystem->saveState(snapshot.mAnimation);
+        snapshot.mPlayers = mPlayers;
+
+        snapshot.mControllers.clear();
+        mInputSampler->forEachController([&](const Controller& controller)
+        {
+            snapshot.mControllers.push_back({controller.getID(), controller.getState()});
+        });
+
+        mScriptEngine->saveState(snapshot.mScripts);
+        snapshot.mRandom = mRandom;
+    }
+
+    void TempestEngine::applySnapshot(const WorldSnapshot& snapshot)
+    {
+        Scene* scene = mCurrentLevel->getScene();
+
+        for(const auto& [name, id] : mCurrentLevel->getInstances())
+        {
+            if(auto it = snapshot.mTransforms.find(id); it != snapshot.mTransforms.end())
+            {
+                MeshInstance* instance = scene->getMeshInstance(id);
+                instance->setPosition(it->second.mPosition);
+                instance->setRotation(it->second.mRotation);
+                mMovedInstances.push_back(id);
+            }
+        }
+
+        for(const auto& [handle, camera] : snapshot.mCameras)
+            mCurrentLevel->getCamera(handle) = camera;
+
+        mPhysicsEngine->restoreState(snapshot.mPhysics);
+        mAnimationSystem->restoreState(snapshot.mAnimation);
+
+        // Players only come back on the instance they were saved with.
+        snapshot.mPlayers.each([&](const uint32_t entity, const Player& saved)
+        {
+            if(Player* player = mPlayers.tryGet(entity); player && player->getInstanceID() == saved.getInstanceID())
+                *player = saved;
+        });
+
+        mInputSampler->forEachController([&](Controller& controller)
+        {
+            for(const auto& [joystick, state] : snapshot.mControllers)
+            {
+                if(joystick == controller.getID())
+                    controller.setState(state);
+            }
+        });
+
+        mScriptEngine->restoreState(snapshot.mScripts);
+        mRandom = snapshot.mRandom;
+    }
+
+    void TempestEngine::clearSnapshots()
+    {
+        for(auto& [name, snapshot] : mSnapshots)
+            delete snapshot;
+        mSnapshots.clear();
+
+        mPendingSnapshots.clear();
+        mPendingRestore.clear();
+    }
+
+    bool TempestEngine::startReplicationServer(const uint16_t port)
+    {
+        UdpTransport* transport = new UdpTransport(port);
+        if(!transport->isOpen())
+        {
+            delete transport;
+            return false;
+        }
+
+        mTransport = transport;
+        mReplicationServer = new ReplicationServer(mTransport);
+        mReplicationServer->setInterestGrid(mInterestGrid);
+
+        return true;
+    }
+
+    bool TempestEngine::connectToReplicationServer(const std::string& host, const uint16_t port)
+    {
+        UdpTransport* transport = new UdpTransport();
+        const ConnectionID server = transport->isOpen() ? transport->connect(host, port) : kInvalidConnection;
+        if(server == kInvalidConnection)
+        {
+            delete transport;
+            return false;
+        }
+
+        mTransport = transport;
+        mReplicationClient = new ReplicationClient(mTransport, server);
+
+        return true;
+    }
+
+    void TempestEngine::replicateInstance(const InstanceHandle instance)
+    {
+        const InstanceTable::Slot* slot = resolveInstance(instance);
+        if(mReplicationServer && slot)
+            mReplicationServer->addInstance(slot->mInstance);
+    }
+
+    void TempestEngine::setReplicatedValue(const InstanceHandle instance, const uint32_t slot, const int value)
+    {
+        const InstanceTable::Slot* instanceSlot = resolveInstance(instance);
+        if(mReplicationServer && instanceSlot)
+            mReplicationServer->setValue(instanceSlot->mInstance, slot, value);
+    }
+
+    int TempestEngine::getReplicatedValue(const InstanceHandle instance, const uint32_t slot) const
+    {
+        const InstanceTable::Slot* instanceSlot = resolveInstance(instance);
+        if(!mReplicationClient || !instanceSlot)
+            return 0;
+
+        return mReplicationClient->getValue(instanceSlot->mInstance, slot);
+    }
+
+    void TempestEngine::setInterestRadius(const InstanceHandle instance, const uint32_t cells)
+    {
+        if(const InstanceTable::Slot* slot = resolveInstance(instance); slot)
+            mInterestGrid->setObserverRadius(slot->mInstance, cells);
+    }
+
+    void TempestEngine::setFarScriptInterval(const uint32_t frames)
+    {
+        mScriptEngine->setScriptRelevance([this](const int64_t entity)
+        {
+            // With no players about there's nothing to be far from.
+            if(mInterestGrid->getObservers().empty())
+                return true;
+
+            const InstanceTable::Slot* slot = mCurrentLevel->getInstanceTable().get(static_cast<InstanceHandle>(entity));
+            return !slot || mInterestGrid->isObserved(slot->mInstance);
+        }, frames);
+    }
+
+    void TempestEngine::updateInterest()
+    {
+        // Sleeping and static bodies can't have changed cell.
+        for(const uint32_t index : mPhysicsEngine->getMovedBodies())
+        {
+            if(const BodyPose* pose = mPhysicsEngine->getBodyPose(index); pose)
+                mInterestGrid->moveObject(pose->mInstance, pose->mPosition);
+        }
+
+        Scene* scene = mCurrentLevel->getScene();
+        for(const InstanceID id : mMovedInstances)
+            mInterestGrid->moveObject(id, scene->getInstancePosition(id));
+        mMovedInstances.clear();
+    }
+
+    void TempestEngine::applyReplicatedState()
+    {
+        mReplicationClient->update();
+
+        // Reapplied every frame, not just when a packet arrives, so local
+        // physics doesn't show through between packets.
+        const ReplicationSnapshot* snapshot = mReplicationClient->getLatestSnapshot();
+        if(!snapshot)
+            return;
+
+        Scene* scene = mCurrentLevel->getScene();
+        for(const ReplicatedEntity& entity : snapshot->mEntities)
+        {
+            // Both ends load the same level so ids line up, anything else gets ignored.
+            if(mCurrentLevel->getInstanceHandle(entity.mID) == kInvalidInstanceHandle)
+                continue;
+
+            MeshInstance* instance = scene->getMeshInstance(entity.mID);
+            instance->setPosition({dequantizePosition(entity.mPosition[0]),
+                                   dequantizePosition(entity.mPosition[1]),
+                                   dequantizePosition(entity.mPosition[2])});
+            instance->setRotation(unpackRotation(entity.mRotation));
+        }
+    }
+
+    void TempestEngine::captureProfile(const std::string& name, const uint32_t frameCount)
+    {
+        const std::filesystem::path dir = mRootDir / "Profiles";
+        std::filesystem::create_directories(dir);
+
+        FrameProfiler::get().requestCapture(dir / (name + ".json"), frameCount);
+    }
+
+    void TempestEngine::setProfilerHitchThreshold(const uint32_t milliseconds)
+    {
+        FrameProfiler::get().setHitchThreshold(std::chrono::milliseconds(milliseconds), mRootDir / "Profiles" / "Hitches");
+    }
+
+    void TempestEngine::startScriptProfiling(const uint32_t windowFrames, const uint32_t instructionInterval)
+    {
+        if(windowFrames == 0)
+            mScriptEngine->getProfiler().stop();
+        else
+            mScriptEngine->getProfiler().start(windowFrames, mRootDir / "Profiles" / "Scripts", instructionInterval);
+    }
+
+    uint32_t TempestEngine::getScriptHeapSize() const
+    {
+        return mScriptEngine->getGarbageCollectionStats().mHeapKB;
+    }
+
+    uint32_t TempestEngine::getScriptGarbageCollectionPause() const
+    {
+        return static_cast<uint32_t>(mScriptEngine->getGarbageCollectionStats().mLastPause.count());
+    }
+
+    void TempestEngine::setScriptGarbageCollectionBudget(const uint32_t microseconds)
+    {
+        mScriptEngine->setGarbageCollectionBudget(std::chrono::microseconds(microseconds));
+    }
+
+    void TempestEngine::setScriptFrameBudget(const uint32_t instructions)
+    {
+        mScriptEngine->setFrameScriptBudget(instructions);
+    }
+
+    uint32_t TempestEngine::getScriptThrottleCount(const std::string& script) const
+    {
+        const auto& stats = mScriptEngine->getScriptBudgetStats();
+        if(auto it = stats.find(script); it != stats.end())
+            return it->second.mThrottledLastFrame + it->second.mDeferredLastFrame;
+
+        return 0;
     }
 
     void TempestEngine::setupGraphicsState()
@@ -1,9 +1,24 @@
 #ifndef TEMPEST_ENGINE_HPP
 #define TEMPEST_ENGINE_HPP
 
+#include <chrono>
 #include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "Engine/GeomUtils.h"
 #include "Engine/Scene.h"
+#include "Level.hpp"
+#include "ComponentPool.hpp"
+#include "Player.hpp"
+#include "Controller.hpp"
+#include "JobSystem.hpp"
+#include "Random.hpp"
+#include "InputRecording.hpp"
+#include "FrameStatistics.hpp"
+#include "FramePacer.hpp"
 
 class RenderEngine;
 class Scene;
@@ -13,81 +28,302 @@ namespace Tempest
 {
     class ScriptEngine;
     class RenderThread;
+    class PhysicsThread;
+    class InputSampler;
     class PhysicsWorld;
     class Level;
-    class Player;
-    class Controller;
+    class AnimationSystem;
+    class HitBoxQuery;
+    class SystemGraph;
+    class BulletTaskScheduler;
+    struct WorldSnapshot;
+    class Transport;
+    class ReplicationServer;
+    class ReplicationClient;
+    class InterestGrid;
+    class BotController;
 
 class TempestEngine
 {
 public:
-    TempestEngine(GLFWwindow* window, const std::filesystem::path& rootDir);
+    TempestEngine(GLFWwindow* window, const std::filesystem::path& rootDir, const JobSystemSettings& jobSettings = {});
+    // Runs on someone elses job system, see WorldHost. Installing bullets task
+    // scheduler is left to the owner as there's only one per process.
+    TempestEngine(GLFWwindow* window, const std::filesystem::path& rootDir, JobSystem* jobs);
     ~TempestEngine();
 
     // Load level
     void loadLevel(const std::filesystem::path& path);
 
+    // Seeds the engine and lua random generators, set before loading a level
+    // for a session that can be replayed.
+    void setRandomSeed(const uint64_t seed);
+    uint64_t getRandomSeed() const
+    {
+        return mRandom.getSeed();
+    }
+
+    // Plays back a recording instead of live input, call before loadLevel as
+    // it reseeds. The engine shuts down once the recording runs out.
+    bool startInputReplay(const std::filesystem::path& path, const ReplayTiming);
+
     // main loop to be called once c++ side.
     void run();
+    // One frame of run for hosts stepping several worlds, the caller owns the
+    // profiler frame and scratch arenas. Returns false once the world closes.
+    bool runFrame();
 
     // lua scripting hooks.
     // must be called before updating transformation!!
-    void startInstanceFrame(const InstanceID);
+    void startInstanceFrame(const InstanceHandle);
+
+    void setInstanceLinearVelocity(const InstanceHandle, const float3&);
+    void translateInstance(const InstanceHandle, const float3&);
+    float3 getInstancePosition(const InstanceHandle) const;
+    void   setInstancePosition(const InstanceHandle, const float3&);
+    void   setInstanceRotation(const InstanceHandle, const quat&);
+    void   setGraphicsInstancePosition(const InstanceHandle, const float3&);
+    float3 getInstanceSize(const InstanceHandle) const;
+    float3 getInstanceCenter(const InstanceHandle) const;
+
+    float3 getPhysicsBodyPosition(const InstanceHandle);
 
-    void setInstanceLinearVelocity(const InstanceID, const float3&);
-    void translateInstance(const InstanceID, const float3&);
-    float3 getInstancePosition(const InstanceID) const;
-    void   setInstancePosition(const InstanceID, const float3&);
-    void   setInstanceRotation(const InstanceID, const quat&);
-    void   setGraphicsInstancePosition(const InstanceID, const float3&);
-    float3 getInstanceSize(const InstanceID) const;
-    float3 getInstanceCenter(const InstanceID) const;
+    void updatePlayersAttachedCameras(const InstanceHandle);
 
-    float3 getPhysicsBodyPosition(const InstanceID);
+    void startAnimation(const InstanceHandle instance, const std::string& name, const bool loop, const float speedModifer);
+    void terminateAnimation(const InstanceHandle instance, const std::string& name);
 
-    void updatePlayersAttachedCameras(const InstanceID);
+    // Resolve clips once and use the handle from then on.
+    uint64_t getAnimationClipHandle(const std::string& name);
+    void startAnimationClip(const InstanceHandle instance, const uint64_t clip, const bool loop, const float speedModifer);
+    void terminateAnimationClip(const InstanceHandle instance, const uint64_t clip);
 
-    void startAnimation(const InstanceID id, const std::string& name, const bool loop, const float speedModifer);
-    void terminateAnimation(const InstanceID id, const std::string& name);
+    // Animation state graph parameters, only valid for meshes that have a graph.
+    uint32_t getAnimationParameterHandle(const InstanceHandle instance, const std::string& name);
+    void setAnimationFloatParameter(const InstanceHandle instance, const uint32_t parameter, const float value);
+    void setAnimationIntParameter(const InstanceHandle instance, const uint32_t parameter, const int value);
+    uint32_t getAnimationStateHandle(const InstanceHandle instance, const std::string& name);
+    uint32_t getCurrentAnimationState(const InstanceHandle instance);
 
-    InstanceID getInstanceIDByName(const std::string&) const;
+    InstanceHandle getInstanceHandle(const std::string&) const;
     SceneID getSceneIDByName(const std::string&) const;
 
     void setMainCameraByName(const std::string&);
     void setShadowCameraByName(const std::string&);
 
-    void createPlayerInstance(const InstanceID, const float3& pos, const float3& dir);
-    const Controller& getControllerForInstance(const InstanceID);
-    void createControllerInstance(const InstanceID, const uint32_t);
-    const Controller& updateControllerInstance(const InstanceID);
-    void attachCameraToPlayer(const InstanceID id, const std::string&, const float armatureLenght);
-    void attachShadowCameraToPlayer(const InstanceID id, const std::string&);
+    // Handle variants of the camera hooks, scripts resolve the handle once at init.
+    CameraHandle getCameraHandle(const std::string&) const;
+    void setMainCamera(const CameraHandle);
+    void setShadowCamera(const CameraHandle);
 
-    void applyImpulseToInstance(const InstanceID, const float3&);
+    void createPlayerInstance(const InstanceHandle, const float3& pos, const float3& dir);
+    const Controller& getControllerForInstance(const InstanceHandle);
+    void createControllerInstance(const InstanceHandle, const uint32_t);
+    const Controller& updateControllerInstance(const InstanceHandle);
+    void attachCameraToPlayer(const InstanceHandle instance, const std::string&, const float armatureLenght);
+    void attachShadowCameraToPlayer(const InstanceHandle instance, const std::string&);
+    void attachCameraHandleToPlayer(const InstanceHandle instance, const CameraHandle, const float armatureLenght);
+    void attachShadowCameraHandleToPlayer(const InstanceHandle instance, const CameraHandle);
+
+    void applyImpulseToInstance(const InstanceHandle, const float3&);
 
     float3 getCameraDirectionByName(const std::string&) const;
     float3 getCameraRightByName(const std::string&) const;
     float3 getCameraPositionByName(const std::string&) const;
+    float3 getCameraDirection(const CameraHandle) const;
+    float3 getCameraRight(const CameraHandle) const;
+    float3 getCameraPosition(const CameraHandle) const;
+
+    // Gameplay randomness, [min, max) and [min, max].
+    float randomFloat(const float min, const float max);
+    int randomInt(const int min, const int max);
+
+    // Records every frames controller state and delta to Recordings/<name>.trec,
+    // only replays the same if started before the level loaded.
+    void startInputRecording(const std::string& name);
+    void stopInputRecording();
+
+    // In memory snapshots of the level, both take effect at the start of the
+    // next frame. Restoring an unknown name does nothing. Loading a level
+    // throws away all snapshots.
+    void saveSnapshot(const std::string& name);
+    void restoreSnapshot(const std::string& name);
+
+    // Mirrors replicated instances to clients over udp, call before run. The
+    // client applies the servers transforms on top of its own simulation.
+    bool startReplicationServer(const uint16_t port);
+    bool connectToReplicationServer(const std::string& host, const uint16_t port);
+
+    // Server side, instances have to be added before their values are sent.
+    void replicateInstance(const InstanceHandle);
+    void setReplicatedValue(const InstanceHandle, const uint32_t slot, const int value);
+    // Client side, 0 until the server has sent it.
+    int getReplicatedValue(const InstanceHandle, const uint32_t slot) const;
+
+    // Players only see, and get sent, what's within this many 16m cells of them.
+    void setInterestRadius(const InstanceHandle, const uint32_t cells);
+    // Component scripts on instances no player is near run every frames
+    // frames, 1 or less runs them all every frame.
+    void setFarScriptInterval(const uint32_t frames);
+
+    // Copies of a player from the level file driven by bots instead of a
+    // gamepad, spawned next frame within spread metres of it.
+    void spawnBots(const std::string& templateName, const uint32_t count, const float spread);
+    // Hands a bot over to the script from then on, x and y are the left stick.
+    void setBotInput(const InstanceHandle, const float x, const float y, const bool jump, const bool sprint);
+    // Adds step bots every framesPerStep frames up to maxBots, writing frame,
+    // physics and script time percentiles for each count to
+    // Profiles/BotScaling.csv, then closes.
+    void startBotLoadTest(const std::string& templateName, const uint32_t maxBots, const uint32_t step, const uint32_t framesPerStep);
+    // Percentiles over the last 600 frames.
+    void logFrameStatistics() const;
+
+    // Caps the game loop, 0 runs as fast as the render thread allows.
+    void setFrameRateLimit(const uint32_t hz);
+    // Weight of the newest frame in the delta the systems see, 1 uses the raw delta.
+    void setDeltaSmoothing(const float weight);
+    // Frames whose work ran over the limits budget, or twice the average frame when unlimited.
+    uint32_t getHitchCount() const;
+
+    // Writes the frame system graph with last frames timings to Profiles/<name>.dot.
+    void writeSystemGraph(const std::string& name) const;
+
+    // Writes the last frameCount frames to Profiles/<name>.json at the end of this frame.
+    void captureProfile(const std::string& name, const uint32_t frameCount);
+    // Frames over the threshold get dumped to Profiles/Hitches, 0 disables.
+    void setProfilerHitchThreshold(const uint32_t milliseconds);
+
+    // Script profile reports go to Profiles/Scripts every windowFrames frames, 0 frames stops profiling.
+    void startScriptProfiling(const uint32_t windowFrames, const uint32_t instructionInterval);
+
+    // Lua heap in KB and how long the last end of frame collection took in microseconds.
+    uint32_t getScriptHeapSize() const;
+    uint32_t getScriptGarbageCollectionPause() const;
+    void setScriptGarbageCollectionBudget(const uint32_t microseconds);
+
+    // Total instructions all component scripts may use per frame, 0 is unlimited.
+    void setScriptFrameBudget(const uint32_t instructions);
+    // How many entities running this script were suspended or skipped last frame.
+    uint32_t getScriptThrottleCount(const std::string& script) const;
+
+    // Hitbox contacts between players from the last frame.
+    const HitBoxQuery& getHitBoxQuery() const
+    {
+        return *mHitBoxQuery;
+    }
 
 private:
 
+    void createSubsystems();
     void setupGraphicsState();
+    // Threads and frame systems, on the first frame.
+    void startRunning();
+    // Logs unknown handles, scripts get them from names that may not exist.
+    bool checkCamera(const CameraHandle) const;
+    // Logs and returns nullptr for handles to removed instances, hooks
+    // taking a handle from a script do nothing with a stale one.
+    const InstanceTable::Slot* resolveInstance(const InstanceHandle) const;
+    // Slot index for the component pools, InstanceTable::kInvalidIndex when stale.
+    uint32_t resolveEntity(const InstanceHandle) const;
+    void updateHitBoxes();
+    // Only between frames with physics idle.
+    void processSnapshotRequests();
+    void captureSnapshot(WorldSnapshot&);
+    void applySnapshot(const WorldSnapshot&);
+    void clearSnapshots();
+    void applyReplicatedState();
+    void updateInterest();
+    // Only between frames with physics idle.
+    void spawnPendingBots();
+    void clearBots();
+    // Deleting it directly would leave scripts with a dangling controller view.
+    void destroyBot(BotController*);
+    // Drops everything kept per entity for a removed instance.
+    void removeInstanceComponents(const InstanceHandle, const InstanceID);
+    void updateBotLoadTest();
+    // Which systems the over budget frame went on, at most once a second.
+    void logHitch();
 
     GLFWwindow* mWindow;
 
     bool mFirstFrame = true;
     bool mShouldClose = false;
 
+    FramePacer mFramePacer;
+    // Smoothed, what the systems step by.
+    std::chrono::microseconds mFrameDelta;
+    FramePacer::Clock::time_point mLastHitchLog;
+    uint32_t mUnloggedHitches;
+    // Held from waiting on the render thread until it's kicked.
+    std::unique_lock<std::mutex> mRenderLock;
+
     Level* mCurrentLevel;
 
-    std::unordered_map<InstanceID, std::unique_ptr<Player>> mPlayers;
-    std::unordered_map<InstanceID, std::unique_ptr<Controller>> mControllers;
+    // Keyed by instance table slot.
+    ComponentPool<Player> mPlayers;
+    // Owned by the input sampler.
+    ComponentPool<Controller*> mControllers;
 
     std::filesystem::path mRootDir;
     RenderEngine* mRenderEngine;
     RenderThread* mRenderThread;
+    PhysicsThread* mPhysicsThread;
+    InputSampler* mInputSampler;
     PhysicsWorld* mPhysicsEngine;
     ScriptEngine* mScriptEngine;
+    JobSystem* mJobSystem;
+    BulletTaskScheduler* mBulletScheduler;
+    bool mOwnsJobSystem;
+    AnimationSystem* mAnimationSystem;
+    HitBoxQuery* mHitBoxQuery;
+    SystemGraph* mSystemGraph;
+
+    Random mRandom;
+    InputRecorder* mInputRecorder;
+    InputReplay* mInputReplay;
+
+    std::unordered_map<std::string, WorldSnapshot*> mSnapshots;
+    std::vector<std::string> mPendingSnapshots;
+    std::string mPendingRestore;
+
+    Transport* mTransport;
+    ReplicationServer* mReplicationServer;
+    ReplicationClient* mReplicationClient;
+
+    struct BotRequest
+    {
+        std::string mTemplate;
+        uint32_t mCount;
+        float mSpread;
+    };
+
+    struct BotLoadTest
+    {
+        std::string mTemplate;
+        uint32_t mMaxBots;
+        uint32_t mStep;
+        uint32_t mFramesPerStep;
+        uint32_t mFrame;
+        std::ofstream mFile;
+    };
+
+    // Owned, keyed by instance table slot like the players.
+    ComponentPool<BotController*> mBots;
+    std::vector<BotRequest> mPendingBots;
+    BotLoadTest* mBotLoadTest;
+    // Handed out for stale handles, never updated so nothing is pressed.
+    BotController* mIdleController;
+
+    FrameStatistics mFrameStatistics;
+    uint32_t mFrameTimeChannel;
+    uint32_t mWorkTimeChannel;
+    uint32_t mPhysicsTimeChannel;
+    uint32_t mScriptTimeChannel;
+    uint32_t mScriptsSystem;
+
+    InterestGrid* mInterestGrid;
+    // Placed by scripts or snapshots this frame, physics moves come from the poses.
+    std::vector<InstanceID> mMovedInstances;
 
 };
 
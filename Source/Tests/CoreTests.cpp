@@ -0,0 +1,166 @@
+#include "Test.hpp"
+
+#include "ComponentPool.hpp"
+#include "FrameStatistics.hpp"
+#include "InstanceTable.hpp"
+
+#include <memory>
+
+namespace Tempest
+{
+
+namespace
+{
+    void testInstanceTableStaleHandles(TestState& state)
+    {
+        InstanceTable table;
+
+        const InstanceHandle first = table.create(10);
+        TEMPEST_CHECK(table.isValid(first));
+        TEMPEST_CHECK(table.get(first)->mInstance == 10);
+        TEMPEST_CHECK(table.getHandle(10) == first);
+
+        table.destroy(first);
+        TEMPEST_CHECK(!table.isValid(first));
+        TEMPEST_CHECK(table.getHandle(10) == kInvalidInstanceHandle);
+
+        // Same slot comes back with the next generation, the old handle mustn't alias it.
+        const InstanceHandle second = table.create(11);
+        TEMPEST_CHECK(InstanceTable::getIndex(second) == InstanceTable::getIndex(first));
+        TEMPEST_CHECK(InstanceTable::getGeneration(second) == InstanceTable::getGeneration(first) + 1);
+        TEMPEST_CHECK(table.isValid(second));
+        TEMPEST_CHECK(!table.isValid(first));
+        TEMPEST_CHECK(table.get(second)->mInstance == 11);
+
+        // Destroying through a stale handle does nothing.
+        table.destroy(first);
+        TEMPEST_CHECK(table.isValid(second));
+    }
+
+    void testInstanceTableInvalidHandles(TestState& state)
+    {
+        InstanceTable table;
+        TEMPEST_CHECK(!table.isValid(kInvalidInstanceHandle));
+        TEMPEST_CHECK(!table.isValid(0));
+
+        const InstanceHandle handle = table.create(1);
+        TEMPEST_CHECK(!table.isValid(handle + 1));
+
+        table.clear();
+        TEMPEST_CHECK(!table.isValid(handle));
+    }
+
+    void testComponentPoolSwapRemove(TestState& state)
+    {
+        ComponentPool<int> pool;
+        pool.emplace(3, 30);
+        pool.emplace(7, 70);
+        pool.emplace(1, 10);
+        TEMPEST_CHECK(pool.size() == 3);
+
+        // Removing the first moves the last one in to its place.
+        pool.remove(3);
+        TEMPEST_CHECK(pool.size() == 2);
+        TEMPEST_CHECK(!pool.contains(3));
+        TEMPEST_CHECK(pool.tryGet(3) == nullptr);
+        TEMPEST_CHECK(pool.getEntities()[0] == 1);
+        TEMPEST_CHECK(pool.getComponents()[0] == 10);
+        TEMPEST_CHECK(pool.get(1) == 10);
+        TEMPEST_CHECK(pool.get(7) == 70);
+
+        // Removing the last just pops it.
+        pool.remove(7);
+        TEMPEST_CHECK(pool.size() == 1);
+        TEMPEST_CHECK(pool.get(1) == 10);
+
+        // Missing entities, including past the sparse array, are ignored.
+        pool.remove(7);
+        pool.remove(1000);
+        TEMPEST_CHECK(pool.size() == 1);
+
+        pool.remove(1);
+        TEMPEST_CHECK(pool.empty());
+    }
+
+    void testComponentPoolDenseOrder(TestState& state)
+    {
+        ComponentPool<std::unique_ptr<int>> pool;
+        for(uint32_t i = 0; i < 8; ++i)
+            pool.emplace(i * 2, std::make_unique<int>(i * 2));
+
+        pool.remove(4);
+        pool.remove(10);
+        pool.emplace(4, std::make_unique<int>(4));
+        // Re-adding an existing entity replaces its component in place.
+        pool.emplace(6, std::make_unique<int>(60));
+
+        uint32_t count = 0;
+        bool matches = true;
+        pool.each([&](const uint32_t entity, const std::unique_ptr<int>& component)
+        {
+            const int expected = entity == 6 ? 60 : static_cast<int>(entity);
+            matches = matches && *component == expected && pool.get(entity).get() == component.get();
+            ++count;
+        });
+
+        TEMPEST_CHECK(count == 7);
+        TEMPEST_CHECK(matches);
+        TEMPEST_CHECK(!pool.contains(10));
+    }
+
+    void testFrameStatisticsPercentiles(TestState& state)
+    {
+        FrameStatistics statistics(100);
+        const uint32_t channel = statistics.addChannel("frame");
+
+        TEMPEST_CHECK(statistics.getPercentiles(channel).mSamples == 0);
+        TEMPEST_CHECK(statistics.getPercentiles(channel).mMax.count() == 0);
+
+        // 1..100 in reverse so sorting is actually needed.
+        for(int64_t i = 100; i > 0; --i)
+            statistics.record(channel, std::chrono::microseconds(i));
+
+        const FramePercentiles percentiles = statistics.getPercentiles(channel);
+        TEMPEST_CHECK(percentiles.mSamples == 100);
+        TEMPEST_CHECK(percentiles.mP50.count() == 50);
+        TEMPEST_CHECK(percentiles.mP90.count() == 90);
+        TEMPEST_CHECK(percentiles.mP99.count() == 99);
+        TEMPEST_CHECK(percentiles.mMax.count() == 100);
+    }
+
+    void testFrameStatisticsWindow(TestState& state)
+    {
+        FrameStatistics statistics(4);
+        const uint32_t channel = statistics.addChannel("frame");
+
+        // Only the last 4 are kept.
+        for(const int64_t sample : {1000, 1000, 1000, 10, 20, 30, 40})
+            statistics.record(channel, std::chrono::microseconds(sample));
+
+        FramePercentiles percentiles = statistics.getPercentiles(channel);
+        TEMPEST_CHECK(percentiles.mSamples == 4);
+        TEMPEST_CHECK(percentiles.mP50.count() == 20);
+        TEMPEST_CHECK(percentiles.mMax.count() == 40);
+
+        // Negative times clamp to zero, and replace the oldest two.
+        statistics.record(channel, std::chrono::microseconds(-5));
+        statistics.record(channel, std::chrono::microseconds(-5));
+        percentiles = statistics.getPercentiles(channel);
+        TEMPEST_CHECK(percentiles.mP50.count() == 0);
+        TEMPEST_CHECK(percentiles.mP90.count() == 40);
+        TEMPEST_CHECK(percentiles.mMax.count() == 40);
+
+        statistics.reset();
+        TEMPEST_CHECK(statistics.getPercentiles(channel).mSamples == 0);
+        TEMPEST_CHECK(statistics.getChannelCount() == 1);
+    }
+}
+
+TEMPEST_TEST(testInstanceTableStaleHandles)
+TEMPEST_TEST(testInstanceTableInvalidHandles)
+TEMPEST_TEST(testComponentPoolSwapRemove)
+TEMPEST_TEST(testComponentPoolDenseOrder)
+TEMPEST_TEST(testFrameStatisticsPercentiles)
+TEMPEST_TEST(testFrameStatisticsWindow)
+
+}
@@ -0,0 +1,147 @@
+#include "Test.hpp"
+
+#include "InterestGrid.hpp"
+
+#include <cmath>
+#include <random>
+#include <unordered_map>
+
+namespace Tempest
+{
+
+namespace
+{
+    void testInterestGridQueries(TestState& state)
+    {
+        InterestGrid grid(10.0f);
+        grid.addObject(1, float3{5.0f, 0.0f, 5.0f});
+        grid.addObject(2, float3{15.0f, 0.0f, 5.0f});
+        grid.addObject(3, float3{35.0f, 0.0f, 5.0f});
+        grid.addObject(4, float3{-5.0f, 0.0f, -5.0f});
+
+        TEMPEST_CHECK(!grid.isObserver(1));
+        TEMPEST_CHECK(grid.getRelevant(1) == nullptr);
+        TEMPEST_CHECK(!grid.isObserved(2));
+
+        // Radius 1 around cell (0, 0) covers -1..1 on both axes.
+        grid.addObserver(1, 1);
+        TEMPEST_CHECK(grid.isObserver(1));
+        TEMPEST_CHECK(grid.isRelevant(1, 1));
+        TEMPEST_CHECK(grid.isRelevant(1, 2));
+        TEMPEST_CHECK(!grid.isRelevant(1, 3));
+        TEMPEST_CHECK(grid.isRelevant(1, 4));
+        TEMPEST_CHECK(grid.getRelevant(1)->size() == 3);
+        TEMPEST_CHECK(grid.isObserved(2));
+        TEMPEST_CHECK(!grid.isObserved(3));
+
+        // Moving inside a cell isn't a cell change.
+        grid.moveObject(2, float3{19.0f, 0.0f, 9.0f});
+        TEMPEST_CHECK(grid.resetCellChangeCount() == 0);
+
+        grid.moveObject(3, float3{25.0f, 0.0f, 5.0f});
+        TEMPEST_CHECK(grid.resetCellChangeCount() == 1);
+        TEMPEST_CHECK(!grid.isRelevant(1, 3));
+        grid.moveObject(3, float3{15.0f, 0.0f, -5.0f});
+        TEMPEST_CHECK(grid.isRelevant(1, 3));
+
+        // The observer moving drags its window with it.
+        grid.moveObject(1, float3{45.0f, 0.0f, 5.0f});
+        TEMPEST_CHECK(!grid.isRelevant(1, 2));
+        TEMPEST_CHECK(!grid.isRelevant(1, 3));
+        TEMPEST_CHECK(!grid.isRelevant(1, 4));
+        TEMPEST_CHECK(grid.isRelevant(1, 1));
+        TEMPEST_CHECK(!grid.isObserved(4));
+
+        grid.setObserverRadius(1, 3);
+        TEMPEST_CHECK(grid.isRelevant(1, 2));
+        TEMPEST_CHECK(grid.isRelevant(1, 3));
+        TEMPEST_CHECK(!grid.isRelevant(1, 4));
+
+        grid.removeObject(2);
+        TEMPEST_CHECK(!grid.isRelevant(1, 2));
+        TEMPEST_CHECK(!grid.isObserved(2));
+
+        grid.removeObserver(1);
+        TEMPEST_CHECK(!grid.isObserver(1));
+        TEMPEST_CHECK(grid.getObservers().empty());
+        TEMPEST_CHECK(!grid.isObserved(3));
+    }
+
+    // Random moves against a brute force check of every observer window.
+    void testInterestGridMatchesBruteForce(TestState& state)
+    {
+        constexpr float kCellSize = 8.0f;
+        constexpr uint32_t kObjectCount = 200;
+        constexpr uint32_t kObserverCount = 6;
+
+        InterestGrid grid(kCellSize);
+        std::unordered_map<InstanceID, float3> positions;
+        std::unordered_map<InstanceID, int32_t> radii;
+
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+        std::uniform_real_distribution<float> step(-12.0f, 12.0f);
+        std::uniform_int_distribution<uint32_t> radius(0, 4);
+
+        for(InstanceID id = 0; id < kObjectCount; ++id)
+        {
+            positions[id] = float3{coordinate(generator), 0.0f, coordinate(generator)};
+            grid.addObject(id, positions[id]);
+        }
+
+        for(InstanceID id = 0; id < kObserverCount; ++id)
+        {
+            radii[id] = static_cast<int32_t>(radius(generator));
+            grid.addObserver(id, static_cast<uint32_t>(radii[id]));
+        }
+
+        auto cellOf = [&](const float v) { return static_cast<int32_t>(std::floor(v / kCellSize)); };
+
+        bool matches = true;
+        for(uint32_t frame = 0; frame < 50; ++frame)
+        {
+            for(auto& [id, position] : positions)
+            {
+                position.x += step(generator);
+                position.z += step(generator);
+                grid.moveObject(id, position);
+            }
+
+            if(frame % 10 == 0)
+            {
+                const InstanceID observer = frame / 10 % kObserverCount;
+                radii[observer] = static_cast<int32_t>(radius(generator));
+                grid.setObserverRadius(observer, static_cast<uint32_t>(radii[observer]));
+            }
+
+            std::unordered_map<InstanceID, uint32_t> observedBy;
+            for(const auto& [observer, observerRadius] : radii)
+            {
+                const float3& centre = positions[observer];
+                uint32_t expectedCount = 0;
+                for(const auto& [id, position] : positions)
+                {
+                    const bool expected = std::abs(cellOf(position.x) - cellOf(centre.x)) <= observerRadius &&
+                                          std::abs(cellOf(position.z) - cellOf(centre.z)) <= observerRadius;
+                    matches = matches && grid.isRelevant(observer, id) == expected;
+                    if(expected)
+                    {
+                        ++expectedCount;
+                        ++observedBy[id];
+                    }
+                }
+                matches = matches && grid.getRelevant(observer)->size() == expectedCount;
+            }
+
+            for(const auto& [id, position] : positions)
+                matches = matches && grid.isObserved(id) == (observedBy[id] > 0);
+        }
+
+        TEMPEST_CHECK(matches);
+    }
+}
+
+TEMPEST_TEST(testInterestGridQueries)
+TEMPEST_TEST(testInterestGridMatchesBruteForce)
+
+}
@@ -0,0 +1,137 @@
+#include "Test.hpp"
+
+#include "PacketStream.hpp"
+#include "Quantization.hpp"
+
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <random>
+
+namespace Tempest
+{
+
+namespace
+{
+    void testVarintRoundTrip(TestState& state)
+    {
+        const uint64_t values[] = {0, 1, 127, 128, 300, 16383, 16384, 0xFFFFFFFFull, 1ull << 63, std::numeric_limits<uint64_t>::max()};
+        const size_t sizes[] = {1, 1, 1, 2, 2, 2, 3, 5, 10, 10};
+
+        for(uint32_t i = 0; i < std::size(values); ++i)
+        {
+            std::vector<uint8_t> data;
+            PacketWriter writer(data);
+            writer.writeVarint(values[i]);
+            TEMPEST_CHECK(data.size() == sizes[i]);
+
+            PacketReader reader(data.data(), data.size());
+            TEMPEST_CHECK(reader.readVarint() == values[i]);
+            TEMPEST_CHECK(!reader.hasError());
+            TEMPEST_CHECK(reader.atEnd());
+        }
+    }
+
+    void testSignedVarintRoundTrip(TestState& state)
+    {
+        const int64_t values[] = {0, -1, 1, -64, 63, -65, 64, std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max()};
+
+        std::vector<uint8_t> data;
+        PacketWriter writer(data);
+        for(const int64_t value : values)
+            writer.writeSignedVarint(value);
+
+        PacketReader reader(data.data(), data.size());
+        for(const int64_t value : values)
+            TEMPEST_CHECK(reader.readSignedVarint() == value);
+        TEMPEST_CHECK(!reader.hasError());
+        TEMPEST_CHECK(reader.atEnd());
+
+        // Small values either side of zero stay a single byte.
+        std::vector<uint8_t> small;
+        PacketWriter smallWriter(small);
+        smallWriter.writeSignedVarint(-64);
+        smallWriter.writeSignedVarint(63);
+        TEMPEST_CHECK(small.size() == 2);
+    }
+
+    void testVarintMalformed(TestState& state)
+    {
+        // Continuation bit set on the last byte.
+        const uint8_t truncated[] = {0x80, 0x80};
+        PacketReader truncatedReader(truncated, sizeof(truncated));
+        TEMPEST_CHECK(truncatedReader.readVarint() == 0);
+        TEMPEST_CHECK(truncatedReader.hasError());
+
+        // Longer than any 64 bit value can be.
+        std::vector<uint8_t> overlong(11, 0x80);
+        overlong.back() = 0x01;
+        PacketReader overlongReader(overlong.data(), overlong.size());
+        TEMPEST_CHECK(overlongReader.readVarint() == 0);
+        TEMPEST_CHECK(overlongReader.hasError());
+    }
+
+    void testPositionQuantization(TestState& state)
+    {
+        for(const float value : {0.0f, 1.0f, -1.0f, 0.3f, -123.456f, 5000.001f})
+        {
+            const float restored = dequantizePosition(quantizePosition(value));
+            TEMPEST_CHECK(std::fabs(restored - value) <= kPositionQuantum * 0.5f + 1e-4f);
+        }
+
+        TEMPEST_CHECK(quantizePosition(kPositionQuantum * 3.0f) == 3);
+        TEMPEST_CHECK(quantizePosition(-kPositionQuantum * 3.0f) == -3);
+    }
+
+    void testRotationQuantization(TestState& state)
+    {
+        std::mt19937 generator(1234);
+        std::normal_distribution<float> distribution;
+
+        // Stored components are off by half a step at most, the rebuilt largest one
+        // picks up their error too so give it two.
+        const float tolerance = 2.0f * (2.0f * 0.70710678f / ((1u << kRotationComponentBits) - 1));
+
+        for(uint32_t i = 0; i < 1000; ++i)
+        {
+            float components[4];
+            float length = 0.0f;
+            for(float& component : components)
+            {
+                component = distribution(generator);
+                length += component * component;
+            }
+            length = std::sqrt(length);
+
+            const quat q(components[3] / length, components[0] / length, components[1] / length, components[2] / length);
+            const quat restored = unpackRotation(packRotation(q));
+
+            // q and -q are the same rotation, either is fine back.
+            const float dot = q.w * restored.w + q.x * restored.x + q.y * restored.y + q.z * restored.z;
+            const float sign = dot < 0.0f ? -1.0f : 1.0f;
+            TEMPEST_CHECK(std::fabs(dot) > 0.9995f);
+            TEMPEST_CHECK(std::fabs(q.x - restored.x * sign) <= tolerance);
+            TEMPEST_CHECK(std::fabs(q.y - restored.y * sign) <= tolerance);
+            TEMPEST_CHECK(std::fabs(q.z - restored.z * sign) <= tolerance);
+            TEMPEST_CHECK(std::fabs(q.w - restored.w * sign) <= tolerance);
+        }
+
+        // Identity, and each axis being the largest with a negative sign.
+        const quat special[] = {quat(1.0f, 0.0f, 0.0f, 0.0f), quat(0.0f, -1.0f, 0.0f, 0.0f), quat(0.0f, 0.0f, -1.0f, 0.0f),
+                                quat(0.0f, 0.0f, 0.0f, -1.0f), quat(-1.0f, 0.0f, 0.0f, 0.0f)};
+        for(const quat& q : special)
+        {
+            const quat restored = unpackRotation(packRotation(q));
+            const float dot = q.w * restored.w + q.x * restored.x + q.y * restored.y + q.z * restored.z;
+            TEMPEST_CHECK(std::fabs(dot) > 0.9999f);
+        }
+    }
+}
+
+TEMPEST_TEST(testVarintRoundTrip)
+TEMPEST_TEST(testSignedVarintRoundTrip)
+TEMPEST_TEST(testVarintMalformed)
+TEMPEST_TEST(testPositionQuantization)
+TEMPEST_TEST(testRotationQuantization)
+
+}
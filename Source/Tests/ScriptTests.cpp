@@ -0,0 +1,126 @@
+#include "Test.hpp"
+
+#include "ScriptSnapshot.hpp"
+
+namespace Tempest
+{
+
+namespace
+{
+    // Runs a chunk that should leave a boolean in the global result.
+    bool checkScript(lua_State* L, const char* source)
+    {
+        if(luaL_dostring(L, source) != LUA_OK)
+        {
+            printf("    %s\n", lua_tostring(L, -1));
+            lua_pop(L, 1);
+            return false;
+        }
+
+        lua_getglobal(L, "result");
+        const bool result = lua_toboolean(L, -1);
+        lua_pop(L, 1);
+
+        return result;
+    }
+
+    void testScriptSnapshotRoundTrip(TestState& state)
+    {
+        lua_State* L = luaL_newstate();
+        luaL_openlibs(L);
+
+        TEMPEST_CHECK(checkScript(L, R"(
+            local counter = 1
+            score = 10
+            name = "player"
+            ratio = 0.25
+            alive = true
+            position = {x = 1, y = 2, nested = {a = 1}}
+            alias = position
+            cycle = {}
+            cycle.self = cycle
+            list = {1, 2, 3}
+            tick = function() counter = counter + 1 return counter end
+            result = true
+        )"));
+
+        ScriptSnapshot snapshot;
+        snapshot.save(L);
+        TEMPEST_CHECK(snapshot.getSize() > 0);
+
+        TEMPEST_CHECK(checkScript(L, R"(
+            tick() tick()
+            score = 99
+            name = nil
+            ratio = 1
+            alive = false
+            position.x = 50
+            position.extra = 1
+            position.nested.a = 5
+            cycle.self = nil
+            list[4] = 4
+            added = 5
+            result = true
+        )"));
+
+        // Held from outside the globals to check it's refilled rather than replaced.
+        lua_getglobal(L, "position");
+        const int held = luaL_ref(L, LUA_REGISTRYINDEX);
+
+        const int top = lua_gettop(L);
+        snapshot.restore(L);
+        TEMPEST_CHECK(lua_gettop(L) == top);
+
+        lua_rawgeti(L, LUA_REGISTRYINDEX, held);
+        lua_getglobal(L, "position");
+        TEMPEST_CHECK(lua_rawequal(L, -1, -2));
+        lua_pop(L, 2);
+        luaL_unref(L, LUA_REGISTRYINDEX, held);
+
+        TEMPEST_CHECK(checkScript(L, "result = tick() == 2"));
+        TEMPEST_CHECK(checkScript(L, "result = score == 10 and name == 'player' and ratio == 0.25 and alive == true"));
+        TEMPEST_CHECK(checkScript(L, "result = position.x == 1 and position.y == 2 and position.extra == nil and position.nested.a == 1"));
+        TEMPEST_CHECK(checkScript(L, "result = alias == position"));
+        TEMPEST_CHECK(checkScript(L, "result = cycle.self == cycle"));
+        TEMPEST_CHECK(checkScript(L, "result = #list == 3 and list[3] == 3"));
+        TEMPEST_CHECK(checkScript(L, "result = added == nil"));
+
+        lua_close(L);
+    }
+
+    void testScriptSnapshotDeepNesting(TestState& state)
+    {
+        lua_State* L = luaL_newstate();
+        luaL_openlibs(L);
+
+        // Tables past the depth limit come back empty, the rest still restores.
+        TEMPEST_CHECK(checkScript(L, R"(
+            deep = {}
+            local t = deep
+            for i = 1, 64 do t.next = {} t = t.next end
+            after = 3
+            result = true
+        )"));
+
+        ScriptSnapshot snapshot;
+        snapshot.save(L);
+
+        TEMPEST_CHECK(checkScript(L, "after = 4 deep = nil result = true"));
+        snapshot.restore(L);
+
+        TEMPEST_CHECK(checkScript(L, "result = after == 3 and deep ~= nil and deep.next ~= nil"));
+        TEMPEST_CHECK(checkScript(L, R"(
+            local depth = 0
+            local t = deep
+            while t.next do t = t.next depth = depth + 1 end
+            result = depth > 0 and depth < 64
+        )"));
+
+        lua_close(L);
+    }
+}
+
+TEMPEST_TEST(testScriptSnapshotRoundTrip)
+TEMPEST_TEST(testScriptSnapshotDeepNesting)
+
+}
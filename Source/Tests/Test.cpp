@@ -0,0 +1,62 @@
+#include "Test.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace Tempest
+{
+
+namespace
+{
+    struct RegisteredTest
+    {
+        const char* mName;
+        TestFunction mFunction;
+    };
+
+    std::vector<RegisteredTest>& getRegisteredTests()
+    {
+        static std::vector<RegisteredTest> tests;
+        return tests;
+    }
+}
+
+
+TestRegistration::TestRegistration(const char* name, TestFunction function)
+{
+    getRegisteredTests().push_back({name, function});
+}
+
+
+uint32_t runTests(const std::string& filter)
+{
+    std::vector<RegisteredTest> tests = getRegisteredTests();
+    std::sort(tests.begin(), tests.end(), [](const auto& lhs, const auto& rhs) { return std::string(lhs.mName) < std::string(rhs.mName); });
+
+    uint32_t run = 0;
+    uint32_t failed = 0;
+    for(const RegisteredTest& test : tests)
+    {
+        if(!filter.empty() && std::string(test.mName).find(filter) == std::string::npos)
+            continue;
+
+        printf("%s\n", test.mName);
+
+        TestState state;
+        test.mFunction(state);
+
+        ++run;
+        if(state.getFailures() > 0)
+        {
+            printf("    FAILED (%u checks)\n", state.getFailures());
+            ++failed;
+        }
+    }
+
+    printf("%u of %u tests passed\n", run - failed, run);
+
+    return failed;
+}
+
+}
@@ -0,0 +1,61 @@
+#ifndef TEMPEST_TEST_HPP
+#define TEMPEST_TEST_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace Tempest
+{
+
+// Passed to every test, failed checks are counted rather than aborting so
+// one run reports everything that's broken.
+class TestState
+{
+public:
+    TestState() :
+        mFailures(0) {}
+
+    bool check(const bool passed, const char* expression, const char* file, const int line)
+    {
+        if(!passed)
+        {
+            printf("    %s:%d: check failed: %s\n", file, line, expression);
+            ++mFailures;
+        }
+
+        return passed;
+    }
+
+    uint32_t getFailures() const
+    {
+        return mFailures;
+    }
+
+private:
+
+    uint32_t mFailures;
+};
+
+
+using TestFunction = void(*)(TestState&);
+
+struct TestRegistration
+{
+    TestRegistration(const char* name, TestFunction);
+};
+
+// Runs every test with filter in its name, returns how many failed.
+uint32_t runTests(const std::string& filter);
+
+}
+
+#define TEMPEST_TEST_CONCAT_IMPL(A, B) A ## B
+#define TEMPEST_TEST_CONCAT(A, B) TEMPEST_TEST_CONCAT_IMPL(A, B)
+
+#define TEMPEST_TEST(F) \
+    static Tempest::TestRegistration TEMPEST_TEST_CONCAT(test_, __LINE__)(#F, &F);
+
+#define TEMPEST_CHECK(COND) state.check(static_cast<bool>(COND), #COND, __FILE__, __LINE__)
+
+#endif
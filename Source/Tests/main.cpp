@@ -0,0 +1,25 @@
+#include "Test.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+
+// TEMPEST_TESTS [--filter name]
+int main(int argc, char **argv)
+{
+    std::string filter;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if(strcmp(argv[i], "--filter") == 0 && hasValue)
+            filter = argv[++i];
+        else
+        {
+            printf("Unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    return Tempest::runTests(filter) == 0 ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+#include "WorldHost.hpp"
+#include "TempestEngine.hpp"
+#include "BulletTaskScheduler.hpp"
+#include "FrameProfiler.hpp"
+
+namespace Tempest
+{
+
+    WorldHost::WorldHost(const JobSystemSettings& jobSettings)
+    {
+        mJobSystem = new JobSystem(jobSettings);
+        mBulletScheduler = new BulletTaskScheduler(mJobSystem);
+        btSetTaskScheduler(mBulletScheduler);
+    }
+
+
+    WorldHost::~WorldHost()
+    {
+        for(TempestEngine* world : mWorlds)
+            delete world;
+
+        btSetTaskScheduler(nullptr);
+        delete mBulletScheduler;
+        delete mJobSystem;
+    }
+
+
+    TempestEngine* WorldHost::createWorld(GLFWwindow* window, const std::filesystem::path& rootDir)
+    {
+        TempestEngine* world = new TempestEngine(window, rootDir, mJobSystem);
+        mWorlds.push_back(world);
+
+        return world;
+    }
+
+
+    void WorldHost::run()
+    {
+        FrameProfiler& profiler = FrameProfiler::get();
+
+        while(!mWorlds.empty())
+        {
+            profiler.beginFrame();
+
+            for(uint32_t i = 0; i < mWorlds.size();)
+            {
+                if(mWorlds[i]->runFrame())
+                {
+                    ++i;
+                    continue;
+                }
+
+                delete mWorlds[i];
+                mWorlds.erase(mWorlds.begin() + i);
+            }
+
+            profiler.endFrame();
+        }
+    }
+
+}
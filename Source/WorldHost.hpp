@@ -0,0 +1,48 @@
+#ifndef TEMPEST_WORLD_HOST_HPP
+#define TEMPEST_WORLD_HOST_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "JobSystem.hpp"
+
+struct GLFWwindow;
+
+namespace Tempest
+{
+    class TempestEngine;
+    class BulletTaskScheduler;
+
+// Runs independent worlds in one process on one job system, and so one set
+// of bullet workers. Worlds step one after the other on the calling thread,
+// their render and physics threads and any jobs still running carry on
+// while the next world does its frame.
+class WorldHost
+{
+public:
+    WorldHost(const JobSystemSettings& jobSettings = {});
+    ~WorldHost();
+
+    // Owned by the host, set it up and load a level before calling run.
+    TempestEngine* createWorld(GLFWwindow* window, const std::filesystem::path& rootDir);
+
+    // Until every world has closed, closed worlds are destroyed straight away.
+    void run();
+
+    uint32_t getWorldCount() const
+    {
+        return static_cast<uint32_t>(mWorlds.size());
+    }
+
+private:
+
+    JobSystem* mJobSystem;
+    BulletTaskScheduler* mBulletScheduler;
+
+    std::vector<TempestEngine*> mWorlds;
+};
+
+}
+
+#endif
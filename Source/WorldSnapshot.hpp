@@ -0,0 +1,46 @@
+#ifndef TEMPEST_WORLD_SNAPSHOT_HPP
+#define TEMPEST_WORLD_SNAPSHOT_HPP
+
+#include "Engine/Scene.h"
+#include "Level.hpp"
+#include "ComponentPool.hpp"
+#include "Player.hpp"
+#include "Controller.hpp"
+#include "Random.hpp"
+#include "PhysicsWorld.hpp"
+#include "AnimationSystem.hpp"
+#include "ScriptSnapshot.hpp"
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Tempest
+{
+
+// In memory copy of everything that changes while a level plays, taken and
+// restored between frames by TempestEngine. Only covers what existing
+// instances were doing, instances added or removed since aren't undone.
+struct WorldSnapshot
+{
+    struct InstanceTransform
+    {
+        float3 mPosition;
+        quat mRotation;
+    };
+
+    std::unordered_map<InstanceID, InstanceTransform> mTransforms;
+    std::vector<std::pair<CameraHandle, Camera>> mCameras;
+    PhysicsWorld::SavedState mPhysics;
+    AnimationSystem::SavedState mAnimation;
+    // Keyed by instance table slot like the engines pool.
+    ComponentPool<Player> mPlayers;
+    // By joystick.
+    std::vector<std::pair<int, ControllerState>> mControllers;
+    ScriptSnapshot mScripts;
+    Random mRandom;
+};
+
+}
+
+#endif
@@ -6,25 +6,106 @@
 #include <glm/gtx/transform.hpp>
 
 #include "TempestEngine.hpp"
+#include "WorldHost.hpp"
+#include "ScriptCache.hpp"
+
+#include <cstdlib>
+#include <cstring>
 
 
 
 
 int main(int argc, char **argv)
 {
+    // Offline step for baked builds, compiles every script under the dir to .luac.
+    if(argc == 3 && strcmp(argv[1], "--precompile-scripts") == 0)
+    {
+        return Tempest::precompileScripts(argv[2]) == 0 ? 0 : 1;
+    }
+
     glfwInit();
 
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 
     glfwWindowHint(GLFW_RESIZABLE, GL_FALSE); // only resize explicitly
+
+    // Independent copies of the level sharing one job system, each in its own window.
+    if(argc == 4 && strcmp(argv[2], "--worlds") == 0)
+    {
+        const uint32_t worldCount = static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10));
+
+        Tempest::WorldHost host;
+        for(uint32_t i = 0; i < worldCount; ++i)
+        {
+            auto* worldWindow = glfwCreateWindow(960, 540, "Tempest", nullptr, nullptr);
+            host.createWorld(worldWindow, argv[1])->loadLevel("scene.json");
+        }
+
+        host.run();
+
+        return 0;
+    }
+
     auto* window = glfwCreateWindow(1920, 1080, "Tempest", nullptr, nullptr);
 
-    if(argc == 2)
+    if(argc >= 2)
     {
         Tempest::TempestEngine *engine = new Tempest::TempestEngine(window, argv[1]);
 
+        const char* botTemplate = nullptr;
+        uint32_t maxBots = 0;
+        uint32_t botStep = 0;
+
+        // Everything here has to happen before the level loads so the session can be replayed.
+        for(int i = 2; i < argc; ++i)
+        {
+            if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            {
+                engine->setRandomSeed(std::strtoull(argv[++i], nullptr, 10));
+            }
+            else if(strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            {
+                engine->startInputRecording(argv[++i]);
+            }
+            else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            {
+                const char* recording = argv[++i];
+                const bool fixedStep = i + 1 < argc && strcmp(argv[i + 1], "--fixed-step") == 0;
+                if(fixedStep)
+                    ++i;
+
+                if(!engine->startInputReplay(recording, fixedStep ? Tempest::ReplayTiming::Fixed : Tempest::ReplayTiming::Recorded))
+                    return 1;
+            }
+            else if(strcmp(argv[i], "--serve") == 0 && i + 1 < argc)
+            {
+                if(!engine->startReplicationServer(static_cast<uint16_t>(std::strtoul(argv[++i], nullptr, 10))))
+                    return 1;
+            }
+            else if(strcmp(argv[i], "--max-fps") == 0 && i + 1 < argc)
+            {
+                engine->setFrameRateLimit(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+            }
+            else if(strcmp(argv[i], "--bot-load-test") == 0 && i + 3 < argc)
+            {
+                botTemplate = argv[++i];
+                maxBots = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+                botStep = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if(strcmp(argv[i], "--connect") == 0 && i + 2 < argc)
+            {
+                const char* host = argv[++i];
+                if(!engine->connectToReplicationServer(host, static_cast<uint16_t>(std::strtoul(argv[++i], nullptr, 10))))
+                    return 1;
+            }
+        }
+
         engine->loadLevel("scene.json");
 
+        // Ten seconds per step at 60Hz.
+        if(botTemplate)
+            engine->startBotLoadTest(botTemplate, maxBots, botStep, 600);
+
         engine->run();
     }
     else